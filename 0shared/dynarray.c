@@ -6,6 +6,7 @@
 #include "dynarray.h"
 #include <assert.h>
 #include <stdlib.h>
+#include <string.h>
 
 /*--------------------------------------------------------------------*/
 
@@ -30,6 +31,10 @@ struct DynArray
 
    /* The array that underlies the DynArray. */
    const void **ppvArray;
+
+   /* When the array that underlies the DynArray is shrunk as
+      elements are removed. */
+   enum DynArray_ShrinkPolicy eShrinkPolicy;
 };
 
 /*--------------------------------------------------------------------*/
@@ -51,10 +56,11 @@ static int DynArray_isValid(DynArray_T oDynArray)
 
 /*--------------------------------------------------------------------*/
 
-/* Increase the physical length of oDynArray.  Return 1 (TRUE) if
-   successful and 0 (FALSE) if insufficient memory is available. */
+/* Increase the physical length of oDynArray to at least
+   uMinPhysLength, and by at least the growth factor.  Return 1 (TRUE)
+   if successful and 0 (FALSE) if insufficient memory is available. */
 
-static int DynArray_grow(DynArray_T oDynArray)
+static int DynArray_growTo(DynArray_T oDynArray, size_t uMinPhysLength)
 {
    const size_t GROWTH_FACTOR = 2;
 
@@ -64,6 +70,8 @@ static int DynArray_grow(DynArray_T oDynArray)
    assert(oDynArray != NULL);
 
    uNewLength = GROWTH_FACTOR * oDynArray->uPhysLength;
+   if (uNewLength < uMinPhysLength)
+      uNewLength = uMinPhysLength;
 
    ppvNewArray = (const void**)
       realloc(oDynArray->ppvArray, sizeof(void*) * uNewLength);
@@ -77,6 +85,66 @@ static int DynArray_grow(DynArray_T oDynArray)
 
 /*--------------------------------------------------------------------*/
 
+/* Increase the physical length of oDynArray.  Return 1 (TRUE) if
+   successful and 0 (FALSE) if insufficient memory is available. */
+
+static int DynArray_grow(DynArray_T oDynArray)
+{
+   assert(oDynArray != NULL);
+
+   return DynArray_growTo(oDynArray, oDynArray->uPhysLength + 1);
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Set the physical length of oDynArray to uNewLength, which must not
+   be less than its length or MIN_PHYS_LENGTH.  If insufficient memory
+   is available, leave oDynArray as it is. */
+
+static void DynArray_resize(DynArray_T oDynArray, size_t uNewLength)
+{
+   const void **ppvNewArray;
+
+   assert(oDynArray != NULL);
+   assert(uNewLength >= oDynArray->uLength);
+   assert(uNewLength >= MIN_PHYS_LENGTH);
+
+   ppvNewArray = (const void**)
+      realloc(oDynArray->ppvArray, sizeof(void*) * uNewLength);
+   if (ppvNewArray == NULL)
+      return;
+
+   oDynArray->uPhysLength = uNewLength;
+   oDynArray->ppvArray = ppvNewArray;
+}
+
+/*--------------------------------------------------------------------*/
+
+/* Shrink oDynArray, after elements were removed from it, as its
+   shrink policy says. */
+
+static void DynArray_shrinkIfSparse(DynArray_T oDynArray)
+{
+   size_t uNewLength;
+
+   assert(oDynArray != NULL);
+
+   if (oDynArray->eShrinkPolicy != DYNARRAY_SHRINK_QUARTER)
+      return;
+   if (oDynArray->uLength >= oDynArray->uPhysLength / 4)
+      return;
+
+   /* Leave room to grow, so that adding and removing around the
+      threshold does not reallocate every time. */
+   uNewLength = 2 * oDynArray->uLength;
+   if (uNewLength < MIN_PHYS_LENGTH)
+      uNewLength = MIN_PHYS_LENGTH;
+   if (uNewLength < oDynArray->uPhysLength)
+      DynArray_resize(oDynArray, uNewLength);
+}
+
+/*--------------------------------------------------------------------*/
+
 DynArray_T DynArray_new(size_t uLength)
 {
    DynArray_T oDynArray;
@@ -86,6 +154,7 @@ DynArray_T DynArray_new(size_t uLength)
       return NULL;
 
    oDynArray->uLength = uLength;
+   oDynArray->eShrinkPolicy = DYNARRAY_SHRINK_NEVER;
    if (uLength > MIN_PHYS_LENGTH)
       oDynArray->uPhysLength = uLength;
    else
@@ -177,8 +246,6 @@ int DynArray_add(DynArray_T oDynArray, const void *pvElement)
 int DynArray_addAt(DynArray_T oDynArray, size_t uIndex,
                    const void *pvElement)
 {
-   size_t u;
-
    assert(oDynArray != NULL);
    assert(uIndex <= oDynArray->uLength);
    assert(DynArray_isValid(oDynArray));
@@ -187,8 +254,9 @@ int DynArray_addAt(DynArray_T oDynArray, size_t uIndex,
       if (! DynArray_grow(oDynArray))
          return 0;
 
-   for (u = oDynArray->uLength; u > uIndex; u--)
-      oDynArray->ppvArray[u] = oDynArray->ppvArray[u-1];
+   memmove(&oDynArray->ppvArray[uIndex + 1],
+           &oDynArray->ppvArray[uIndex],
+           sizeof(void*) * (oDynArray->uLength - uIndex));
 
    oDynArray->ppvArray[uIndex] = pvElement;
    oDynArray->uLength++;
@@ -203,7 +271,6 @@ int DynArray_addAt(DynArray_T oDynArray, size_t uIndex,
 void *DynArray_removeAt(DynArray_T oDynArray, size_t uIndex)
 {
    const void *pvOldElement;
-   size_t u;
 
    assert(oDynArray != NULL);
    assert(uIndex < oDynArray->uLength);
@@ -213,8 +280,11 @@ void *DynArray_removeAt(DynArray_T oDynArray, size_t uIndex)
 
    oDynArray->uLength--;
 
-   for (u = uIndex; u < oDynArray->uLength; u++)
-      oDynArray->ppvArray[u] = oDynArray->ppvArray[u+1];
+   memmove(&oDynArray->ppvArray[uIndex],
+           &oDynArray->ppvArray[uIndex + 1],
+           sizeof(void*) * (oDynArray->uLength - uIndex));
+
+   DynArray_shrinkIfSparse(oDynArray);
 
    assert(DynArray_isValid(oDynArray));
 
@@ -223,6 +293,119 @@ void *DynArray_removeAt(DynArray_T oDynArray, size_t uIndex)
 
 /*--------------------------------------------------------------------*/
 
+int DynArray_addRange(DynArray_T oDynArray, size_t uIndex,
+                      const void **ppvElements, size_t uCount)
+{
+   assert(oDynArray != NULL);
+   assert(ppvElements != NULL || uCount == 0);
+   assert(uIndex <= oDynArray->uLength);
+   assert(DynArray_isValid(oDynArray));
+
+   if (oDynArray->uLength + uCount > oDynArray->uPhysLength)
+      if (! DynArray_growTo(oDynArray, oDynArray->uLength + uCount))
+         return 0;
+
+   memmove(&oDynArray->ppvArray[uIndex + uCount],
+           &oDynArray->ppvArray[uIndex],
+           sizeof(void*) * (oDynArray->uLength - uIndex));
+   if (uCount > 0)
+      memcpy(&oDynArray->ppvArray[uIndex], ppvElements,
+             sizeof(void*) * uCount);
+   oDynArray->uLength += uCount;
+
+   assert(DynArray_isValid(oDynArray));
+
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+void DynArray_removeRange(DynArray_T oDynArray, size_t uIndex,
+                          size_t uCount)
+{
+   assert(oDynArray != NULL);
+   assert(uIndex <= oDynArray->uLength);
+   assert(uCount <= oDynArray->uLength - uIndex);
+   assert(DynArray_isValid(oDynArray));
+
+   memmove(&oDynArray->ppvArray[uIndex],
+           &oDynArray->ppvArray[uIndex + uCount],
+           sizeof(void*) * (oDynArray->uLength - uIndex - uCount));
+   oDynArray->uLength -= uCount;
+
+   DynArray_shrinkIfSparse(oDynArray);
+
+   assert(DynArray_isValid(oDynArray));
+}
+
+/*--------------------------------------------------------------------*/
+
+int DynArray_reserve(DynArray_T oDynArray, size_t uPhysLength)
+{
+   const void **ppvNewArray;
+
+   assert(oDynArray != NULL);
+   assert(DynArray_isValid(oDynArray));
+
+   if (uPhysLength <= oDynArray->uPhysLength)
+      return 1;
+
+   /* Exactly as much as asked for: the client knows what is coming. */
+   ppvNewArray = (const void**)
+      realloc(oDynArray->ppvArray, sizeof(void*) * uPhysLength);
+   if (ppvNewArray == NULL)
+      return 0;
+
+   oDynArray->uPhysLength = uPhysLength;
+   oDynArray->ppvArray = ppvNewArray;
+
+   assert(DynArray_isValid(oDynArray));
+
+   return 1;
+}
+
+/*--------------------------------------------------------------------*/
+
+void DynArray_shrinkToFit(DynArray_T oDynArray)
+{
+   size_t uNewLength;
+
+   assert(oDynArray != NULL);
+   assert(DynArray_isValid(oDynArray));
+
+   uNewLength = oDynArray->uLength;
+   if (uNewLength < MIN_PHYS_LENGTH)
+      uNewLength = MIN_PHYS_LENGTH;
+   if (uNewLength < oDynArray->uPhysLength)
+      DynArray_resize(oDynArray, uNewLength);
+
+   assert(DynArray_isValid(oDynArray));
+}
+
+/*--------------------------------------------------------------------*/
+
+void DynArray_setShrinkPolicy(DynArray_T oDynArray,
+                              enum DynArray_ShrinkPolicy ePolicy)
+{
+   assert(oDynArray != NULL);
+   assert(DynArray_isValid(oDynArray));
+
+   oDynArray->eShrinkPolicy = ePolicy;
+   DynArray_shrinkIfSparse(oDynArray);
+}
+
+/*--------------------------------------------------------------------*/
+
+void **DynArray_getArray(DynArray_T oDynArray)
+{
+   assert(oDynArray != NULL);
+   assert(DynArray_isValid(oDynArray));
+
+   return (void**)oDynArray->ppvArray;
+}
+
+/*--------------------------------------------------------------------*/
+
 void DynArray_toArray(DynArray_T oDynArray, void **ppvArray)
 {
    size_t u;
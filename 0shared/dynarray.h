@@ -13,6 +13,18 @@
 
 typedef struct DynArray *DynArray_T;
 
+/* When a DynArray_T object gives memory back as elements are removed
+   from it. */
+
+enum DynArray_ShrinkPolicy
+{
+   /* Never; only DynArray_shrinkToFit shrinks it.  The default. */
+   DYNARRAY_SHRINK_NEVER,
+
+   /* Whenever it drops below a quarter full, to twice its length. */
+   DYNARRAY_SHRINK_QUARTER
+};
+
 /*--------------------------------------------------------------------*/
 
 /* Return a new DynArray_T object whose length is uLength, or
@@ -71,6 +83,58 @@ void *DynArray_removeAt(DynArray_T oDynArray, size_t uIndex);
 
 /*--------------------------------------------------------------------*/
 
+/* Add the uCount elements at ppvElements to oDynArray such that they
+   are its uIndex'th element onwards, moving the elements after them
+   once.  Return 1 (TRUE) if successful, or 0 (FALSE), leaving
+   oDynArray unchanged, if insufficient memory is available. */
+
+int DynArray_addRange(DynArray_T oDynArray, size_t uIndex,
+                      const void **ppvElements, size_t uCount);
+
+/*--------------------------------------------------------------------*/
+
+/* Remove the uCount elements of oDynArray from its uIndex'th element
+   onwards, moving the elements after them once.  The removed
+   elements are not returned; get them first if they are needed. */
+
+void DynArray_removeRange(DynArray_T oDynArray, size_t uIndex,
+                          size_t uCount);
+
+/*--------------------------------------------------------------------*/
+
+/* Make room in oDynArray for at least uPhysLength elements, so that
+   adding up to that many elements does not reallocate.  Return 1
+   (TRUE) if successful, or 0 (FALSE) if insufficient memory is
+   available. */
+
+int DynArray_reserve(DynArray_T oDynArray, size_t uPhysLength);
+
+/*--------------------------------------------------------------------*/
+
+/* Give back the memory oDynArray holds beyond its length.  If the
+   memory cannot be reallocated, leave oDynArray as it is. */
+
+void DynArray_shrinkToFit(DynArray_T oDynArray);
+
+/*--------------------------------------------------------------------*/
+
+/* Set when oDynArray gives memory back as elements are removed, and
+   apply ePolicy to it at once. */
+
+void DynArray_setShrinkPolicy(DynArray_T oDynArray,
+                              enum DynArray_ShrinkPolicy ePolicy);
+
+/*--------------------------------------------------------------------*/
+
+/* Return the array that underlies oDynArray, whose first
+   DynArray_getLength(oDynArray) elements are those of oDynArray.  It
+   is valid until elements are next added to or removed from
+   oDynArray. */
+
+void **DynArray_getArray(DynArray_T oDynArray);
+
+/*--------------------------------------------------------------------*/
+
 /* Fill ppvArray with the elements of oDynArray.  ppvArray must point
    to an area of memory that is large enough to hold all elements of
    oDynArray. */
@@ -97,6 +97,7 @@ static int Path_split(const char *pcPath, DynArray_T *poDComponents) {
       }
 
       if( DynArray_add(oDSubstrings, pcCopy) == 0) {
+         free(pcCopy);
          DynArray_map(oDSubstrings,
                       (void (*)(void*, void*)) Path_freeString, NULL);
          DynArray_free(oDSubstrings);
@@ -0,0 +1,959 @@
+/*--------------------------------------------------------------------*/
+/* art.c                                                              */
+/* Author: Will Huang and George Tziampazis                           */
+/*--------------------------------------------------------------------*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#if defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#include "art.h"
+
+/* Kinds of inner node, by the number of children they can hold */
+enum { ART_NODE4, ART_NODE16, ART_NODE48, ART_NODE256 };
+
+/* Most bytes of a compressed path stored in an inner node; the rest
+   are read from the key of any element below it */
+enum { ART_MAX_PREFIX = 10 };
+
+/* Fewest children that a node of each kind but the smallest keeps;
+   below these, it shrinks to the next smaller kind */
+enum { ART_MIN16 = 4, ART_MIN48 = 13, ART_MIN256 = 38 };
+
+/*
+  A child of an inner node is either an inner node or an element. The
+  lowest bit of the pointer to an element, which is otherwise 0, is
+  set to tell them apart.
+*/
+#define ART_IS_ELEMENT(pv) (((size_t)(pv) & 1) != 0)
+#define ART_TAG(pvElement) ((void *)((char *)(pvElement) + 1))
+#define ART_UNTAG(pv) ((void *)((char *)(pv) - 1))
+
+/* The header of an inner node */
+struct artNode {
+   /* the kind of the node */
+   unsigned char ucType;
+   /* the number of children */
+   unsigned short usChildren;
+   /* the first bytes of the compressed path: the key bytes shared by
+      all elements below that the node's ancestors do not branch on */
+   unsigned char aucPrefix[ART_MAX_PREFIX];
+   /* the length of the compressed path */
+   size_t ulPrefixLength;
+   /* the number of elements below the node */
+   size_t ulElements;
+};
+
+/* An inner node with up to 4 children, in order of key byte */
+struct artNode4 {
+   struct artNode sNode;
+   unsigned char aucKeys[4];
+   void *apvChildren[4];
+};
+
+/* An inner node with up to 16 children, in order of key byte */
+struct artNode16 {
+   struct artNode sNode;
+   unsigned char aucKeys[16];
+   void *apvChildren[16];
+};
+
+/* An inner node with up to 48 children, indexed by key byte */
+struct artNode48 {
+   struct artNode sNode;
+   /* 1 + the index in apvChildren of the child for each byte, or 0 */
+   unsigned char aucSlots[256];
+   void *apvChildren[48];
+};
+
+/* An inner node with a child slot for every key byte */
+struct artNode256 {
+   struct artNode sNode;
+   void *apvChildren[256];
+};
+
+/* The tree */
+struct art {
+   /* the root: NULL, an element or an inner node */
+   void *pvRoot;
+   /* gets an element's key, of which the first ulSkip characters are
+      ignored */
+   const char *(*pfGetKey)(const void *pvElement);
+   size_t ulSkip;
+};
+
+/* A key being looked up */
+struct artQuery {
+   /* the key's characters */
+   const char *pcKey;
+   size_t ulLength;
+   /* TRUE if the key ends with its ulLength characters, as an element
+      key does with its '\0', and FALSE if it is only a prefix */
+   boolean bWhole;
+};
+
+/* Returns the key of the element whose tagged pointer is pvTagged. */
+static const char *Art_getKey(Art_T oArt, void *pvTagged) {
+   assert(oArt != NULL);
+   assert(ART_IS_ELEMENT(pvTagged));
+
+   return (*oArt->pfGetKey)(ART_UNTAG(pvTagged)) + oArt->ulSkip;
+}
+
+/*
+  Returns byte ulDepth of the key of psQuery: its '\0' just past a
+  whole key, and -1, which sorts before every byte, past a prefix.
+*/
+static int Art_queryByte(const struct artQuery *psQuery,
+                         size_t ulDepth) {
+   assert(psQuery != NULL);
+
+   if(ulDepth < psQuery->ulLength)
+      return (unsigned char)psQuery->pcKey[ulDepth];
+   if(ulDepth == psQuery->ulLength && psQuery->bWhole)
+      return 0;
+   return -1;
+}
+
+/* Returns the number of elements at or below child pvChild. */
+static size_t Art_countElements(void *pvChild) {
+   if(ART_IS_ELEMENT(pvChild))
+      return 1;
+   return ((struct artNode *)pvChild)->ulElements;
+}
+
+/* Returns a new inner node of kind ucType, or NULL. */
+static struct artNode *Art_newNode(unsigned char ucType) {
+   struct artNode *psNode;
+   size_t ulSize;
+
+   switch(ucType) {
+      case ART_NODE4:
+         ulSize = sizeof(struct artNode4);
+         break;
+      case ART_NODE16:
+         ulSize = sizeof(struct artNode16);
+         break;
+      case ART_NODE48:
+         ulSize = sizeof(struct artNode48);
+         break;
+      default:
+         ulSize = sizeof(struct artNode256);
+         break;
+   }
+   psNode = calloc(1, ulSize);
+   if(psNode != NULL)
+      psNode->ucType = ucType;
+   return psNode;
+}
+
+/*
+  Returns the index of the child of node psNode16 for key byte ucByte,
+  comparing all its keys at once where the processor allows, or -1 if
+  it has none.
+*/
+static int Art_findKey16(const struct artNode16 *psNode16,
+                         unsigned char ucByte) {
+#if defined(__SSE2__)
+   __m128i vKeys;
+   int iMask;
+
+   assert(psNode16 != NULL);
+
+   vKeys = _mm_loadu_si128((const __m128i *)psNode16->aucKeys);
+   iMask = _mm_movemask_epi8(_mm_cmpeq_epi8(vKeys,
+                                            _mm_set1_epi8((char)ucByte)));
+   iMask &= (1 << psNode16->sNode.usChildren) - 1;
+   return iMask != 0 ? __builtin_ctz((unsigned)iMask) : -1;
+#else
+   int i;
+
+   assert(psNode16 != NULL);
+
+   for(i = 0; i < psNode16->sNode.usChildren; i++)
+      if(psNode16->aucKeys[i] == ucByte)
+         return i;
+   return -1;
+#endif
+}
+
+/*
+  Returns the number of the keys of node psNode16, which are in order,
+  that are less than iByte.
+*/
+static int Art_countLess16(const struct artNode16 *psNode16, int iByte) {
+#if defined(__SSE2__)
+   __m128i vBias;
+   __m128i vKeys;
+   int iMask;
+
+   assert(psNode16 != NULL);
+
+   if(iByte <= 0)
+      return 0;
+   if(iByte > 255)
+      return psNode16->sNode.usChildren;
+   /* compare as unsigned by moving both sides into signed range */
+   vBias = _mm_set1_epi8((char)0x80);
+   vKeys = _mm_xor_si128(_mm_loadu_si128(
+                            (const __m128i *)psNode16->aucKeys), vBias);
+   iMask = _mm_movemask_epi8(_mm_cmplt_epi8(vKeys, _mm_xor_si128(
+                                _mm_set1_epi8((char)iByte), vBias)));
+   iMask &= (1 << psNode16->sNode.usChildren) - 1;
+   return __builtin_popcount((unsigned)iMask);
+#else
+   int i;
+
+   assert(psNode16 != NULL);
+
+   for(i = 0; i < psNode16->sNode.usChildren; i++)
+      if(psNode16->aucKeys[i] >= iByte)
+         break;
+   return i;
+#endif
+}
+
+/*
+  Returns the address of the slot of the child of psNode for key byte
+  ucByte, or NULL if it has none.
+*/
+static void **Art_findChild(struct artNode *psNode, unsigned char ucByte) {
+   struct artNode4 *psNode4;
+   struct artNode48 *psNode48;
+   struct artNode256 *psNode256;
+   int i;
+
+   assert(psNode != NULL);
+
+   switch(psNode->ucType) {
+      case ART_NODE4:
+         psNode4 = (struct artNode4 *)psNode;
+         for(i = 0; i < psNode->usChildren; i++)
+            if(psNode4->aucKeys[i] == ucByte)
+               return &psNode4->apvChildren[i];
+         return NULL;
+      case ART_NODE16:
+         i = Art_findKey16((struct artNode16 *)psNode, ucByte);
+         return i < 0 ? NULL :
+            &((struct artNode16 *)psNode)->apvChildren[i];
+      case ART_NODE48:
+         psNode48 = (struct artNode48 *)psNode;
+         if(psNode48->aucSlots[ucByte] == 0)
+            return NULL;
+         return &psNode48->apvChildren[psNode48->aucSlots[ucByte] - 1];
+      default:
+         psNode256 = (struct artNode256 *)psNode;
+         if(psNode256->apvChildren[ucByte] == NULL)
+            return NULL;
+         return &psNode256->apvChildren[ucByte];
+   }
+}
+
+/*
+  Returns the number of elements below the children of psNode whose
+  key bytes are less than iByte.
+*/
+static size_t Art_countBefore(struct artNode *psNode, int iByte) {
+   struct artNode4 *psNode4;
+   struct artNode16 *psNode16;
+   struct artNode48 *psNode48;
+   struct artNode256 *psNode256;
+   size_t ulCount = 0;
+   int i, iLess;
+
+   assert(psNode != NULL);
+
+   switch(psNode->ucType) {
+      case ART_NODE4:
+         psNode4 = (struct artNode4 *)psNode;
+         for(i = 0; i < psNode->usChildren &&
+                psNode4->aucKeys[i] < iByte; i++)
+            ulCount += Art_countElements(psNode4->apvChildren[i]);
+         break;
+      case ART_NODE16:
+         psNode16 = (struct artNode16 *)psNode;
+         iLess = Art_countLess16(psNode16, iByte);
+         for(i = 0; i < iLess; i++)
+            ulCount += Art_countElements(psNode16->apvChildren[i]);
+         break;
+      case ART_NODE48:
+         psNode48 = (struct artNode48 *)psNode;
+         for(i = 0; i < iByte && i < 256; i++)
+            if(psNode48->aucSlots[i] != 0)
+               ulCount += Art_countElements(
+                  psNode48->apvChildren[psNode48->aucSlots[i] - 1]);
+         break;
+      default:
+         psNode256 = (struct artNode256 *)psNode;
+         for(i = 0; i < iByte && i < 256; i++)
+            if(psNode256->apvChildren[i] != NULL)
+               ulCount += Art_countElements(psNode256->apvChildren[i]);
+         break;
+   }
+   return ulCount;
+}
+
+/*
+  Returns the child of psNode in slot i, for i from 0 to 255, or NULL
+  if the slot is empty. The children are in the slots in order.
+*/
+static void *Art_childAt(struct artNode *psNode, int i) {
+   struct artNode48 *psNode48;
+
+   assert(psNode != NULL);
+   assert(i >= 0 && i < 256);
+
+   switch(psNode->ucType) {
+      case ART_NODE4:
+         return i < psNode->usChildren ?
+            ((struct artNode4 *)psNode)->apvChildren[i] : NULL;
+      case ART_NODE16:
+         return i < psNode->usChildren ?
+            ((struct artNode16 *)psNode)->apvChildren[i] : NULL;
+      case ART_NODE48:
+         psNode48 = (struct artNode48 *)psNode;
+         return psNode48->aucSlots[i] == 0 ? NULL :
+            psNode48->apvChildren[psNode48->aucSlots[i] - 1];
+      default:
+         return ((struct artNode256 *)psNode)->apvChildren[i];
+   }
+}
+
+/*
+  Returns the child of psNode that holds the element of rank *pulRank
+  among the elements below psNode, and sets *pulRank to its rank
+  among the elements below that child.
+*/
+static void *Art_childByRank(struct artNode *psNode, size_t *pulRank) {
+   void *pvChild;
+   size_t ulCount;
+   int i;
+
+   assert(psNode != NULL);
+   assert(pulRank != NULL);
+   assert(*pulRank < psNode->ulElements);
+
+   for(i = 0; i < 256; i++) {
+      pvChild = Art_childAt(psNode, i);
+      if(pvChild == NULL)
+         continue;
+      ulCount = Art_countElements(pvChild);
+      if(*pulRank < ulCount)
+         return pvChild;
+      *pulRank -= ulCount;
+   }
+   assert(FALSE);
+   return NULL;
+}
+
+/* Returns the tagged pointer to the first element at or below pv. */
+static void *Art_firstElement(void *pv) {
+   size_t ulRank;
+
+   while(!ART_IS_ELEMENT(pv)) {
+      ulRank = 0;
+      pv = Art_childByRank(pv, &ulRank);
+   }
+   return pv;
+}
+
+/*
+  Returns byte i of the compressed path of psNode, which is at depth
+  ulDepth, reading it from the key of an element below if it is not
+  stored.
+*/
+static int Art_prefixByte(Art_T oArt, struct artNode *psNode,
+                          size_t ulDepth, size_t i) {
+   assert(oArt != NULL);
+   assert(psNode != NULL);
+   assert(i < psNode->ulPrefixLength);
+
+   if(i < ART_MAX_PREFIX)
+      return psNode->aucPrefix[i];
+   return (unsigned char)Art_getKey(oArt,
+                            Art_firstElement(psNode))[ulDepth + i];
+}
+
+/*
+  Stores the first bytes of the compressed path of psNode, which is at
+  depth ulDepth, from the key of an element below it.
+*/
+static void Art_refillPrefix(Art_T oArt, struct artNode *psNode,
+                             size_t ulDepth) {
+   size_t ulLength;
+
+   assert(oArt != NULL);
+   assert(psNode != NULL);
+
+   ulLength = psNode->ulPrefixLength < ART_MAX_PREFIX ?
+      psNode->ulPrefixLength : ART_MAX_PREFIX;
+   memcpy(psNode->aucPrefix,
+          Art_getKey(oArt, Art_firstElement(psNode)) + ulDepth,
+          ulLength);
+}
+
+/*
+  Compares the key pcKey of an element with that of psQuery. Returns
+  <0, 0 or >0 as strcmp does.
+*/
+static int Art_compareKey(const char *pcKey,
+                          const struct artQuery *psQuery) {
+   size_t i;
+   int iByte;
+
+   assert(pcKey != NULL);
+   assert(psQuery != NULL);
+
+   for(i = 0; ; i++) {
+      iByte = Art_queryByte(psQuery, i);
+      if((unsigned char)pcKey[i] != iByte)
+         return (unsigned char)pcKey[i] < iByte ? -1 : 1;
+      if(iByte == 0)
+         return 0;
+   }
+}
+
+/*
+  Returns the number of elements of oArt whose keys sort before that
+  of psQuery, and sets *pbFound to whether one has that key.
+*/
+static size_t Art_rank(Art_T oArt, const struct artQuery *psQuery,
+                       boolean *pbFound) {
+   struct artNode *psNode;
+   void *pv;
+   void **ppvChild;
+   size_t ulRank = 0;
+   size_t ulDepth = 0;
+   size_t i;
+   int iByte, iPrefix, iCompare;
+
+   assert(oArt != NULL);
+   assert(psQuery != NULL);
+   assert(pbFound != NULL);
+
+   *pbFound = FALSE;
+   pv = oArt->pvRoot;
+   while(pv != NULL) {
+      if(ART_IS_ELEMENT(pv)) {
+         iCompare = Art_compareKey(Art_getKey(oArt, pv), psQuery);
+         *pbFound = (boolean)(iCompare == 0);
+         return ulRank + (iCompare < 0);
+      }
+      psNode = pv;
+
+      /* all keys below differ from the query the same way as their
+         shared bytes do */
+      for(i = 0; i < psNode->ulPrefixLength; i++) {
+         iPrefix = Art_prefixByte(oArt, psNode, ulDepth, i);
+         iByte = Art_queryByte(psQuery, ulDepth + i);
+         if(iByte != iPrefix)
+            return ulRank + (iByte > iPrefix ? psNode->ulElements : 0);
+      }
+      ulDepth += psNode->ulPrefixLength;
+
+      iByte = Art_queryByte(psQuery, ulDepth);
+      ulRank += Art_countBefore(psNode, iByte);
+      if(iByte < 0)
+         return ulRank;
+      ppvChild = Art_findChild(psNode, (unsigned char)iByte);
+      if(ppvChild == NULL)
+         return ulRank;
+      pv = *ppvChild;
+      ulDepth++;
+   }
+   return ulRank;
+}
+
+/*
+  Makes pvChild the child of *ppsNode for key byte ucByte, which it
+  must not have, moving the node to a bigger one if full. Returns
+  SUCCESS, or MEMORY_ERROR (leaving *ppsNode unchanged).
+*/
+static int Art_addChild(struct artNode **ppsNode, unsigned char ucByte,
+                        void *pvChild) {
+   struct artNode *psNode;
+   struct artNode *psBigger;
+   struct artNode4 *psNode4;
+   struct artNode16 *psNode16;
+   struct artNode48 *psNode48;
+   struct artNode256 *psNode256;
+   unsigned char *aucKeys;
+   void **apvChildren;
+   int i, iSlot;
+
+   assert(ppsNode != NULL);
+   assert(*ppsNode != NULL);
+   assert(Art_findChild(*ppsNode, ucByte) == NULL);
+
+   psNode = *ppsNode;
+   if((psNode->ucType == ART_NODE4 && psNode->usChildren == 4) ||
+      (psNode->ucType == ART_NODE16 && psNode->usChildren == 16) ||
+      (psNode->ucType == ART_NODE48 && psNode->usChildren == 48)) {
+      psBigger = Art_newNode((unsigned char)(psNode->ucType + 1));
+      if(psBigger == NULL)
+         return MEMORY_ERROR;
+      memcpy(psBigger->aucPrefix, psNode->aucPrefix, ART_MAX_PREFIX);
+      psBigger->ulPrefixLength = psNode->ulPrefixLength;
+      psBigger->ulElements = psNode->ulElements;
+      psBigger->usChildren = psNode->usChildren;
+
+      switch(psNode->ucType) {
+         case ART_NODE4:
+            psNode4 = (struct artNode4 *)psNode;
+            psNode16 = (struct artNode16 *)psBigger;
+            memcpy(psNode16->aucKeys, psNode4->aucKeys, 4);
+            memcpy(psNode16->apvChildren, psNode4->apvChildren,
+                   4 * sizeof(void *));
+            break;
+         case ART_NODE16:
+            psNode16 = (struct artNode16 *)psNode;
+            psNode48 = (struct artNode48 *)psBigger;
+            for(i = 0; i < 16; i++) {
+               psNode48->aucSlots[psNode16->aucKeys[i]] =
+                  (unsigned char)(i + 1);
+               psNode48->apvChildren[i] = psNode16->apvChildren[i];
+            }
+            break;
+         default:
+            psNode48 = (struct artNode48 *)psNode;
+            psNode256 = (struct artNode256 *)psBigger;
+            for(i = 0; i < 256; i++)
+               if(psNode48->aucSlots[i] != 0)
+                  psNode256->apvChildren[i] =
+                     psNode48->apvChildren[psNode48->aucSlots[i] - 1];
+            break;
+      }
+      free(psNode);
+      psNode = psBigger;
+      *ppsNode = psNode;
+   }
+
+   switch(psNode->ucType) {
+      case ART_NODE4:
+      case ART_NODE16:
+         /* the keys are few, so shifting them to stay in order is
+            cheap */
+         if(psNode->ucType == ART_NODE4) {
+            aucKeys = ((struct artNode4 *)psNode)->aucKeys;
+            apvChildren = ((struct artNode4 *)psNode)->apvChildren;
+         }
+         else {
+            aucKeys = ((struct artNode16 *)psNode)->aucKeys;
+            apvChildren = ((struct artNode16 *)psNode)->apvChildren;
+         }
+         for(i = psNode->usChildren; i > 0 && aucKeys[i - 1] > ucByte;
+             i--) {
+            aucKeys[i] = aucKeys[i - 1];
+            apvChildren[i] = apvChildren[i - 1];
+         }
+         aucKeys[i] = ucByte;
+         apvChildren[i] = pvChild;
+         break;
+      case ART_NODE48:
+         psNode48 = (struct artNode48 *)psNode;
+         for(iSlot = 0; psNode48->apvChildren[iSlot] != NULL; iSlot++)
+            ;
+         psNode48->apvChildren[iSlot] = pvChild;
+         psNode48->aucSlots[ucByte] = (unsigned char)(iSlot + 1);
+         break;
+      default:
+         ((struct artNode256 *)psNode)->apvChildren[ucByte] = pvChild;
+         break;
+   }
+   psNode->usChildren++;
+   return SUCCESS;
+}
+
+/*
+  Inserts the element whose tagged pointer is pvTagged, with key
+  pcKey, into the subtree in *ppvSlot, whose root is at depth ulDepth.
+  Returns SUCCESS, or MEMORY_ERROR (leaving the subtree unchanged).
+*/
+static int Art_insertBelow(Art_T oArt, void **ppvSlot, size_t ulDepth,
+                           void *pvTagged, const char *pcKey) {
+   struct artNode *psNode;
+   struct artNode *psNew;
+   const char *pcOther;
+   void **ppvChild;
+   size_t i;
+   int iStatus;
+   int iPrefix = 0;
+
+   assert(oArt != NULL);
+   assert(ppvSlot != NULL);
+   assert(pcKey != NULL);
+
+   if(*ppvSlot == NULL) {
+      *ppvSlot = pvTagged;
+      return SUCCESS;
+   }
+
+   if(ART_IS_ELEMENT(*ppvSlot)) {
+      /* the two keys become the children of a node branching where
+         they first differ, with the bytes before as its path */
+      pcOther = Art_getKey(oArt, *ppvSlot);
+      for(i = 0; pcOther[ulDepth + i] == pcKey[ulDepth + i]; i++)
+         assert(pcKey[ulDepth + i] != '\0');
+      psNew = Art_newNode(ART_NODE4);
+      if(psNew == NULL)
+         return MEMORY_ERROR;
+      psNew->ulPrefixLength = i;
+      memcpy(psNew->aucPrefix, pcKey + ulDepth,
+             i < ART_MAX_PREFIX ? i : ART_MAX_PREFIX);
+      (void)Art_addChild(&psNew, (unsigned char)pcOther[ulDepth + i],
+                         *ppvSlot);
+      (void)Art_addChild(&psNew, (unsigned char)pcKey[ulDepth + i],
+                         pvTagged);
+      psNew->ulElements = 2;
+      *ppvSlot = psNew;
+      return SUCCESS;
+   }
+
+   psNode = *ppvSlot;
+   for(i = 0; i < psNode->ulPrefixLength; i++) {
+      iPrefix = Art_prefixByte(oArt, psNode, ulDepth, i);
+      if(iPrefix != (unsigned char)pcKey[ulDepth + i])
+         break;
+   }
+   if(i < psNode->ulPrefixLength) {
+      /* the key leaves the compressed path: split it there */
+      psNew = Art_newNode(ART_NODE4);
+      if(psNew == NULL)
+         return MEMORY_ERROR;
+      psNew->ulPrefixLength = i;
+      memcpy(psNew->aucPrefix, pcKey + ulDepth,
+             i < ART_MAX_PREFIX ? i : ART_MAX_PREFIX);
+      psNode->ulPrefixLength -= i + 1;
+      Art_refillPrefix(oArt, psNode, ulDepth + i + 1);
+      (void)Art_addChild(&psNew, (unsigned char)iPrefix, psNode);
+      (void)Art_addChild(&psNew, (unsigned char)pcKey[ulDepth + i],
+                         pvTagged);
+      psNew->ulElements = psNode->ulElements + 1;
+      *ppvSlot = psNew;
+      return SUCCESS;
+   }
+   ulDepth += psNode->ulPrefixLength;
+
+   ppvChild = Art_findChild(psNode, (unsigned char)pcKey[ulDepth]);
+   if(ppvChild != NULL)
+      iStatus = Art_insertBelow(oArt, ppvChild, ulDepth + 1, pvTagged,
+                                pcKey);
+   else
+      iStatus = Art_addChild((struct artNode **)ppvSlot,
+                             (unsigned char)pcKey[ulDepth], pvTagged);
+   if(iStatus == SUCCESS)
+      ((struct artNode *)*ppvSlot)->ulElements++;
+   return iStatus;
+}
+
+/* Removes the child of psNode for key byte ucByte, which it has. */
+static void Art_removeChild(struct artNode *psNode, unsigned char ucByte) {
+   struct artNode48 *psNode48;
+   unsigned char *aucKeys;
+   void **apvChildren;
+   int i;
+
+   assert(psNode != NULL);
+   assert(Art_findChild(psNode, ucByte) != NULL);
+
+   switch(psNode->ucType) {
+      case ART_NODE4:
+      case ART_NODE16:
+         if(psNode->ucType == ART_NODE4) {
+            aucKeys = ((struct artNode4 *)psNode)->aucKeys;
+            apvChildren = ((struct artNode4 *)psNode)->apvChildren;
+         }
+         else {
+            aucKeys = ((struct artNode16 *)psNode)->aucKeys;
+            apvChildren = ((struct artNode16 *)psNode)->apvChildren;
+         }
+         for(i = 0; aucKeys[i] != ucByte; i++)
+            ;
+         for(; i + 1 < psNode->usChildren; i++) {
+            aucKeys[i] = aucKeys[i + 1];
+            apvChildren[i] = apvChildren[i + 1];
+         }
+         break;
+      case ART_NODE48:
+         psNode48 = (struct artNode48 *)psNode;
+         psNode48->apvChildren[psNode48->aucSlots[ucByte] - 1] = NULL;
+         psNode48->aucSlots[ucByte] = 0;
+         break;
+      default:
+         ((struct artNode256 *)psNode)->apvChildren[ucByte] = NULL;
+         break;
+   }
+   psNode->usChildren--;
+}
+
+/*
+  Moves the inner node in *ppvSlot, at depth ulDepth, which has just
+  lost a child, to a smaller one if it has become sparse, or replaces
+  it by its only child, whose compressed path takes in the node's.
+  Keeps the node as it is if memory could not be allocated.
+*/
+static void Art_shrink(Art_T oArt, void **ppvSlot, size_t ulDepth) {
+   struct artNode *psNode;
+   struct artNode *psSmaller;
+   struct artNode16 *psNode16;
+   struct artNode48 *psNode48;
+   struct artNode256 *psNode256;
+   void *pvChild;
+   size_t ulRank = 0;
+   int i, iCount;
+
+   assert(oArt != NULL);
+   assert(ppvSlot != NULL);
+
+   psNode = *ppvSlot;
+   if(psNode->ucType == ART_NODE4) {
+      if(psNode->usChildren != 1)
+         return;
+      pvChild = Art_childByRank(psNode, &ulRank);
+      if(!ART_IS_ELEMENT(pvChild)) {
+         ((struct artNode *)pvChild)->ulPrefixLength +=
+            psNode->ulPrefixLength + 1;
+         Art_refillPrefix(oArt, pvChild, ulDepth);
+      }
+      *ppvSlot = pvChild;
+      free(psNode);
+      return;
+   }
+
+   if((psNode->ucType == ART_NODE16 && psNode->usChildren >= ART_MIN16)
+      || (psNode->ucType == ART_NODE48 &&
+          psNode->usChildren >= ART_MIN48) ||
+      (psNode->ucType == ART_NODE256 &&
+       psNode->usChildren >= ART_MIN256))
+      return;
+
+   psSmaller = Art_newNode((unsigned char)(psNode->ucType - 1));
+   if(psSmaller == NULL)
+      return;
+   memcpy(psSmaller->aucPrefix, psNode->aucPrefix, ART_MAX_PREFIX);
+   psSmaller->ulPrefixLength = psNode->ulPrefixLength;
+   psSmaller->ulElements = psNode->ulElements;
+   psSmaller->usChildren = psNode->usChildren;
+
+   switch(psNode->ucType) {
+      case ART_NODE16:
+         psNode16 = (struct artNode16 *)psNode;
+         memcpy(((struct artNode4 *)psSmaller)->aucKeys,
+                psNode16->aucKeys, psNode->usChildren);
+         memcpy(((struct artNode4 *)psSmaller)->apvChildren,
+                psNode16->apvChildren,
+                psNode->usChildren * sizeof(void *));
+         break;
+      case ART_NODE48:
+         psNode48 = (struct artNode48 *)psNode;
+         psNode16 = (struct artNode16 *)psSmaller;
+         for(i = 0, iCount = 0; i < 256; i++) {
+            if(psNode48->aucSlots[i] == 0)
+               continue;
+            psNode16->aucKeys[iCount] = (unsigned char)i;
+            psNode16->apvChildren[iCount++] =
+               psNode48->apvChildren[psNode48->aucSlots[i] - 1];
+         }
+         break;
+      default:
+         psNode256 = (struct artNode256 *)psNode;
+         psNode48 = (struct artNode48 *)psSmaller;
+         for(i = 0, iCount = 0; i < 256; i++) {
+            if(psNode256->apvChildren[i] == NULL)
+               continue;
+            psNode48->apvChildren[iCount] = psNode256->apvChildren[i];
+            psNode48->aucSlots[i] = (unsigned char)++iCount;
+         }
+         break;
+   }
+   free(psNode);
+   *ppvSlot = psSmaller;
+}
+
+/*
+  Removes the element with key pcKey, which must be there, from the
+  subtree in *ppvSlot, whose root is at depth ulDepth, and returns its
+  tagged pointer.
+*/
+static void *Art_removeBelow(Art_T oArt, void **ppvSlot, size_t ulDepth,
+                             const char *pcKey) {
+   struct artNode *psNode;
+   void **ppvChild;
+   void *pvTagged;
+   unsigned char ucByte;
+
+   assert(oArt != NULL);
+   assert(ppvSlot != NULL);
+   assert(*ppvSlot != NULL);
+   assert(pcKey != NULL);
+
+   if(ART_IS_ELEMENT(*ppvSlot)) {
+      assert(strcmp(Art_getKey(oArt, *ppvSlot), pcKey) == 0);
+      pvTagged = *ppvSlot;
+      *ppvSlot = NULL;
+      return pvTagged;
+   }
+
+   psNode = *ppvSlot;
+   ucByte = (unsigned char)pcKey[ulDepth + psNode->ulPrefixLength];
+   ppvChild = Art_findChild(psNode, ucByte);
+   assert(ppvChild != NULL);
+
+   psNode->ulElements--;
+   if(ART_IS_ELEMENT(*ppvChild)) {
+      pvTagged = *ppvChild;
+      Art_removeChild(psNode, ucByte);
+      Art_shrink(oArt, ppvSlot, ulDepth);
+      return pvTagged;
+   }
+   return Art_removeBelow(oArt, ppvChild,
+                          ulDepth + psNode->ulPrefixLength + 1, pcKey);
+}
+
+/* Frees the inner nodes at and below pv. */
+static void Art_freeBelow(void *pv) {
+   struct artNode *psNode;
+   int i;
+
+   if(pv == NULL || ART_IS_ELEMENT(pv))
+      return;
+   psNode = pv;
+   for(i = 0; i < 256; i++)
+      Art_freeBelow(Art_childAt(psNode, i));
+   free(psNode);
+}
+
+/*
+  Applies *pfApply to the elements at and below pv in order, as
+  Art_map does.
+*/
+static void Art_mapBelow(void *pv,
+                         void (*pfApply)(void *pvElement, void *pvExtra),
+                         const void *pvExtra) {
+   struct artNode *psNode;
+   void *pvChild;
+   int i;
+
+   if(ART_IS_ELEMENT(pv)) {
+      (*pfApply)(ART_UNTAG(pv), (void *)pvExtra);
+      return;
+   }
+   psNode = pv;
+   for(i = 0; i < 256; i++) {
+      pvChild = Art_childAt(psNode, i);
+      if(pvChild != NULL)
+         Art_mapBelow(pvChild, pfApply, pvExtra);
+   }
+}
+
+/* ================================================================== */
+Art_T Art_new(const char *(*pfGetKey)(const void *pvElement),
+              size_t ulSkip) {
+   Art_T oArt;
+
+   assert(pfGetKey != NULL);
+
+   oArt = malloc(sizeof(struct art));
+   if(oArt == NULL)
+      return NULL;
+   oArt->pvRoot = NULL;
+   oArt->pfGetKey = pfGetKey;
+   oArt->ulSkip = ulSkip;
+   return oArt;
+}
+
+/* ================================================================== */
+void Art_free(Art_T oArt) {
+   if(oArt == NULL)
+      return;
+   Art_freeBelow(oArt->pvRoot);
+   free(oArt);
+}
+
+/* ================================================================== */
+size_t Art_getLength(Art_T oArt) {
+   assert(oArt != NULL);
+
+   if(oArt->pvRoot == NULL)
+      return 0;
+   return Art_countElements(oArt->pvRoot);
+}
+
+/* ================================================================== */
+void *Art_get(Art_T oArt, size_t ulRank) {
+   void *pv;
+
+   assert(oArt != NULL);
+   assert(ulRank < Art_getLength(oArt));
+
+   pv = oArt->pvRoot;
+   while(!ART_IS_ELEMENT(pv))
+      pv = Art_childByRank(pv, &ulRank);
+   return ART_UNTAG(pv);
+}
+
+/* ================================================================== */
+boolean Art_search(Art_T oArt, const char *pcKey, size_t ulLength,
+                   size_t *pulRank) {
+   struct artQuery sQuery;
+   boolean bFound;
+
+   assert(oArt != NULL);
+   assert(pcKey != NULL);
+   assert(pulRank != NULL);
+
+   sQuery.pcKey = pcKey;
+   sQuery.ulLength = ulLength;
+   sQuery.bWhole = TRUE;
+   *pulRank = Art_rank(oArt, &sQuery, &bFound);
+   return bFound;
+}
+
+/* ================================================================== */
+size_t Art_seek(Art_T oArt, const char *pcPrefix, size_t ulLength) {
+   struct artQuery sQuery;
+   boolean bFound;
+
+   assert(oArt != NULL);
+   assert(pcPrefix != NULL);
+
+   sQuery.pcKey = pcPrefix;
+   sQuery.ulLength = ulLength;
+   sQuery.bWhole = FALSE;
+   return Art_rank(oArt, &sQuery, &bFound);
+}
+
+/* ================================================================== */
+int Art_insert(Art_T oArt, void *pvElement) {
+   assert(oArt != NULL);
+   assert(pvElement != NULL);
+   assert(!ART_IS_ELEMENT(pvElement));
+
+   return Art_insertBelow(oArt, &oArt->pvRoot, 0, ART_TAG(pvElement),
+                          (*oArt->pfGetKey)(pvElement) + oArt->ulSkip);
+}
+
+/* ================================================================== */
+void *Art_removeAt(Art_T oArt, size_t ulRank) {
+   void *pvElement;
+
+   assert(oArt != NULL);
+   assert(ulRank < Art_getLength(oArt));
+
+   pvElement = Art_get(oArt, ulRank);
+   return ART_UNTAG(Art_removeBelow(oArt, &oArt->pvRoot, 0,
+                       (*oArt->pfGetKey)(pvElement) + oArt->ulSkip));
+}
+
+/* ================================================================== */
+void Art_map(Art_T oArt,
+             void (*pfApply)(void *pvElement, void *pvExtra),
+             const void *pvExtra) {
+   assert(oArt != NULL);
+   assert(pfApply != NULL);
+
+   if(oArt->pvRoot != NULL)
+      Art_mapBelow(oArt->pvRoot, pfApply, pvExtra);
+}
@@ -0,0 +1,85 @@
+/*--------------------------------------------------------------------*/
+/* art.h                                                              */
+/* Author: Will Huang and George Tziampazis                           */
+/*--------------------------------------------------------------------*/
+
+#ifndef ART_INCLUDED
+#define ART_INCLUDED
+
+#include <stddef.h>
+#include "a4def.h"
+
+/*
+  An Art_T is a set of elements ordered by string keys, kept in an
+  adaptive radix tree: inner nodes branch on one key byte each, grow
+  and shrink among capacities of 4, 16, 48 and 256 children, and
+  store the bytes shared by all keys below them once. Lookups and
+  updates take time proportional to the key's length, and no element
+  is ever moved. Each inner node counts the elements below it, so
+  that elements can also be got by rank, their position in order.
+  Elements must be pointers to objects aligned to at least 2 bytes,
+  such as those allocated by malloc.
+*/
+typedef struct art *Art_T;
+
+/*
+  Returns a new, empty Art_T whose elements are keyed by the strings
+  (*pfGetKey)(pvElement) returns, less their first ulSkip characters,
+  or NULL if memory could not be allocated. The keys must not change
+  while their elements are in the set, and keys are ordered as by
+  strcmp.
+*/
+Art_T Art_new(const char *(*pfGetKey)(const void *pvElement),
+              size_t ulSkip);
+
+/* Frees oArt, but not its elements. */
+void Art_free(Art_T oArt);
+
+/* Returns the number of elements in oArt. */
+size_t Art_getLength(Art_T oArt);
+
+/*
+  Returns the element of oArt with rank ulRank, which must be less
+  than Art_getLength(oArt).
+*/
+void *Art_get(Art_T oArt, size_t ulRank);
+
+/*
+  Returns TRUE if oArt has an element whose key is the ulLength
+  characters at pcKey, and FALSE if not. Sets *pulRank to the rank of
+  that element, or that such an element would have if inserted.
+*/
+boolean Art_search(Art_T oArt, const char *pcKey, size_t ulLength,
+                   size_t *pulRank);
+
+/*
+  Returns the rank of the first element of oArt whose key does not
+  sort before the ulLength characters at pcPrefix, or the number of
+  elements if there is none. The elements whose keys start with those
+  characters follow it, one after another.
+*/
+size_t Art_seek(Art_T oArt, const char *pcPrefix, size_t ulLength);
+
+/*
+  Inserts pvElement, whose key must not be that of an element
+  already in oArt. Returns SUCCESS, or MEMORY_ERROR (leaving oArt
+  unchanged) if memory could not be allocated.
+*/
+int Art_insert(Art_T oArt, void *pvElement);
+
+/*
+  Removes the element of oArt with rank ulRank, which must be less
+  than Art_getLength(oArt), and returns it. Cannot fail: nodes are
+  only shrunk if memory can be allocated for the smaller ones.
+*/
+void *Art_removeAt(Art_T oArt, size_t ulRank);
+
+/*
+  Applies function *pfApply to each element of oArt in order, passing
+  pvExtra as an extra argument.
+*/
+void Art_map(Art_T oArt,
+             void (*pfApply)(void *pvElement, void *pvExtra),
+             const void *pvExtra);
+
+#endif
@@ -0,0 +1,312 @@
+/*--------------------------------------------------------------------*/
+/* backing.c                                                          */
+/* Author: Will Huang and George Tziampazis                           */
+/*--------------------------------------------------------------------*/
+
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include "backing.h"
+
+/* Largest range of address space reserved for the mapping */
+#define MAX_RESERVE ((size_t)1 << 40)
+/* Smallest range of address space worth reserving */
+#define MIN_RESERVE ((size_t)1 << 28)
+/* Name of the backing file within the temporary directory */
+#define FILE_TEMPLATE "/ftbackXXXXXX"
+
+/* A free extent of the backing file */
+struct freeExtent {
+   /* offset of the extent in the file */
+   size_t ulOffset;
+   /* length of the extent in bytes */
+   size_t ulLength;
+   /* next free extent, in increasing order of offset */
+   struct freeExtent *psNext;
+};
+
+/* Descriptor of the backing file, or -1 if there is none */
+static int iFd = -1;
+/* Start of the reserved address range the file is mapped into */
+static char *pcBase;
+/* Length of the reserved address range */
+static size_t ulReserve;
+/* Length of the backing file */
+static size_t ulFileSize;
+/* Total length of the allocated extents */
+static size_t ulLiveBytes;
+/* Free extents of the file, in increasing order of offset */
+static struct freeExtent *psFreeList;
+
+/* Returns ulLength rounded up to a whole number of pages. */
+static size_t Backing_roundUp(size_t ulLength) {
+   size_t ulPage = (size_t)sysconf(_SC_PAGESIZE);
+
+   return (ulLength + ulPage - 1) / ulPage * ulPage;
+}
+
+/*
+  Creates the backing file in the temporary directory, unlinking it at
+  once so that it disappears with the process, and reserves address
+  space to map it into. Returns SUCCESS or MEMORY_ERROR.
+*/
+static int Backing_open(void) {
+   const char *pcDir;
+   char *pcName;
+   void *pvReserve;
+
+   pcDir = getenv("TMPDIR");
+   if(pcDir == NULL || *pcDir == '\0')
+      pcDir = "/tmp";
+
+   pcName = malloc(strlen(pcDir) + sizeof(FILE_TEMPLATE));
+   if(pcName == NULL)
+      return MEMORY_ERROR;
+   strcpy(pcName, pcDir);
+   strcat(pcName, FILE_TEMPLATE);
+
+   iFd = mkstemp(pcName);
+   if(iFd < 0) {
+      free(pcName);
+      return MEMORY_ERROR;
+   }
+   (void)unlink(pcName);
+   free(pcName);
+
+   /* reserve as much address space as the system allows, up to
+      MAX_RESERVE */
+   ulReserve = MAX_RESERVE;
+   for(;;) {
+      pvReserve = mmap(NULL, ulReserve, PROT_NONE,
+                       MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE,
+                       -1, 0);
+      if(pvReserve != MAP_FAILED)
+         break;
+      ulReserve /= 2;
+      if(ulReserve < MIN_RESERVE) {
+         (void)close(iFd);
+         iFd = -1;
+         return MEMORY_ERROR;
+      }
+   }
+
+   pcBase = pvReserve;
+   ulFileSize = 0;
+   return SUCCESS;
+}
+
+/*
+  Shortens the backing file to ulNewSize bytes, returning the address
+  space past it to the reservation.
+*/
+static void Backing_truncate(size_t ulNewSize) {
+   assert(ulNewSize <= ulFileSize);
+
+   if(ulNewSize == ulFileSize)
+      return;
+
+   (void)mmap(pcBase + ulNewSize, ulFileSize - ulNewSize, PROT_NONE,
+              MAP_PRIVATE | MAP_ANONYMOUS | MAP_NORESERVE | MAP_FIXED,
+              -1, 0);
+   (void)ftruncate(iFd, (off_t)ulNewSize);
+   ulFileSize = ulNewSize;
+}
+
+/*
+  Takes ulCapacity bytes from the first free extent that starts before
+  ulLimit and is big enough. Returns 1 (TRUE) and sets *pulOffset to
+  the bytes' offset if there is such an extent, or returns 0 (FALSE).
+*/
+static int Backing_takeFree(size_t ulCapacity, size_t ulLimit,
+                            size_t *pulOffset) {
+   struct freeExtent **ppsLink;
+   struct freeExtent *psFree;
+
+   assert(pulOffset != NULL);
+
+   for(ppsLink = &psFreeList; *ppsLink != NULL;
+       ppsLink = &(*ppsLink)->psNext) {
+      psFree = *ppsLink;
+      if(psFree->ulOffset >= ulLimit)
+         return 0;
+      if(psFree->ulLength < ulCapacity)
+         continue;
+
+      *pulOffset = psFree->ulOffset;
+      if(psFree->ulLength == ulCapacity) {
+         *ppsLink = psFree->psNext;
+         free(psFree);
+      }
+      else {
+         psFree->ulOffset += ulCapacity;
+         psFree->ulLength -= ulCapacity;
+      }
+      return 1;
+   }
+   return 0;
+}
+
+/* ================================================================== */
+int Backing_alloc(size_t ulLength, size_t *pulOffset,
+                  size_t *pulCapacity) {
+   size_t ulCapacity;
+   size_t ulOffset;
+   void *pvMapped;
+   int iStatus;
+
+   assert(ulLength > 0);
+   assert(pulOffset != NULL);
+   assert(pulCapacity != NULL);
+
+   if(iFd < 0) {
+      iStatus = Backing_open();
+      if(iStatus != SUCCESS)
+         return iStatus;
+   }
+
+   ulCapacity = Backing_roundUp(ulLength);
+   if(ulCapacity < ulLength)
+      return MEMORY_ERROR;
+
+   /* reuse a free extent if one is big enough */
+   if(!Backing_takeFree(ulCapacity, ulFileSize, &ulOffset)) {
+      /* otherwise extend the file and map the new part */
+      ulOffset = ulFileSize;
+      if(ulCapacity > ulReserve - ulFileSize)
+         return MEMORY_ERROR;
+      if(ftruncate(iFd, (off_t)(ulFileSize + ulCapacity)) != 0)
+         return MEMORY_ERROR;
+      pvMapped = mmap(pcBase + ulOffset, ulCapacity,
+                      PROT_READ | PROT_WRITE, MAP_SHARED | MAP_FIXED,
+                      iFd, (off_t)ulOffset);
+      if(pvMapped == MAP_FAILED) {
+         (void)ftruncate(iFd, (off_t)ulFileSize);
+         return MEMORY_ERROR;
+      }
+      ulFileSize += ulCapacity;
+   }
+
+   ulLiveBytes += ulCapacity;
+   *pulOffset = ulOffset;
+   *pulCapacity = ulCapacity;
+   return SUCCESS;
+}
+
+/* ================================================================== */
+void Backing_free(size_t ulOffset, size_t ulCapacity) {
+   struct freeExtent **ppsLink;
+   struct freeExtent *psPrev = NULL;
+   struct freeExtent *psNext;
+   struct freeExtent *psNew;
+
+   assert(iFd >= 0);
+   assert(ulOffset + ulCapacity <= ulFileSize);
+   assert(ulLiveBytes >= ulCapacity);
+
+   ulLiveBytes -= ulCapacity;
+
+   /* give the disk blocks back at once; the pages now read as zero */
+   (void)fallocate(iFd, FALLOC_FL_PUNCH_HOLE | FALLOC_FL_KEEP_SIZE,
+                   (off_t)ulOffset, (off_t)ulCapacity);
+
+   /* find the neighbours of the extent in the free list */
+   ppsLink = &psFreeList;
+   while(*ppsLink != NULL && (*ppsLink)->ulOffset < ulOffset) {
+      psPrev = *ppsLink;
+      ppsLink = &(*ppsLink)->psNext;
+   }
+   psNext = *ppsLink;
+
+   /* merge with the previous and/or next free extent if adjacent */
+   if(psPrev != NULL && psPrev->ulOffset + psPrev->ulLength == ulOffset)
+      psPrev->ulLength += ulCapacity;
+   else {
+      psNew = malloc(sizeof(struct freeExtent));
+      /* without a list node the extent is simply never reused */
+      if(psNew == NULL)
+         return;
+      psNew->ulOffset = ulOffset;
+      psNew->ulLength = ulCapacity;
+      psNew->psNext = psNext;
+      *ppsLink = psNew;
+      psPrev = psNew;
+   }
+   if(psNext != NULL &&
+      psPrev->ulOffset + psPrev->ulLength == psNext->ulOffset) {
+      psPrev->ulLength += psNext->ulLength;
+      psPrev->psNext = psNext->psNext;
+      free(psNext);
+   }
+
+   /* free space at the end of the file is cut off */
+   if(psPrev->psNext == NULL &&
+      psPrev->ulOffset + psPrev->ulLength == ulFileSize) {
+      Backing_truncate(psPrev->ulOffset);
+      ppsLink = &psFreeList;
+      while(*ppsLink != psPrev)
+         ppsLink = &(*ppsLink)->psNext;
+      *ppsLink = NULL;
+      free(psPrev);
+   }
+}
+
+/* ================================================================== */
+void *Backing_getAddress(size_t ulOffset) {
+   assert(iFd >= 0);
+   assert(ulOffset < ulFileSize);
+
+   return pcBase + ulOffset;
+}
+
+/* ================================================================== */
+size_t Backing_relocate(size_t ulOffset, size_t ulCapacity) {
+   size_t ulNewOffset;
+
+   assert(iFd >= 0);
+   assert(ulOffset + ulCapacity <= ulFileSize);
+
+   if(!Backing_takeFree(ulCapacity, ulOffset, &ulNewOffset))
+      return ulOffset;
+
+   ulLiveBytes += ulCapacity;
+   memcpy(pcBase + ulNewOffset, pcBase + ulOffset, ulCapacity);
+   Backing_free(ulOffset, ulCapacity);
+   return ulNewOffset;
+}
+
+/* ================================================================== */
+void Backing_getStats(size_t *pulFileBytes, size_t *pulLiveBytes) {
+   assert(pulFileBytes != NULL);
+   assert(pulLiveBytes != NULL);
+
+   *pulFileBytes = ulFileSize;
+   *pulLiveBytes = ulLiveBytes;
+}
+
+/* ================================================================== */
+void Backing_reset(void) {
+   struct freeExtent *psNext;
+
+   assert(ulLiveBytes == 0);
+
+   if(iFd < 0)
+      return;
+
+   (void)munmap(pcBase, ulReserve);
+   (void)close(iFd);
+   iFd = -1;
+   pcBase = NULL;
+   ulReserve = 0;
+   ulFileSize = 0;
+
+   while(psFreeList != NULL) {
+      psNext = psFreeList->psNext;
+      free(psFreeList);
+      psFreeList = psNext;
+   }
+}
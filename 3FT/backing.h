@@ -0,0 +1,63 @@
+/*--------------------------------------------------------------------*/
+/* backing.h                                                          */
+/* Author: Will Huang and George Tziampazis                           */
+/*--------------------------------------------------------------------*/
+
+#ifndef BACKING_INCLUDED
+#define BACKING_INCLUDED
+
+#include <stddef.h>
+#include "a4def.h"
+
+/*
+  The backing file is an unlinked temporary file that holds file
+  contents too big to keep on the heap. The whole file is mapped into
+  one reserved range of address space, so an extent at a given offset
+  always has the same address and pages in on demand. Extents are
+  whole pages. Freed extents are reused first-fit, their disk blocks
+  are released at once by punching holes, and free space at the end of
+  the file is truncated away.
+*/
+
+/*
+  Allocates an extent of at least ulLength bytes (ulLength must be
+  > 0), creating the backing file if there is none yet. Returns an int
+  SUCCESS status and sets *pulOffset to the extent's offset in the
+  file and *pulCapacity to its usable size. Otherwise, returns status:
+  * MEMORY_ERROR if the file or address space could not be extended
+*/
+int Backing_alloc(size_t ulLength, size_t *pulOffset,
+                  size_t *pulCapacity);
+
+/*
+  Releases the extent with offset ulOffset and usable size ulCapacity,
+  as reported by Backing_alloc.
+*/
+void Backing_free(size_t ulOffset, size_t ulCapacity);
+
+/*
+  Returns the address at which the byte at offset ulOffset of the
+  backing file is mapped.
+*/
+void *Backing_getAddress(size_t ulOffset);
+
+/*
+  Moves the bytes of the extent with offset ulOffset and usable size
+  ulCapacity to the lowest free extent before it that is big enough,
+  if there is one. Returns the extent's (possibly unchanged) offset.
+*/
+size_t Backing_relocate(size_t ulOffset, size_t ulCapacity);
+
+/*
+  Sets *pulFileBytes to the length of the backing file and
+  *pulLiveBytes to the total size of its allocated extents.
+*/
+void Backing_getStats(size_t *pulFileBytes, size_t *pulLiveBytes);
+
+/*
+  Unmaps and closes the backing file. Every extent must have been
+  freed or otherwise be no longer in use.
+*/
+void Backing_reset(void);
+
+#endif
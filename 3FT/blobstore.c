@@ -0,0 +1,281 @@
+/*--------------------------------------------------------------------*/
+/* blobstore.c                                                        */
+/* Author: Will Huang and George Tziampazis                           */
+/*--------------------------------------------------------------------*/
+
+#include <stdlib.h>
+#include <stdint.h>
+#include <assert.h>
+#include <string.h>
+#include "blobstore.h"
+
+/* Number of buckets in a new index (must be a power of two) */
+#define MIN_BUCKETS 64
+
+/* A stored blob */
+struct blob {
+   /* 128-bit hash of the bytes, as two 64-bit halves */
+   uint64_t auHash[2];
+
+   /* number of references to this blob */
+   size_t ulRefs;
+
+   /* number of bytes held */
+   size_t ulLength;
+
+   /* next blob in the same bucket of the index */
+   struct blob *psNext;
+
+   /* the bytes themselves follow this struct */
+};
+
+/* Buckets of the index, chained through psNext */
+static struct blob **ppsBuckets;
+/* Number of buckets in ppsBuckets (a power of two, or 0) */
+static size_t ulNumBuckets;
+/* Number of distinct blobs stored */
+static size_t ulNumBlobs;
+/* Sum over blobs of ulLength * ulRefs */
+static size_t ulLogicalBytes;
+/* Sum over blobs of ulLength */
+static size_t ulStoredBytes;
+
+/* Returns 64-bit value uX rotated left by iBits. */
+static uint64_t BlobStore_rotl(uint64_t uX, int iBits) {
+   return (uX << iBits) | (uX >> (64 - iBits));
+}
+
+/* Returns the 64-bit finalization mix of uK. */
+static uint64_t BlobStore_fmix(uint64_t uK) {
+   uK ^= uK >> 33;
+   uK *= UINT64_C(0xff51afd7ed558ccd);
+   uK ^= uK >> 33;
+   uK *= UINT64_C(0xc4ceb9fe1a85ec53);
+   uK ^= uK >> 33;
+   return uK;
+}
+
+/* Returns the 64-bit little-endian word at pucBytes. */
+static uint64_t BlobStore_load(const unsigned char *pucBytes) {
+   uint64_t uWord = 0;
+   int i;
+
+   for(i = 7; i >= 0; i--)
+      uWord = (uWord << 8) | pucBytes[i];
+   return uWord;
+}
+
+/*
+  Stores in auHash the 128-bit hash of the ulLength bytes at pvBytes.
+  This is MurmurHash3 (x64, 128-bit variant) with a zero seed, which
+  processes 16 bytes per step.
+*/
+static void BlobStore_hash(const void *pvBytes, size_t ulLength,
+                           uint64_t auHash[2]) {
+   const uint64_t C1 = UINT64_C(0x87c37b91114253d5);
+   const uint64_t C2 = UINT64_C(0x4cf5ad432745937f);
+   const unsigned char *pucBytes = pvBytes;
+   size_t ulBlocks = ulLength / 16;
+   size_t ulTail;
+   uint64_t uH1 = 0, uH2 = 0;
+   uint64_t uK1, uK2;
+   size_t i;
+
+   /* body: whole 16-byte blocks */
+   for(i = 0; i < ulBlocks; i++) {
+      uK1 = BlobStore_load(pucBytes + 16 * i);
+      uK2 = BlobStore_load(pucBytes + 16 * i + 8);
+
+      uK1 *= C1; uK1 = BlobStore_rotl(uK1, 31); uK1 *= C2; uH1 ^= uK1;
+      uH1 = BlobStore_rotl(uH1, 27); uH1 += uH2;
+      uH1 = uH1 * 5 + 0x52dce729;
+
+      uK2 *= C2; uK2 = BlobStore_rotl(uK2, 33); uK2 *= C1; uH2 ^= uK2;
+      uH2 = BlobStore_rotl(uH2, 31); uH2 += uH1;
+      uH2 = uH2 * 5 + 0x38495ab5;
+   }
+
+   /* tail: the remaining 0 to 15 bytes */
+   pucBytes += 16 * ulBlocks;
+   ulTail = ulLength & 15;
+   uK1 = 0;
+   uK2 = 0;
+   for(i = ulTail; i > 8; i--)
+      uK2 = (uK2 << 8) | pucBytes[i - 1];
+   for(i = (ulTail < 8 ? ulTail : 8); i > 0; i--)
+      uK1 = (uK1 << 8) | pucBytes[i - 1];
+   if(ulTail > 8) {
+      uK2 *= C2; uK2 = BlobStore_rotl(uK2, 33); uK2 *= C1; uH2 ^= uK2;
+   }
+   if(ulTail > 0) {
+      uK1 *= C1; uK1 = BlobStore_rotl(uK1, 31); uK1 *= C2; uH1 ^= uK1;
+   }
+
+   /* finalization */
+   uH1 ^= (uint64_t)ulLength;
+   uH2 ^= (uint64_t)ulLength;
+   uH1 += uH2;
+   uH2 += uH1;
+   uH1 = BlobStore_fmix(uH1);
+   uH2 = BlobStore_fmix(uH2);
+   uH1 += uH2;
+   uH2 += uH1;
+
+   auHash[0] = uH1;
+   auHash[1] = uH2;
+}
+
+/*
+  Doubles the number of buckets in the index (or creates it), moving
+  every blob to its new bucket. Returns 1 (TRUE) if successful and 0
+  (FALSE) if insufficient memory is available.
+*/
+static int BlobStore_grow(void) {
+   struct blob **ppsNew;
+   struct blob *psBlob;
+   struct blob *psNext;
+   size_t ulNew;
+   size_t ulBucket;
+   size_t i;
+
+   ulNew = (ulNumBuckets == 0) ? MIN_BUCKETS : 2 * ulNumBuckets;
+   ppsNew = calloc(ulNew, sizeof(struct blob *));
+   if(ppsNew == NULL)
+      return 0;
+
+   for(i = 0; i < ulNumBuckets; i++) {
+      for(psBlob = ppsBuckets[i]; psBlob != NULL; psBlob = psNext) {
+         psNext = psBlob->psNext;
+         ulBucket = (size_t)psBlob->auHash[0] & (ulNew - 1);
+         psBlob->psNext = ppsNew[ulBucket];
+         ppsNew[ulBucket] = psBlob;
+      }
+   }
+
+   free(ppsBuckets);
+   ppsBuckets = ppsNew;
+   ulNumBuckets = ulNew;
+   return 1;
+}
+
+/* ================================================================== */
+int BlobStore_intern(const void *pvBytes, size_t ulLength,
+                     Blob_T *poBResult) {
+   uint64_t auHash[2];
+   struct blob *psBlob;
+   size_t ulBucket;
+
+   assert(pvBytes != NULL || ulLength == 0);
+   assert(poBResult != NULL);
+
+   BlobStore_hash(pvBytes, ulLength, auHash);
+
+   /* look for a stored blob with the same bytes, verifying a hash
+      match with a full comparison */
+   if(ulNumBuckets != 0) {
+      ulBucket = (size_t)auHash[0] & (ulNumBuckets - 1);
+      for(psBlob = ppsBuckets[ulBucket]; psBlob != NULL;
+          psBlob = psBlob->psNext) {
+         if(psBlob->auHash[0] == auHash[0] &&
+            psBlob->auHash[1] == auHash[1] &&
+            psBlob->ulLength == ulLength &&
+            memcmp(psBlob + 1, pvBytes, ulLength) == 0) {
+            psBlob->ulRefs++;
+            ulLogicalBytes += ulLength;
+            *poBResult = psBlob;
+            return SUCCESS;
+         }
+      }
+   }
+
+   /* keep the load factor at most one blob per bucket */
+   if(ulNumBlobs >= ulNumBuckets)
+      if(!BlobStore_grow()) {
+         *poBResult = NULL;
+         return MEMORY_ERROR;
+      }
+
+   psBlob = malloc(sizeof(struct blob) + ulLength);
+   if(psBlob == NULL) {
+      *poBResult = NULL;
+      return MEMORY_ERROR;
+   }
+   psBlob->auHash[0] = auHash[0];
+   psBlob->auHash[1] = auHash[1];
+   psBlob->ulRefs = 1;
+   psBlob->ulLength = ulLength;
+   if(ulLength != 0)
+      memcpy(psBlob + 1, pvBytes, ulLength);
+
+   ulBucket = (size_t)auHash[0] & (ulNumBuckets - 1);
+   psBlob->psNext = ppsBuckets[ulBucket];
+   ppsBuckets[ulBucket] = psBlob;
+
+   ulNumBlobs++;
+   ulLogicalBytes += ulLength;
+   ulStoredBytes += ulLength;
+
+   *poBResult = psBlob;
+   return SUCCESS;
+}
+
+/* ================================================================== */
+void BlobStore_release(Blob_T oBBlob) {
+   struct blob **ppsLink;
+   size_t ulBucket;
+
+   assert(oBBlob != NULL);
+   assert(oBBlob->ulRefs > 0);
+
+   ulLogicalBytes -= oBBlob->ulLength;
+   oBBlob->ulRefs--;
+   if(oBBlob->ulRefs != 0)
+      return;
+
+   /* unlink from its bucket and free */
+   ulBucket = (size_t)oBBlob->auHash[0] & (ulNumBuckets - 1);
+   ppsLink = &ppsBuckets[ulBucket];
+   while(*ppsLink != oBBlob) {
+      assert(*ppsLink != NULL);
+      ppsLink = &(*ppsLink)->psNext;
+   }
+   *ppsLink = oBBlob->psNext;
+
+   ulNumBlobs--;
+   ulStoredBytes -= oBBlob->ulLength;
+   free(oBBlob);
+}
+
+/* ================================================================== */
+const void *BlobStore_getBytes(Blob_T oBBlob) {
+   assert(oBBlob != NULL);
+
+   return (const void *)(oBBlob + 1);
+}
+
+/* ================================================================== */
+size_t BlobStore_getLength(Blob_T oBBlob) {
+   assert(oBBlob != NULL);
+
+   return oBBlob->ulLength;
+}
+
+/* ================================================================== */
+void BlobStore_getStats(size_t *pulLogical, size_t *pulStored) {
+   assert(pulLogical != NULL);
+   assert(pulStored != NULL);
+
+   *pulLogical = ulLogicalBytes;
+   *pulStored = ulStoredBytes;
+}
+
+/* ================================================================== */
+void BlobStore_reset(void) {
+   assert(ulNumBlobs == 0);
+
+   free(ppsBuckets);
+   ppsBuckets = NULL;
+   ulNumBuckets = 0;
+   ulLogicalBytes = 0;
+   ulStoredBytes = 0;
+}
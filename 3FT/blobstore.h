@@ -0,0 +1,55 @@
+/*--------------------------------------------------------------------*/
+/* blobstore.h                                                        */
+/* Author: Will Huang and George Tziampazis                           */
+/*--------------------------------------------------------------------*/
+
+#ifndef BLOBSTORE_INCLUDED
+#define BLOBSTORE_INCLUDED
+
+#include <stddef.h>
+#include "a4def.h"
+
+/*
+  The blob store is a content-addressed store of immutable byte
+  strings ("blobs"). Blobs are keyed by a 128-bit hash of their bytes,
+  with a full comparison on hash match, so byte-identical contents are
+  stored once and shared through a reference count.
+*/
+
+/* A Blob_T is a reference-counted, immutable byte string */
+typedef struct blob *Blob_T;
+
+/*
+  Finds the blob holding the ulLength bytes at pvBytes, creating it if
+  there is none, and adds a reference to it. Returns an int SUCCESS
+  status and sets *poBResult to the blob if successful. Otherwise, sets
+  *poBResult to NULL and returns status:
+  * MEMORY_ERROR if memory could not be allocated to complete request
+*/
+int BlobStore_intern(const void *pvBytes, size_t ulLength,
+                     Blob_T *poBResult);
+
+/*
+  Drops a reference to oBBlob, freeing it once no references remain.
+*/
+void BlobStore_release(Blob_T oBBlob);
+
+/* Returns the bytes held by oBBlob, which must not be modified. */
+const void *BlobStore_getBytes(Blob_T oBBlob);
+
+/* Returns the number of bytes held by oBBlob. */
+size_t BlobStore_getLength(Blob_T oBBlob);
+
+/*
+  Sets *pulLogical to the total length of all references to blobs
+  (each blob's length times its reference count) and *pulStored to the
+  total length of the distinct blobs actually stored.
+*/
+void BlobStore_getStats(size_t *pulLogical, size_t *pulStored);
+
+/*
+  Frees the store's index. Every blob must have been released.
+*/
+void BlobStore_reset(void);
+
+#endif
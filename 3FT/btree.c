@@ -0,0 +1,644 @@
+/*--------------------------------------------------------------------*/
+/* btree.c                                                            */
+/* Author: Will Huang and George Tziampazis                           */
+/*--------------------------------------------------------------------*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "btree.h"
+
+/*
+  The most elements in a leaf and children of an inner node, chosen so
+  that each node fills four 64-byte cache lines. Every node but the
+  root keeps at least half as many.
+*/
+enum { BTREE_LEAF_SLOTS = 30, BTREE_INNER_SLOTS = 10 };
+enum { BTREE_LEAF_MIN = BTREE_LEAF_SLOTS / 2,
+       BTREE_INNER_MIN = BTREE_INNER_SLOTS / 2 };
+
+/* More levels than any tree that fits in memory can have */
+enum { BTREE_MAX_LEVELS = 64 };
+
+/* A leaf, holding elements */
+struct bTreeLeaf {
+   /* the number of elements */
+   size_t ulCount;
+   /* the next leaf in order, or NULL */
+   struct bTreeLeaf *psNext;
+   void *apvElements[BTREE_LEAF_SLOTS];
+};
+
+/* An inner node, holding the subtrees below it */
+struct bTreeInner {
+   /* the number of children */
+   size_t ulCount;
+   /* the number of elements below each child */
+   size_t aulCounts[BTREE_INNER_SLOTS];
+   /* the first element below each child, which searches compare */
+   void *apvFirst[BTREE_INNER_SLOTS];
+   /* the children: leaves at level 1, and inner nodes above */
+   void *apvChildren[BTREE_INNER_SLOTS];
+};
+
+/* The tree */
+struct bTree {
+   /* the root, NULL while the tree is empty */
+   void *pvRoot;
+   /* the level of the root: 0 if it is a leaf */
+   size_t ulHeight;
+   /* the number of elements */
+   size_t ulLength;
+};
+
+/* Returns the first element below node pvNode at level ulLevel. */
+static void *BTree_first(void *pvNode, size_t ulLevel) {
+   assert(pvNode != NULL);
+
+   if(ulLevel == 0)
+      return ((struct bTreeLeaf *)pvNode)->apvElements[0];
+   return ((struct bTreeInner *)pvNode)->apvFirst[0];
+}
+
+/*
+  Returns the number of elements or children, whichever it holds, of
+  node pvNode at level ulLevel.
+*/
+static size_t BTree_size(void *pvNode, size_t ulLevel) {
+   assert(pvNode != NULL);
+
+   if(ulLevel == 0)
+      return ((struct bTreeLeaf *)pvNode)->ulCount;
+   return ((struct bTreeInner *)pvNode)->ulCount;
+}
+
+/* Returns the number of elements below node pvNode at level ulLevel. */
+static size_t BTree_countBelow(void *pvNode, size_t ulLevel) {
+   struct bTreeInner *psInner;
+   size_t ulCount = 0;
+   size_t i;
+
+   assert(pvNode != NULL);
+
+   if(ulLevel == 0)
+      return ((struct bTreeLeaf *)pvNode)->ulCount;
+   psInner = pvNode;
+   for(i = 0; i < psInner->ulCount; i++)
+      ulCount += psInner->aulCounts[i];
+   return ulCount;
+}
+
+/*
+  Returns the index of the child of psInner below which an element is
+  added at index *pulIndex among the elements below psInner, and sets
+  *pulIndex to its index among the elements below that child.
+*/
+static size_t BTree_childForAdd(struct bTreeInner *psInner,
+                                size_t *pulIndex) {
+   size_t i;
+
+   assert(psInner != NULL);
+   assert(pulIndex != NULL);
+
+   for(i = 0; i + 1 < psInner->ulCount &&
+          *pulIndex > psInner->aulCounts[i]; i++)
+      *pulIndex -= psInner->aulCounts[i];
+   return i;
+}
+
+/*
+  Returns the index of the child of psInner below which the element at
+  index *pulIndex among the elements below psInner is, and sets
+  *pulIndex to its index among the elements below that child.
+*/
+static size_t BTree_childForGet(struct bTreeInner *psInner,
+                                size_t *pulIndex) {
+   size_t i;
+
+   assert(psInner != NULL);
+   assert(pulIndex != NULL);
+
+   for(i = 0; *pulIndex >= psInner->aulCounts[i]; i++) {
+      *pulIndex -= psInner->aulCounts[i];
+      assert(i + 1 < psInner->ulCount);
+   }
+   return i;
+}
+
+/*
+  Adds pvElement at index ulIndex of the elements below node pvNode at
+  level ulLevel. If the node was full, it is split, taking a new node
+  from apvSpare[ulLevel], and the new right half is returned;
+  otherwise NULL is returned.
+*/
+static void *BTree_addBelow(void *pvNode, size_t ulLevel, size_t ulIndex,
+                            void *pvElement, void **apvSpare) {
+   struct bTreeLeaf *psLeaf, *psRight;
+   struct bTreeInner *psInner, *psSplit;
+   size_t ulChild;
+   size_t ulKeep;
+   void *pvNew;
+
+   assert(pvNode != NULL);
+   assert(apvSpare != NULL);
+
+   if(ulLevel == 0) {
+      psLeaf = pvNode;
+      assert(ulIndex <= psLeaf->ulCount);
+      psRight = NULL;
+      if(psLeaf->ulCount == BTREE_LEAF_SLOTS) {
+         /* move the upper half to a new leaf after this one */
+         psRight = apvSpare[0];
+         assert(psRight != NULL);
+         ulKeep = (BTREE_LEAF_SLOTS + 1) / 2;
+         psRight->ulCount = BTREE_LEAF_SLOTS - ulKeep;
+         memcpy(psRight->apvElements, psLeaf->apvElements + ulKeep,
+                psRight->ulCount * sizeof(void *));
+         psLeaf->ulCount = ulKeep;
+         psRight->psNext = psLeaf->psNext;
+         psLeaf->psNext = psRight;
+         if(ulIndex > ulKeep) {
+            ulIndex -= ulKeep;
+            psLeaf = psRight;
+         }
+      }
+      memmove(psLeaf->apvElements + ulIndex + 1,
+              psLeaf->apvElements + ulIndex,
+              (psLeaf->ulCount - ulIndex) * sizeof(void *));
+      psLeaf->apvElements[ulIndex] = pvElement;
+      psLeaf->ulCount++;
+      return psRight;
+   }
+
+   psInner = pvNode;
+   ulChild = BTree_childForAdd(psInner, &ulIndex);
+   pvNew = BTree_addBelow(psInner->apvChildren[ulChild], ulLevel - 1,
+                          ulIndex, pvElement, apvSpare);
+   psInner->aulCounts[ulChild]++;
+   psInner->apvFirst[ulChild] =
+      BTree_first(psInner->apvChildren[ulChild], ulLevel - 1);
+   if(pvNew == NULL)
+      return NULL;
+
+   /* the child split: its new right half follows it */
+   psInner->aulCounts[ulChild] -= BTree_countBelow(pvNew, ulLevel - 1);
+   psSplit = NULL;
+   if(psInner->ulCount == BTREE_INNER_SLOTS) {
+      psSplit = apvSpare[ulLevel];
+      assert(psSplit != NULL);
+      ulKeep = (BTREE_INNER_SLOTS + 1) / 2;
+      psSplit->ulCount = BTREE_INNER_SLOTS - ulKeep;
+      memcpy(psSplit->aulCounts, psInner->aulCounts + ulKeep,
+             psSplit->ulCount * sizeof(size_t));
+      memcpy(psSplit->apvFirst, psInner->apvFirst + ulKeep,
+             psSplit->ulCount * sizeof(void *));
+      memcpy(psSplit->apvChildren, psInner->apvChildren + ulKeep,
+             psSplit->ulCount * sizeof(void *));
+      psInner->ulCount = ulKeep;
+      if(ulChild >= ulKeep) {
+         ulChild -= ulKeep;
+         psInner = psSplit;
+      }
+   }
+   ulChild++;
+   memmove(psInner->aulCounts + ulChild + 1, psInner->aulCounts + ulChild,
+           (psInner->ulCount - ulChild) * sizeof(size_t));
+   memmove(psInner->apvFirst + ulChild + 1, psInner->apvFirst + ulChild,
+           (psInner->ulCount - ulChild) * sizeof(void *));
+   memmove(psInner->apvChildren + ulChild + 1,
+           psInner->apvChildren + ulChild,
+           (psInner->ulCount - ulChild) * sizeof(void *));
+   psInner->aulCounts[ulChild] = BTree_countBelow(pvNew, ulLevel - 1);
+   psInner->apvFirst[ulChild] = BTree_first(pvNew, ulLevel - 1);
+   psInner->apvChildren[ulChild] = pvNew;
+   psInner->ulCount++;
+   return psSplit;
+}
+
+/*
+  Moves elements or children between the children ulLeft and
+  ulLeft + 1 of psInner, which are at level ulLevel, so that neither
+  has fewer than the minimum, merging them if they have too few
+  between them.
+*/
+static void BTree_rebalance(struct bTreeInner *psInner, size_t ulLeft,
+                            size_t ulLevel) {
+   struct bTreeLeaf *psLeft, *psRight;
+   struct bTreeInner *psLeftIn, *psRightIn;
+   size_t ulMin;
+   size_t ulTotal;
+   size_t ulMove;
+   size_t i;
+
+   assert(psInner != NULL);
+   assert(ulLeft + 1 < psInner->ulCount);
+
+   ulMin = ulLevel == 0 ? BTREE_LEAF_MIN : BTREE_INNER_MIN;
+   ulTotal = BTree_size(psInner->apvChildren[ulLeft], ulLevel) +
+      BTree_size(psInner->apvChildren[ulLeft + 1], ulLevel);
+
+   if(ulLevel == 0) {
+      psLeft = psInner->apvChildren[ulLeft];
+      psRight = psInner->apvChildren[ulLeft + 1];
+      if(ulTotal < 2 * ulMin) {
+         /* the left leaf takes in the right one */
+         memcpy(psLeft->apvElements + psLeft->ulCount,
+                psRight->apvElements, psRight->ulCount * sizeof(void *));
+         psLeft->ulCount = ulTotal;
+         psLeft->psNext = psRight->psNext;
+         free(psRight);
+      }
+      else if(psLeft->ulCount < ulMin) {
+         ulMove = ulMin - psLeft->ulCount;
+         memcpy(psLeft->apvElements + psLeft->ulCount,
+                psRight->apvElements, ulMove * sizeof(void *));
+         memmove(psRight->apvElements, psRight->apvElements + ulMove,
+                 (psRight->ulCount - ulMove) * sizeof(void *));
+         psLeft->ulCount += ulMove;
+         psRight->ulCount -= ulMove;
+      }
+      else {
+         ulMove = ulMin - psRight->ulCount;
+         memmove(psRight->apvElements + ulMove, psRight->apvElements,
+                 psRight->ulCount * sizeof(void *));
+         memcpy(psRight->apvElements,
+                psLeft->apvElements + psLeft->ulCount - ulMove,
+                ulMove * sizeof(void *));
+         psLeft->ulCount -= ulMove;
+         psRight->ulCount += ulMove;
+      }
+   }
+   else {
+      psLeftIn = psInner->apvChildren[ulLeft];
+      psRightIn = psInner->apvChildren[ulLeft + 1];
+      if(ulTotal < 2 * ulMin) {
+         memcpy(psLeftIn->aulCounts + psLeftIn->ulCount,
+                psRightIn->aulCounts, psRightIn->ulCount * sizeof(size_t));
+         memcpy(psLeftIn->apvFirst + psLeftIn->ulCount,
+                psRightIn->apvFirst, psRightIn->ulCount * sizeof(void *));
+         memcpy(psLeftIn->apvChildren + psLeftIn->ulCount,
+                psRightIn->apvChildren,
+                psRightIn->ulCount * sizeof(void *));
+         psLeftIn->ulCount = ulTotal;
+         free(psRightIn);
+      }
+      else if(psLeftIn->ulCount < ulMin) {
+         ulMove = ulMin - psLeftIn->ulCount;
+         for(i = 0; i < ulMove; i++) {
+            psLeftIn->aulCounts[psLeftIn->ulCount + i] =
+               psRightIn->aulCounts[i];
+            psLeftIn->apvFirst[psLeftIn->ulCount + i] =
+               psRightIn->apvFirst[i];
+            psLeftIn->apvChildren[psLeftIn->ulCount + i] =
+               psRightIn->apvChildren[i];
+         }
+         psLeftIn->ulCount += ulMove;
+         psRightIn->ulCount -= ulMove;
+         memmove(psRightIn->aulCounts, psRightIn->aulCounts + ulMove,
+                 psRightIn->ulCount * sizeof(size_t));
+         memmove(psRightIn->apvFirst, psRightIn->apvFirst + ulMove,
+                 psRightIn->ulCount * sizeof(void *));
+         memmove(psRightIn->apvChildren, psRightIn->apvChildren + ulMove,
+                 psRightIn->ulCount * sizeof(void *));
+      }
+      else {
+         ulMove = ulMin - psRightIn->ulCount;
+         memmove(psRightIn->aulCounts + ulMove, psRightIn->aulCounts,
+                 psRightIn->ulCount * sizeof(size_t));
+         memmove(psRightIn->apvFirst + ulMove, psRightIn->apvFirst,
+                 psRightIn->ulCount * sizeof(void *));
+         memmove(psRightIn->apvChildren + ulMove, psRightIn->apvChildren,
+                 psRightIn->ulCount * sizeof(void *));
+         psLeftIn->ulCount -= ulMove;
+         psRightIn->ulCount += ulMove;
+         for(i = 0; i < ulMove; i++) {
+            psRightIn->aulCounts[i] =
+               psLeftIn->aulCounts[psLeftIn->ulCount + i];
+            psRightIn->apvFirst[i] =
+               psLeftIn->apvFirst[psLeftIn->ulCount + i];
+            psRightIn->apvChildren[i] =
+               psLeftIn->apvChildren[psLeftIn->ulCount + i];
+         }
+      }
+   }
+
+   if(ulTotal < 2 * ulMin) {
+      /* the right child is gone */
+      psInner->aulCounts[ulLeft] += psInner->aulCounts[ulLeft + 1];
+      psInner->ulCount--;
+      for(i = ulLeft + 1; i < psInner->ulCount; i++) {
+         psInner->aulCounts[i] = psInner->aulCounts[i + 1];
+         psInner->apvFirst[i] = psInner->apvFirst[i + 1];
+         psInner->apvChildren[i] = psInner->apvChildren[i + 1];
+      }
+      return;
+   }
+   ulTotal = psInner->aulCounts[ulLeft] + psInner->aulCounts[ulLeft + 1];
+   psInner->aulCounts[ulLeft] =
+      BTree_countBelow(psInner->apvChildren[ulLeft], ulLevel);
+   psInner->aulCounts[ulLeft + 1] = ulTotal - psInner->aulCounts[ulLeft];
+   psInner->apvFirst[ulLeft + 1] =
+      BTree_first(psInner->apvChildren[ulLeft + 1], ulLevel);
+}
+
+/*
+  Removes and returns the element at index ulIndex of the elements
+  below node pvNode at level ulLevel, which may be left with fewer
+  than the minimum for its parent to rebalance.
+*/
+static void *BTree_removeBelow(void *pvNode, size_t ulLevel,
+                               size_t ulIndex) {
+   struct bTreeLeaf *psLeaf;
+   struct bTreeInner *psInner;
+   size_t ulChild;
+   size_t ulMin;
+   void *pvElement;
+
+   assert(pvNode != NULL);
+
+   if(ulLevel == 0) {
+      psLeaf = pvNode;
+      assert(ulIndex < psLeaf->ulCount);
+      pvElement = psLeaf->apvElements[ulIndex];
+      psLeaf->ulCount--;
+      memmove(psLeaf->apvElements + ulIndex,
+              psLeaf->apvElements + ulIndex + 1,
+              (psLeaf->ulCount - ulIndex) * sizeof(void *));
+      return pvElement;
+   }
+
+   psInner = pvNode;
+   ulChild = BTree_childForGet(psInner, &ulIndex);
+   pvElement = BTree_removeBelow(psInner->apvChildren[ulChild],
+                                 ulLevel - 1, ulIndex);
+   psInner->aulCounts[ulChild]--;
+
+   ulMin = ulLevel == 1 ? BTREE_LEAF_MIN : BTREE_INNER_MIN;
+   if(BTree_size(psInner->apvChildren[ulChild], ulLevel - 1) < ulMin &&
+      psInner->ulCount > 1) {
+      /* fix the child up with its right sibling, or its left one if
+         it is the last */
+      if(ulChild + 1 == psInner->ulCount)
+         ulChild--;
+      BTree_rebalance(psInner, ulChild, ulLevel - 1);
+   }
+   if(BTree_size(psInner->apvChildren[ulChild], ulLevel - 1) > 0)
+      psInner->apvFirst[ulChild] =
+         BTree_first(psInner->apvChildren[ulChild], ulLevel - 1);
+   return pvElement;
+}
+
+/* Frees node pvNode at level ulLevel and the nodes below it. */
+static void BTree_freeBelow(void *pvNode, size_t ulLevel) {
+   struct bTreeInner *psInner;
+   size_t i;
+
+   assert(pvNode != NULL);
+
+   if(ulLevel > 0) {
+      psInner = pvNode;
+      for(i = 0; i < psInner->ulCount; i++)
+         BTree_freeBelow(psInner->apvChildren[i], ulLevel - 1);
+   }
+   free(pvNode);
+}
+
+/* ================================================================== */
+BTree_T BTree_new(void) {
+   BTree_T oBTree;
+
+   oBTree = malloc(sizeof(struct bTree));
+   if(oBTree == NULL)
+      return NULL;
+   oBTree->pvRoot = NULL;
+   oBTree->ulHeight = 0;
+   oBTree->ulLength = 0;
+   return oBTree;
+}
+
+/* ================================================================== */
+void BTree_free(BTree_T oBTree) {
+   assert(oBTree != NULL);
+
+   if(oBTree->pvRoot != NULL)
+      BTree_freeBelow(oBTree->pvRoot, oBTree->ulHeight);
+   free(oBTree);
+}
+
+/* ================================================================== */
+size_t BTree_getLength(BTree_T oBTree) {
+   assert(oBTree != NULL);
+
+   return oBTree->ulLength;
+}
+
+/* ================================================================== */
+void *BTree_get(BTree_T oBTree, size_t ulIndex) {
+   void *pvNode;
+   size_t ulLevel;
+
+   assert(oBTree != NULL);
+   assert(ulIndex < oBTree->ulLength);
+
+   pvNode = oBTree->pvRoot;
+   for(ulLevel = oBTree->ulHeight; ulLevel > 0; ulLevel--)
+      pvNode = ((struct bTreeInner *)pvNode)->apvChildren[
+         BTree_childForGet(pvNode, &ulIndex)];
+   return ((struct bTreeLeaf *)pvNode)->apvElements[ulIndex];
+}
+
+/* ================================================================== */
+int BTree_addAt(BTree_T oBTree, size_t ulIndex, void *pvElement) {
+   void *apvSpare[BTREE_MAX_LEVELS + 1];
+   struct bTreeInner *psRoot;
+   void *pvNode;
+   void *pvNew;
+   size_t ulLevel;
+   size_t ulPosition;
+   size_t ulSplits;
+
+   assert(oBTree != NULL);
+   assert(ulIndex <= oBTree->ulLength);
+
+   if(oBTree->pvRoot == NULL) {
+      oBTree->pvRoot = calloc(1, sizeof(struct bTreeLeaf));
+      if(oBTree->pvRoot == NULL)
+         return 0;
+      oBTree->ulHeight = 0;
+   }
+
+   /* a split can only fail before anything changes: find how many of
+      the nodes on the way down are full and split with their child,
+      and allocate their new halves first */
+   pvNode = oBTree->pvRoot;
+   ulPosition = ulIndex;
+   ulSplits = 0;
+   for(ulLevel = oBTree->ulHeight; ; ulLevel--) {
+      if(BTree_size(pvNode, ulLevel) < (ulLevel == 0 ?
+            (size_t)BTREE_LEAF_SLOTS : (size_t)BTREE_INNER_SLOTS))
+         ulSplits = 0;
+      else
+         ulSplits++;
+      if(ulLevel == 0)
+         break;
+      pvNode = ((struct bTreeInner *)pvNode)->apvChildren[
+         BTree_childForAdd(pvNode, &ulPosition)];
+   }
+   assert(oBTree->ulHeight + 1 < BTREE_MAX_LEVELS);
+   memset(apvSpare, 0, sizeof(apvSpare));
+   for(ulLevel = 0; ulLevel < ulSplits; ulLevel++) {
+      apvSpare[ulLevel] = malloc(ulLevel == 0 ?
+                                 sizeof(struct bTreeLeaf) :
+                                 sizeof(struct bTreeInner));
+      if(apvSpare[ulLevel] == NULL)
+         break;
+   }
+   psRoot = NULL;
+   if(ulLevel == ulSplits && ulSplits > oBTree->ulHeight) {
+      /* the root splits too, so a new root goes above it */
+      psRoot = malloc(sizeof(struct bTreeInner));
+      if(psRoot == NULL)
+         ulLevel = 0;
+   }
+   if(ulLevel < ulSplits) {
+      for(ulLevel = 0; ulLevel < ulSplits; ulLevel++)
+         free(apvSpare[ulLevel]);
+      if(oBTree->ulLength == 0) {
+         free(oBTree->pvRoot);
+         oBTree->pvRoot = NULL;
+      }
+      return 0;
+   }
+
+   pvNew = BTree_addBelow(oBTree->pvRoot, oBTree->ulHeight, ulIndex,
+                          pvElement, apvSpare);
+   if(pvNew != NULL) {
+      assert(psRoot != NULL);
+      psRoot->ulCount = 2;
+      psRoot->apvChildren[0] = oBTree->pvRoot;
+      psRoot->apvChildren[1] = pvNew;
+      psRoot->aulCounts[1] = BTree_countBelow(pvNew, oBTree->ulHeight);
+      psRoot->aulCounts[0] = oBTree->ulLength + 1 - psRoot->aulCounts[1];
+      psRoot->apvFirst[0] = BTree_first(oBTree->pvRoot, oBTree->ulHeight);
+      psRoot->apvFirst[1] = BTree_first(pvNew, oBTree->ulHeight);
+      oBTree->pvRoot = psRoot;
+      oBTree->ulHeight++;
+   }
+   oBTree->ulLength++;
+   return 1;
+}
+
+/* ================================================================== */
+void *BTree_removeAt(BTree_T oBTree, size_t ulIndex) {
+   struct bTreeInner *psRoot;
+   void *pvElement;
+
+   assert(oBTree != NULL);
+   assert(ulIndex < oBTree->ulLength);
+
+   pvElement = BTree_removeBelow(oBTree->pvRoot, oBTree->ulHeight,
+                                 ulIndex);
+   oBTree->ulLength--;
+
+   /* an inner root left with one child gives way to it */
+   while(oBTree->ulHeight > 0 &&
+         ((struct bTreeInner *)oBTree->pvRoot)->ulCount == 1) {
+      psRoot = oBTree->pvRoot;
+      oBTree->pvRoot = psRoot->apvChildren[0];
+      oBTree->ulHeight--;
+      free(psRoot);
+   }
+   if(oBTree->ulLength == 0) {
+      free(oBTree->pvRoot);
+      oBTree->pvRoot = NULL;
+   }
+   return pvElement;
+}
+
+/* ================================================================== */
+void BTree_map(BTree_T oBTree,
+               void (*pfApply)(void *pvElement, void *pvExtra),
+               const void *pvExtra) {
+   struct bTreeLeaf *psLeaf;
+   void *pvNode;
+   size_t ulLevel;
+   size_t i;
+
+   assert(oBTree != NULL);
+   assert(pfApply != NULL);
+
+   if(oBTree->pvRoot == NULL)
+      return;
+
+   /* go down to the first leaf, then along the leaves */
+   pvNode = oBTree->pvRoot;
+   for(ulLevel = oBTree->ulHeight; ulLevel > 0; ulLevel--)
+      pvNode = ((struct bTreeInner *)pvNode)->apvChildren[0];
+   for(psLeaf = pvNode; psLeaf != NULL; psLeaf = psLeaf->psNext)
+      for(i = 0; i < psLeaf->ulCount; i++)
+         (*pfApply)(psLeaf->apvElements[i], (void *)pvExtra);
+}
+
+/* ================================================================== */
+int BTree_bsearch(BTree_T oBTree, void *pvSoughtElement,
+                  size_t *pulIndex,
+                  int (*pfCompare)(const void *pvElement1,
+                                   const void *pvElement2)) {
+   struct bTreeInner *psInner;
+   struct bTreeLeaf *psLeaf;
+   void *pvNode;
+   size_t ulLevel;
+   size_t ulIndex = 0;
+   size_t ulLo, ulHi, ulMid;
+   size_t i;
+
+   assert(oBTree != NULL);
+   assert(pulIndex != NULL);
+   assert(pfCompare != NULL);
+
+   if(oBTree->pvRoot == NULL) {
+      *pulIndex = 0;
+      return 0;
+   }
+
+   /* go down into the last child whose first element is less than the
+      sought one, or the first child if there is none */
+   pvNode = oBTree->pvRoot;
+   for(ulLevel = oBTree->ulHeight; ulLevel > 0; ulLevel--) {
+      psInner = pvNode;
+      ulLo = 1;
+      ulHi = psInner->ulCount;
+      while(ulLo < ulHi) {
+         ulMid = ulLo + (ulHi - ulLo) / 2;
+         if((*pfCompare)(psInner->apvFirst[ulMid], pvSoughtElement) < 0)
+            ulLo = ulMid + 1;
+         else
+            ulHi = ulMid;
+      }
+      for(i = 0; i + 1 < ulLo; i++)
+         ulIndex += psInner->aulCounts[i];
+      pvNode = psInner->apvChildren[ulLo - 1];
+   }
+
+   /* find the first element of the leaf that is not less */
+   psLeaf = pvNode;
+   ulLo = 0;
+   ulHi = psLeaf->ulCount;
+   while(ulLo < ulHi) {
+      ulMid = ulLo + (ulHi - ulLo) / 2;
+      if((*pfCompare)(psLeaf->apvElements[ulMid], pvSoughtElement) < 0)
+         ulLo = ulMid + 1;
+      else
+         ulHi = ulMid;
+   }
+   *pulIndex = ulIndex + ulLo;
+
+   /* past the end of the leaf, it may be the next leaf's first */
+   if(ulLo < psLeaf->ulCount)
+      return (*pfCompare)(psLeaf->apvElements[ulLo],
+                          pvSoughtElement) == 0;
+   if(psLeaf->psNext != NULL)
+      return (*pfCompare)(psLeaf->psNext->apvElements[0],
+                          pvSoughtElement) == 0;
+   return 0;
+}
@@ -0,0 +1,69 @@
+/*--------------------------------------------------------------------*/
+/* btree.h                                                            */
+/* Author: Will Huang and George Tziampazis                           */
+/*--------------------------------------------------------------------*/
+
+#ifndef BTREE_INCLUDED
+#define BTREE_INCLUDED
+
+#include <stddef.h>
+
+/*
+  A BTree_T is a sequence of elements, like a DynArray_T, kept in the
+  leaves of a B+tree: the leaves are linked in order, and each inner
+  node counts the elements below each of its children. Getting,
+  adding or removing the element at an index takes O(log n) time
+  instead of shifting the elements after it, and a sorted BTree_T can
+  be binary searched as a DynArray_T can. Nodes are a few cache lines
+  each, and none is allocated until the first element is added.
+*/
+typedef struct bTree *BTree_T;
+
+/* Returns a new, empty BTree_T, or NULL if memory could not be
+   allocated. */
+BTree_T BTree_new(void);
+
+/* Frees oBTree, but not its elements. */
+void BTree_free(BTree_T oBTree);
+
+/* Returns the number of elements in oBTree. */
+size_t BTree_getLength(BTree_T oBTree);
+
+/* Returns the element of oBTree at index ulIndex, which must be less
+   than its length. */
+void *BTree_get(BTree_T oBTree, size_t ulIndex);
+
+/*
+  Adds pvElement to oBTree so that it is at index ulIndex, which must
+  not be more than its length. Returns 1 (TRUE) if successful, or 0
+  (FALSE), leaving oBTree unchanged, if memory could not be allocated.
+*/
+int BTree_addAt(BTree_T oBTree, size_t ulIndex, void *pvElement);
+
+/*
+  Removes the element of oBTree at index ulIndex, which must be less
+  than its length, and returns it. Cannot fail.
+*/
+void *BTree_removeAt(BTree_T oBTree, size_t ulIndex);
+
+/*
+  Applies function *pfApply to each element of oBTree in order,
+  passing pvExtra as an extra argument.
+*/
+void BTree_map(BTree_T oBTree,
+               void (*pfApply)(void *pvElement, void *pvExtra),
+               const void *pvExtra);
+
+/*
+  Binary searches oBTree, which must be sorted as determined by
+  *pfCompare, for *pvSoughtElement, as DynArray_bsearch does. If the
+  element is found, assigns its index to *pulIndex and returns 1.
+  Otherwise assigns the index where it would belong to *pulIndex and
+  returns 0. *pfCompare is called with an element of oBTree first.
+*/
+int BTree_bsearch(BTree_T oBTree, void *pvSoughtElement,
+                  size_t *pulIndex,
+                  int (*pfCompare)(const void *pvElement1,
+                                   const void *pvElement2));
+
+#endif
@@ -0,0 +1,230 @@
+/*--------------------------------------------------------------------*/
+/* childindex.c                                                       */
+/* Author: Will Huang and George Tziampazis                           */
+/*--------------------------------------------------------------------*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <assert.h>
+#include "childindex.h"
+
+/* Number of slots in a new table (must be a power of two) */
+enum { CHILDINDEX_MIN_SLOTS = 32 };
+
+/*
+  The lowest bit of the pointer to a child, which is otherwise 0, is
+  set if the child is a file.
+*/
+#define CHILDINDEX_TAG(pvChild, bIsFile) \
+   ((void *)((char *)(pvChild) + ((bIsFile) ? 1 : 0)))
+#define CHILDINDEX_IS_FILE(pv) (((size_t)(pv) & 1) != 0)
+#define CHILDINDEX_UNTAG(pv) \
+   ((void *)((char *)(pv) - (CHILDINDEX_IS_FILE(pv) ? 1 : 0)))
+
+/* A slot of the table */
+struct childSlot {
+   /* the hash of the child's name, so that most mismatches are told
+      apart without reading the child */
+   size_t ulHash;
+   /* the tagged child, or NULL if the slot is empty */
+   void *pvTagged;
+};
+
+/* The table, probed linearly */
+struct childIndex {
+   /* the slots */
+   struct childSlot *psSlots;
+   /* the number of slots (a power of two) */
+   size_t ulNumSlots;
+   /* the number of children indexed */
+   size_t ulNumChildren;
+   /* the function that returns a child's key */
+   const char *(*pfGetKey)(const void *pvChild, boolean bIsFile);
+   /* the number of characters of each key to skip */
+   size_t ulSkip;
+};
+
+/* Returns the FNV-1a hash of the ulLength characters at pcName. */
+static size_t ChildIndex_hash(const char *pcName, size_t ulLength) {
+   size_t ulHash = (size_t)2166136261UL;
+
+   assert(pcName != NULL);
+
+   while(ulLength-- > 0) {
+      ulHash ^= (unsigned char)*pcName++;
+      ulHash *= (size_t)16777619UL;
+   }
+   return ulHash;
+}
+
+/* Returns the name of tagged child pvTagged in oIndex. */
+static const char *ChildIndex_getName(ChildIndex_T oIndex,
+                                      const void *pvTagged) {
+   assert(oIndex != NULL);
+   assert(pvTagged != NULL);
+
+   return (*oIndex->pfGetKey)(CHILDINDEX_UNTAG(pvTagged),
+                              CHILDINDEX_IS_FILE(pvTagged)) +
+          oIndex->ulSkip;
+}
+
+/*
+  Puts tagged child pvTagged, whose name has hash ulHash, into the
+  first empty slot of its run in psSlots, a table of ulNumSlots.
+*/
+static void ChildIndex_place(struct childSlot *psSlots, size_t ulNumSlots,
+                             size_t ulHash, void *pvTagged) {
+   size_t i;
+
+   assert(psSlots != NULL);
+   assert(pvTagged != NULL);
+
+   for(i = ulHash & (ulNumSlots - 1); psSlots[i].pvTagged != NULL;
+       i = (i + 1) & (ulNumSlots - 1))
+      ;
+   psSlots[i].ulHash = ulHash;
+   psSlots[i].pvTagged = pvTagged;
+}
+
+/*
+  Doubles the number of slots of oIndex and rehashes its children.
+  Returns SUCCESS or MEMORY_ERROR, in which case oIndex is unchanged.
+*/
+static int ChildIndex_grow(ChildIndex_T oIndex) {
+   struct childSlot *psNew;
+   size_t ulNewNum;
+   size_t i;
+
+   assert(oIndex != NULL);
+
+   ulNewNum = oIndex->ulNumSlots * 2;
+   psNew = calloc(ulNewNum, sizeof(struct childSlot));
+   if(psNew == NULL)
+      return MEMORY_ERROR;
+   for(i = 0; i < oIndex->ulNumSlots; i++)
+      if(oIndex->psSlots[i].pvTagged != NULL)
+         ChildIndex_place(psNew, ulNewNum, oIndex->psSlots[i].ulHash,
+                          oIndex->psSlots[i].pvTagged);
+   free(oIndex->psSlots);
+   oIndex->psSlots = psNew;
+   oIndex->ulNumSlots = ulNewNum;
+   return SUCCESS;
+}
+
+/* ================================================================== */
+ChildIndex_T ChildIndex_new(const char *(*pfGetKey)(const void *pvChild,
+                                                    boolean bIsFile),
+                            size_t ulSkip) {
+   ChildIndex_T oIndex;
+
+   assert(pfGetKey != NULL);
+
+   oIndex = malloc(sizeof(struct childIndex));
+   if(oIndex == NULL)
+      return NULL;
+   oIndex->psSlots = calloc(CHILDINDEX_MIN_SLOTS,
+                            sizeof(struct childSlot));
+   if(oIndex->psSlots == NULL) {
+      free(oIndex);
+      return NULL;
+   }
+   oIndex->ulNumSlots = CHILDINDEX_MIN_SLOTS;
+   oIndex->ulNumChildren = 0;
+   oIndex->pfGetKey = pfGetKey;
+   oIndex->ulSkip = ulSkip;
+   return oIndex;
+}
+
+/* ================================================================== */
+void ChildIndex_free(ChildIndex_T oIndex) {
+   if(oIndex == NULL)
+      return;
+   free(oIndex->psSlots);
+   free(oIndex);
+}
+
+/* ================================================================== */
+int ChildIndex_add(ChildIndex_T oIndex, void *pvChild, boolean bIsFile) {
+   void *pvTagged;
+   const char *pcName;
+
+   assert(oIndex != NULL);
+   assert(pvChild != NULL);
+   assert(!CHILDINDEX_IS_FILE(pvChild));
+
+   /* keep the table at most three quarters full */
+   if(4 * (oIndex->ulNumChildren + 1) > 3 * oIndex->ulNumSlots &&
+      ChildIndex_grow(oIndex) != SUCCESS)
+      return MEMORY_ERROR;
+
+   pvTagged = CHILDINDEX_TAG(pvChild, bIsFile);
+   pcName = ChildIndex_getName(oIndex, pvTagged);
+   ChildIndex_place(oIndex->psSlots, oIndex->ulNumSlots,
+                    ChildIndex_hash(pcName, strlen(pcName)), pvTagged);
+   oIndex->ulNumChildren++;
+   return SUCCESS;
+}
+
+/* ================================================================== */
+void ChildIndex_remove(ChildIndex_T oIndex, const void *pvChild,
+                       boolean bIsFile) {
+   const void *pvTagged;
+   const char *pcName;
+   size_t ulMask;
+   size_t ulHome;
+   size_t i;
+   size_t j;
+
+   assert(oIndex != NULL);
+   assert(pvChild != NULL);
+
+   pvTagged = CHILDINDEX_TAG(pvChild, bIsFile);
+   pcName = ChildIndex_getName(oIndex, pvTagged);
+   ulMask = oIndex->ulNumSlots - 1;
+   for(i = ChildIndex_hash(pcName, strlen(pcName)) & ulMask;
+       oIndex->psSlots[i].pvTagged != pvTagged; i = (i + 1) & ulMask)
+      assert(oIndex->psSlots[i].pvTagged != NULL);
+
+   /* close the gap: move back each later child of the run that
+      could have been placed in it, so that no probe stops short */
+   for(j = (i + 1) & ulMask; oIndex->psSlots[j].pvTagged != NULL;
+       j = (j + 1) & ulMask) {
+      ulHome = oIndex->psSlots[j].ulHash & ulMask;
+      if(((j - ulHome) & ulMask) >= ((j - i) & ulMask)) {
+         oIndex->psSlots[i] = oIndex->psSlots[j];
+         i = j;
+      }
+   }
+   oIndex->psSlots[i].pvTagged = NULL;
+   oIndex->ulNumChildren--;
+}
+
+/* ================================================================== */
+void *ChildIndex_find(ChildIndex_T oIndex, const char *pcName,
+                      size_t ulLength, boolean *pbIsFile) {
+   const char *pcChildName;
+   void *pvTagged;
+   size_t ulHash;
+   size_t ulMask;
+   size_t i;
+
+   assert(oIndex != NULL);
+   assert(pcName != NULL);
+   assert(pbIsFile != NULL);
+
+   ulHash = ChildIndex_hash(pcName, ulLength);
+   ulMask = oIndex->ulNumSlots - 1;
+   for(i = ulHash & ulMask; oIndex->psSlots[i].pvTagged != NULL;
+       i = (i + 1) & ulMask) {
+      if(oIndex->psSlots[i].ulHash != ulHash)
+         continue;
+      pvTagged = oIndex->psSlots[i].pvTagged;
+      pcChildName = ChildIndex_getName(oIndex, pvTagged);
+      if(strncmp(pcChildName, pcName, ulLength) == 0 &&
+         pcChildName[ulLength] == '\0') {
+         *pbIsFile = (boolean)CHILDINDEX_IS_FILE(pvTagged);
+         return CHILDINDEX_UNTAG(pvTagged);
+      }
+   }
+   return NULL;
+}
@@ -0,0 +1,55 @@
+/*--------------------------------------------------------------------*/
+/* childindex.h                                                       */
+/* Author: Will Huang and George Tziampazis                           */
+/*--------------------------------------------------------------------*/
+
+#ifndef CHILDINDEX_INCLUDED
+#define CHILDINDEX_INCLUDED
+
+#include <stddef.h>
+#include "a4def.h"
+
+/*
+  A ChildIndex_T is a hash table of the children of one directory,
+  files and directories together, keyed by name and tagged with their
+  kind, so that whether a name is taken, and by what, is answered by
+  a single probe instead of a search of each kind's children. It
+  holds no order; the children's own arrays or trees stay the views.
+  Children must be pointers to objects aligned to at least 2 bytes,
+  such as those allocated by malloc.
+*/
+typedef struct childIndex *ChildIndex_T;
+
+/*
+  Returns a new, empty ChildIndex_T whose children are keyed by the
+  strings (*pfGetKey)(pvChild, bIsFile) returns, less their first
+  ulSkip characters, or NULL if memory could not be allocated. The
+  keys must not change while their children are indexed.
+*/
+ChildIndex_T ChildIndex_new(const char *(*pfGetKey)(const void *pvChild,
+                                                    boolean bIsFile),
+                            size_t ulSkip);
+
+/* Frees oIndex, but not the children. */
+void ChildIndex_free(ChildIndex_T oIndex);
+
+/*
+  Indexes pvChild, a file if bIsFile and a directory if not, whose
+  name must not be indexed already. Returns SUCCESS, or MEMORY_ERROR
+  (leaving oIndex unchanged) if memory could not be allocated.
+*/
+int ChildIndex_add(ChildIndex_T oIndex, void *pvChild, boolean bIsFile);
+
+/* Removes pvChild, a file if bIsFile, which must be in oIndex. */
+void ChildIndex_remove(ChildIndex_T oIndex, const void *pvChild,
+                       boolean bIsFile);
+
+/*
+  Returns the child of oIndex whose name is the ulLength characters
+  at pcName, setting *pbIsFile to whether it is a file, or returns
+  NULL if there is none.
+*/
+void *ChildIndex_find(ChildIndex_T oIndex, const char *pcName,
+                      size_t ulLength, boolean *pbIsFile);
+
+#endif
@@ -0,0 +1,161 @@
+/*--------------------------------------------------------------------*/
+/* contentheap.c                                                      */
+/* Author: Will Huang and George Tziampazis                           */
+/*--------------------------------------------------------------------*/
+
+#include <stdlib.h>
+#include <assert.h>
+#include "contentheap.h"
+
+/* Smallest size class, in bytes (must be a power of two) */
+#define MIN_CLASS_SIZE 64
+/* Number of size classes: MIN_CLASS_SIZE, 2*MIN_CLASS_SIZE, ... */
+#define NUM_CLASSES 7
+/* Bytes of block storage carved from each slab */
+#define SLAB_SIZE 32768
+/* Bytes reserved at the start of each slab for its header, keeping
+   blocks aligned as malloc would */
+#define SLAB_HEADER 16
+
+/* A block on a size class's free list */
+struct freeBlock {
+   /* next free block of the same size class */
+   struct freeBlock *psNext;
+};
+
+/* A slab of memory that size class blocks are carved from */
+struct slab {
+   /* next slab in the list of all slabs */
+   struct slab *psNext;
+};
+
+/* A size class of blocks */
+struct sizeClass {
+   /* blocks of this class that were freed and may be reused */
+   struct freeBlock *psFree;
+   /* next never-used block in the current slab of this class */
+   char *pcNext;
+   /* end of the current slab of this class */
+   char *pcEnd;
+};
+
+/* All size classes, smallest first */
+static struct sizeClass asClasses[NUM_CLASSES];
+/* List of all slabs allocated, so that they can be released */
+static struct slab *psSlabs;
+
+/*
+  Returns the index of the smallest size class that holds ulSize
+  bytes, or NUM_CLASSES if ulSize is too big for any class.
+*/
+static size_t ContentHeap_classOf(size_t ulSize) {
+   size_t ulClass = 0;
+   size_t ulClassSize = MIN_CLASS_SIZE;
+
+   while(ulClass < NUM_CLASSES && ulClassSize < ulSize) {
+      ulClass++;
+      ulClassSize *= 2;
+   }
+   return ulClass;
+}
+
+/*
+  Starts a new slab for size class ulClass. Returns 1 (TRUE) if
+  successful and 0 (FALSE) if insufficient memory is available.
+*/
+static int ContentHeap_newSlab(size_t ulClass) {
+   struct slab *psSlab;
+
+   assert(ulClass < NUM_CLASSES);
+
+   psSlab = malloc(SLAB_HEADER + SLAB_SIZE);
+   if(psSlab == NULL)
+      return 0;
+
+   psSlab->psNext = psSlabs;
+   psSlabs = psSlab;
+
+   asClasses[ulClass].pcNext = (char *)psSlab + SLAB_HEADER;
+   asClasses[ulClass].pcEnd = asClasses[ulClass].pcNext + SLAB_SIZE;
+   return 1;
+}
+
+/* ================================================================== */
+void *ContentHeap_alloc(size_t ulSize, size_t *pulCapacity) {
+   size_t ulClass;
+   size_t ulClassSize;
+   struct sizeClass *psClass;
+   void *pvBlock;
+
+   assert(ulSize > 0);
+   assert(pulCapacity != NULL);
+
+   /* big blocks come straight from malloc */
+   ulClass = ContentHeap_classOf(ulSize);
+   if(ulClass == NUM_CLASSES) {
+      pvBlock = malloc(ulSize);
+      if(pvBlock != NULL)
+         *pulCapacity = ulSize;
+      return pvBlock;
+   }
+
+   ulClassSize = (size_t)MIN_CLASS_SIZE << ulClass;
+   psClass = &asClasses[ulClass];
+
+   /* reuse a freed block if there is one */
+   if(psClass->psFree != NULL) {
+      pvBlock = psClass->psFree;
+      psClass->psFree = psClass->psFree->psNext;
+      *pulCapacity = ulClassSize;
+      return pvBlock;
+   }
+
+   /* otherwise carve a new block, starting a slab if needed */
+   if(psClass->pcNext == psClass->pcEnd)
+      if(!ContentHeap_newSlab(ulClass))
+         return NULL;
+
+   pvBlock = psClass->pcNext;
+   psClass->pcNext += ulClassSize;
+   *pulCapacity = ulClassSize;
+   return pvBlock;
+}
+
+/* ================================================================== */
+void ContentHeap_free(void *pvBlock, size_t ulCapacity) {
+   size_t ulClass;
+   struct freeBlock *psBlock;
+
+   assert(pvBlock != NULL);
+   assert(ulCapacity > 0);
+
+   ulClass = ContentHeap_classOf(ulCapacity);
+   if(ulClass == NUM_CLASSES) {
+      free(pvBlock);
+      return;
+   }
+   assert(((size_t)MIN_CLASS_SIZE << ulClass) == ulCapacity);
+
+   /* push onto the class's free list */
+   psBlock = pvBlock;
+   psBlock->psNext = asClasses[ulClass].psFree;
+   asClasses[ulClass].psFree = psBlock;
+}
+
+/* ================================================================== */
+void ContentHeap_reset(void) {
+   struct slab *psNext;
+   size_t ulClass;
+
+   while(psSlabs != NULL) {
+      psNext = psSlabs->psNext;
+      free(psSlabs);
+      psSlabs = psNext;
+   }
+
+   for(ulClass = 0; ulClass < NUM_CLASSES; ulClass++) {
+      asClasses[ulClass].psFree = NULL;
+      asClasses[ulClass].pcNext = NULL;
+      asClasses[ulClass].pcEnd = NULL;
+   }
+}
@@ -0,0 +1,41 @@
+/*--------------------------------------------------------------------*/
+/* contentheap.h                                                      */
+/* Author: Will Huang and George Tziampazis                           */
+/*--------------------------------------------------------------------*/
+
+#ifndef CONTENTHEAP_INCLUDED
+#define CONTENTHEAP_INCLUDED
+
+#include <stddef.h>
+
+/*
+  The content heap is a size-classed allocator for file contents owned
+  by the FT. Requests up to a few kilobytes are rounded up to a power
+  of two and carved out of larger slabs, so that many small files cost
+  a handful of malloc calls instead of one each. Freed blocks are kept
+  on per-class free lists for reuse until ContentHeap_reset is called.
+  Larger requests are passed through to malloc.
+*/
+
+/*
+  Allocates a block of at least ulSize bytes (ulSize must be > 0).
+  Returns the block and sets *pulCapacity to its usable size, or
+  returns NULL (leaving *pulCapacity unchanged) if insufficient memory
+  is available.
+*/
+void *ContentHeap_alloc(size_t ulSize, size_t *pulCapacity);
+
+/*
+  Returns block pvBlock, whose usable size as reported by
+  ContentHeap_alloc is ulCapacity, to the content heap.
+*/
+void ContentHeap_free(void *pvBlock, size_t ulCapacity);
+
+/*
+  Releases all slabs held by the content heap. Every block handed out
+  by ContentHeap_alloc must have been returned with ContentHeap_free
+  or otherwise be no longer in use.
+*/
+void ContentHeap_reset(void);
+
+#endif
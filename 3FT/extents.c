@@ -0,0 +1,246 @@
+/*--------------------------------------------------------------------*/
+/* extents.c                                                          */
+/* Author: Will Huang and George Tziampazis                           */
+/*--------------------------------------------------------------------*/
+
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include "extents.h"
+#include "contentheap.h"
+
+/* The minimum number of slots in a chunk table */
+#define MIN_SLOTS 4
+
+/*
+  A chunked byte string. Chunk i holds bytes [i * EXTENTS_CHUNK_SIZE,
+  (i+1) * EXTENTS_CHUNK_SIZE). A NULL chunk holds only zero bytes.
+  Chunks at or past the end of the string are NULL, and the bytes of
+  the last chunk past the end of the string are zero, so that the
+  string can be extended without clearing anything.
+*/
+struct extents {
+   /* length of the string in bytes */
+   size_t ulLength;
+
+   /* number of slots in ppucChunks */
+   size_t ulSlots;
+
+   /* the chunk table */
+   unsigned char **ppucChunks;
+};
+
+/* Returns the number of chunks needed to hold ulLength bytes. */
+static size_t Extents_chunksFor(size_t ulLength) {
+   return (ulLength + EXTENTS_CHUNK_SIZE - 1) / EXTENTS_CHUNK_SIZE;
+}
+
+/*
+  Makes the chunk table of oEExtents at least ulSlots slots long.
+  Returns 1 (TRUE) if successful and 0 (FALSE) if insufficient memory
+  is available.
+*/
+static int Extents_reserve(Extents_T oEExtents, size_t ulSlots) {
+   unsigned char **ppucNew;
+   size_t ulNew;
+
+   assert(oEExtents != NULL);
+
+   if(ulSlots <= oEExtents->ulSlots)
+      return 1;
+
+   ulNew = (oEExtents->ulSlots < MIN_SLOTS) ? MIN_SLOTS
+                                            : oEExtents->ulSlots;
+   while(ulNew < ulSlots)
+      ulNew *= 2;
+
+   ppucNew = realloc(oEExtents->ppucChunks,
+                     ulNew * sizeof(unsigned char *));
+   if(ppucNew == NULL)
+      return 0;
+
+   memset(ppucNew + oEExtents->ulSlots, 0,
+          (ulNew - oEExtents->ulSlots) * sizeof(unsigned char *));
+   oEExtents->ppucChunks = ppucNew;
+   oEExtents->ulSlots = ulNew;
+   return 1;
+}
+
+/* Frees the chunks of oEExtents from index ulFirst on. */
+static void Extents_freeChunksFrom(Extents_T oEExtents, size_t ulFirst) {
+   size_t i;
+
+   assert(oEExtents != NULL);
+
+   for(i = ulFirst; i < oEExtents->ulSlots; i++) {
+      if(oEExtents->ppucChunks[i] != NULL) {
+         ContentHeap_free(oEExtents->ppucChunks[i], EXTENTS_CHUNK_SIZE);
+         oEExtents->ppucChunks[i] = NULL;
+      }
+   }
+}
+
+/* ================================================================== */
+int Extents_new(const void *pvBytes, size_t ulLength,
+                Extents_T *poEResult) {
+   Extents_T oENew;
+   int iStatus;
+
+   assert(poEResult != NULL);
+
+   oENew = malloc(sizeof(struct extents));
+   if(oENew == NULL) {
+      *poEResult = NULL;
+      return MEMORY_ERROR;
+   }
+   oENew->ulLength = 0;
+   oENew->ulSlots = 0;
+   oENew->ppucChunks = NULL;
+
+   if(pvBytes != NULL)
+      iStatus = Extents_write(oENew, 0, pvBytes, ulLength);
+   else
+      iStatus = Extents_truncate(oENew, ulLength);
+   if(iStatus != SUCCESS) {
+      Extents_free(oENew);
+      *poEResult = NULL;
+      return iStatus;
+   }
+
+   *poEResult = oENew;
+   return SUCCESS;
+}
+
+/* ================================================================== */
+void Extents_free(Extents_T oEExtents) {
+   assert(oEExtents != NULL);
+
+   Extents_freeChunksFrom(oEExtents, 0);
+   free(oEExtents->ppucChunks);
+   free(oEExtents);
+}
+
+/* ================================================================== */
+size_t Extents_getLength(Extents_T oEExtents) {
+   assert(oEExtents != NULL);
+
+   return oEExtents->ulLength;
+}
+
+/* ================================================================== */
+size_t Extents_read(Extents_T oEExtents, size_t ulOffset, void *pvBuf,
+                    size_t ulLength) {
+   unsigned char *pucBuf = pvBuf;
+   unsigned char *pucChunk;
+   size_t ulDone = 0;
+   size_t ulIndex, ulStart, ulCount;
+
+   assert(oEExtents != NULL);
+   assert(pvBuf != NULL || ulLength == 0);
+
+   if(ulOffset >= oEExtents->ulLength)
+      return 0;
+   if(ulLength > oEExtents->ulLength - ulOffset)
+      ulLength = oEExtents->ulLength - ulOffset;
+
+   while(ulDone < ulLength) {
+      ulIndex = (ulOffset + ulDone) / EXTENTS_CHUNK_SIZE;
+      ulStart = (ulOffset + ulDone) % EXTENTS_CHUNK_SIZE;
+      ulCount = EXTENTS_CHUNK_SIZE - ulStart;
+      if(ulCount > ulLength - ulDone)
+         ulCount = ulLength - ulDone;
+
+      pucChunk = oEExtents->ppucChunks[ulIndex];
+      if(pucChunk == NULL)
+         memset(pucBuf + ulDone, 0, ulCount);
+      else
+         memcpy(pucBuf + ulDone, pucChunk + ulStart, ulCount);
+      ulDone += ulCount;
+   }
+   return ulLength;
+}
+
+/* ================================================================== */
+int Extents_write(Extents_T oEExtents, size_t ulOffset,
+                  const void *pvBuf, size_t ulLength) {
+   const unsigned char *pucBuf = pvBuf;
+   size_t ulOldChunks, ulFirst, ulLast;
+   size_t ulDone = 0;
+   size_t ulIndex, ulStart, ulCount, ulCapacity;
+   size_t i;
+
+   assert(oEExtents != NULL);
+   assert(pvBuf != NULL || ulLength == 0);
+
+   if(ulLength == 0)
+      return SUCCESS;
+   /* the end of the range must be representable */
+   if(ulOffset + ulLength < ulOffset)
+      return MEMORY_ERROR;
+
+   ulOldChunks = Extents_chunksFor(oEExtents->ulLength);
+   ulFirst = ulOffset / EXTENTS_CHUNK_SIZE;
+   ulLast = (ulOffset + ulLength - 1) / EXTENTS_CHUNK_SIZE;
+   if(!Extents_reserve(oEExtents, ulLast + 1))
+      return MEMORY_ERROR;
+
+   /* allocate every chunk in the range before changing any bytes */
+   for(i = ulFirst; i <= ulLast; i++) {
+      if(oEExtents->ppucChunks[i] != NULL)
+         continue;
+      oEExtents->ppucChunks[i] =
+         ContentHeap_alloc(EXTENTS_CHUNK_SIZE, &ulCapacity);
+      if(oEExtents->ppucChunks[i] == NULL) {
+         /* chunks past the end must stay NULL; zero chunks within
+            the string are harmless */
+         Extents_freeChunksFrom(oEExtents, ulOldChunks);
+         return MEMORY_ERROR;
+      }
+      assert(ulCapacity == EXTENTS_CHUNK_SIZE);
+      memset(oEExtents->ppucChunks[i], 0, EXTENTS_CHUNK_SIZE);
+   }
+
+   while(ulDone < ulLength) {
+      ulIndex = (ulOffset + ulDone) / EXTENTS_CHUNK_SIZE;
+      ulStart = (ulOffset + ulDone) % EXTENTS_CHUNK_SIZE;
+      ulCount = EXTENTS_CHUNK_SIZE - ulStart;
+      if(ulCount > ulLength - ulDone)
+         ulCount = ulLength - ulDone;
+
+      memcpy(oEExtents->ppucChunks[ulIndex] + ulStart, pucBuf + ulDone,
+             ulCount);
+      ulDone += ulCount;
+   }
+
+   if(ulOffset + ulLength > oEExtents->ulLength)
+      oEExtents->ulLength = ulOffset + ulLength;
+   return SUCCESS;
+}
+
+/* ================================================================== */
+int Extents_truncate(Extents_T oEExtents, size_t ulLength) {
+   size_t ulChunks;
+   size_t ulTail;
+
+   assert(oEExtents != NULL);
+
+   ulChunks = Extents_chunksFor(ulLength);
+
+   /* growing: the new bytes already read as zero */
+   if(ulLength >= oEExtents->ulLength) {
+      if(!Extents_reserve(oEExtents, ulChunks))
+         return MEMORY_ERROR;
+      oEExtents->ulLength = ulLength;
+      return SUCCESS;
+   }
+
+   /* shrinking: free whole chunks past the end, and clear the tail of
+      the new last chunk */
+   Extents_freeChunksFrom(oEExtents, ulChunks);
+   ulTail = ulLength % EXTENTS_CHUNK_SIZE;
+   if(ulTail != 0 && oEExtents->ppucChunks[ulChunks - 1] != NULL)
+      memset(oEExtents->ppucChunks[ulChunks - 1] + ulTail, 0,
+             EXTENTS_CHUNK_SIZE - ulTail);
+   oEExtents->ulLength = ulLength;
+   return SUCCESS;
+}
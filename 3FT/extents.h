@@ -0,0 +1,66 @@
+/*--------------------------------------------------------------------*/
+/* extents.h                                                          */
+/* Author: Will Huang and George Tziampazis                           */
+/*--------------------------------------------------------------------*/
+
+#ifndef EXTENTS_INCLUDED
+#define EXTENTS_INCLUDED
+
+#include <stddef.h>
+#include "a4def.h"
+
+/*
+  An Extents_T object is a byte string stored as a table of fixed-size
+  chunks from the content heap, so that reading, overwriting, appending
+  or truncating a range costs time proportional to the bytes touched
+  rather than to the length of the whole string. Chunks that have only
+  ever held zeros need not be allocated at all.
+*/
+typedef struct extents *Extents_T;
+
+/* Size in bytes of each chunk of an Extents_T */
+enum { EXTENTS_CHUNK_SIZE = 4096 };
+
+/*
+  Creates a new Extents_T object holding a copy of the ulLength bytes
+  at pvBytes (or ulLength zero bytes if pvBytes is NULL). Returns an
+  int SUCCESS status and sets *poEResult to the new object if
+  successful. Otherwise, sets *poEResult to NULL and returns status:
+  * MEMORY_ERROR if memory could not be allocated to complete request
+*/
+int Extents_new(const void *pvBytes, size_t ulLength,
+                Extents_T *poEResult);
+
+/* Frees oEExtents and all of its chunks. */
+void Extents_free(Extents_T oEExtents);
+
+/* Returns the length in bytes of oEExtents. */
+size_t Extents_getLength(Extents_T oEExtents);
+
+/*
+  Copies up to ulLength bytes of oEExtents, starting at byte ulOffset,
+  into pvBuf. Returns the number of bytes copied, which is less than
+  ulLength only if the end of oEExtents is reached.
+*/
+size_t Extents_read(Extents_T oEExtents, size_t ulOffset, void *pvBuf,
+                    size_t ulLength);
+
+/*
+  Overwrites the ulLength bytes of oEExtents starting at byte ulOffset
+  with the bytes at pvBuf, extending oEExtents if needed. Any gap
+  between the old end and ulOffset reads as zero bytes.
+  Returns SUCCESS, or MEMORY_ERROR (leaving the bytes of oEExtents
+  unchanged) if memory could not be allocated to complete request.
+*/
+int Extents_write(Extents_T oEExtents, size_t ulOffset,
+                  const void *pvBuf, size_t ulLength);
+
+/*
+  Sets the length of oEExtents to ulLength, discarding bytes past it
+  or extending with zero bytes. Returns SUCCESS, or MEMORY_ERROR
+  (leaving oEExtents unchanged) if memory could not be allocated to
+  complete request.
+*/
+int Extents_truncate(Extents_T oEExtents, size_t ulLength);
+
+#endif
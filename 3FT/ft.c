@@ -13,13 +13,19 @@
 #include "path.h"
 #include "noded.h"
 #include "nodef.h"
+#include "contentheap.h"
+#include "blobstore.h"
+#include "backing.h"
+#include "nameindex.h"
+#include "partrav.h"
+#include "sortedarray.h"
 #include "ft.h"
 
 /*
   A File Tree is a representation of a hierarchy of directories and
   files: the File Tree is rooted at a directory, directories
   may be internal nodes or leaves, and files are always leaves. It is 
-  represented as an AO with 3 state variables:
+  represented as an AO with 6 state variables:
 */
 
 /* Variables to keep track of FT characteristics: */
@@ -29,6 +35,29 @@ static boolean bIsInitialized;
 static NodeD_T oNRoot;
 /* 3. Counter of number of directories (not including files) in FT */
 static size_t ulDirCount;
+/* 4. Flag for whether file contents are owned by the FT (TRUE) or
+      borrowed from the client (FALSE) */
+static boolean bOwnsContents;
+/* 5. Flag for whether owned contents are deduplicated through the 
+      blob store (TRUE) or stored separately per file (FALSE) */
+static boolean bDedupContents;
+/* 6. Counter of changes to the shape of the FT, so that directory 
+      cursors can tell when they must find their place again */
+static size_t ulGeneration;
+
+/*
+  Copies ulLength bytes from pvContents into the owned storage of file
+  node oNfNode, sharing them through the blob store if the FT 
+  deduplicates contents. Returns SUCCESS or MEMORY_ERROR.
+*/
+static int FT_storeContents(NodeF_T oNfNode, const void *pvContents,
+                            size_t ulLength) {
+    assert(oNfNode != NULL);
+
+    if(bDedupContents)
+        return NodeF_setSharedContents(oNfNode, pvContents, ulLength);
+    return NodeF_setContents(oNfNode, pvContents, ulLength);
+}
 
 /* --------------------------------------------------------------------
 
@@ -39,6 +68,60 @@ static size_t ulDirCount;
   (findDir and findFile).
 */
 
+/*
+  Traverses the FT starting at directory oNdFrom, whose path must be a
+  prefix of oPPath, to the farthest possible DIRECTORY following
+  oPPath, going no deeper than depth ulDepth. If able to traverse,
+  returns an int SUCCESS status and sets *poNFurthest to the furthest
+  directory node reached. Otherwise, sets *poNFurthest to NULL and
+  returns with status:
+  * MEMORY_ERROR if memory could not be allocated to complete request
+*/
+static int FT_walkDown(NodeD_T oNdFrom, Path_T oPPath, size_t ulDepth,
+                       NodeD_T *poNFurthest) {
+    int iStatus;
+    Path_T oPPrefix = NULL;
+    NodeD_T oNCurr;
+    NodeD_T oNChild;
+    size_t ulChildID;
+    size_t i;
+
+    assert(oNdFrom != NULL);
+    assert(oPPath != NULL);
+    assert(poNFurthest != NULL);
+
+    oNCurr = oNdFrom;
+    /* Increment over depths until at closest ancestor DIRECTORY of 
+    last node in the path. If the last node is a directory, it will 
+    stop there. */
+    for (i = Path_getDepth(NodeD_getPath(oNCurr)) + 1; i <= ulDepth; 
+         i++) {
+        iStatus = Path_prefix(oPPath, i, &oPPrefix);
+        if(iStatus != SUCCESS) {
+            *poNFurthest = NULL;
+            return iStatus;
+        }
+        /* If the current node has the next directory as a child */
+        if (NodeD_hasDirChild(oNCurr, oPPrefix, &ulChildID)) {
+            Path_free(oPPrefix);
+            oPPrefix = NULL;
+            iStatus = NodeD_getDirChild(oNCurr, ulChildID, &oNChild);
+            if (iStatus != SUCCESS) {
+                *poNFurthest = NULL;
+                return iStatus;
+            }
+            /* Set up for next depth */
+            oNCurr = oNChild;
+        }
+        else {
+            break;
+        }
+    }
+    Path_free(oPPrefix);
+    *poNFurthest = oNCurr;
+    return SUCCESS;
+}
+
 /*
   Traverses the FT starting at the root to the farthest possible 
   DIRECTORY following absolute path oPPath. If able to traverse, 
@@ -55,10 +138,6 @@ static size_t ulDirCount;
 static int FT_traversePath(Path_T oPPath, NodeD_T *poNFurthest) {
     int iStatus;
     Path_T oPPrefix = NULL;
-    NodeD_T oNCurr;
-    NodeD_T oNChild;
-    size_t ulDepth, ulChildID;
-    size_t i;
 
     assert(oPPath != NULL);
     assert(poNFurthest != NULL);
@@ -84,37 +163,125 @@ static int FT_traversePath(Path_T oPPath, NodeD_T *poNFurthest) {
         return CONFLICTING_PATH;
     }
     Path_free(oPPrefix);
-    oPPrefix = NULL;
 
-    oNCurr = oNRoot;
-    ulDepth = Path_getDepth(oPPath);
-    /* Increment over depths until at closest ancestor DIRECTORY of 
-    last node in the path. If the last node is a directory, it will 
-    stop there. */
-    for (i = 2; i <= ulDepth; i++) {
-        iStatus = Path_prefix(oPPath, i, &oPPrefix);
-        if(iStatus != SUCCESS) {
-            *poNFurthest = NULL;
+    return FT_walkDown(oNRoot, oPPath, Path_getDepth(oPPath), 
+                       poNFurthest);
+}
+
+/*
+  Creates the missing directories of absolute path oPPath from one 
+  level below oNdFrom (or from the root if oNdFrom is NULL) down to 
+  depth ulDepth. oNdFrom must be the furthest directory along oPPath 
+  in the FT. Returns an int SUCCESS status and sets *poNdLast to the 
+  deepest directory (oNdFrom if none was created), *poNdFirstNew to 
+  the first one created (or NULL) and *pulNewDirs to the number 
+  created. Otherwise, frees any directories created and returns:
+  * NOT_A_DIRECTORY if a file is in the way of a new directory
+  * MEMORY_ERROR if memory could not be allocated to complete request
+  The FT's root and directory count are not updated.
+*/
+static int FT_buildDirs(NodeD_T oNdFrom, Path_T oPPath, size_t ulDepth,
+                        NodeD_T *poNdLast, NodeD_T *poNdFirstNew,
+                        size_t *pulNewDirs) {
+    int iStatus;
+    NodeD_T oNFirstNew = NULL;
+    NodeD_T oNCurr = oNdFrom;
+    size_t ulIndex, ulChildID;
+    size_t ulNewNodes = 0;
+
+    assert(oPPath != NULL);
+    assert(poNdLast != NULL);
+    assert(poNdFirstNew != NULL);
+    assert(pulNewDirs != NULL);
+
+    if(oNCurr == NULL) /* new root! */
+        ulIndex = 1;
+    else
+        ulIndex = Path_getDepth(NodeD_getPath(oNCurr)) + 1;
+
+    /* starting at oNCurr, build rest of the path one level at a time */
+    while (ulIndex <= ulDepth) {
+        Path_T oPPrefix = NULL;
+        NodeD_T oNNewNode = NULL;
+        /* generate a Path_T for this level */
+        iStatus = Path_prefix(oPPath, ulIndex, &oPPrefix);
+        if (iStatus != SUCCESS) {
+            if (oNFirstNew != NULL)
+                (void) NodeD_free(oNFirstNew);
             return iStatus;
         }
-        /* If the current node has the next directory as a child */
-        if (NodeD_hasDirChild(oNCurr, oPPrefix, &ulChildID)) {
+        /* If trying to insert child of a file; only the first level 
+        can be in the way, since the levels below it are new */
+        if (oNFirstNew == NULL && oNCurr != NULL &&
+            NodeD_hasFileChild(oNCurr, oPPrefix, &ulChildID)) {
             Path_free(oPPrefix);
-            oPPrefix = NULL;
-            iStatus = NodeD_getDirChild(oNCurr, ulChildID, &oNChild);
-            if (iStatus != SUCCESS) {
-                *poNFurthest = NULL;
-                return iStatus;
-            }
-            /* Set up for next depth */
-            oNCurr = oNChild;
+            return NOT_A_DIRECTORY;
         }
-        else {
-            break;
+        /* insert the new node for this level */
+        iStatus = NodeD_new(oPPrefix, oNCurr, &oNNewNode);
+        if(iStatus != SUCCESS) {
+            Path_free(oPPrefix);
+            if(oNFirstNew != NULL)
+                (void) NodeD_free(oNFirstNew);
+            return iStatus;
         }
+        /* set up for next level */
+        Path_free(oPPrefix);
+        oNCurr = oNNewNode;
+        ulNewNodes++;
+        if(oNFirstNew == NULL)
+            oNFirstNew = oNCurr;
+        ulIndex++;
     }
-    Path_free(oPPrefix);
-    *poNFurthest = oNCurr;
+
+    *poNdLast = oNCurr;
+    *poNdFirstNew = oNFirstNew;
+    *pulNewDirs = ulNewNodes;
+    return SUCCESS;
+}
+
+/*
+  Creates a new, unlinked file node with absolute path oPPath holding 
+  the ulLength bytes of pvContents: a copy of them if the FT owns file 
+  contents, otherwise the client's pointer. Returns an int SUCCESS 
+  status and sets *poNfResult to the new node. Otherwise, sets 
+  *poNfResult to NULL and returns:
+  * MEMORY_ERROR if memory could not be allocated to complete request
+*/
+static int FT_newFile(Path_T oPPath, void *pvContents, size_t ulLength,
+                      NodeF_T *poNfResult) {
+    int iStatus;
+    NodeF_T oNNewFile = NULL;
+
+    assert(oPPath != NULL);
+    assert(poNfResult != NULL);
+
+    /* generate a new node with only initialized fields */
+    if(bOwnsContents)
+        iStatus = NodeF_newOwned(oPPath, &oNNewFile);
+    else
+        iStatus = NodeF_new(oPPath, &oNNewFile);
+    if(iStatus != SUCCESS) {
+        *poNfResult = NULL;
+        return iStatus;
+    }
+
+    /* Set the fields of the new node, copying owned contents before 
+    the node is linked so that a failure leaves the tree unchanged */
+    if(bOwnsContents) {
+        iStatus = FT_storeContents(oNNewFile, pvContents, ulLength);
+        if(iStatus != SUCCESS) {
+            NodeF_free(oNNewFile);
+            *poNfResult = NULL;
+            return iStatus;
+        }
+    }
+    else {
+        (void)NodeF_replaceContents(oNNewFile,pvContents);
+        (void)(NodeF_replaceLength(oNNewFile,ulLength));
+    }
+
+    *poNfResult = oNNewFile;
     return SUCCESS;
 }
 
@@ -224,7 +391,8 @@ static int FT_findFile(const char *pcPath, NodeF_T *poNResult) {
 static int FT_findDir(const char *pcPath, NodeD_T *poNResult) {
     Path_T oPPath = NULL;
     NodeD_T oNFound = NULL;
-    NodeF_T oNFile = NULL;
+    NodeD_T oNdChild = NULL;
+    NodeF_T oNfChild = NULL;
     int iStatus;
 
     assert(pcPath != NULL);
@@ -260,18 +428,21 @@ static int FT_findDir(const char *pcPath, NodeD_T *poNResult) {
         return NO_SUCH_PATH;
     }
 
-    /* Checks that the node being searched for is NOT a file */
-    iStatus = FT_findFile(pcPath,&oNFile);
-    if (iStatus == SUCCESS) {
-        Path_free(oPPath);
-        return NOT_A_DIRECTORY;
-    }
-
-    /* Checks that found correct path */
+    /* Checks that found correct path; if not, the node being searched
+    for may be a file child of the directory reached, which the same 
+    traversal already found */
     if(Path_comparePath(NodeD_getPath(oNFound), oPPath) != 0) {
+        iStatus = NO_SUCH_PATH;
+        if(Path_getDepth(NodeD_getPath(oNFound)) + 1 == 
+           Path_getDepth(oPPath) &&
+           NodeD_lookupChild(oNFound, Path_getPathname(oPPath),
+                             Path_getStrLength(oPPath), &oNdChild,
+                             &oNfChild) &&
+           oNfChild != NULL)
+            iStatus = NOT_A_DIRECTORY;
         Path_free(oPPath);
         *poNResult = NULL;
-        return NO_SUCH_PATH;
+        return iStatus;
     }
 
     Path_free(oPPath);
@@ -285,7 +456,7 @@ int FT_insertDir(const char *pcPath) {
     Path_T oPPath = NULL;
     NodeD_T oNFirstNew = NULL;
     NodeD_T oNCurr = NULL;
-    size_t ulDepth, ulIndex;
+    size_t ulDepth;
     size_t ulNewNodes = 0; 
 
     assert(pcPath != NULL);
@@ -315,61 +486,25 @@ int FT_insertDir(const char *pcPath) {
     }
 
     ulDepth = Path_getDepth(oPPath);
-    if(oNCurr == NULL) /* new root! */
-        ulIndex = 1;
-    else {
-        ulIndex = Path_getDepth(NodeD_getPath(oNCurr)) + 1;
-        /* oNCurr is the node we're trying to insert */
-        if (ulIndex == ulDepth + 1 && !Path_comparePath(oPPath, 
+    /* oNCurr is the node we're trying to insert */
+    if (oNCurr != NULL && !Path_comparePath(oPPath, 
         NodeD_getPath(oNCurr))) {
-            Path_free(oPPath);
-            return ALREADY_IN_TREE;
-        }
+        Path_free(oPPath);
+        return ALREADY_IN_TREE;
     }
 
     /* starting at oNCurr, build rest of the path one level at a time */
-    while (ulIndex <= ulDepth) {
-        Path_T oPPrefix = NULL;
-        NodeD_T oNNewNode = NULL;
-        /* generate a Path_T for this level */
-        iStatus = Path_prefix(oPPath, ulIndex, &oPPrefix);
-        if (iStatus != SUCCESS) {
-            Path_free(oPPath);
-            if (oNFirstNew != NULL)
-                (void) NodeD_free(oNFirstNew);
-            return iStatus;
-        }
-        /* If trying to insert child of a file */
-        if (FT_containsFile(Path_getPathname(oPPrefix))) {
-            Path_free(oPPath);
-            Path_free(oPPrefix);
-            if (oNFirstNew != NULL)
-                (void)NodeD_free(oNFirstNew);
-            return NOT_A_DIRECTORY;
-        }
-        /* insert the new node for this level */
-        iStatus = NodeD_new(oPPrefix, oNCurr, &oNNewNode);
-        if(iStatus != SUCCESS) {
-            Path_free(oPPath);
-            Path_free(oPPrefix);
-            if(oNFirstNew != NULL)
-                (void) NodeD_free(oNFirstNew);
-            return iStatus;
-        }
-        /* set up for next level */
-        Path_free(oPPrefix);
-        oNCurr = oNNewNode;
-        ulNewNodes++;
-        if(oNFirstNew == NULL)
-            oNFirstNew = oNCurr;
-        ulIndex++;
-    }
-
+    iStatus = FT_buildDirs(oNCurr, oPPath, ulDepth, &oNCurr, 
+                           &oNFirstNew, &ulNewNodes);
     Path_free(oPPath);
+    if(iStatus != SUCCESS)
+        return iStatus;
+
     /* update FT state variables to reflect insertion */
     if(oNRoot == NULL)
         oNRoot = oNFirstNew;
     ulDirCount += ulNewNodes;
+    ulGeneration++;
 
     return SUCCESS;
 }   
@@ -387,6 +522,110 @@ boolean FT_containsDir(const char *pcPath) {
     return (boolean) (iStatus == SUCCESS);
 }
 
+/* ================================================================== */
+/*
+  The following auxiliary functions are used for freeing large 
+  subtrees in parallel.
+*/
+
+/* Fewest directories in a subtree worth freeing with several threads */
+enum { FT_PARALLEL_FREE_MIN = 4096 };
+
+/*
+  Returns TRUE if the subtree rooted at oNdDir has at least 
+  *pulBudget directories, counting them down from *pulBudget but 
+  stopping as soon as it reaches 0.
+*/
+static boolean FT_hasAtLeast(NodeD_T oNdDir, size_t *pulBudget) {
+    NodeD_T oNdChild = NULL;
+    size_t i;
+
+    assert(oNdDir != NULL);
+    assert(pulBudget != NULL);
+
+    if(--*pulBudget == 0)
+        return TRUE;
+    for(i = 0; i < NodeD_getNumDirChildren(oNdDir); i++) {
+        (void)NodeD_getDirChild(oNdDir, i, &oNdChild);
+        if(FT_hasAtLeast(oNdChild, pulBudget))
+            return TRUE;
+    }
+    return FALSE;
+}
+
+/*
+  Counts directory oNdDir, about to be freed, in worker ulWorker's 
+  entry of aulCounts, for ParTrav_run.
+*/
+static enum ParTrav_action FT_countFreed(NodeD_T oNdDir, size_t ulRoot,
+                                         size_t ulWorker,
+                                         size_t *aulCounts) {
+    assert(oNdDir != NULL);
+    assert(aulCounts != NULL);
+
+    (void)ulRoot;
+    aulCounts[ulWorker]++;
+    return PARTRAV_CONTINUE;
+}
+
+/*
+  Frees directory oNdDir, whose children have been queued, for 
+  ParTrav_run.
+*/
+static void FT_freeVisited(NodeD_T oNdDir, size_t ulRoot,
+                           size_t ulWorker, void *pvExtra) {
+    assert(oNdDir != NULL);
+
+    (void)ulRoot;
+    (void)ulWorker;
+    (void)pvExtra;
+    NodeD_freeShallow(oNdDir);
+}
+
+/*
+  Unlinks the subtree rooted at oNdDir from the FT and frees it, 
+  with one thread per processor if it is large and its nodes hold 
+  nothing shared between them (owned contents or name index 
+  entries), and serially otherwise. Returns the number of directories
+  freed.
+*/
+static size_t FT_freeSubtree(NodeD_T oNdDir) {
+    struct ParTrav_visitor sVisitor;
+    size_t *aulCounts;
+    size_t ulWorkers;
+    size_t ulEntries, ulBytes;
+    size_t ulBudget = FT_PARALLEL_FREE_MIN;
+    size_t ulCount = 0;
+    size_t i;
+
+    assert(oNdDir != NULL);
+
+    ulWorkers = ParTrav_getDefaultWorkers();
+    NameIndex_getStats(&ulEntries, &ulBytes);
+    if(bOwnsContents || ulEntries != 0 || ulWorkers == 1 ||
+       !FT_hasAtLeast(oNdDir, &ulBudget))
+        return NodeD_free(oNdDir);
+
+    /* no counts, no threads */
+    aulCounts = calloc(ulWorkers, sizeof(size_t));
+    if(aulCounts == NULL)
+        return NodeD_free(oNdDir);
+
+    /* each directory is freed by the worker that visits it, once its
+       children are queued for any worker to take */
+    NodeD_detach(oNdDir);
+    sVisitor.pfVisit = (enum ParTrav_action (*)(NodeD_T, size_t, size_t,
+                                                void *)) FT_countFreed;
+    sVisitor.pfRelease = FT_freeVisited;
+    sVisitor.pvExtra = aulCounts;
+    ParTrav_run(&oNdDir, 1, ulWorkers, &sVisitor);
+
+    for(i = 0; i < ulWorkers; i++)
+        ulCount += aulCounts[i];
+    free(aulCounts);
+    return ulCount;
+}
+
 /* ================================================================== */
 int FT_rmDir(const char *pcPath) {
     int iStatus;
@@ -406,7 +645,8 @@ int FT_rmDir(const char *pcPath) {
         return iStatus;
 
     /* Free the directory (including its children) */
-    ulDirCount -= NodeD_free(oNdFound);
+    ulDirCount -= FT_freeSubtree(oNdFound);
+    ulGeneration++;
     if(ulDirCount == 0)
         oNRoot = NULL;
 
@@ -421,7 +661,9 @@ ulLength) {
     NodeD_T oNFirstNew = NULL; /* first new node added */
     NodeD_T oNParent = NULL;
     NodeF_T oNNewFile = NULL; /* file to be added */
-    size_t ulDepth, ulIndex, ulChildID; 
+    NodeD_T oNdChild = NULL;
+    NodeF_T oNfChild = NULL;
+    size_t ulDepth, ulChildID; 
     size_t ulNewNodes = 0; /* number of new directories */
 
     assert(pcPath != NULL);
@@ -456,60 +698,27 @@ ulLength) {
     }
 
     ulDepth = Path_getDepth(oPPath);
-    if (oNParent == NULL) /* new root! */
-        ulIndex = 1;
-    else {
-        ulIndex = Path_getDepth(NodeD_getPath(oNParent)) + 1;
-        /* the file is already a child of its parent directory */
-        if (NodeD_hasFileChild(oNParent, oPPath, &ulChildID) || 
-        NodeD_hasDirChild(oNParent, oPPath, &ulChildID) || 
-        (Path_comparePath(NodeD_getPath(oNParent), oPPath) == 0)) {
-            Path_free(oPPath);
-            return ALREADY_IN_TREE;
-        }
+    /* the file is already a child of its parent directory */
+    if (oNParent != NULL &&
+        (NodeD_lookupChild(oNParent, Path_getPathname(oPPath),
+                           Path_getStrLength(oPPath), &oNdChild,
+                           &oNfChild) ||
+         (Path_comparePath(NodeD_getPath(oNParent), oPPath) == 0))) {
+        Path_free(oPPath);
+        return ALREADY_IN_TREE;
     }
 
     /* starting at oNParent, build rest of the directories one by one 
-    but not the file itself yet, hence < not <= */
-    while (ulIndex < ulDepth) {
-        Path_T oPPrefix = NULL;
-        NodeD_T oNNewNode = NULL;
-        /* generate a Path_T for this level */
-        iStatus = Path_prefix(oPPath, ulIndex, &oPPrefix);
-        if (iStatus != SUCCESS) {
-            Path_free(oPPath);
-            if (oNFirstNew != NULL)
-                (void) NodeD_free(oNFirstNew);
-            return iStatus;
-        }
-        /* If trying to insert child of a file */
-        if (FT_containsFile(Path_getPathname(oPPrefix))) {
-            Path_free(oPPath);
-            Path_free(oPPrefix);
-            if (oNFirstNew != NULL)
-                (void)NodeD_free(oNFirstNew);
-            return NOT_A_DIRECTORY;
-        }
-        /* insert the new node for this level */
-        iStatus = NodeD_new(oPPrefix, oNParent, &oNNewNode);
-        if(iStatus != SUCCESS) {
-            Path_free(oPPath);
-            Path_free(oPPrefix);
-            if(oNFirstNew != NULL)
-                (void) NodeD_free(oNFirstNew);
-            return iStatus;
-        }
-        /* set up for next level */
-        Path_free(oPPrefix);
-        oNParent = oNNewNode;
-        ulNewNodes++;
-        if(oNFirstNew == NULL)
-            oNFirstNew = oNParent;
-        ulIndex++;
+    but not the file itself yet, hence ulDepth - 1 */
+    iStatus = FT_buildDirs(oNParent, oPPath, ulDepth - 1, &oNParent,
+                           &oNFirstNew, &ulNewNodes);
+    if(iStatus != SUCCESS) {
+        Path_free(oPPath);
+        return iStatus;
     }
     
-    /* generate a new node with only initialized fields */
-    iStatus = NodeF_new(oPPath, &oNNewFile);
+    /* generate the new file node with its contents */
+    iStatus = FT_newFile(oPPath, pvContents, ulLength, &oNNewFile);
     if(iStatus != SUCCESS) {
         Path_free(oPPath);
         if(oNFirstNew != NULL)
@@ -521,21 +730,18 @@ ulLength) {
     parent directory, if not add it as a child of the parent directory. 
     ulChildID is generated from NodeD_hasFileChild() */
     if (NodeD_hasFileChild(oNParent, oPPath, &ulChildID)) {
+        NodeF_free(oNNewFile);
         Path_free(oPPath);
-        free(oNNewFile);
         return ALREADY_IN_TREE;
     }
     iStatus = NodeD_addFileChild(oNParent, oNNewFile, ulChildID);
     if (iStatus != SUCCESS) {
+        NodeF_free(oNNewFile);
         Path_free(oPPath);
         if(oNFirstNew != NULL)
             (void) NodeD_free(oNFirstNew);
         return iStatus; 
     }
-    
-    /* Set the fields of the new node */
-    (void)NodeF_replaceContents(oNNewFile,pvContents);
-    (void)(NodeF_replaceLength(oNNewFile,ulLength));
 
     Path_free(oPPath);
     /* update DT state variables to reflect insertion */
@@ -544,6 +750,7 @@ ulLength) {
     /* Update the number of directories (not files, those are not 
     counted) */
     ulDirCount += ulNewNodes;
+    ulGeneration++;
 
     return SUCCESS;
 }
@@ -590,8 +797,8 @@ int FT_rmFile(const char *pcPath) {
     &ulIndex);
 
     /* Remove and free the file node */
-    NodeF_free(oNFound);
-    (void)DynArray_removeAt(NodeD_getFileChildren(oNdParent), ulIndex);
+    NodeD_removeFileChild(oNdParent, ulIndex);
+    ulGeneration++;
 
     return SUCCESS;
 }
@@ -616,6 +823,7 @@ void *FT_replaceFileContents(const char *pcPath, void *pvNewContents,
 size_t ulNewLength) {
     int iStatus;
     NodeF_T oNFound = NULL;
+    void *pvOldCopy = NULL;
 
     assert(pcPath != NULL);
 
@@ -623,39 +831,2796 @@ size_t ulNewLength) {
     iStatus = FT_findFile(pcPath, &oNFound);
     if(iStatus != SUCCESS)
         return NULL;
+
+    /* Owned contents: hand the client a copy of the old contents, 
+    since the FT's storage is reused or freed */
+    if(NodeF_ownsContents(oNFound)) {
+        iStatus = NodeF_copyContents(oNFound, &pvOldCopy);
+        if(iStatus != SUCCESS)
+            return NULL;
+        iStatus = FT_storeContents(oNFound, pvNewContents, 
+                                   ulNewLength);
+        if(iStatus != SUCCESS) {
+            free(pvOldCopy);
+            return NULL;
+        }
+        return pvOldCopy;
+    }
     
     (void)NodeF_replaceLength(oNFound,ulNewLength);
     return NodeF_replaceContents(oNFound,pvNewContents);
 }
 
 /* ================================================================== */
-int FT_stat(const char *pcPath, boolean *pbIsFile, size_t *pulSize) {
-    NodeD_T oNdFound = NULL;
-    NodeF_T oNfFound = NULL;
-    int iStatusDir;
-    int iStatusFile;
+/*
+  Finds the file with absolute path pcPath for a ranged operation.
+  Returns an int SUCCESS status and sets *poNResult to the file node if
+  found. Otherwise, sets *poNResult to NULL and returns a status as
+  FT_findFile does, except that NOT_A_FILE is returned if pcPath is in
+  the FT as a directory.
+*/
+static int FT_findFileForRange(const char *pcPath, NodeF_T *poNResult) {
+    int iStatus;
+    NodeD_T oNdFound = NULL;
+
+    assert(pcPath != NULL);
+    assert(poNResult != NULL);
+
+    iStatus = FT_findFile(pcPath, poNResult);
+    if(iStatus == NO_SUCH_PATH) {
+        *poNResult = NULL;
+        if(FT_findDir(pcPath, &oNdFound) == SUCCESS)
+            return NOT_A_FILE;
+    }
+    return iStatus;
+}
+
+/* ================================================================== */
+int FT_readFile(const char *pcPath, size_t ulOffset, void *pvBuf,
+                size_t ulLength, size_t *pulRead) {
+    int iStatus;
+    NodeF_T oNFound = NULL;
+
+    assert(pcPath != NULL);
+    assert(pvBuf != NULL || ulLength == 0);
+    assert(pulRead != NULL);
+
+    iStatus = FT_findFileForRange(pcPath, &oNFound);
+    if(iStatus != SUCCESS)
+        return iStatus;
+
+    *pulRead = NodeF_read(oNFound, ulOffset, pvBuf, ulLength);
+    return SUCCESS;
+}
+
+/* ================================================================== */
+int FT_writeFile(const char *pcPath, size_t ulOffset, 
+                 const void *pvBuf, size_t ulLength) {
+    int iStatus;
+    NodeF_T oNFound = NULL;
+
+    assert(pcPath != NULL);
+    assert(pvBuf != NULL || ulLength == 0);
+
+    /* ranged updates need contents the FT can modify */
+    if(!bOwnsContents)
+        return INITIALIZATION_ERROR;
+
+    iStatus = FT_findFileForRange(pcPath, &oNFound);
+    if(iStatus != SUCCESS)
+        return iStatus;
+
+    return NodeF_write(oNFound, ulOffset, pvBuf, ulLength);
+}
+
+/* ================================================================== */
+int FT_appendFile(const char *pcPath, const void *pvBuf, 
+                  size_t ulLength) {
+    int iStatus;
+    NodeF_T oNFound = NULL;
+
+    assert(pcPath != NULL);
+    assert(pvBuf != NULL || ulLength == 0);
+
+    /* ranged updates need contents the FT can modify */
+    if(!bOwnsContents)
+        return INITIALIZATION_ERROR;
+
+    iStatus = FT_findFileForRange(pcPath, &oNFound);
+    if(iStatus != SUCCESS)
+        return iStatus;
+
+    return NodeF_write(oNFound, NodeF_getLength(oNFound), pvBuf, 
+                       ulLength);
+}
+
+/* ================================================================== */
+int FT_truncateFile(const char *pcPath, size_t ulLength) {
+    int iStatus;
+    NodeF_T oNFound = NULL;
+
+    assert(pcPath != NULL);
+
+    /* ranged updates need contents the FT can modify */
+    if(!bOwnsContents)
+        return INITIALIZATION_ERROR;
+
+    iStatus = FT_findFileForRange(pcPath, &oNFound);
+    if(iStatus != SUCCESS)
+        return iStatus;
+
+    return NodeF_truncate(oNFound, ulLength);
+}
+
+/* ================================================================== */
+int FT_pinFile(const char *pcPath) {
+    int iStatus;
+    NodeF_T oNFound = NULL;
+
+    assert(pcPath != NULL);
+
+    iStatus = FT_findFileForRange(pcPath, &oNFound);
+    if(iStatus != SUCCESS)
+        return iStatus;
+
+    NodeF_pin(oNFound);
+    return SUCCESS;
+}
+
+/* ================================================================== */
+int FT_unpinFile(const char *pcPath) {
+    int iStatus;
+    NodeF_T oNFound = NULL;
+
+    assert(pcPath != NULL);
+
+    iStatus = FT_findFileForRange(pcPath, &oNFound);
+    if(iStatus != SUCCESS)
+        return iStatus;
+
+    NodeF_unpin(oNFound);
+    return SUCCESS;
+}
+
+/* ================================================================== */
+/*
+  The following auxiliary functions are used for advancing many
+  independent lookups in lock-step, for FT_statMany and
+  FT_getFileContentsMany. Each round first starts loading what every
+  lookup's next step will touch, and only then takes the steps, so
+  that the cache misses of different lookups overlap instead of being
+  waited for one after another.
+*/
+
+/* Number of lookups in flight at once */
+enum { FT_LOOKUP_WINDOW = 16 };
+
+/* A lookup in progress */
+struct lookup {
+    /* index of the lookup's path in the batch */
+    size_t ulIndex;
+    /* the path being looked up */
+    const char *pcPath;
+    /* length of the prefix of pcPath that is oNdAt's path */
+    size_t ulMatched;
+    /* the furthest directory along pcPath reached so far */
+    NodeD_T oNdAt;
+};
+
+/*
+  Returns SUCCESS if pcPath is a well-formatted path by the rules of
+  Path_new, or BAD_PATH if it is not, without allocating anything.
+*/
+static int FT_checkPath(const char *pcPath) {
+    const char *pc;
+
+    assert(pcPath != NULL);
+
+    if(*pcPath == '\0' || *pcPath == '/')
+        return BAD_PATH;
+    for(pc = pcPath; *pc != '\0'; pc++)
+        if(*pc == '/' && (pc[1] == '/' || pc[1] == '\0'))
+            return BAD_PATH;
+    return SUCCESS;
+}
+
+/*
+  Starts the lookup of pcPath, the ulIndex'th path of the batch, in
+  *psLookup. Returns TRUE if the lookup is in progress. Otherwise, 
+  calls (*pfDone)(ulIndex, iStatus, NULL, NULL, pvExtra) with the 
+  status FT_stat would return, and returns FALSE.
+*/
+static boolean FT_startLookup(struct lookup *psLookup, size_t ulIndex,
+                              const char *pcPath,
+                              void (*pfDone)(size_t, int, NodeD_T,
+                                             NodeF_T, void *),
+                              void *pvExtra) {
+    const char *pcRoot;
+    size_t ulRootLength;
+    int iStatus;
+
+    assert(psLookup != NULL);
+    assert(pcPath != NULL);
+    assert(pfDone != NULL);
+
+    iStatus = FT_checkPath(pcPath);
+    if(iStatus == SUCCESS && oNRoot == NULL)
+        iStatus = NO_SUCH_PATH;
+    if(iStatus != SUCCESS) {
+        (*pfDone)(ulIndex, iStatus, NULL, NULL, pvExtra);
+        return FALSE;
+    }
+
+    /* the root's path must be the first component of pcPath */
+    pcRoot = Path_getPathname(NodeD_getPath(oNRoot));
+    ulRootLength = Path_getStrLength(NodeD_getPath(oNRoot));
+    if(strncmp(pcPath, pcRoot, ulRootLength) != 0 ||
+       (pcPath[ulRootLength] != '/' && pcPath[ulRootLength] != '\0')) {
+        (*pfDone)(ulIndex, CONFLICTING_PATH, NULL, NULL, pvExtra);
+        return FALSE;
+    }
+
+    psLookup->ulIndex = ulIndex;
+    psLookup->pcPath = pcPath;
+    psLookup->ulMatched = ulRootLength;
+    psLookup->oNdAt = oNRoot;
+    return TRUE;
+}
+
+/*
+  Advances the lookup *psLookup by one level, prefetching the
+  directory it moves to. Returns TRUE if the lookup is still in
+  progress. Otherwise, calls (*pfDone) with the lookup's index, the
+  status FT_stat would return, and the directory or file found (or 
+  NULL), and returns FALSE.
+*/
+static boolean FT_stepLookup(struct lookup *psLookup,
+                             void (*pfDone)(size_t, int, NodeD_T,
+                                            NodeF_T, void *),
+                             void *pvExtra) {
+    const char *pcPath;
+    size_t ulNext;
+    NodeD_T oNdChild = NULL;
+    NodeF_T oNfChild = NULL;
+
+    assert(psLookup != NULL);
+    assert(pfDone != NULL);
+
+    pcPath = psLookup->pcPath;
+    if(pcPath[psLookup->ulMatched] == '\0') {
+        (*pfDone)(psLookup->ulIndex, SUCCESS, psLookup->oNdAt, NULL,
+                  pvExtra);
+        return FALSE;
+    }
+
+    /* find the end of the next component */
+    ulNext = psLookup->ulMatched + 1;
+    while(pcPath[ulNext] != '/' && pcPath[ulNext] != '\0')
+        ulNext++;
+
+    /* one search answers both whether and as what the child exists */
+    (void)NodeD_lookupChild(psLookup->oNdAt, pcPath, ulNext, &oNdChild,
+                            &oNfChild);
+    if(oNdChild != NULL) {
+        NodeD_prefetch(oNdChild);
+        psLookup->oNdAt = oNdChild;
+        psLookup->ulMatched = ulNext;
+        return TRUE;
+    }
+
+    /* only the last component can be a file */
+    if(oNfChild != NULL && pcPath[ulNext] == '\0') {
+        (*pfDone)(psLookup->ulIndex, SUCCESS, NULL, oNfChild, pvExtra);
+        return FALSE;
+    }
+
+    (*pfDone)(psLookup->ulIndex, NO_SUCH_PATH, NULL, NULL, pvExtra);
+    return FALSE;
+}
+
+/*
+  Looks up the ulCount paths in ppcPaths, up to FT_LOOKUP_WINDOW at a
+  time in lock-step, calling (*pfDone)(ulIndex, iStatus, oNdFound,
+  oNfFound, pvExtra) once for each path as it is finished, in no
+  particular order.
+*/
+static void FT_lookupMany(const char **ppcPaths, size_t ulCount,
+                          void (*pfDone)(size_t, int, NodeD_T, NodeF_T,
+                                         void *),
+                          void *pvExtra) {
+    struct lookup asLookups[FT_LOOKUP_WINDOW];
+    size_t ulActive = 0; /* number of lookups in progress */
+    size_t ulNext = 0;   /* index of the next path to start */
+    size_t i;
+
+    assert(ppcPaths != NULL || ulCount == 0);
+    assert(pfDone != NULL);
+
+    for(;;) {
+        /* refill the window */
+        while(ulActive < FT_LOOKUP_WINDOW && ulNext < ulCount) {
+            assert(ppcPaths[ulNext] != NULL);
+            if(FT_startLookup(&asLookups[ulActive], ulNext,
+                              ppcPaths[ulNext], pfDone, pvExtra))
+                ulActive++;
+            ulNext++;
+        }
+        if(ulActive == 0)
+            return;
+
+        /* start loading what every lookup's next step touches */
+        for(i = 0; i < ulActive; i++)
+            NodeD_prefetchChildren(asLookups[i].oNdAt);
+
+        /* then take the steps, dropping finished lookups */
+        i = 0;
+        while(i < ulActive) {
+            if(FT_stepLookup(&asLookups[i], pfDone, pvExtra))
+                i++;
+            else
+                asLookups[i] = asLookups[--ulActive];
+        }
+    }
+}
+
+/*
+  Records the outcome of a lookup of FT_statMany in psResults, the
+  array of results.
+*/
+static void FT_statDone(size_t ulIndex, int iStatus, NodeD_T oNdFound,
+                        NodeF_T oNfFound,
+                        struct FT_statResult *psResults) {
+    assert(psResults != NULL);
+
+    psResults[ulIndex].iStatus = iStatus;
+    if(oNfFound != NULL) {
+        psResults[ulIndex].bIsFile = TRUE;
+        psResults[ulIndex].ulSize = NodeF_getLength(oNfFound);
+    }
+    else if(oNdFound != NULL) {
+        psResults[ulIndex].bIsFile = FALSE;
+        psResults[ulIndex].ulSize = 0;
+    }
+}
+
+/*
+  Records the outcome of a lookup of FT_getFileContentsMany in
+  ppvContents, the array of contents.
+*/
+static void FT_contentsDone(size_t ulIndex, int iStatus,
+                            NodeD_T oNdFound, NodeF_T oNfFound,
+                            void **ppvContents) {
+    assert(ppvContents != NULL);
+
+    (void)iStatus;
+    (void)oNdFound;
+    if(oNfFound != NULL)
+        ppvContents[ulIndex] = NodeF_getContents(oNfFound);
+    else
+        ppvContents[ulIndex] = NULL;
+}
+
+/* ================================================================== */
+int FT_statMany(const char **ppcPaths, size_t ulCount,
+                struct FT_statResult *psResults) {
+    assert(ppcPaths != NULL || ulCount == 0);
+    assert(psResults != NULL || ulCount == 0);
+
+    if(!bIsInitialized)
+        return INITIALIZATION_ERROR;
+
+    FT_lookupMany(ppcPaths, ulCount,
+                  (void (*)(size_t, int, NodeD_T, NodeF_T, void *))
+                  FT_statDone, psResults);
+    return SUCCESS;
+}
+
+/* ================================================================== */
+int FT_getFileContentsMany(const char **ppcPaths, size_t ulCount,
+                           void **ppvContents) {
+    assert(ppcPaths != NULL || ulCount == 0);
+    assert(ppvContents != NULL || ulCount == 0);
+
+    if(!bIsInitialized)
+        return INITIALIZATION_ERROR;
+
+    FT_lookupMany(ppcPaths, ulCount,
+                  (void (*)(size_t, int, NodeD_T, NodeF_T, void *))
+                  FT_contentsDone, ppvContents);
+    return SUCCESS;
+}
+
+/* The outcome of a lookup by FT_lookupOne */
+struct lookupOutcome {
+    /* the status FT_stat would return */
+    int iStatus;
+    /* the directory or file found, or NULL */
+    NodeD_T oNdFound;
+    NodeF_T oNfFound;
+};
+
+/* Records the outcome of a lookup of FT_lookupOne in *psOutcome. */
+static void FT_oneDone(size_t ulIndex, int iStatus, NodeD_T oNdFound,
+                       NodeF_T oNfFound,
+                       struct lookupOutcome *psOutcome) {
+    assert(psOutcome != NULL);
+
+    (void)ulIndex;
+    psOutcome->iStatus = iStatus;
+    psOutcome->oNdFound = oNdFound;
+    psOutcome->oNfFound = oNfFound;
+}
+
+/*
+  Looks up pcPath as FT_stat does, but without allocating anything.
+  Returns the status FT_stat would return, and sets *poNdFound and 
+  *poNfFound to the directory or file found (the other, or both, are 
+  set to NULL).
+*/
+static int FT_lookupOne(const char *pcPath, NodeD_T *poNdFound,
+                        NodeF_T *poNfFound) {
+    struct lookup sLookup;
+    struct lookupOutcome sOutcome;
+    void (*pfDone)(size_t, int, NodeD_T, NodeF_T, void *) =
+        (void (*)(size_t, int, NodeD_T, NodeF_T, void *)) FT_oneDone;
+
+    assert(pcPath != NULL);
+    assert(poNdFound != NULL);
+    assert(poNfFound != NULL);
+
+    if(FT_startLookup(&sLookup, 0, pcPath, pfDone, &sOutcome))
+        while(FT_stepLookup(&sLookup, pfDone, &sOutcome))
+            ;
+
+    *poNdFound = sOutcome.oNdFound;
+    *poNfFound = sOutcome.oNfFound;
+    return sOutcome.iStatus;
+}
+
+/* ================================================================== */
+int FT_stat(const char *pcPath, boolean *pbIsFile, size_t *pulSize) {
+    NodeD_T oNdFound = NULL;
+    NodeF_T oNfFound = NULL;
+    int iStatus;
+
+    assert(pcPath != NULL);
+
+    if(!bIsInitialized)
+        return INITIALIZATION_ERROR;
+
+    /* one traversal finds the path as a file or as a directory */
+    iStatus = FT_lookupOne(pcPath, &oNdFound, &oNfFound);
+    if(iStatus != SUCCESS)
+        return iStatus;
+
+    /* Case 1: path found as a directory */
+    if (oNdFound != NULL) {
+        *pbIsFile = (int) FALSE;
+        return SUCCESS;
+    }
+    /* Case 2: path found as a file */
+    *pbIsFile = (int) TRUE;
+    *pulSize = NodeF_getLength(oNfFound);
+    return SUCCESS;
+}
+
+/* ================================================================== */
+/*
+  The following auxiliary functions and structure are used for 
+  listing directories with cursors.
+*/
+
+/* A cursor over the children of a directory */
+struct dirCursor {
+    /* the directory, valid while ulGeneration is unchanged */
+    NodeD_T oNdDir;
+    /* value of ulGeneration when oNdDir and ulNext were last valid */
+    size_t ulGeneration;
+    /* TRUE while listing the file children, FALSE once listing the 
+       directory children */
+    boolean bInFiles;
+    /* index of the next child to list */
+    size_t ulNext;
+    /* full path of the last child listed since bInFiles last changed,
+       or the empty string, to find the place again after the FT 
+       changes */
+    char *pcLast;
+    /* number of bytes allocated for pcLast */
+    size_t ulLastSize;
+    /* the directory's path, stored right after the struct */
+    char *pcDirPath;
+    /* the length of pcDirPath */
+    size_t ulDirLength;
+};
+
+/*
+  Finds oCursor's directory and place in it again after the FT has 
+  changed shape. Returns SUCCESS, or NO_SUCH_PATH if the directory is 
+  no longer in the FT.
+*/
+static int FT_resyncCursor(DirCursor_T oCursor) {
+    NodeD_T oNdFound = NULL;
+    NodeF_T oNfFound = NULL;
+    size_t ulLength;
+    boolean bFound;
+
+    assert(oCursor != NULL);
+
+    if(FT_lookupOne(oCursor->pcDirPath, &oNdFound, &oNfFound) 
+       != SUCCESS || oNdFound == NULL)
+        return NO_SUCH_PATH;
+    oCursor->oNdDir = oNdFound;
+
+    /* resume right after the last child listed, even if it is gone */
+    oCursor->ulNext = 0;
+    ulLength = strlen(oCursor->pcLast);
+    if(ulLength != 0) {
+        if(oCursor->bInFiles)
+            bFound = NodeD_findFileChild(oNdFound, oCursor->pcLast,
+                                         ulLength, &oCursor->ulNext);
+        else
+            bFound = NodeD_findDirChild(oNdFound, oCursor->pcLast,
+                                        ulLength, &oCursor->ulNext);
+        if(bFound)
+            oCursor->ulNext++;
+    }
+
+    oCursor->ulGeneration = ulGeneration;
+    return SUCCESS;
+}
+
+/*
+  Records oPPath as the path of the last child oCursor has listed.
+  Returns SUCCESS, or MEMORY_ERROR if room for it could not be 
+  allocated.
+*/
+static int FT_rememberLast(DirCursor_T oCursor, Path_T oPPath) {
+    size_t ulSize;
+    char *pcNew;
+
+    assert(oCursor != NULL);
+    assert(oPPath != NULL);
+
+    ulSize = Path_getStrLength(oPPath) + 1;
+    if(ulSize > oCursor->ulLastSize) {
+        pcNew = realloc(oCursor->pcLast, ulSize);
+        if(pcNew == NULL)
+            return MEMORY_ERROR;
+        oCursor->pcLast = pcNew;
+        oCursor->ulLastSize = ulSize;
+    }
+    strcpy(oCursor->pcLast, Path_getPathname(oPPath));
+    return SUCCESS;
+}
+
+/* ================================================================== */
+int FT_openDir(const char *pcPath, DirCursor_T *poCursor) {
+    int iStatus;
+    NodeD_T oNdFound = NULL;
+    NodeF_T oNfFound = NULL;
+    NodeD_T oNdChild = NULL;
+    NodeF_T oNfChild = NULL;
+    DirCursor_T oCursor;
+    size_t ulDirLength, ulLongest, ulLength;
+    size_t i;
+
+    assert(pcPath != NULL);
+    assert(poCursor != NULL);
+
+    if(!bIsInitialized)
+        return INITIALIZATION_ERROR;
+
+    iStatus = FT_lookupOne(pcPath, &oNdFound, &oNfFound);
+    if(iStatus != SUCCESS)
+        return iStatus;
+    if(oNfFound != NULL)
+        return NOT_A_DIRECTORY;
+
+    /* make room for the longest child path now, so that listing
+       allocates nothing unless a longer one is inserted later */
+    ulDirLength = Path_getStrLength(NodeD_getPath(oNdFound));
+    ulLongest = ulDirLength;
+    for(i = 0; i < NodeD_getNumFileChildren(oNdFound); i++) {
+        (void)NodeD_getFileChild(oNdFound, i, &oNfChild);
+        ulLength = Path_getStrLength(NodeF_getPath(oNfChild));
+        if(ulLength > ulLongest)
+            ulLongest = ulLength;
+    }
+    for(i = 0; i < NodeD_getNumDirChildren(oNdFound); i++) {
+        (void)NodeD_getDirChild(oNdFound, i, &oNdChild);
+        ulLength = Path_getStrLength(NodeD_getPath(oNdChild));
+        if(ulLength > ulLongest)
+            ulLongest = ulLength;
+    }
+
+    oCursor = malloc(sizeof(struct dirCursor) + ulDirLength + 1);
+    if(oCursor == NULL)
+        return MEMORY_ERROR;
+    oCursor->pcLast = malloc(ulLongest + 1);
+    if(oCursor->pcLast == NULL) {
+        free(oCursor);
+        return MEMORY_ERROR;
+    }
+
+    oCursor->oNdDir = oNdFound;
+    oCursor->ulGeneration = ulGeneration;
+    oCursor->bInFiles = TRUE;
+    oCursor->ulNext = 0;
+    oCursor->pcLast[0] = '\0';
+    oCursor->ulLastSize = ulLongest + 1;
+    oCursor->pcDirPath = (char *)(oCursor + 1);
+    strcpy(oCursor->pcDirPath, Path_getPathname(NodeD_getPath(oNdFound)));
+    oCursor->ulDirLength = ulDirLength;
+
+    *poCursor = oCursor;
+    return SUCCESS;
+}
+
+/* ================================================================== */
+int FT_readDir(DirCursor_T oCursor, struct FT_dirEntry *psEntries,
+               size_t ulMax, size_t *pulRead) {
+    int iStatus;
+    NodeD_T oNdChild = NULL;
+    NodeF_T oNfChild = NULL;
+    Path_T oPLast = NULL;  /* path of the last child listed, if any */
+    boolean bWasInFiles;
+    size_t ulWasNext;
+    size_t ulRead = 0;
+
+    assert(oCursor != NULL);
+    assert(psEntries != NULL || ulMax == 0);
+    assert(pulRead != NULL);
+
+    if(!bIsInitialized)
+        return INITIALIZATION_ERROR;
+
+    if(oCursor->ulGeneration != ulGeneration) {
+        iStatus = FT_resyncCursor(oCursor);
+        if(iStatus != SUCCESS)
+            return iStatus;
+    }
+
+    bWasInFiles = oCursor->bInFiles;
+    ulWasNext = oCursor->ulNext;
+    while(ulRead < ulMax) {
+        if(oCursor->bInFiles) {
+            if(NodeD_getFileChild(oCursor->oNdDir, oCursor->ulNext,
+                                  &oNfChild) != SUCCESS) {
+                /* on to the directory children */
+                oCursor->bInFiles = FALSE;
+                oCursor->ulNext = 0;
+                oCursor->pcLast[0] = '\0';
+                oPLast = NULL;
+                continue;
+            }
+            oPLast = NodeF_getPath(oNfChild);
+            psEntries[ulRead].bIsFile = TRUE;
+            psEntries[ulRead].ulSize = NodeF_getLength(oNfChild);
+        }
+        else {
+            if(NodeD_getDirChild(oCursor->oNdDir, oCursor->ulNext,
+                                 &oNdChild) != SUCCESS)
+                break;
+            oPLast = NodeD_getPath(oNdChild);
+            psEntries[ulRead].bIsFile = FALSE;
+            psEntries[ulRead].ulSize = 0;
+        }
+        psEntries[ulRead].pcName = 
+            Path_getPathname(oPLast) + oCursor->ulDirLength + 1;
+        oCursor->ulNext++;
+        ulRead++;
+    }
+
+    if(oPLast != NULL) {
+        iStatus = FT_rememberLast(oCursor, oPLast);
+        if(iStatus != SUCCESS) {
+            oCursor->bInFiles = bWasInFiles;
+            oCursor->ulNext = ulWasNext;
+            return iStatus;
+        }
+    }
+
+    *pulRead = ulRead;
+    return SUCCESS;
+}
+
+/* ================================================================== */
+void FT_closeDir(DirCursor_T oCursor) {
+    assert(oCursor != NULL);
+
+    free(oCursor->pcLast);
+    free(oCursor);
+}
+
+/* ================================================================== */
+/*
+  The following auxiliary functions and structures are used for 
+  walking a subtree with FT_walk.
+*/
+
+/* The state of a walk shared by every visit */
+struct walk {
+    /* the visitor and its extra argument */
+    enum FT_walkAction (*pfVisit)(const struct FT_walkEntry *, void *);
+    void *pvExtra;
+    /* the order of the walk */
+    enum FT_walkOrder eOrder;
+    /* the depth of the path the walk started from */
+    size_t ulStartDepth;
+};
+
+/* A queue of directories, for breadth-first walks */
+struct dirQueue {
+    /* ring buffer of ulCapacity directories, ulCount of them queued
+       starting at index ulHead */
+    NodeD_T *aoNdDirs;
+    size_t ulHead;
+    size_t ulCount;
+    size_t ulCapacity;
+};
+
+/* Initial capacity of a dirQueue */
+enum { FT_QUEUE_MIN = 16 };
+
+/*
+  Visits the node with path oPPath and name pcName, a file of length
+  ulSize if bIsFile, with psWalk's visitor, and returns its answer.
+*/
+static enum FT_walkAction FT_visit(struct walk *psWalk, Path_T oPPath,
+                                   const char *pcName, boolean bIsFile,
+                                   size_t ulSize) {
+    struct FT_walkEntry sEntry;
+
+    assert(psWalk != NULL);
+    assert(oPPath != NULL);
+    assert(pcName != NULL);
+
+    sEntry.pcPath = Path_getPathname(oPPath);
+    sEntry.pcName = pcName;
+    sEntry.bIsFile = bIsFile;
+    sEntry.ulSize = ulSize;
+    sEntry.ulDepth = Path_getDepth(oPPath) - psWalk->ulStartDepth;
+    return (*psWalk->pfVisit)(&sEntry, psWalk->pvExtra);
+}
+
+/*
+  Visits the file children of oNdDir with psWalk's visitor. Returns 
+  FT_WALK_STOP if the visitor asked to stop, and FT_WALK_CONTINUE 
+  otherwise.
+*/
+static enum FT_walkAction FT_visitFiles(struct walk *psWalk,
+                                        NodeD_T oNdDir) {
+    NodeF_T oNfChild = NULL;
+    Path_T oPChild;
+    size_t ulDirLength;
+    size_t i;
+
+    assert(psWalk != NULL);
+    assert(oNdDir != NULL);
+
+    ulDirLength = Path_getStrLength(NodeD_getPath(oNdDir));
+    for(i = 0; i < NodeD_getNumFileChildren(oNdDir); i++) {
+        (void)NodeD_getFileChild(oNdDir, i, &oNfChild);
+        oPChild = NodeF_getPath(oNfChild);
+        if(FT_visit(psWalk, oPChild,
+                    Path_getPathname(oPChild) + ulDirLength + 1, TRUE,
+                    NodeF_getLength(oNfChild)) == FT_WALK_STOP)
+            return FT_WALK_STOP;
+    }
+    return FT_WALK_CONTINUE;
+}
+
+/*
+  Walks the subtree rooted at oNdDir, with name pcName, depth-first in
+  psWalk's order: in pre-order a directory is visited before its file
+  children and then its directory children's subtrees, as 
+  FT_toString orders them, and in post-order after them.
+  Returns FT_WALK_STOP if the visitor asked to stop, and 
+  FT_WALK_CONTINUE otherwise.
+*/
+static enum FT_walkAction FT_walkDepthFirst(struct walk *psWalk,
+                                            NodeD_T oNdDir,
+                                            const char *pcName) {
+    enum FT_walkAction eAction;
+    NodeD_T oNdChild = NULL;
+    size_t ulDirLength;
+    size_t i;
+
+    assert(psWalk != NULL);
+    assert(oNdDir != NULL);
+    assert(pcName != NULL);
+
+    if(psWalk->eOrder == FT_WALK_PRE) {
+        eAction = FT_visit(psWalk, NodeD_getPath(oNdDir), pcName,
+                           FALSE, 0);
+        if(eAction != FT_WALK_CONTINUE)
+            return eAction == FT_WALK_STOP ? FT_WALK_STOP
+                                           : FT_WALK_CONTINUE;
+    }
+
+    if(FT_visitFiles(psWalk, oNdDir) == FT_WALK_STOP)
+        return FT_WALK_STOP;
+
+    ulDirLength = Path_getStrLength(NodeD_getPath(oNdDir));
+    for(i = 0; i < NodeD_getNumDirChildren(oNdDir); i++) {
+        (void)NodeD_getDirChild(oNdDir, i, &oNdChild);
+        if(FT_walkDepthFirst(psWalk, oNdChild,
+                             Path_getPathname(NodeD_getPath(oNdChild))
+                             + ulDirLength + 1) == FT_WALK_STOP)
+            return FT_WALK_STOP;
+    }
+
+    if(psWalk->eOrder == FT_WALK_POST &&
+       FT_visit(psWalk, NodeD_getPath(oNdDir), pcName, FALSE, 0)
+       == FT_WALK_STOP)
+        return FT_WALK_STOP;
+
+    return FT_WALK_CONTINUE;
+}
+
+/*
+  Appends oNdDir to the end of *psQueue, growing it if full. Returns
+  SUCCESS, or MEMORY_ERROR if it could not be grown.
+*/
+static int FT_queuePush(struct dirQueue *psQueue, NodeD_T oNdDir) {
+    NodeD_T *aoNdNew;
+    size_t ulNewCapacity;
+    size_t i;
+
+    assert(psQueue != NULL);
+    assert(oNdDir != NULL);
+
+    if(psQueue->ulCount == psQueue->ulCapacity) {
+        ulNewCapacity = psQueue->ulCapacity == 0 ?
+            FT_QUEUE_MIN : psQueue->ulCapacity * 2;
+        aoNdNew = malloc(ulNewCapacity * sizeof(NodeD_T));
+        if(aoNdNew == NULL)
+            return MEMORY_ERROR;
+        for(i = 0; i < psQueue->ulCount; i++)
+            aoNdNew[i] = psQueue->aoNdDirs[(psQueue->ulHead + i) %
+                                           psQueue->ulCapacity];
+        free(psQueue->aoNdDirs);
+        psQueue->aoNdDirs = aoNdNew;
+        psQueue->ulHead = 0;
+        psQueue->ulCapacity = ulNewCapacity;
+    }
+
+    psQueue->aoNdDirs[(psQueue->ulHead + psQueue->ulCount) %
+                      psQueue->ulCapacity] = oNdDir;
+    psQueue->ulCount++;
+    return SUCCESS;
+}
+
+/* Removes and returns the directory at the front of *psQueue. */
+static NodeD_T FT_queuePop(struct dirQueue *psQueue) {
+    NodeD_T oNdDir;
+
+    assert(psQueue != NULL);
+    assert(psQueue->ulCount > 0);
+
+    oNdDir = psQueue->aoNdDirs[psQueue->ulHead];
+    psQueue->ulHead = (psQueue->ulHead + 1) % psQueue->ulCapacity;
+    psQueue->ulCount--;
+    return oNdDir;
+}
+
+/*
+  Walks the subtree rooted at oNdStart, with name pcName, 
+  breadth-first: each level is visited before the next, and the 
+  children of a directory are visited together, files first. Only the
+  directories of the level being visited and of the next are queued.
+  Returns SUCCESS, or MEMORY_ERROR if the queue could not be grown.
+*/
+static int FT_walkBreadthFirst(struct walk *psWalk, NodeD_T oNdStart,
+                               const char *pcName) {
+    struct dirQueue sQueue = {NULL, 0, 0, 0};
+    enum FT_walkAction eAction;
+    NodeD_T oNdDir;
+    NodeD_T oNdChild = NULL;
+    Path_T oPChild;
+    size_t ulDirLength;
+    size_t i;
+    int iStatus = SUCCESS;
+
+    assert(psWalk != NULL);
+    assert(oNdStart != NULL);
+    assert(pcName != NULL);
+
+    eAction = FT_visit(psWalk, NodeD_getPath(oNdStart), pcName, FALSE,
+                       0);
+    if(eAction == FT_WALK_CONTINUE)
+        iStatus = FT_queuePush(&sQueue, oNdStart);
+
+    while(iStatus == SUCCESS && sQueue.ulCount > 0) {
+        oNdDir = FT_queuePop(&sQueue);
+        if(FT_visitFiles(psWalk, oNdDir) == FT_WALK_STOP)
+            break;
+
+        ulDirLength = Path_getStrLength(NodeD_getPath(oNdDir));
+        for(i = 0; i < NodeD_getNumDirChildren(oNdDir); i++) {
+            (void)NodeD_getDirChild(oNdDir, i, &oNdChild);
+            oPChild = NodeD_getPath(oNdChild);
+            eAction = FT_visit(psWalk, oPChild,
+                               Path_getPathname(oPChild) + 
+                               ulDirLength + 1, FALSE, 0);
+            if(eAction == FT_WALK_STOP)
+                break;
+            if(eAction == FT_WALK_CONTINUE) {
+                iStatus = FT_queuePush(&sQueue, oNdChild);
+                if(iStatus != SUCCESS)
+                    break;
+            }
+        }
+        if(eAction == FT_WALK_STOP)
+            break;
+    }
+
+    free(sQueue.aoNdDirs);
+    return iStatus;
+}
+
+/* ================================================================== */
+int FT_walk(const char *pcPath, enum FT_walkOrder eOrder,
+            enum FT_walkAction (*pfVisit)(const struct FT_walkEntry *,
+                                          void *),
+            void *pvExtra) {
+    struct walk sWalk;
+    NodeD_T oNdFound = NULL;
+    NodeF_T oNfFound = NULL;
+    Path_T oPFound;
+    const char *pcName;
+    int iStatus;
+
+    assert(pcPath != NULL);
+    assert(pfVisit != NULL);
+
+    if(!bIsInitialized)
+        return INITIALIZATION_ERROR;
+
+    iStatus = FT_lookupOne(pcPath, &oNdFound, &oNfFound);
+    if(iStatus != SUCCESS)
+        return iStatus;
+
+    oPFound = oNfFound != NULL ? NodeF_getPath(oNfFound) 
+                               : NodeD_getPath(oNdFound);
+    pcName = strrchr(Path_getPathname(oPFound), '/');
+    pcName = pcName != NULL ? pcName + 1 : Path_getPathname(oPFound);
+
+    sWalk.pfVisit = pfVisit;
+    sWalk.pvExtra = pvExtra;
+    sWalk.eOrder = eOrder;
+    sWalk.ulStartDepth = Path_getDepth(oPFound);
+
+    if(oNfFound != NULL) {
+        (void)FT_visit(&sWalk, oPFound, pcName, TRUE,
+                       NodeF_getLength(oNfFound));
+        return SUCCESS;
+    }
+    if(eOrder == FT_WALK_BFS)
+        return FT_walkBreadthFirst(&sWalk, oNdFound, pcName);
+    (void)FT_walkDepthFirst(&sWalk, oNdFound, pcName);
+    return SUCCESS;
+}
+
+/* ================================================================== */
+/*
+  The following auxiliary functions and structures are used for 
+  matching paths against patterns with FT_glob.
+*/
+
+/* Largest number of components of a compiled pattern */
+enum { FT_GLOB_MAX = 31 };
+
+/* A component of a compiled pattern */
+struct globComp {
+    /* the component's text, with wildcards, ended by '\0' */
+    const char *pcText;
+    /* the length of the text before the first wildcard */
+    size_t ulLiteral;
+    /* whether the component is "**", matching any number of 
+       components */
+    boolean bDeep;
+};
+
+/* A compiled pattern */
+struct glob {
+    /* the walk state shared with FT_walk, for visiting matches */
+    struct walk sWalk;
+    /* the components, and how many there are */
+    struct globComp asComps[FT_GLOB_MAX];
+    size_t ulCount;
+    /* a copy of the pattern with each '/' replaced by '\0' */
+    char *pcText;
+};
+
+/*
+  Matches character c against the character class starting at pcClass
+  with '['. Sets *pbMatch to whether c is in the class and returns the
+  length of the class up to and including its ']', or returns 0 if the
+  class has no ']' (so that its '[' is an ordinary character).
+*/
+static size_t FT_globClass(const char *pcClass, char c,
+                           boolean *pbMatch) {
+    const char *pc = pcClass + 1;
+    boolean bNegated = FALSE;
+    boolean bMatch = FALSE;
+    unsigned char ucLow, ucHigh;
+
+    assert(pcClass != NULL && *pcClass == '[');
+    assert(pbMatch != NULL);
+
+    if(*pc == '!' || *pc == '^') {
+        bNegated = TRUE;
+        pc++;
+    }
+    /* a ']' right after the '[' is a member, not the end */
+    do {
+        if(*pc == '\0')
+            return 0;
+        ucLow = (unsigned char)*pc;
+        if(pc[1] == '-' && pc[2] != ']' && pc[2] != '\0') {
+            ucHigh = (unsigned char)pc[2];
+            pc += 3;
+        }
+        else {
+            ucHigh = ucLow;
+            pc++;
+        }
+        if((unsigned char)c >= ucLow && (unsigned char)c <= ucHigh)
+            bMatch = TRUE;
+    } while(*pc != ']');
+
+    *pbMatch = (boolean)(bMatch != bNegated);
+    return (size_t)(pc + 1 - pcClass);
+}
+
+/*
+  Returns TRUE if name pcName matches pattern component pcPattern, in
+  which '*' matches any run of characters, '?' any one character, and
+  "[...]" any one character of the class, and FALSE otherwise.
+*/
+static boolean FT_globMatch(const char *pcPattern, const char *pcName) {
+    const char *pcStarPattern = NULL; /* pattern after the last '*' */
+    const char *pcStarName = NULL;    /* where that '*' match ends */
+    size_t ulClass;
+    boolean bInClass;
+
+    assert(pcPattern != NULL);
+    assert(pcName != NULL);
+
+    while(*pcName != '\0') {
+        if(*pcPattern == '*') {
+            pcStarPattern = ++pcPattern;
+            pcStarName = pcName;
+            continue;
+        }
+        if(*pcPattern == '?') {
+            pcPattern++;
+            pcName++;
+            continue;
+        }
+        ulClass = *pcPattern == '[' ?
+            FT_globClass(pcPattern, *pcName, &bInClass) : 0;
+        if(ulClass != 0 ? bInClass : *pcPattern == *pcName) {
+            pcPattern += ulClass != 0 ? ulClass : 1;
+            pcName++;
+            continue;
+        }
+        /* mismatch: let the last '*' match one more character */
+        if(pcStarPattern == NULL)
+            return FALSE;
+        pcPattern = pcStarPattern;
+        pcName = ++pcStarName;
+    }
+
+    while(*pcPattern == '*')
+        pcPattern++;
+    return (boolean)(*pcPattern == '\0');
+}
+
+/*
+  Adds to the set of pattern positions ulStates every position 
+  reachable from one in it by letting a "**" component match no 
+  components, and returns the result.
+*/
+static unsigned long FT_globClose(const struct glob *psGlob,
+                                  unsigned long ulStates) {
+    size_t i;
+
+    assert(psGlob != NULL);
+
+    for(i = 0; i < psGlob->ulCount; i++)
+        if((ulStates & (1UL << i)) && psGlob->asComps[i].bDeep)
+            ulStates |= 1UL << (i + 1);
+    return ulStates;
+}
+
+/*
+  Returns the set of pattern positions reached from those in ulStates
+  by matching a node named pcName: position i, the number of 
+  components matched so far, moves to i + 1 if the name matches 
+  component i, and stays if component i is "**". The node matches the 
+  whole pattern if position psGlob->ulCount is in the result, and its
+  descendants may match if any other position is.
+*/
+static unsigned long FT_globAdvance(const struct glob *psGlob,
+                                    unsigned long ulStates,
+                                    const char *pcName) {
+    unsigned long ulNext = 0;
+    size_t i;
+
+    assert(psGlob != NULL);
+    assert(pcName != NULL);
+
+    for(i = 0; i < psGlob->ulCount; i++) {
+        if(!(ulStates & (1UL << i)))
+            continue;
+        if(psGlob->asComps[i].bDeep)
+            ulNext |= 1UL << i;
+        else if(FT_globMatch(psGlob->asComps[i].pcText, pcName))
+            ulNext |= 1UL << (i + 1);
+    }
+    return FT_globClose(psGlob, ulNext);
+}
+
+/*
+  Compiles pattern pcPattern into *psGlob. A component "**" matches 
+  any number of components, and one starting with "**", as in "**.gz",
+  is read as "**" followed by the rest with a single '*', as in 
+  "**" "*.gz". Returns SUCCESS, or BAD_PATH if pcPattern is not a 
+  well-formatted path or has too many components, or MEMORY_ERROR.
+*/
+static int FT_globCompile(struct glob *psGlob, const char *pcPattern) {
+    struct globComp *psComp;
+    char *pc;
+    int iStatus;
+
+    assert(psGlob != NULL);
+    assert(pcPattern != NULL);
+
+    iStatus = FT_checkPath(pcPattern);
+    if(iStatus != SUCCESS)
+        return iStatus;
+
+    psGlob->pcText = malloc(strlen(pcPattern) + 1);
+    if(psGlob->pcText == NULL)
+        return MEMORY_ERROR;
+    strcpy(psGlob->pcText, pcPattern);
+
+    psGlob->ulCount = 0;
+    pc = psGlob->pcText;
+    while(pc != NULL) {
+        if(psGlob->ulCount + 2 > FT_GLOB_MAX) {
+            free(psGlob->pcText);
+            return BAD_PATH;
+        }
+        psComp = &psGlob->asComps[psGlob->ulCount++];
+        psComp->pcText = pc;
+        psComp->bDeep = FALSE;
+        if(pc[0] == '*' && pc[1] == '*') {
+            psComp->bDeep = TRUE;
+            if(pc[2] != '\0' && pc[2] != '/') {
+                /* the rest, from the second '*', is a component */
+                psComp = &psGlob->asComps[psGlob->ulCount++];
+                psComp->pcText = pc + 1;
+                psComp->bDeep = FALSE;
+            }
+        }
+        psComp->ulLiteral = strcspn(psComp->pcText, "*?[/");
+
+        pc = strchr(pc, '/');
+        if(pc != NULL)
+            *pc++ = '\0';
+    }
+    return SUCCESS;
+}
+
+/*
+  Returns TRUE if only the children of a directory whose names start 
+  with some literal text can match from the set of pattern positions 
+  ulStates, setting *ppcPrefix and *pulLength to that text; returns 
+  FALSE if every child must be tried.
+*/
+static boolean FT_globPrefix(const struct glob *psGlob,
+                             unsigned long ulStates,
+                             const char **ppcPrefix,
+                             size_t *pulLength) {
+    size_t i;
+
+    assert(psGlob != NULL);
+    assert(ppcPrefix != NULL);
+    assert(pulLength != NULL);
+
+    /* a child can only move on from the positions before the end */
+    ulStates &= ~(1UL << psGlob->ulCount);
+    for(i = 0; i < psGlob->ulCount; i++)
+        if(ulStates == 1UL << i)
+            break;
+    if(i == psGlob->ulCount || psGlob->asComps[i].bDeep ||
+       psGlob->asComps[i].ulLiteral == 0)
+        return FALSE;
+
+    *ppcPrefix = psGlob->asComps[i].pcText;
+    *pulLength = psGlob->asComps[i].ulLiteral;
+    return TRUE;
+}
+
+/*
+  Visits, with psGlob's visitor, the descendants of oNdDir that match
+  psGlob, where ulStates is the set of pattern positions reached at
+  oNdDir. Children whose names cannot match are skipped by searching 
+  the sorted children for a literal prefix. Returns FT_WALK_STOP if 
+  the visitor asked to stop, and FT_WALK_CONTINUE otherwise.
+*/
+static enum FT_walkAction FT_globChildren(struct glob *psGlob,
+                                          NodeD_T oNdDir,
+                                          unsigned long ulStates) {
+    unsigned long ulEnd = 1UL << psGlob->ulCount;
+    unsigned long ulChildStates;
+    enum FT_walkAction eAction;
+    NodeD_T oNdChild = NULL;
+    NodeF_T oNfChild = NULL;
+    Path_T oPChild;
+    const char *pcPrefix = NULL;
+    const char *pcName;
+    size_t ulPrefixLength = 0;
+    size_t ulDirLength;
+    boolean bSeek;
+    size_t i;
+
+    assert(psGlob != NULL);
+    assert(oNdDir != NULL);
+
+    ulDirLength = Path_getStrLength(NodeD_getPath(oNdDir));
+    bSeek = FT_globPrefix(psGlob, ulStates, &pcPrefix, &ulPrefixLength);
+
+    i = bSeek ? NodeD_seekFileChildren(oNdDir, pcPrefix,
+                                       ulPrefixLength) : 0;
+    for(; i < NodeD_getNumFileChildren(oNdDir); i++) {
+        (void)NodeD_getFileChild(oNdDir, i, &oNfChild);
+        oPChild = NodeF_getPath(oNfChild);
+        pcName = Path_getPathname(oPChild) + ulDirLength + 1;
+        if(bSeek && strncmp(pcName, pcPrefix, ulPrefixLength) != 0)
+            break;
+        ulChildStates = FT_globAdvance(psGlob, ulStates, pcName);
+        if((ulChildStates & ulEnd) &&
+           FT_visit(&psGlob->sWalk, oPChild, pcName, TRUE,
+                    NodeF_getLength(oNfChild)) == FT_WALK_STOP)
+            return FT_WALK_STOP;
+    }
+
+    i = bSeek ? NodeD_seekDirChildren(oNdDir, pcPrefix,
+                                      ulPrefixLength) : 0;
+    for(; i < NodeD_getNumDirChildren(oNdDir); i++) {
+        (void)NodeD_getDirChild(oNdDir, i, &oNdChild);
+        oPChild = NodeD_getPath(oNdChild);
+        pcName = Path_getPathname(oPChild) + ulDirLength + 1;
+        if(bSeek && strncmp(pcName, pcPrefix, ulPrefixLength) != 0)
+            break;
+        ulChildStates = FT_globAdvance(psGlob, ulStates, pcName);
+        eAction = FT_WALK_CONTINUE;
+        if(ulChildStates & ulEnd)
+            eAction = FT_visit(&psGlob->sWalk, oPChild, pcName, FALSE,
+                               0);
+        if(eAction == FT_WALK_STOP)
+            return FT_WALK_STOP;
+        if(eAction == FT_WALK_CONTINUE && (ulChildStates & ~ulEnd) &&
+           FT_globChildren(psGlob, oNdChild, ulChildStates) 
+           == FT_WALK_STOP)
+            return FT_WALK_STOP;
+    }
+
+    return FT_WALK_CONTINUE;
+}
+
+/* ================================================================== */
+int FT_glob(const char *pcPattern,
+            enum FT_walkAction (*pfVisit)(const struct FT_walkEntry *,
+                                          void *),
+            void *pvExtra) {
+    struct glob sGlob;
+    unsigned long ulStates;
+    enum FT_walkAction eAction = FT_WALK_CONTINUE;
+    Path_T oPRoot;
+    int iStatus;
+
+    assert(pcPattern != NULL);
+    assert(pfVisit != NULL);
+
+    if(!bIsInitialized)
+        return INITIALIZATION_ERROR;
+
+    iStatus = FT_globCompile(&sGlob, pcPattern);
+    if(iStatus != SUCCESS)
+        return iStatus;
+
+    if(oNRoot != NULL) {
+        sGlob.sWalk.pfVisit = pfVisit;
+        sGlob.sWalk.pvExtra = pvExtra;
+        sGlob.sWalk.eOrder = FT_WALK_PRE;
+        sGlob.sWalk.ulStartDepth = 0;
+
+        oPRoot = NodeD_getPath(oNRoot);
+        ulStates = FT_globAdvance(&sGlob, FT_globClose(&sGlob, 1UL),
+                                  Path_getPathname(oPRoot));
+        if(ulStates & (1UL << sGlob.ulCount))
+            eAction = FT_visit(&sGlob.sWalk, oPRoot,
+                               Path_getPathname(oPRoot), FALSE, 0);
+        if(eAction == FT_WALK_CONTINUE &&
+           (ulStates & ~(1UL << sGlob.ulCount)))
+            (void)FT_globChildren(&sGlob, oNRoot, ulStates);
+    }
+
+    free(sGlob.pcText);
+    return SUCCESS;
+}
+
+/* ================================================================== */
+/*
+  The following auxiliary functions and structure are used for 
+  finding nodes by name with FT_findByName.
+*/
+
+/* A search by name */
+struct nameSearch {
+    /* the walk state shared with FT_walk, for visiting matches */
+    struct walk sWalk;
+    /* the name sought */
+    const char *pcName;
+    /* the visitor's last answer */
+    enum FT_walkAction eAction;
+};
+
+/*
+  Visits node pvNode, a file if bIsFile and a directory otherwise, 
+  found in the name index, with psSearch's visitor. Returns FALSE if
+  the visitor asked to stop, and TRUE otherwise.
+*/
+static boolean FT_nameFound(boolean bIsFile, void *pvNode,
+                            struct nameSearch *psSearch) {
+    Path_T oPPath;
+
+    assert(pvNode != NULL);
+    assert(psSearch != NULL);
+
+    oPPath = bIsFile ? NodeF_getPath((NodeF_T)pvNode)
+                     : NodeD_getPath((NodeD_T)pvNode);
+    psSearch->eAction = FT_visit(&psSearch->sWalk, oPPath,
+                                 psSearch->pcName, bIsFile,
+                                 bIsFile ? NodeF_getLength(pvNode) : 0);
+    return (boolean)(psSearch->eAction != FT_WALK_STOP);
+}
+
+/*
+  Passes psEntry on to psSearch's visitor if it has the name sought,
+  for searching an FT without a name index by walking it.
+*/
+static enum FT_walkAction FT_nameFilter(
+    const struct FT_walkEntry *psEntry, struct nameSearch *psSearch) {
+    assert(psEntry != NULL);
+    assert(psSearch != NULL);
+
+    if(strcmp(psEntry->pcName, psSearch->pcName) != 0)
+        return FT_WALK_CONTINUE;
+    return (*psSearch->sWalk.pfVisit)(psEntry, psSearch->sWalk.pvExtra);
+}
+
+/* ================================================================== */
+int FT_findByName(const char *pcName,
+                  enum FT_walkAction (*pfVisit)(
+                      const struct FT_walkEntry *, void *),
+                  void *pvExtra) {
+    struct nameSearch sSearch;
+    struct walk sFilter;
+
+    assert(pcName != NULL);
+    assert(pfVisit != NULL);
+
+    if(!bIsInitialized)
+        return INITIALIZATION_ERROR;
+    if(*pcName == '\0' || strchr(pcName, '/') != NULL)
+        return BAD_PATH;
+    if(oNRoot == NULL)
+        return SUCCESS;
+
+    sSearch.sWalk.pfVisit = pfVisit;
+    sSearch.sWalk.pvExtra = pvExtra;
+    sSearch.sWalk.eOrder = FT_WALK_PRE;
+    sSearch.sWalk.ulStartDepth = 0;
+    sSearch.pcName = pcName;
+    sSearch.eAction = FT_WALK_CONTINUE;
+
+    if(NameIndex_isEnabled()) {
+        NameIndex_find(pcName,
+                       (boolean (*)(boolean, void *, void *))
+                       FT_nameFound, &sSearch);
+        return SUCCESS;
+    }
+
+    /* without the index, every node must be looked at */
+    sFilter.pfVisit = (enum FT_walkAction (*)(
+        const struct FT_walkEntry *, void *)) FT_nameFilter;
+    sFilter.pvExtra = &sSearch;
+    sFilter.eOrder = FT_WALK_PRE;
+    sFilter.ulStartDepth = 0;
+    (void)FT_walkDepthFirst(&sFilter, oNRoot,
+                            Path_getPathname(NodeD_getPath(oNRoot)));
+    return SUCCESS;
+}
+
+/* ================================================================== */
+/*
+  The following auxiliary functions and structure are used for 
+  scanning the FT in order of path with FT_scanRange and 
+  FT_scanPrefix, and for sorting batches in the same order.
+*/
+
+/*
+  Returns the rank of character c in the order in which paths are
+  sorted for scans and batches: the end of the string, then '/', then
+  all other characters in the order of their codes.
+*/
+static int FT_rankPathChar(char c) {
+    if(c == '\0')
+        return 0;
+    if(c == '/')
+        return 1;
+    return (int)(unsigned char)c + 2;
+}
+
+/*
+  Compares pathnames (or any strings) pc1 and pc2 component by 
+  component, so that all of a directory's descendants sort together
+  right after it. Returns <0, 0 or >0 like strcmp.
+*/
+static int FT_comparePaths(const char *pc1, const char *pc2) {
+    assert(pc1 != NULL);
+    assert(pc2 != NULL);
+
+    while(*pc1 != '\0' && *pc1 == *pc2) {
+        pc1++;
+        pc2++;
+    }
+    return FT_rankPathChar(*pc1) - FT_rankPathChar(*pc2);
+}
+
+/* The state of a scan */
+struct scan {
+    /* the walk state shared with FT_walk, for visiting nodes */
+    struct walk sWalk;
+    /* the key that every path visited must be less than, or NULL */
+    const char *pcEnd;
+    /* the text that every path visited must start with, or NULL, and
+       its length */
+    const char *pcPrefix;
+    size_t ulPrefixLength;
+    /* the path of the node the visitor stopped at, or NULL */
+    Path_T oPStopped;
+};
+
+/*
+  Visits the node with path oPPath and name pcName, a file of length
+  ulSize if bIsFile, with psScan's visitor if the path is in the 
+  scan's range. Returns the visitor's answer, or FT_WALK_STOP if the 
+  path is past the range, which ends the scan since every path after
+  it is too.
+*/
+static enum FT_walkAction FT_scanVisit(struct scan *psScan,
+                                       Path_T oPPath,
+                                       const char *pcName,
+                                       boolean bIsFile, size_t ulSize) {
+    const char *pcPath;
+    enum FT_walkAction eAction;
+
+    assert(psScan != NULL);
+    assert(oPPath != NULL);
+
+    pcPath = Path_getPathname(oPPath);
+    if(psScan->pcEnd != NULL &&
+       FT_comparePaths(pcPath, psScan->pcEnd) >= 0)
+        return FT_WALK_STOP;
+    if(psScan->pcPrefix != NULL &&
+       strncmp(pcPath, psScan->pcPrefix, psScan->ulPrefixLength) != 0)
+        return FT_WALK_STOP;
+
+    eAction = FT_visit(&psScan->sWalk, oPPath, pcName, bIsFile, ulSize);
+    if(eAction == FT_WALK_STOP)
+        psScan->oPStopped = oPPath;
+    return eAction;
+}
+
+static enum FT_walkAction FT_scanDir(struct scan *psScan, 
+                                     NodeD_T oNdDir,
+                                     const char *pcName);
+
+/*
+  Scans the children of oNdDir from file child ulFile and directory 
+  child ulDir on, and their subtrees, merging the two child arrays by
+  name. Returns FT_WALK_STOP if the scan ended, and FT_WALK_CONTINUE
+  otherwise.
+*/
+static enum FT_walkAction FT_scanChildren(struct scan *psScan,
+                                          NodeD_T oNdDir, 
+                                          size_t ulFile, size_t ulDir) {
+    NodeF_T oNfChild = NULL;
+    NodeD_T oNdChild = NULL;
+    const char *pcFileName = NULL;
+    const char *pcDirName = NULL;
+    size_t ulNumFiles, ulNumDirs;
+    size_t ulDirLength;
+
+    assert(psScan != NULL);
+    assert(oNdDir != NULL);
+
+    ulDirLength = Path_getStrLength(NodeD_getPath(oNdDir));
+    ulNumFiles = NodeD_getNumFileChildren(oNdDir);
+    ulNumDirs = NodeD_getNumDirChildren(oNdDir);
+
+    while(ulFile < ulNumFiles || ulDir < ulNumDirs) {
+        if(ulFile < ulNumFiles) {
+            (void)NodeD_getFileChild(oNdDir, ulFile, &oNfChild);
+            pcFileName = Path_getPathname(NodeF_getPath(oNfChild)) +
+                         ulDirLength + 1;
+        }
+        if(ulDir < ulNumDirs) {
+            (void)NodeD_getDirChild(oNdDir, ulDir, &oNdChild);
+            pcDirName = Path_getPathname(NodeD_getPath(oNdChild)) +
+                        ulDirLength + 1;
+        }
+
+        /* a file and a directory never have the same name */
+        if(ulDir == ulNumDirs || (ulFile < ulNumFiles &&
+                                  strcmp(pcFileName, pcDirName) < 0)) {
+            if(FT_scanVisit(psScan, NodeF_getPath(oNfChild), 
+                            pcFileName, TRUE, NodeF_getLength(oNfChild))
+               == FT_WALK_STOP)
+                return FT_WALK_STOP;
+            ulFile++;
+        }
+        else {
+            if(FT_scanDir(psScan, oNdChild, pcDirName) == FT_WALK_STOP)
+                return FT_WALK_STOP;
+            ulDir++;
+        }
+    }
+    return FT_WALK_CONTINUE;
+}
+
+/*
+  Scans directory oNdDir, with name pcName, and its subtree. Returns 
+  FT_WALK_STOP if the scan ended, and FT_WALK_CONTINUE otherwise.
+*/
+static enum FT_walkAction FT_scanDir(struct scan *psScan,
+                                     NodeD_T oNdDir,
+                                     const char *pcName) {
+    enum FT_walkAction eAction;
+
+    assert(psScan != NULL);
+    assert(oNdDir != NULL);
+
+    eAction = FT_scanVisit(psScan, NodeD_getPath(oNdDir), pcName,
+                           FALSE, 0);
+    if(eAction != FT_WALK_CONTINUE)
+        return eAction == FT_WALK_STOP ? FT_WALK_STOP : FT_WALK_CONTINUE;
+    return FT_scanChildren(psScan, oNdDir, 0, 0);
+}
+
+/*
+  Scans the nodes of the subtree below oNdDir whose paths are not less
+  than pcKey, which starts with oNdDir's path and a '/', seeking 
+  straight to the first of them by binary search at each level. 
+  Returns FT_WALK_STOP if the scan ended, and FT_WALK_CONTINUE 
+  otherwise.
+*/
+static enum FT_walkAction FT_scanSeek(struct scan *psScan,
+                                      NodeD_T oNdDir,
+                                      const char *pcKey) {
+    NodeF_T oNfChild = NULL;
+    NodeD_T oNdChild = NULL;
+    const char *pcComponent;
+    const char *pcName;
+    size_t ulLength;
+    size_t ulDirLength;
+    size_t ulFile, ulDir;
+    boolean bDeeper;
+
+    assert(psScan != NULL);
+    assert(oNdDir != NULL);
+    assert(pcKey != NULL);
+
+    /* the key's component at the children's level */
+    ulDirLength = Path_getStrLength(NodeD_getPath(oNdDir));
+    pcComponent = pcKey + ulDirLength + 1;
+    ulLength = strcspn(pcComponent, "/");
+    bDeeper = (boolean)(pcComponent[ulLength] == '/');
+
+    /* a file named as the component is before a key reaching deeper */
+    ulFile = NodeD_seekFileChildren(oNdDir, pcComponent, ulLength);
+    if(bDeeper && ulFile < NodeD_getNumFileChildren(oNdDir)) {
+        (void)NodeD_getFileChild(oNdDir, ulFile, &oNfChild);
+        pcName = Path_getPathname(NodeF_getPath(oNfChild)) +
+                 ulDirLength + 1;
+        if(strncmp(pcName, pcComponent, ulLength) == 0 &&
+           pcName[ulLength] == '\0')
+            ulFile++;
+    }
+
+    /* and part of the subtree of a directory named so is after it */
+    ulDir = NodeD_seekDirChildren(oNdDir, pcComponent, ulLength);
+    if(bDeeper && ulDir < NodeD_getNumDirChildren(oNdDir)) {
+        (void)NodeD_getDirChild(oNdDir, ulDir, &oNdChild);
+        pcName = Path_getPathname(NodeD_getPath(oNdChild)) +
+                 ulDirLength + 1;
+        if(strncmp(pcName, pcComponent, ulLength) == 0 &&
+           pcName[ulLength] == '\0') {
+            if(FT_scanSeek(psScan, oNdChild, pcKey) == FT_WALK_STOP)
+                return FT_WALK_STOP;
+            ulDir++;
+        }
+    }
+
+    return FT_scanChildren(psScan, oNdDir, ulFile, ulDir);
+}
+
+/*
+  Scans the FT from key pcFrom (or its first node if NULL) on with 
+  *psScan, and sets *ppcResume, unless ppcResume is NULL, to the key 
+  to resume from if the visitor stopped the scan, or NULL. Returns 
+  SUCCESS or MEMORY_ERROR.
+*/
+static int FT_scan(struct scan *psScan, const char *pcFrom,
+                   char **ppcResume) {
+    const char *pcRoot;
+    size_t ulRootLength;
+    size_t ulLength;
+
+    assert(psScan != NULL);
+
+    psScan->sWalk.eOrder = FT_WALK_PRE;
+    psScan->sWalk.ulStartDepth = 0;
+    psScan->oPStopped = NULL;
+
+    if(oNRoot != NULL) {
+        pcRoot = Path_getPathname(NodeD_getPath(oNRoot));
+        ulRootLength = Path_getStrLength(NodeD_getPath(oNRoot));
+        if(pcFrom == NULL || FT_comparePaths(pcFrom, pcRoot) <= 0)
+            (void)FT_scanDir(psScan, oNRoot, pcRoot);
+        else if(strncmp(pcFrom, pcRoot, ulRootLength) == 0 &&
+                pcFrom[ulRootLength] == '/')
+            (void)FT_scanSeek(psScan, oNRoot, pcFrom);
+        /* otherwise the key is past every path */
+    }
+
+    if(ppcResume == NULL)
+        return SUCCESS;
+    *ppcResume = NULL;
+    if(psScan->oPStopped == NULL)
+        return SUCCESS;
+
+    /* the path with a '/' added is after the path but before any
+       other path that is */
+    ulLength = Path_getStrLength(psScan->oPStopped);
+    *ppcResume = malloc(ulLength + 2);
+    if(*ppcResume == NULL)
+        return MEMORY_ERROR;
+    strcpy(*ppcResume, Path_getPathname(psScan->oPStopped));
+    strcpy(*ppcResume + ulLength, "/");
+    return SUCCESS;
+}
+
+/* ================================================================== */
+int FT_scanRange(const char *pcStart, const char *pcEnd,
+                 enum FT_walkAction (*pfVisit)(
+                     const struct FT_walkEntry *, void *),
+                 void *pvExtra, char **ppcResume) {
+    struct scan sScan;
+
+    assert(pfVisit != NULL);
+
+    if(!bIsInitialized)
+        return INITIALIZATION_ERROR;
+
+    sScan.sWalk.pfVisit = pfVisit;
+    sScan.sWalk.pvExtra = pvExtra;
+    sScan.pcEnd = pcEnd;
+    sScan.pcPrefix = NULL;
+    sScan.ulPrefixLength = 0;
+    return FT_scan(&sScan, pcStart, ppcResume);
+}
+
+/* ================================================================== */
+int FT_scanPrefix(const char *pcPrefix, const char *pcStart,
+                  enum FT_walkAction (*pfVisit)(
+                      const struct FT_walkEntry *, void *),
+                  void *pvExtra, char **ppcResume) {
+    struct scan sScan;
+
+    assert(pcPrefix != NULL);
+    assert(pfVisit != NULL);
+
+    if(!bIsInitialized)
+        return INITIALIZATION_ERROR;
+
+    sScan.sWalk.pfVisit = pfVisit;
+    sScan.sWalk.pvExtra = pvExtra;
+    sScan.pcEnd = NULL;
+    sScan.pcPrefix = pcPrefix;
+    sScan.ulPrefixLength = strlen(pcPrefix);
+
+    /* the paths starting with the prefix are all after it */
+    if(pcStart == NULL || FT_comparePaths(pcStart, pcPrefix) < 0)
+        pcStart = pcPrefix;
+    return FT_scan(&sScan, pcStart, ppcResume);
+}
+
+/* ================================================================== */
+/*
+  The following auxiliary functions and structure are used for 
+  walking a subtree with a pool of threads with FT_parallelWalk.
+*/
+
+/* The state of a parallel walk shared by every worker */
+struct parallelWalk {
+    /* the visitor and its extra argument */
+    enum FT_walkAction (*pfVisit)(const struct FT_walkEntry *, size_t,
+                                  void *);
+    void *pvExtra;
+    /* the depth of the path the walk started from */
+    size_t ulStartDepth;
+};
+
+/*
+  Visits the node with path oPPath, a file of length ulSize if 
+  bIsFile, with psWalk's visitor as worker ulWorker, and returns its 
+  answer.
+*/
+static enum FT_walkAction FT_parallelVisitNode(
+    struct parallelWalk *psWalk, Path_T oPPath, boolean bIsFile,
+    size_t ulSize, size_t ulWorker) {
+    struct FT_walkEntry sEntry;
+
+    assert(psWalk != NULL);
+    assert(oPPath != NULL);
+
+    sEntry.pcPath = Path_getPathname(oPPath);
+    sEntry.pcName = Path_getComponent(oPPath, Path_getDepth(oPPath) - 1);
+    sEntry.bIsFile = bIsFile;
+    sEntry.ulSize = ulSize;
+    sEntry.ulDepth = Path_getDepth(oPPath) - psWalk->ulStartDepth;
+    return (*psWalk->pfVisit)(&sEntry, ulWorker, psWalk->pvExtra);
+}
+
+/*
+  Visits directory oNdDir and its file children with psWalk's visitor
+  as worker ulWorker, for ParTrav_run. Returns whether to visit the
+  directory's directory children.
+*/
+static enum ParTrav_action FT_parallelVisit(NodeD_T oNdDir,
+                                            size_t ulRoot,
+                                            size_t ulWorker,
+                                            struct parallelWalk *psWalk) {
+    enum FT_walkAction eAction;
+    NodeF_T oNfChild = NULL;
+    size_t i;
+
+    assert(oNdDir != NULL);
+    assert(psWalk != NULL);
+
+    (void)ulRoot;
+    eAction = FT_parallelVisitNode(psWalk, NodeD_getPath(oNdDir), FALSE,
+                                   0, ulWorker);
+    if(eAction == FT_WALK_STOP)
+        return PARTRAV_STOP;
+    if(eAction == FT_WALK_SKIP_SUBTREE)
+        return PARTRAV_SKIP;
+
+    for(i = 0; i < NodeD_getNumFileChildren(oNdDir); i++) {
+        (void)NodeD_getFileChild(oNdDir, i, &oNfChild);
+        if(FT_parallelVisitNode(psWalk, NodeF_getPath(oNfChild), TRUE,
+                                NodeF_getLength(oNfChild), ulWorker)
+           == FT_WALK_STOP)
+            return PARTRAV_STOP;
+    }
+    return PARTRAV_CONTINUE;
+}
+
+/* ================================================================== */
+int FT_parallelWalk(const char *pcPath, size_t ulThreads,
+                    enum FT_walkAction (*pfVisit)(
+                        const struct FT_walkEntry *, size_t, void *),
+                    void *pvExtra) {
+    struct parallelWalk sWalk;
+    struct ParTrav_visitor sVisitor;
+    NodeD_T oNdFound = NULL;
+    NodeF_T oNfFound = NULL;
+    Path_T oPFound;
+    int iStatus;
+
+    assert(pcPath != NULL);
+    assert(pfVisit != NULL);
+
+    if(!bIsInitialized)
+        return INITIALIZATION_ERROR;
+
+    iStatus = FT_lookupOne(pcPath, &oNdFound, &oNfFound);
+    if(iStatus != SUCCESS)
+        return iStatus;
+
+    oPFound = oNfFound != NULL ? NodeF_getPath(oNfFound) 
+                               : NodeD_getPath(oNdFound);
+    sWalk.pfVisit = pfVisit;
+    sWalk.pvExtra = pvExtra;
+    sWalk.ulStartDepth = Path_getDepth(oPFound);
+
+    if(oNfFound != NULL) {
+        (void)FT_parallelVisitNode(&sWalk, oPFound, TRUE,
+                                   NodeF_getLength(oNfFound), 0);
+        return SUCCESS;
+    }
+
+    sVisitor.pfVisit = (enum ParTrav_action (*)(NodeD_T, size_t, size_t,
+                                                void *))
+                       FT_parallelVisit;
+    sVisitor.pfRelease = NULL;
+    sVisitor.pvExtra = &sWalk;
+    ParTrav_run(&oNdFound, 1, ulThreads, &sVisitor);
+    return SUCCESS;
+}
+
+/* ================================================================== */
+/*
+  The following auxiliary functions are used for applying a batch of
+  operations with FT_applyBatch.
+*/
+
+/* An operation of a batch, with its parsed path */
+struct batchEntry {
+    /* the client's operation, whose status is set when applied */
+    struct FT_op *psOp;
+    /* the operation's path */
+    Path_T oPPath;
+    /* position of the operation in the batch, to keep the sort stable */
+    size_t ulIndex;
+};
+
+/*
+  Compares the batch entries pointed to by pv1 and pv2 by path,
+  ordering the paths component by component so that all of a
+  directory's descendants sort together right after it, and then by
+  position in the batch. Returns <0, 0 or >0 like strcmp.
+*/
+static int FT_compareEntries(const void *pv1, const void *pv2) {
+    const struct batchEntry *psEntry1 = pv1;
+    const struct batchEntry *psEntry2 = pv2;
+    int iCompare;
+
+    iCompare = FT_comparePaths(Path_getPathname(psEntry1->oPPath),
+                               Path_getPathname(psEntry2->oPPath));
+    if(iCompare != 0)
+        return iCompare;
+
+    if(psEntry1->ulIndex < psEntry2->ulIndex)
+        return -1;
+    return (psEntry1->ulIndex > psEntry2->ulIndex);
+}
+
+/* Sorts an array of batch entries as FT_compareEntries orders them */
+SORTEDARRAY_SORT(FT_sortEntries, struct batchEntry, FT_compareEntries)
+
+/*
+  Returns the deepest of oNdFrom and its ancestors whose path is a 
+  prefix of oPPath no deeper than ulDepth. One of them must be.
+*/
+static NodeD_T FT_climbTo(NodeD_T oNdFrom, Path_T oPPath, 
+                          size_t ulDepth) {
+    size_t ulFromDepth;
+
+    assert(oNdFrom != NULL);
+    assert(oPPath != NULL);
+
+    for(;;) {
+        ulFromDepth = Path_getDepth(NodeD_getPath(oNdFrom));
+        if(ulFromDepth <= ulDepth &&
+           Path_getSharedPrefixDepth(NodeD_getPath(oNdFrom), oPPath) ==
+           ulFromDepth)
+            return oNdFrom;
+        oNdFrom = NodeD_getParent(oNdFrom);
+        assert(oNdFrom != NULL);
+    }
+}
+
+/*
+  Finds the furthest existing directory along oPPath, no deeper than
+  ulDepth (which must be at least 1), as FT_traversePath does, but
+  starting the descent from the nearest ancestor of oPPath among
+  oNdHint and its ancestors rather than from the root. oNdHint is the
+  directory the previous operation of the batch ended at, or NULL.
+  Returns and sets *poNFurthest as FT_traversePath does.
+*/
+static int FT_batchLocate(NodeD_T oNdHint, Path_T oPPath, size_t ulDepth,
+                          NodeD_T *poNFurthest) {
+    NodeD_T oNdFrom;
+
+    assert(oPPath != NULL);
+    assert(poNFurthest != NULL);
+    assert(ulDepth >= 1);
+
+    /* root is NULL -> won't find anything */
+    if(oNRoot == NULL) {
+        *poNFurthest = NULL;
+        return SUCCESS;
+    }
+
+    /* the root's path must be a prefix of oPPath */
+    if(Path_getSharedPrefixDepth(NodeD_getPath(oNRoot), oPPath) == 0) {
+        *poNFurthest = NULL;
+        return CONFLICTING_PATH;
+    }
+
+    oNdFrom = FT_climbTo((oNdHint != NULL) ? oNdHint : oNRoot, oPPath,
+                         ulDepth);
+    return FT_walkDown(oNdFrom, oPPath, ulDepth, poNFurthest);
+}
+
+/*
+  Applies the FT_OP_INSERT_DIR operation of psEntry as FT_insertDir
+  would, setting its status. *poNdHint is the directory the previous
+  operation ended at, or NULL, and is updated for the next operation.
+*/
+static void FT_batchInsertDir(NodeD_T *poNdHint,
+                              struct batchEntry *psEntry) {
+    int iStatus;
+    Path_T oPPath;
+    NodeD_T oNCurr = NULL;
+    NodeD_T oNFirstNew = NULL;
+    size_t ulNewNodes = 0;
+
+    assert(poNdHint != NULL);
+    assert(psEntry != NULL);
+
+    oPPath = psEntry->oPPath;
+    iStatus = FT_batchLocate(*poNdHint, oPPath, Path_getDepth(oPPath),
+                             &oNCurr);
+    if(iStatus != SUCCESS) {
+        psEntry->psOp->iStatus = iStatus;
+        return;
+    }
+
+    if(oNCurr != NULL && !Path_comparePath(oPPath, 
+                                           NodeD_getPath(oNCurr))) {
+        *poNdHint = oNCurr;
+        psEntry->psOp->iStatus = ALREADY_IN_TREE;
+        return;
+    }
+
+    iStatus = FT_buildDirs(oNCurr, oPPath, Path_getDepth(oPPath), 
+                           &oNCurr, &oNFirstNew, &ulNewNodes);
+    psEntry->psOp->iStatus = iStatus;
+    if(iStatus != SUCCESS)
+        return;
+
+    if(oNRoot == NULL)
+        oNRoot = oNFirstNew;
+    ulDirCount += ulNewNodes;
+    *poNdHint = oNCurr;
+}
+
+/*
+  Returns the number of entries at the start of the ulCount entries of
+  psEntries that are operations of kind eKind on children of the
+  directory with path oPParentPath.
+*/
+static size_t FT_batchRunLength(struct batchEntry *psEntries,
+                                size_t ulCount, enum FT_opKind eKind,
+                                Path_T oPParentPath) {
+    size_t ulParentDepth;
+    size_t i;
+
+    assert(psEntries != NULL);
+    assert(oPParentPath != NULL);
+
+    ulParentDepth = Path_getDepth(oPParentPath);
+    for(i = 0; i < ulCount; i++) {
+        if(psEntries[i].psOp->eKind != eKind ||
+           Path_getDepth(psEntries[i].oPPath) != ulParentDepth + 1 ||
+           Path_getSharedPrefixDepth(psEntries[i].oPPath, 
+                                     oPParentPath) != ulParentDepth)
+            break;
+    }
+    return i;
+}
+
+/*
+  Applies the FT_OP_INSERT_FILE operation of psEntries[0] as 
+  FT_insertFile would, together with the run of FT_OP_INSERT_FILE 
+  operations right after it on files in the same directory: their new 
+  nodes are merged into the directory's file children in one pass. 
+  Sets each operation's status, updates *poNdHint as 
+  FT_batchInsertDir does, and returns the number of entries applied.
+*/
+static size_t FT_batchInsertFiles(NodeD_T *poNdHint,
+                                  struct batchEntry *psEntries,
+                                  size_t ulCount) {
+    int iStatus;
+    Path_T oPPath;
+    NodeD_T oNParent = NULL;
+    NodeD_T oNFirstNew = NULL; /* first directory created for the run */
+    NodeF_T *aoNfNew;          /* new file nodes, in order of path */
+    NodeD_T oNdChild;
+    NodeF_T oNfChild;
+    size_t ulDepth, ulRun, ulNew;
+    size_t ulNewNodes = 0;
+    size_t i;
+
+    assert(poNdHint != NULL);
+    assert(psEntries != NULL);
+    assert(ulCount > 0);
+
+    oPPath = psEntries[0].oPPath;
+    ulDepth = Path_getDepth(oPPath);
+    if(ulDepth == 1) {
+        psEntries[0].psOp->iStatus = CONFLICTING_PATH;
+        return 1;
+    }
+
+    iStatus = FT_batchLocate(*poNdHint, oPPath, ulDepth - 1, 
+                             &oNParent);
+    if(iStatus != SUCCESS) {
+        psEntries[0].psOp->iStatus = iStatus;
+        return 1;
+    }
+
+    /* create the parent directory if needed, as FT_insertFile would */
+    if(oNParent == NULL || 
+       Path_getDepth(NodeD_getPath(oNParent)) < ulDepth - 1) {
+        iStatus = FT_buildDirs(oNParent, oPPath, ulDepth - 1, &oNParent,
+                               &oNFirstNew, &ulNewNodes);
+        if(iStatus != SUCCESS) {
+            psEntries[0].psOp->iStatus = iStatus;
+            return 1;
+        }
+    }
+
+    ulRun = FT_batchRunLength(psEntries, ulCount, FT_OP_INSERT_FILE,
+                              NodeD_getPath(oNParent));
+    assert(ulRun > 0);
+
+    aoNfNew = malloc(ulRun * sizeof(NodeF_T));
+    if(aoNfNew == NULL) {
+        ulRun = 1;
+        psEntries[0].psOp->iStatus = MEMORY_ERROR;
+        ulNew = 0;
+    }
+    else {
+        /* create the new nodes, checking each against the existing 
+        children and the previous operation on the same path */
+        ulNew = 0;
+        for(i = 0; i < ulRun; i++) {
+            oPPath = psEntries[i].oPPath;
+            if(NodeD_lookupChild(oNParent, Path_getPathname(oPPath),
+                                 Path_getStrLength(oPPath), &oNdChild,
+                                 &oNfChild) ||
+               (ulNew > 0 && 
+                Path_comparePath(NodeF_getPath(aoNfNew[ulNew - 1]),
+                                 oPPath) == 0)) {
+                psEntries[i].psOp->iStatus = ALREADY_IN_TREE;
+                continue;
+            }
+            iStatus = FT_newFile(oPPath, psEntries[i].psOp->pvContents,
+                                 psEntries[i].psOp->ulLength,
+                                 &aoNfNew[ulNew]);
+            psEntries[i].psOp->iStatus = iStatus;
+            if(iStatus == SUCCESS)
+                ulNew++;
+        }
+
+        /* link them all in one merge */
+        iStatus = NodeD_addFileChildren(oNParent, aoNfNew, ulNew);
+        if(iStatus != SUCCESS) {
+            for(i = 0; i < ulNew; i++)
+                NodeF_free(aoNfNew[i]);
+            for(i = 0; i < ulRun; i++)
+                if(psEntries[i].psOp->iStatus == SUCCESS)
+                    psEntries[i].psOp->iStatus = iStatus;
+            ulNew = 0;
+        }
+        free(aoNfNew);
+    }
+
+    /* directories created for files that all failed are removed, as 
+    FT_insertFile would leave the tree unchanged */
+    if(oNFirstNew != NULL && ulNew == 0) {
+        (void)NodeD_free(oNFirstNew);
+        *poNdHint = NULL;
+        return ulRun;
+    }
+
+    if(oNRoot == NULL)
+        oNRoot = oNFirstNew;
+    ulDirCount += ulNewNodes;
+    *poNdHint = oNParent;
+    return ulRun;
+}
+
+/*
+  Applies the FT_OP_RM_FILE operation of psEntries[0] as FT_rmFile 
+  would, together with the run of FT_OP_RM_FILE operations right after
+  it on files in the same directory: their nodes are unlinked from the
+  directory's file children in one pass. Sets each operation's status, 
+  updates *poNdHint as FT_batchInsertDir does, and returns the number 
+  of entries applied.
+*/
+static size_t FT_batchRemoveFiles(NodeD_T *poNdHint,
+                                  struct batchEntry *psEntries,
+                                  size_t ulCount) {
+    int iStatus;
+    Path_T oPPath;
+    NodeD_T oNParent = NULL;
+    size_t *aulIndices;   /* indices of the children to remove */
+    size_t ulDepth, ulRun, ulChildID;
+    size_t ulRemoved = 0;
+    size_t i;
+
+    assert(poNdHint != NULL);
+    assert(psEntries != NULL);
+    assert(ulCount > 0);
+
+    oPPath = psEntries[0].oPPath;
+    ulDepth = Path_getDepth(oPPath);
+
+    /* a path of depth 1 can only be the root directory */
+    if(ulDepth == 1) {
+        if(oNRoot == NULL)
+            iStatus = NO_SUCH_PATH;
+        else if(Path_comparePath(NodeD_getPath(oNRoot), oPPath) == 0)
+            iStatus = NOT_A_FILE;
+        else
+            iStatus = CONFLICTING_PATH;
+        psEntries[0].psOp->iStatus = iStatus;
+        return 1;
+    }
+
+    iStatus = FT_batchLocate(*poNdHint, oPPath, ulDepth - 1, 
+                             &oNParent);
+    if(iStatus != SUCCESS) {
+        psEntries[0].psOp->iStatus = iStatus;
+        return 1;
+    }
+    if(oNParent == NULL || 
+       Path_getDepth(NodeD_getPath(oNParent)) < ulDepth - 1) {
+        psEntries[0].psOp->iStatus = NO_SUCH_PATH;
+        return 1;
+    }
+    *poNdHint = oNParent;
+
+    ulRun = FT_batchRunLength(psEntries, ulCount, FT_OP_RM_FILE,
+                              NodeD_getPath(oNParent));
+    assert(ulRun > 0);
+
+    aulIndices = malloc(ulRun * sizeof(size_t));
+    if(aulIndices == NULL) {
+        psEntries[0].psOp->iStatus = MEMORY_ERROR;
+        return 1;
+    }
+
+    /* sorted paths give increasing indices, with repeats adjacent */
+    for(i = 0; i < ulRun; i++) {
+        oPPath = psEntries[i].oPPath;
+        if(NodeD_hasDirChild(oNParent, oPPath, &ulChildID))
+            iStatus = NOT_A_FILE;
+        else if(!NodeD_hasFileChild(oNParent, oPPath, &ulChildID) ||
+                (ulRemoved > 0 && 
+                 aulIndices[ulRemoved - 1] == ulChildID))
+            iStatus = NO_SUCH_PATH;
+        else {
+            aulIndices[ulRemoved++] = ulChildID;
+            iStatus = SUCCESS;
+        }
+        psEntries[i].psOp->iStatus = iStatus;
+    }
+
+    NodeD_removeFileChildrenAt(oNParent, aulIndices, ulRemoved);
+    free(aulIndices);
+    return ulRun;
+}
+
+/* ================================================================== */
+int FT_applyBatch(struct FT_op *psOps, size_t ulCount) {
+    int iStatus;
+    struct batchEntry *psEntries;
+    NodeD_T oNdHint = NULL; /* directory the last operation ended at */
+    size_t ulValid = 0;     /* number of operations with valid paths */
+    size_t ulDone;
+    size_t i;
+
+    assert(psOps != NULL || ulCount == 0);
+
+    if(!bIsInitialized)
+        return INITIALIZATION_ERROR;
+    if(ulCount == 0)
+        return SUCCESS;
+
+    psEntries = malloc(ulCount * sizeof(struct batchEntry));
+    if(psEntries == NULL)
+        return MEMORY_ERROR;
+
+    /* validate every path once, up front */
+    for(i = 0; i < ulCount; i++) {
+        assert(psOps[i].pcPath != NULL);
+        iStatus = Path_new(psOps[i].pcPath, &psEntries[ulValid].oPPath);
+        if(iStatus != SUCCESS) {
+            psOps[i].iStatus = iStatus;
+            continue;
+        }
+        psEntries[ulValid].psOp = &psOps[i];
+        psEntries[ulValid].ulIndex = i;
+        ulValid++;
+    }
+
+    /* operations on a directory's subtree become adjacent, so each 
+    descent continues from where the previous operation ended */
+    FT_sortEntries(psEntries, ulValid);
+
+    for(i = 0; i < ulValid; i += ulDone) {
+        switch(psEntries[i].psOp->eKind) {
+            case FT_OP_INSERT_DIR:
+                FT_batchInsertDir(&oNdHint, &psEntries[i]);
+                ulDone = 1;
+                break;
+            case FT_OP_INSERT_FILE:
+                ulDone = FT_batchInsertFiles(&oNdHint, psEntries + i,
+                                             ulValid - i);
+                break;
+            case FT_OP_RM_FILE:
+                ulDone = FT_batchRemoveFiles(&oNdHint, psEntries + i,
+                                             ulValid - i);
+                break;
+            default:
+                assert(FALSE);
+                psEntries[i].psOp->iStatus = BAD_PATH;
+                ulDone = 1;
+                break;
+        }
+    }
+
+    for(i = 0; i < ulValid; i++)
+        Path_free(psEntries[i].oPPath);
+    free(psEntries);
+    ulGeneration++;
+    return SUCCESS;
+}
+
+/* ================================================================== */
+/*
+  The following auxiliary functions and structures are used for 
+  building a tree in parallel with FT_buildFromPaths.
+*/
+
+/* Fewest operations worth sorting with several threads */
+enum { FT_BUILD_MIN_PARALLEL = 4096 };
+/* Operations per task when parsing and freeing paths */
+enum { FT_BUILD_CHUNK = 1024 };
+
+/*
+  A tree being built from operations, shared by the threads building
+  it. Each of the root's children is built, with the subtree below it,
+  from its own group of operations by one thread.
+*/
+struct build {
+    /* the client's operations */
+    struct FT_op *psOps;
+    size_t ulOps;
+    /* the operations' entries, parsed in place, then sorted by path,
+       with the ulValid valid ones first; asTemp holds merge output */
+    struct batchEntry *asEntries;
+    struct batchEntry *asTemp;
+    size_t ulValid;
+    /* the number of sorted runs being merged, and how many runs make
+       up each of the runs being merged in this round */
+    size_t ulRuns;
+    size_t ulWidth;
+    /* the root, and for each of its children, the index in asEntries 
+       of the group's first operation and what the group built: its 
+       directory or file (or neither), and the number of directories;
+       the last group ends before index ulGroupsEnd */
+    NodeD_T oNdRoot;
+    size_t *aulGroupStarts;
+    size_t ulGroups;
+    size_t ulGroupsEnd;
+    NodeD_T *aoNdTops;
+    NodeF_T *aoNfTops;
+    size_t *aulDirCounts;
+};
+
+/*
+  Parses the paths of the ulTask'th chunk of psBuild's operations into
+  their entries, setting the status of each invalid one and leaving 
+  its entry's path NULL, for ParTrav_runTasks.
+*/
+static void FT_buildParse(size_t ulTask, size_t ulWorker,
+                          struct build *psBuild) {
+    size_t ulEnd;
+    size_t i;
+
+    assert(psBuild != NULL);
+
+    (void)ulWorker;
+    ulEnd = (ulTask + 1) * FT_BUILD_CHUNK;
+    if(ulEnd > psBuild->ulOps)
+        ulEnd = psBuild->ulOps;
+    for(i = ulTask * FT_BUILD_CHUNK; i < ulEnd; i++) {
+        assert(psBuild->psOps[i].pcPath != NULL);
+        psBuild->asEntries[i].psOp = &psBuild->psOps[i];
+        psBuild->asEntries[i].ulIndex = i;
+        psBuild->psOps[i].iStatus = Path_new(psBuild->psOps[i].pcPath,
+                                        &psBuild->asEntries[i].oPPath);
+        if(psBuild->psOps[i].iStatus != SUCCESS)
+            psBuild->asEntries[i].oPPath = NULL;
+    }
+}
+
+/*
+  Frees the paths of the ulTask'th chunk of psBuild's valid entries, 
+  for ParTrav_runTasks.
+*/
+static void FT_buildFreePaths(size_t ulTask, size_t ulWorker,
+                              struct build *psBuild) {
+    size_t ulEnd;
+    size_t i;
+
+    assert(psBuild != NULL);
+
+    (void)ulWorker;
+    ulEnd = (ulTask + 1) * FT_BUILD_CHUNK;
+    if(ulEnd > psBuild->ulValid)
+        ulEnd = psBuild->ulValid;
+    for(i = ulTask * FT_BUILD_CHUNK; i < ulEnd; i++)
+        Path_free(psBuild->asEntries[i].oPPath);
+}
+
+/* Returns the index of the first entry of psBuild's ulRun'th run. */
+static size_t FT_buildRunStart(struct build *psBuild, size_t ulRun) {
+    assert(psBuild != NULL);
+
+    if(ulRun >= psBuild->ulRuns)
+        return psBuild->ulValid;
+    return psBuild->ulValid / psBuild->ulRuns * ulRun +
+        psBuild->ulValid % psBuild->ulRuns * ulRun / psBuild->ulRuns;
+}
+
+/* Sorts psBuild's ulTask'th run, for ParTrav_runTasks. */
+static void FT_buildSortRun(size_t ulTask, size_t ulWorker,
+                            struct build *psBuild) {
+    size_t ulStart;
+
+    assert(psBuild != NULL);
+
+    (void)ulWorker;
+    ulStart = FT_buildRunStart(psBuild, ulTask);
+    FT_sortEntries(psBuild->asEntries + ulStart,
+                   FT_buildRunStart(psBuild, ulTask + 1) - ulStart);
+}
+
+/*
+  Merges the ulTask'th pair of sorted runs of psBuild's entries, each
+  ulWidth runs long, into the same place in asTemp, for 
+  ParTrav_runTasks.
+*/
+static void FT_buildMergeRuns(size_t ulTask, size_t ulWorker,
+                              struct build *psBuild) {
+    struct batchEntry *asFrom;
+    struct batchEntry *asTo;
+    size_t ulLeft, ulMid, ulRight, ulEnd;
+    size_t ulOut;
+
+    assert(psBuild != NULL);
+
+    (void)ulWorker;
+    asFrom = psBuild->asEntries;
+    asTo = psBuild->asTemp;
+    ulLeft = FT_buildRunStart(psBuild, 2 * ulTask * psBuild->ulWidth);
+    ulMid = FT_buildRunStart(psBuild, 
+                             (2 * ulTask + 1) * psBuild->ulWidth);
+    ulEnd = FT_buildRunStart(psBuild, 
+                             (2 * ulTask + 2) * psBuild->ulWidth);
+    ulRight = ulMid;
+
+    for(ulOut = ulLeft; ulOut < ulEnd; ulOut++) {
+        if(ulRight == ulEnd ||
+           (ulLeft < ulMid && FT_compareEntries(&asFrom[ulLeft],
+                                                &asFrom[ulRight]) < 0))
+            asTo[ulOut] = asFrom[ulLeft++];
+        else
+            asTo[ulOut] = asFrom[ulRight++];
+    }
+}
+
+/*
+  Sorts the valid entries of *psBuild by path with ulWorkers workers:
+  runs of them are sorted concurrently, then merged pairwise, each 
+  round's merges concurrently, or, if memory for merging cannot be 
+  allocated, all of them at once.
+*/
+static void FT_buildSort(struct build *psBuild, size_t ulWorkers) {
+    struct batchEntry *asSwap;
+
+    assert(psBuild != NULL);
+
+    psBuild->ulRuns = psBuild->ulValid < FT_BUILD_MIN_PARALLEL ? 
+        1 : ulWorkers;
+    psBuild->asTemp = NULL;
+    if(psBuild->ulRuns > 1) {
+        psBuild->asTemp = malloc(psBuild->ulValid * 
+                                 sizeof(struct batchEntry));
+        /* one run needs no merging */
+        if(psBuild->asTemp == NULL)
+            psBuild->ulRuns = 1;
+    }
+
+    ParTrav_runTasks(psBuild->ulRuns, ulWorkers, 
+                     (void (*)(size_t, size_t, void *)) FT_buildSortRun,
+                     psBuild);
+
+    for(psBuild->ulWidth = 1; psBuild->ulWidth < psBuild->ulRuns;
+        psBuild->ulWidth *= 2) {
+        ParTrav_runTasks((psBuild->ulRuns + 2 * psBuild->ulWidth - 1) /
+                         (2 * psBuild->ulWidth), ulWorkers,
+                         (void (*)(size_t, size_t, void *))
+                         FT_buildMergeRuns, psBuild);
+        asSwap = psBuild->asEntries;
+        psBuild->asEntries = psBuild->asTemp;
+        psBuild->asTemp = asSwap;
+    }
+
+    free(psBuild->asTemp);
+    psBuild->asTemp = NULL;
+}
+
+/*
+  Applies the operation of psEntry, on a path of depth at least 3, 
+  below the directory *poNdTop of its group of psBuild (created if 
+  NULL), as FT_applyBatch would, setting its status. *poNdHint is the
+  directory the group's previous operation ended at, or NULL, and is 
+  updated for the next one. Adds the number of directories created 
+  to *pulDirs.
+*/
+static void FT_buildBelowTop(struct build *psBuild, NodeD_T *poNdTop,
+                             NodeD_T *poNdHint, 
+                             struct batchEntry *psEntry,
+                             size_t *pulDirs) {
+    int iStatus;
+    Path_T oPPath;
+    Path_T oPPrefix = NULL;
+    NodeD_T oNdParent = NULL;
+    NodeD_T oNdFirstNew = NULL;
+    NodeF_T oNfNew = NULL;
+    boolean bNewTop = FALSE;
+    size_t ulDepth, ulTarget, ulChildID, ulOtherID;
+    size_t ulNewDirs = 0;
+
+    assert(psBuild != NULL);
+    assert(poNdTop != NULL);
+    assert(poNdHint != NULL);
+    assert(psEntry != NULL);
+    assert(pulDirs != NULL);
+
+    oPPath = psEntry->oPPath;
+    ulDepth = Path_getDepth(oPPath);
+    ulTarget = psEntry->psOp->eKind == FT_OP_INSERT_DIR ? 
+        ulDepth : ulDepth - 1;
+
+    if(*poNdTop == NULL) {
+        iStatus = Path_prefix(oPPath, 2, &oPPrefix);
+        if(iStatus == SUCCESS)
+            iStatus = NodeD_newUnlinked(oPPrefix, psBuild->oNdRoot,
+                                        poNdTop);
+        Path_free(oPPrefix);
+        if(iStatus != SUCCESS) {
+            psEntry->psOp->iStatus = iStatus;
+            return;
+        }
+        bNewTop = TRUE;
+        *poNdHint = *poNdTop;
+    }
 
-    assert(pcPath != NULL);
+    iStatus = FT_walkDown(FT_climbTo(*poNdHint != NULL ? 
+                                     *poNdHint : *poNdTop,
+                                     oPPath, ulTarget),
+                          oPPath, ulTarget, &oNdParent);
+    if(iStatus == SUCCESS && 
+       Path_getDepth(NodeD_getPath(oNdParent)) == ulDepth)
+        iStatus = ALREADY_IN_TREE;
+    else if(iStatus == SUCCESS &&
+            Path_getDepth(NodeD_getPath(oNdParent)) < ulTarget)
+        iStatus = FT_buildDirs(oNdParent, oPPath, ulTarget, &oNdParent,
+                               &oNdFirstNew, &ulNewDirs);
 
-    /* Check if path can be found as a file AND as a directory */
-    iStatusDir = FT_findDir(pcPath, &oNdFound);
-    iStatusFile = FT_findFile(pcPath, &oNfFound);
+    if(iStatus == SUCCESS && psEntry->psOp->eKind == FT_OP_INSERT_FILE) {
+        if(NodeD_hasFileChild(oNdParent, oPPath, &ulChildID) ||
+           NodeD_hasDirChild(oNdParent, oPPath, &ulOtherID))
+            iStatus = ALREADY_IN_TREE;
+        else {
+            /* sorted paths make ulChildID the end of the array */
+            iStatus = FT_newFile(oPPath, psEntry->psOp->pvContents,
+                                 psEntry->psOp->ulLength, &oNfNew);
+            if(iStatus == SUCCESS) {
+                iStatus = NodeD_addFileChild(oNdParent, oNfNew, 
+                                             ulChildID);
+                if(iStatus != SUCCESS)
+                    NodeF_free(oNfNew);
+            }
+        }
+        /* directories created for a file that failed are removed, as
+           FT_insertFile would leave the tree unchanged */
+        if(iStatus != SUCCESS && oNdFirstNew != NULL) {
+            (void)NodeD_free(oNdFirstNew);
+            oNdParent = NULL;
+            ulNewDirs = 0;
+        }
+    }
+    psEntry->psOp->iStatus = iStatus;
 
-    /* Case 1: path found as a directory */
-    if (iStatusDir == SUCCESS) {
-        *pbIsFile = (int) FALSE;
-        return iStatusDir;
+    /* so is the group's directory, if created for the operation */
+    if(bNewTop && iStatus != SUCCESS) {
+        NodeD_freeShallow(*poNdTop);
+        *poNdTop = NULL;
+        *poNdHint = NULL;
+        return;
     }
-    /* Case 2: path found as a file */
-    else if (iStatusFile == SUCCESS) {
-        *pbIsFile = (int) TRUE;
-        *pulSize = NodeF_getLength(oNfFound);
-        return iStatusFile;
+    if(bNewTop)
+        (*pulDirs)++;
+    *pulDirs += ulNewDirs;
+    *poNdHint = oNdParent;
+}
+
+/*
+  Applies the ulTask'th group of operations of psBuild, on the paths
+  at and below one child of the root, as FT_applyBatch would, setting
+  their statuses, and records what the group built, for 
+  ParTrav_runTasks. Nothing outside the group's subtree is changed: 
+  its directory is not linked into the root.
+*/
+static void FT_buildGroup(size_t ulTask, size_t ulWorker,
+                          struct build *psBuild) {
+    struct batchEntry *psEntry;
+    NodeD_T oNdTop = NULL;
+    NodeF_T oNfTop = NULL;
+    NodeD_T oNdHint = NULL;
+    size_t ulDirs = 0;
+    size_t ulEnd;
+    size_t i;
+    int iStatus;
+
+    assert(psBuild != NULL);
+
+    (void)ulWorker;
+    ulEnd = ulTask + 1 < psBuild->ulGroups ?
+        psBuild->aulGroupStarts[ulTask + 1] : psBuild->ulGroupsEnd;
+    for(i = psBuild->aulGroupStarts[ulTask]; i < ulEnd; i++) {
+        psEntry = &psBuild->asEntries[i];
+
+        /* a file child of the root has nothing below it */
+        if(oNfTop != NULL) {
+            if(Path_getDepth(psEntry->oPPath) == 2 &&
+               psEntry->psOp->eKind == FT_OP_INSERT_FILE)
+                psEntry->psOp->iStatus = ALREADY_IN_TREE;
+            else
+                psEntry->psOp->iStatus = NOT_A_DIRECTORY;
+            continue;
+        }
+
+        if(Path_getDepth(psEntry->oPPath) > 2) {
+            FT_buildBelowTop(psBuild, &oNdTop, &oNdHint, psEntry,
+                             &ulDirs);
+            continue;
+        }
+
+        /* the group's own directory or file */
+        if(oNdTop != NULL)
+            iStatus = ALREADY_IN_TREE;
+        else if(psEntry->psOp->eKind == FT_OP_INSERT_DIR) {
+            iStatus = NodeD_newUnlinked(psEntry->oPPath, 
+                                        psBuild->oNdRoot, &oNdTop);
+            if(iStatus == SUCCESS)
+                ulDirs++;
+        }
+        else
+            iStatus = FT_newFile(psEntry->oPPath, 
+                                 psEntry->psOp->pvContents,
+                                 psEntry->psOp->ulLength, &oNfTop);
+        psEntry->psOp->iStatus = iStatus;
+        oNdHint = oNdTop;
     }
-    /* failed both cases */
-    else {
-        return iStatusDir;
+
+    psBuild->aoNdTops[ulTask] = oNdTop;
+    psBuild->aoNfTops[ulTask] = oNfTop;
+    psBuild->aulDirCounts[ulTask] = ulDirs;
+}
+
+/*
+  Creates the root of *psBuild, the directory of depth 1 of its first 
+  valid entry that is not a file of depth 1, and sets the status of 
+  every entry not in a group of operations below it: those on 
+  conflicting paths and on the root itself. Sets the groups' bounds,
+  which are contiguous as the entries are sorted.
+  Returns SUCCESS or MEMORY_ERROR.
+*/
+static int FT_buildRoot(struct build *psBuild) {
+    struct batchEntry *psEntry;
+    Path_T oPPrefix = NULL;
+    boolean bRootInserted = FALSE;
+    size_t ulDepth;
+    size_t i;
+    int iStatus;
+
+    assert(psBuild != NULL);
+
+    psBuild->oNdRoot = NULL;
+    psBuild->ulGroups = 0;
+    psBuild->ulGroupsEnd = 0;
+    for(i = 0; i < psBuild->ulValid; i++) {
+        psEntry = &psBuild->asEntries[i];
+        ulDepth = Path_getDepth(psEntry->oPPath);
+
+        if(psEntry->psOp->eKind == FT_OP_INSERT_FILE && ulDepth == 1) {
+            psEntry->psOp->iStatus = CONFLICTING_PATH;
+            continue;
+        }
+
+        if(psBuild->oNdRoot == NULL) {
+            iStatus = Path_prefix(psEntry->oPPath, 1, &oPPrefix);
+            if(iStatus == SUCCESS)
+                iStatus = NodeD_new(oPPrefix, NULL, &psBuild->oNdRoot);
+            Path_free(oPPrefix);
+            if(iStatus != SUCCESS)
+                return iStatus;
+        }
+
+        if(Path_getSharedPrefixDepth(NodeD_getPath(psBuild->oNdRoot),
+                                     psEntry->oPPath) == 0)
+            psEntry->psOp->iStatus = CONFLICTING_PATH;
+        else if(ulDepth == 1) {
+            psEntry->psOp->iStatus = bRootInserted ? 
+                ALREADY_IN_TREE : SUCCESS;
+            bRootInserted = TRUE;
+        }
+        else {
+            if(psBuild->ulGroups == 0 ||
+               Path_getSharedPrefixDepth(psEntry->oPPath,
+                   psBuild->asEntries[psBuild->aulGroupStarts[
+                       psBuild->ulGroups - 1]].oPPath) < 2)
+                psBuild->aulGroupStarts[psBuild->ulGroups++] = i;
+            psBuild->ulGroupsEnd = i + 1;
+        }
+    }
+    return SUCCESS;
+}
+
+/*
+  Links what the groups of *psBuild built into its root, and makes it
+  the FT's root. Returns SUCCESS, or MEMORY_ERROR, freeing the root 
+  and everything the groups built.
+*/
+static int FT_buildLink(struct build *psBuild) {
+    size_t ulDirs = 0, ulFiles = 0;
+    size_t ulDirCountNew = 1;
+    size_t i;
+
+    assert(psBuild != NULL);
+    assert(psBuild->oNdRoot != NULL);
+
+    /* gather the groups' results in place, in order */
+    for(i = 0; i < psBuild->ulGroups; i++) {
+        if(psBuild->aoNdTops[i] != NULL)
+            psBuild->aoNdTops[ulDirs++] = psBuild->aoNdTops[i];
+        else if(psBuild->aoNfTops[i] != NULL)
+            psBuild->aoNfTops[ulFiles++] = psBuild->aoNfTops[i];
+        ulDirCountNew += psBuild->aulDirCounts[i];
+    }
+
+    if(NodeD_appendDirChildren(psBuild->oNdRoot, psBuild->aoNdTops,
+                               ulDirs) != SUCCESS) {
+        /* the root never held them, so they are freed unlinked */
+        for(i = 0; i < ulDirs; i++)
+            (void)NodeD_freeUnlinked(psBuild->aoNdTops[i]);
+        for(i = 0; i < ulFiles; i++)
+            NodeF_free(psBuild->aoNfTops[i]);
+        (void)NodeD_free(psBuild->oNdRoot);
+        return MEMORY_ERROR;
+    }
+    if(NodeD_addFileChildren(psBuild->oNdRoot, psBuild->aoNfTops,
+                             ulFiles) != SUCCESS) {
+        for(i = 0; i < ulFiles; i++)
+            NodeF_free(psBuild->aoNfTops[i]);
+        /* the directories are freed with the root */
+        (void)NodeD_free(psBuild->oNdRoot);
+        return MEMORY_ERROR;
+    }
+
+    oNRoot = psBuild->oNdRoot;
+    ulDirCount = ulDirCountNew;
+    return SUCCESS;
+}
+
+/* ================================================================== */
+int FT_buildFromPaths(struct FT_op *psOps, size_t ulCount,
+                      size_t ulThreads) {
+    struct build sBuild;
+    size_t ulWorkers;
+    size_t i;
+    int iStatus;
+
+    assert(psOps != NULL || ulCount == 0);
+
+    if(!bIsInitialized)
+        return INITIALIZATION_ERROR;
+
+    /* only insertions into an empty tree can be split up */
+    for(i = 0; i < ulCount; i++)
+        if(psOps[i].eKind == FT_OP_RM_FILE)
+            break;
+    if(oNRoot != NULL || i < ulCount)
+        return FT_applyBatch(psOps, ulCount);
+    if(ulCount == 0)
+        return SUCCESS;
+
+    /* owned contents and the name index are not shared safely */
+    ulWorkers = ulThreads != 0 ? ulThreads : ParTrav_getDefaultWorkers();
+    if(bOwnsContents || NameIndex_isEnabled())
+        ulWorkers = 1;
+
+    sBuild.psOps = psOps;
+    sBuild.ulOps = ulCount;
+    sBuild.asEntries = malloc(ulCount * sizeof(struct batchEntry));
+    sBuild.aulGroupStarts = malloc(ulCount * sizeof(size_t));
+    if(sBuild.asEntries == NULL || sBuild.aulGroupStarts == NULL) {
+        free(sBuild.asEntries);
+        free(sBuild.aulGroupStarts);
+        return MEMORY_ERROR;
+    }
+
+    /* validate every path once, up front, and keep the valid ones */
+    ParTrav_runTasks((ulCount + FT_BUILD_CHUNK - 1) / FT_BUILD_CHUNK,
+                     ulWorkers, (void (*)(size_t, size_t, void *))
+                     FT_buildParse, &sBuild);
+    sBuild.ulValid = 0;
+    for(i = 0; i < ulCount; i++)
+        if(sBuild.asEntries[i].oPPath != NULL)
+            sBuild.asEntries[sBuild.ulValid++] = sBuild.asEntries[i];
+
+    /* each group of operations below a child of the root becomes a 
+    contiguous run, built apart from the others */
+    FT_buildSort(&sBuild, ulWorkers);
+    iStatus = FT_buildRoot(&sBuild);
+
+    sBuild.aoNdTops = malloc((sBuild.ulGroups + 1) * sizeof(NodeD_T));
+    sBuild.aoNfTops = malloc((sBuild.ulGroups + 1) * sizeof(NodeF_T));
+    sBuild.aulDirCounts = malloc((sBuild.ulGroups + 1) * 
+                                 sizeof(size_t));
+    if(sBuild.aoNdTops == NULL || sBuild.aoNfTops == NULL ||
+       sBuild.aulDirCounts == NULL)
+        iStatus = MEMORY_ERROR;
+
+    if(iStatus == SUCCESS && sBuild.oNdRoot != NULL) {
+        ParTrav_runTasks(sBuild.ulGroups, ulWorkers,
+                         (void (*)(size_t, size_t, void *))
+                         FT_buildGroup, &sBuild);
+        iStatus = FT_buildLink(&sBuild);
     }
+    else if(sBuild.oNdRoot != NULL)
+        (void)NodeD_free(sBuild.oNdRoot);
+
+    ParTrav_runTasks((sBuild.ulValid + FT_BUILD_CHUNK - 1) / 
+                     FT_BUILD_CHUNK, ulWorkers,
+                     (void (*)(size_t, size_t, void *))
+                     FT_buildFreePaths, &sBuild);
+    free(sBuild.asEntries);
+    free(sBuild.aulGroupStarts);
+    free(sBuild.aoNdTops);
+    free(sBuild.aoNfTops);
+    free(sBuild.aulDirCounts);
+    ulGeneration++;
+    return iStatus;
 }
 
 /* ================================================================== */
@@ -672,6 +3637,125 @@ int FT_init(void) {
     return SUCCESS;
 }
 
+/* ================================================================== */
+int FT_setOwnedContents(boolean bOwned) {
+    /* cannot change ownership of contents already in the FT */
+    if(bIsInitialized)
+        return INITIALIZATION_ERROR;
+
+    bOwnsContents = bOwned;
+    return SUCCESS;
+}
+
+/* ================================================================== */
+int FT_setDedupContents(boolean bDedup) {
+    /* cannot change how contents already in the FT are stored */
+    if(bIsInitialized)
+        return INITIALIZATION_ERROR;
+
+    bDedupContents = bDedup;
+    return SUCCESS;
+}
+
+/* ================================================================== */
+int FT_setNameIndex(boolean bIndexed) {
+    /* nodes already in the FT are not in the index */
+    if(bIsInitialized)
+        return INITIALIZATION_ERROR;
+
+    NameIndex_setEnabled(bIndexed);
+    return SUCCESS;
+}
+
+/* ================================================================== */
+int FT_getNameIndexStats(size_t *pulEntries, size_t *pulBytes) {
+    assert(pulEntries != NULL);
+    assert(pulBytes != NULL);
+
+    if(!bIsInitialized)
+        return INITIALIZATION_ERROR;
+
+    NameIndex_getStats(pulEntries, pulBytes);
+    return SUCCESS;
+}
+
+/* ================================================================== */
+int FT_getDedupStats(size_t *pulLogicalBytes, size_t *pulStoredBytes,
+                     double *pdRatio) {
+    assert(pulLogicalBytes != NULL);
+    assert(pulStoredBytes != NULL);
+    assert(pdRatio != NULL);
+
+    if(!bIsInitialized)
+        return INITIALIZATION_ERROR;
+
+    BlobStore_getStats(pulLogicalBytes, pulStoredBytes);
+    /* nothing stored counts as no duplication */
+    if(*pulStoredBytes == 0)
+        *pdRatio = 1.0;
+    else
+        *pdRatio = (double)*pulLogicalBytes / (double)*pulStoredBytes;
+    return SUCCESS;
+}
+
+/* ================================================================== */
+int FT_setSpillThreshold(size_t ulBytes) {
+    NodeF_setSpillThreshold(ulBytes);
+    return SUCCESS;
+}
+
+/* ================================================================== */
+int FT_setContentBudget(size_t ulBytes) {
+    NodeF_setContentBudget(ulBytes);
+    return SUCCESS;
+}
+
+/*
+  Moves the contents of every file in the subtree rooted at oNdNode
+  that are in the backing file toward the start of the file.
+*/
+static void FT_compactSubtree(NodeD_T oNdNode) {
+    NodeD_T oNdChild = NULL;
+    NodeF_T oNfChild = NULL;
+    size_t c;
+    int iStatus;
+
+    assert(oNdNode != NULL);
+
+    for(c = 0; c < NodeD_getNumFileChildren(oNdNode); c++) {
+        iStatus = NodeD_getFileChild(oNdNode, c, &oNfChild);
+        assert(iStatus == SUCCESS);
+        NodeF_compactBacking(oNfChild);
+    }
+    for(c = 0; c < NodeD_getNumDirChildren(oNdNode); c++) {
+        iStatus = NodeD_getDirChild(oNdNode, c, &oNdChild);
+        assert(iStatus == SUCCESS);
+        FT_compactSubtree(oNdChild);
+    }
+}
+
+/* ================================================================== */
+int FT_compactBacking(void) {
+    if(!bIsInitialized)
+        return INITIALIZATION_ERROR;
+
+    if(bOwnsContents && oNRoot != NULL)
+        FT_compactSubtree(oNRoot);
+    return SUCCESS;
+}
+
+/* ================================================================== */
+int FT_getBackingStats(size_t *pulFileBytes, size_t *pulLiveBytes) {
+    assert(pulFileBytes != NULL);
+    assert(pulLiveBytes != NULL);
+
+    if(!bIsInitialized)
+        return INITIALIZATION_ERROR;
+
+    Backing_getStats(pulFileBytes, pulLiveBytes);
+    return SUCCESS;
+}
+
 /* ================================================================== */
 int FT_destroy(void) {
     /* cannot destroy if it doesn't exist */
@@ -681,7 +3765,7 @@ int FT_destroy(void) {
     /* Free from root if it exists (will recursively free everything 
     else)*/
     if(oNRoot) {
-        ulDirCount -= NodeD_free(oNRoot);
+        ulDirCount -= FT_freeSubtree(oNRoot);
         /* uninitialize root */
         oNRoot = NULL;
     }
@@ -689,109 +3773,487 @@ int FT_destroy(void) {
     /* uninitialize FT fields */
     assert(ulDirCount == 0);
 
+    /* every owned content block, blob and backing file extent has 
+    been freed with its file */
+    if(bOwnsContents) {
+        ContentHeap_reset();
+        BlobStore_reset();
+        Backing_reset();
+    }
+    /* and every node has been removed from the name index */
+    NameIndex_reset();
+
     bIsInitialized = FALSE;
+    ulGeneration++;
 
     return SUCCESS;
 }
 
 /* ================================================================== */
 /*
-  The following auxiliary functions are used for generating the
-  string representation of the FT.
+  The following auxiliary functions and structures are used for 
+  generating the string representation of the FT, in parallel.
 */
 
+/* Fewest directories in an FT worth rendering with several threads */
+enum { FT_TEXT_MIN_PARALLEL = 4096 };
+/* Largest number of rounds of splitting the text into segments */
+enum { FT_TEXT_ROUNDS = 4 };
+/* Segments per worker to aim for, so that stealing can balance them */
+enum { FT_TEXT_SPREAD = 4 };
+/* Bytes per worker that FT_streamString renders at a time */
+enum { FT_STREAM_CHUNK = 1 << 20 };
+
+/* A piece of the FT's string representation */
+struct textSegment {
+    /* the directory the piece is of */
+    NodeD_T oNdDir;
+    /* TRUE if the piece is the text of the directory's whole subtree,
+       FALSE if it is that of the directory and its files only */
+    boolean bWhole;
+    /* the length of the piece, and where it starts in the whole text,
+       once known */
+    size_t ulLength;
+    size_t ulOffset;
+};
+
 /*
-  Performs pre-order traversal of file tree rooted at n,
-  inserting each payload to DynArray_T d beginning at index i.
-  Returns the next unused index in d after the insertion(s).
+  The string representation of the FT as a sequence of segments, in 
+  order, to be rendered by several workers
 */
+struct textPlan {
+    /* the segments */
+    struct textSegment *asSegments;
+    size_t ulCount;
+    /* the number of workers */
+    size_t ulWorkers;
+    /* indices in asSegments of the whole segments being worked on,
+       their directories, and the workers' results for them */
+    size_t *aulIndices;
+    NodeD_T *aoNdRoots;
+    size_t *aulResults;
+    /* the number of whole segments being worked on */
+    size_t ulRoots;
+    /* where the segment with offset ulBase is rendered to */
+    char *pcBase;
+    size_t ulBase;
+};
 
-static size_t FT_preOrderTraversal(NodeD_T n, DynArray_T d, size_t i) {
-    size_t c;
+/*
+  Adds the length of the text of directory oNdDir to psPlan's result 
+  of worker ulWorker for the ulRoot'th segment worked on, for 
+  ParTrav_run.
+*/
+static enum ParTrav_action FT_measureDir(NodeD_T oNdDir, size_t ulRoot,
+                                         size_t ulWorker,
+                                         struct textPlan *psPlan) {
+    assert(oNdDir != NULL);
+    assert(psPlan != NULL);
+
+    psPlan->aulResults[ulWorker * psPlan->ulRoots + ulRoot] +=
+        NodeD_getStringLength(oNdDir);
+    return PARTRAV_CONTINUE;
+}
+
+/*
+  Writes the text of the subtree rooted at oNdDir to pcDest, without 
+  a '\0'. Returns the address just past the characters written.
+*/
+static char *FT_writeSubtree(NodeD_T oNdDir, char *pcDest) {
+    NodeD_T oNdChild = NULL;
+    size_t i;
+
+    assert(oNdDir != NULL);
+    assert(pcDest != NULL);
+
+    pcDest = NodeD_writeString(oNdDir, pcDest);
+    for(i = 0; i < NodeD_getNumDirChildren(oNdDir); i++) {
+        (void)NodeD_getDirChild(oNdDir, i, &oNdChild);
+        pcDest = FT_writeSubtree(oNdChild, pcDest);
+    }
+    return pcDest;
+}
+
+/* Returns the length of the text of the subtree rooted at oNdDir. */
+static size_t FT_measureSubtree(NodeD_T oNdDir) {
+    NodeD_T oNdChild = NULL;
+    size_t ulLength;
+    size_t i;
+
+    assert(oNdDir != NULL);
+
+    ulLength = NodeD_getStringLength(oNdDir);
+    for(i = 0; i < NodeD_getNumDirChildren(oNdDir); i++) {
+        (void)NodeD_getDirChild(oNdDir, i, &oNdChild);
+        ulLength += FT_measureSubtree(oNdChild);
+    }
+    return ulLength;
+}
+
+/*
+  Writes the text of the ulRoot'th whole segment worked on by psPlan
+  at its place, for ParTrav_run. The segment's subtree is written by 
+  one worker, as it must be in order.
+*/
+static enum ParTrav_action FT_renderDir(NodeD_T oNdDir, size_t ulRoot,
+                                        size_t ulWorker,
+                                        struct textPlan *psPlan) {
+    struct textSegment *psSegment;
+    char *pcEnd;
+
+    assert(oNdDir != NULL);
+    assert(psPlan != NULL);
+
+    (void)ulWorker;
+    psSegment = &psPlan->asSegments[psPlan->aulIndices[ulRoot]];
+    pcEnd = FT_writeSubtree(oNdDir, psPlan->pcBase + 
+                            (psSegment->ulOffset - psPlan->ulBase));
+    assert(pcEnd == psPlan->pcBase + (psSegment->ulOffset - 
+                    psPlan->ulBase) + psSegment->ulLength);
+    (void)pcEnd;
+    return PARTRAV_SKIP;
+}
+
+/*
+  Makes room in *psPlan to work on up to ulCount whole segments at 
+  once. Returns SUCCESS or MEMORY_ERROR.
+*/
+static int FT_reservePlan(struct textPlan *psPlan, size_t ulCount) {
+    assert(psPlan != NULL);
+
+    free(psPlan->aulIndices);
+    free(psPlan->aoNdRoots);
+    free(psPlan->aulResults);
+    psPlan->aulIndices = malloc(ulCount * sizeof(size_t));
+    psPlan->aoNdRoots = malloc(ulCount * sizeof(NodeD_T));
+    psPlan->aulResults = malloc(ulCount * psPlan->ulWorkers * 
+                                sizeof(size_t));
+    if(psPlan->aulIndices == NULL || psPlan->aoNdRoots == NULL ||
+       psPlan->aulResults == NULL)
+        return MEMORY_ERROR;
+    return SUCCESS;
+}
+
+/*
+  Measures, in parallel, every whole segment of *psPlan whose length 
+  is not known yet (marked by a length of 0, as no text is empty). 
+  Returns SUCCESS or MEMORY_ERROR.
+*/
+static int FT_measurePlan(struct textPlan *psPlan) {
+    struct ParTrav_visitor sVisitor;
+    struct textSegment *psSegment;
+    size_t i, w;
+
+    assert(psPlan != NULL);
 
-    assert(d != NULL);
+    if(FT_reservePlan(psPlan, psPlan->ulCount) != SUCCESS)
+        return MEMORY_ERROR;
 
-    if(n != NULL) {
-        (void) DynArray_set(d, i, n);
-        i++;
-        for(c = 0; c < NodeD_getNumDirChildren(n); c++) {
-            int iStatus;
-            NodeD_T oNdChild = NULL;
-            iStatus = NodeD_getDirChild(n,c, &oNdChild);
-            assert(iStatus == SUCCESS);
-            i = FT_preOrderTraversal(oNdChild, d, i);
+    psPlan->ulRoots = 0;
+    for(i = 0; i < psPlan->ulCount; i++) {
+        if(psPlan->asSegments[i].ulLength == 0) {
+            psPlan->aulIndices[psPlan->ulRoots] = i;
+            psPlan->aoNdRoots[psPlan->ulRoots] = 
+                psPlan->asSegments[i].oNdDir;
+            psPlan->ulRoots++;
         }
     }
-    return i;
+    memset(psPlan->aulResults, 0, 
+           psPlan->ulRoots * psPlan->ulWorkers * sizeof(size_t));
+
+    sVisitor.pfVisit = (enum ParTrav_action (*)(NodeD_T, size_t, size_t,
+                                                void *)) FT_measureDir;
+    sVisitor.pfRelease = NULL;
+    sVisitor.pvExtra = psPlan;
+    ParTrav_run(psPlan->aoNdRoots, psPlan->ulRoots, psPlan->ulWorkers,
+                &sVisitor);
+
+    for(i = 0; i < psPlan->ulRoots; i++) {
+        psSegment = &psPlan->asSegments[psPlan->aulIndices[i]];
+        for(w = 0; w < psPlan->ulWorkers; w++)
+            psSegment->ulLength += 
+                psPlan->aulResults[w * psPlan->ulRoots + i];
+    }
+    return SUCCESS;
+}
+
+/*
+  Replaces each whole segment of *psPlan longer than ulLimit whose
+  directory has directory children by a segment for the directory 
+  itself and a whole segment, of length not known yet, for each 
+  child. Sets *pbSplit to whether any segment was split. Returns 
+  SUCCESS or MEMORY_ERROR.
+*/
+static int FT_splitPlan(struct textPlan *psPlan, size_t ulLimit,
+                        boolean *pbSplit) {
+    struct textSegment *asNew;
+    struct textSegment *psSegment;
+    NodeD_T oNdChild = NULL;
+    size_t ulNewCount = 0;
+    size_t i, c;
+
+    assert(psPlan != NULL);
+    assert(pbSplit != NULL);
+
+    for(i = 0; i < psPlan->ulCount; i++) {
+        psSegment = &psPlan->asSegments[i];
+        ulNewCount++;
+        if(psSegment->bWhole && psSegment->ulLength > ulLimit)
+            ulNewCount += NodeD_getNumDirChildren(psSegment->oNdDir);
+    }
+    *pbSplit = (boolean)(ulNewCount != psPlan->ulCount);
+    if(!*pbSplit)
+        return SUCCESS;
+
+    asNew = malloc(ulNewCount * sizeof(struct textSegment));
+    if(asNew == NULL)
+        return MEMORY_ERROR;
+
+    ulNewCount = 0;
+    for(i = 0; i < psPlan->ulCount; i++) {
+        psSegment = &psPlan->asSegments[i];
+        asNew[ulNewCount] = *psSegment;
+        if(!psSegment->bWhole || psSegment->ulLength <= ulLimit ||
+           NodeD_getNumDirChildren(psSegment->oNdDir) == 0) {
+            ulNewCount++;
+            continue;
+        }
+        asNew[ulNewCount].bWhole = FALSE;
+        asNew[ulNewCount].ulLength = 
+            NodeD_getStringLength(psSegment->oNdDir);
+        ulNewCount++;
+        for(c = 0; c < NodeD_getNumDirChildren(psSegment->oNdDir); c++) {
+            (void)NodeD_getDirChild(psSegment->oNdDir, c, &oNdChild);
+            asNew[ulNewCount].oNdDir = oNdChild;
+            asNew[ulNewCount].bWhole = TRUE;
+            asNew[ulNewCount].ulLength = 0;
+            ulNewCount++;
+        }
+    }
+
+    free(psPlan->asSegments);
+    psPlan->asSegments = asNew;
+    psPlan->ulCount = ulNewCount;
+    return SUCCESS;
 }
 
 /*
-  Alternate version of strlen that uses pulAcc as an in-out parameter
-  to accumulate a string length, rather than returning the length of
-  oNdNode's path, and also always adds one addition byte to the sum.
-  Also accumulates the lengths of oNdNode's children Paths.
+  Plans the string representation of the non-empty FT for ulWorkers 
+  workers in *psPlan: measures it, splitting segments until none whose
+  directory has children is longer than ulLimit, or, if ulLimit is 0,
+  (a few times at most) than a share of the total that lets the 
+  workers balance their work, and sets each segment's offset. Sets 
+  *pulTotal to the total length. Returns SUCCESS or MEMORY_ERROR, in
+  which case the plan must still be freed with FT_freePlan.
 */
-static void FT_strlenAccumulate(NodeD_T oNdNode, size_t *pulAcc) {
-    char* pcNodeString;
+static int FT_makePlan(struct textPlan *psPlan, size_t ulWorkers,
+                       size_t ulLimit, size_t *pulTotal) {
+    size_t ulTotal = 0;
+    size_t ulRound;
+    boolean bBalance = (boolean)(ulLimit == 0);
+    boolean bSplit = TRUE;
+    size_t i;
+
+    assert(psPlan != NULL);
+    assert(pulTotal != NULL);
+    assert(oNRoot != NULL);
 
-    assert(pulAcc != NULL);
+    psPlan->asSegments = malloc(sizeof(struct textSegment));
+    psPlan->ulCount = 0;
+    psPlan->ulWorkers = ulWorkers;
+    psPlan->aulIndices = NULL;
+    psPlan->aoNdRoots = NULL;
+    psPlan->aulResults = NULL;
+    if(psPlan->asSegments == NULL)
+        return MEMORY_ERROR;
+    psPlan->asSegments[0].oNdDir = oNRoot;
+    psPlan->asSegments[0].bWhole = TRUE;
+    psPlan->asSegments[0].ulLength = 0;
+    psPlan->ulCount = 1;
+
+    for(ulRound = 0; bSplit; ulRound++) {
+        if(FT_measurePlan(psPlan) != SUCCESS)
+            return MEMORY_ERROR;
+        if(ulRound == 0) {
+            for(i = 0; i < psPlan->ulCount; i++)
+                ulTotal += psPlan->asSegments[i].ulLength;
+            if(ulLimit == 0)
+                ulLimit = ulTotal / (ulWorkers * FT_TEXT_SPREAD);
+        }
+        /* when only balancing the work, a few rounds do, and one 
+           worker gains nothing from more segments */
+        if(bBalance && (ulWorkers == 1 || ulRound == FT_TEXT_ROUNDS))
+            break;
+        if(FT_splitPlan(psPlan, ulLimit, &bSplit) != SUCCESS)
+            return MEMORY_ERROR;
+    }
 
-    /* Accumulate string lengths */
-    if(oNdNode != NULL) {
-        pcNodeString = NodeD_toString(oNdNode);
-        *pulAcc += strlen(pcNodeString);
-        free(pcNodeString);      
+    ulTotal = 0;
+    for(i = 0; i < psPlan->ulCount; i++) {
+        psPlan->asSegments[i].ulOffset = ulTotal;
+        ulTotal += psPlan->asSegments[i].ulLength;
     }
+    *pulTotal = ulTotal;
+    return SUCCESS;
 }
 
 /*
-  Alternate version of strcat that inverts the typical argument
-  order, appending oNdNode's string represenation onto pcAcc, and also 
-  always adds one newline at the end of the concatenated string.
+  Renders the segments ulFirst to ulLast - 1 of *psPlan in parallel 
+  to pcDest, where the text of segment ulFirst starts. Returns SUCCESS
+  or MEMORY_ERROR.
 */
-static void FT_strcatAccumulate(NodeD_T oNdNode, char *pcAcc) {
-    char* pcNodeString;
+static int FT_renderPlan(struct textPlan *psPlan, size_t ulFirst,
+                         size_t ulLast, char *pcDest) {
+    struct ParTrav_visitor sVisitor;
+    struct textSegment *psSegment;
+    size_t i;
 
-    assert(pcAcc != NULL);
+    assert(psPlan != NULL);
+    assert(ulFirst < ulLast);
+    assert(pcDest != NULL);
 
-    if(oNdNode != NULL) {
-        pcNodeString = NodeD_toString(oNdNode);
-        strcat(pcAcc, pcNodeString);
-        free(pcNodeString);
+    if(FT_reservePlan(psPlan, ulLast - ulFirst) != SUCCESS)
+        return MEMORY_ERROR;
+
+    psPlan->pcBase = pcDest;
+    psPlan->ulBase = psPlan->asSegments[ulFirst].ulOffset;
+    psPlan->ulRoots = 0;
+    for(i = ulFirst; i < ulLast; i++) {
+        psSegment = &psPlan->asSegments[i];
+        if(psSegment->bWhole) {
+            psPlan->aulIndices[psPlan->ulRoots] = i;
+            psPlan->aoNdRoots[psPlan->ulRoots] = psSegment->oNdDir;
+            psPlan->ulRoots++;
+        }
+        else
+            (void)NodeD_writeString(psSegment->oNdDir, pcDest + 
+                                    (psSegment->ulOffset - 
+                                     psPlan->ulBase));
     }
+
+    sVisitor.pfVisit = (enum ParTrav_action (*)(NodeD_T, size_t, size_t,
+                                                void *)) FT_renderDir;
+    sVisitor.pfRelease = NULL;
+    sVisitor.pvExtra = psPlan;
+    ParTrav_run(psPlan->aoNdRoots, psPlan->ulRoots, psPlan->ulWorkers,
+                &sVisitor);
+    return SUCCESS;
+}
+
+/* Frees all memory allocated for *psPlan. */
+static void FT_freePlan(struct textPlan *psPlan) {
+    assert(psPlan != NULL);
+
+    free(psPlan->asSegments);
+    free(psPlan->aulIndices);
+    free(psPlan->aoNdRoots);
+    free(psPlan->aulResults);
 }
 
 /* ================================================================== */
 char *FT_toString(void) {
-    DynArray_T nodes;
-    size_t totalStrlen = 1;
-    char *result = NULL;
-    
+    struct textPlan sPlan;
+    size_t ulTotal;
+    char *pcResult;
+
     /* Make sure FT is initialized */
     if(!bIsInitialized)
         return NULL;
 
-    /* Create array of all directory nodes to accumulate them */
-    nodes = DynArray_new(ulDirCount);
-    (void) FT_preOrderTraversal(oNRoot, nodes, 0);
+    if(oNRoot == NULL) {
+        pcResult = malloc(1);
+        if(pcResult != NULL)
+            *pcResult = '\0';
+        return pcResult;
+    }
+
+    /* a small FT is written in order, in one pass */
+    if(ulDirCount < FT_TEXT_MIN_PARALLEL) {
+        ulTotal = FT_measureSubtree(oNRoot);
+        pcResult = malloc(ulTotal + 1);
+        if(pcResult != NULL)
+            *FT_writeSubtree(oNRoot, pcResult) = '\0';
+        return pcResult;
+    }
 
-    /* Accumulate length of all directory node strings */
-    DynArray_map(nodes, (void (*)(void *, void*)) FT_strlenAccumulate,
-                    (void*) &totalStrlen);
+    /* measure the pieces first, so that each can be written at its
+       place by any worker */
+    if(FT_makePlan(&sPlan, ParTrav_getDefaultWorkers(), 0, &ulTotal)
+       != SUCCESS) {
+        FT_freePlan(&sPlan);
+        return NULL;
+    }
 
-    /* Allocate mem and check for enough mem */
-    result = malloc(totalStrlen + 1);
-    if(result == NULL) {
-        DynArray_free(nodes);
+    pcResult = malloc(ulTotal + 1);
+    if(pcResult == NULL ||
+       FT_renderPlan(&sPlan, 0, sPlan.ulCount, pcResult) != SUCCESS) {
+        free(pcResult);
+        FT_freePlan(&sPlan);
         return NULL;
     }
-    *result = '\0';
+    pcResult[ulTotal] = '\0';
 
-    /* Accumulate string representations of all nodes */
-    DynArray_map(nodes, (void (*)(void *, void*)) FT_strcatAccumulate,
-    (void *) result);
-    
-    DynArray_free(nodes);
+    FT_freePlan(&sPlan);
+    return pcResult;
+}
+
+/* ================================================================== */
+int FT_streamString(size_t ulThreads,
+                    int (*pfWrite)(const char *pcText, size_t ulLength,
+                                   void *pvExtra),
+                    void *pvExtra) {
+    struct textPlan sPlan;
+    size_t ulTotal;
+    size_t ulFirst, ulLast;
+    size_t ulLength;
+    char *pcBuffer = NULL;
+    size_t ulBufferSize = 0;
+    int iStatus = SUCCESS;
+
+    assert(pfWrite != NULL);
 
-    return result;
-}
\ No newline at end of file
+    if(!bIsInitialized)
+        return INITIALIZATION_ERROR;
+    if(oNRoot == NULL)
+        return SUCCESS;
+
+    if(ulThreads == 0)
+        ulThreads = ParTrav_getDefaultWorkers();
+    /* a small FT is rendered in order by the calling thread alone */
+    if(ulDirCount < FT_TEXT_MIN_PARALLEL)
+        ulThreads = 1;
+    if(FT_makePlan(&sPlan, ulThreads, FT_STREAM_CHUNK, &ulTotal)
+       != SUCCESS) {
+        FT_freePlan(&sPlan);
+        return MEMORY_ERROR;
+    }
+
+    /* render runs of segments of about a chunk per worker, in order */
+    for(ulFirst = 0; ulFirst < sPlan.ulCount; ulFirst = ulLast) {
+        ulLength = 0;
+        for(ulLast = ulFirst; ulLast < sPlan.ulCount; ulLast++) {
+            if(ulLast > ulFirst && ulLength + 
+               sPlan.asSegments[ulLast].ulLength > 
+               ulThreads * FT_STREAM_CHUNK)
+                break;
+            ulLength += sPlan.asSegments[ulLast].ulLength;
+        }
+
+        if(ulLength > ulBufferSize) {
+            free(pcBuffer);
+            pcBuffer = malloc(ulLength);
+            ulBufferSize = pcBuffer != NULL ? ulLength : 0;
+        }
+        if(pcBuffer == NULL ||
+           FT_renderPlan(&sPlan, ulFirst, ulLast, pcBuffer) != SUCCESS) {
+            iStatus = MEMORY_ERROR;
+            break;
+        }
+        if((*pfWrite)(pcBuffer, ulLength, pvExtra) != 0)
+            break;
+    }
+
+    free(pcBuffer);
+    FT_freePlan(&sPlan);
+    return iStatus;
+}
@@ -36,7 +36,9 @@ boolean FT_containsDir(const char *pcPath);
 
 /*
   Removes the FT hierarchy (subtree) at the directory with absolute
-  path pcPath. Returns SUCCESS if found and removed.
+  path pcPath. A large subtree whose files borrow their contents is
+  freed by one thread per processor, if the name index is empty.
+  Returns SUCCESS if found and removed.
   Otherwise, returns:
   * INITIALIZATION_ERROR if the FT is not in an initialized state
   * BAD_PATH if pcPath does not represent a well-formatted path
@@ -50,7 +52,10 @@ int FT_rmDir(const char *pcPath);
 
 /*
    Inserts a new file into the FT with absolute path pcPath, with
-   file contents pvContents of size ulLength bytes.
+   file contents pvContents of size ulLength bytes. If the FT owns
+   file contents (see FT_setOwnedContents), the ulLength bytes at
+   pvContents are copied into the FT (a NULL pvContents gives ulLength
+   zero bytes); otherwise the FT borrows pvContents from the client.
    Returns SUCCESS if the new file is inserted successfully.
    Otherwise, returns:
    * INITIALIZATION_ERROR if the FT is not in an initialized state
@@ -89,6 +94,17 @@ int FT_rmFile(const char *pcPath);
 
   Note: checking for a non-NULL return is not an appropriate
   contains check, because the contents of a file may be NULL.
+
+  If the FT owns file contents, the returned pointer is to storage
+  owned by the FT, which remains valid until the file is next changed
+  or removed, FT_compactBacking is called, or the FT is destroyed.
+  Empty contents are NULL. Large contents may be in the backing file
+  (see FT_setSpillThreshold), in which case the pointer is into its
+  memory mapping and the pages are read in on demand.
+  With a content budget (see FT_setContentBudget), contents evicted
+  to the backing file are moved back into memory, and the pointer
+  is valid only until the next call of an FT function unless the file
+  is pinned with FT_pinFile.
 */
 void *FT_getFileContents(const char *pcPath);
 
@@ -97,10 +113,143 @@ void *FT_getFileContents(const char *pcPath);
   the parameter pvNewContents of size ulNewLength bytes.
   Returns the old contents if successful. (Note: contents may be NULL.)
   Returns NULL if unable to complete the request for any reason.
+
+  If the FT owns file contents, the ulNewLength bytes at pvNewContents
+  are copied into the FT, and the old contents are returned as a copy
+  allocated with malloc, which is then owned by client! Empty old
+  contents are returned as NULL.
 */
 void *FT_replaceFileContents(const char *pcPath, void *pvNewContents,
                              size_t ulNewLength);
 
+/*
+  Copies up to ulLength bytes of the contents of the file with absolute
+  path pcPath, starting at byte ulOffset, into pvBuf, and sets
+  *pulRead to the number of bytes copied (less than ulLength only if
+  the end of the contents is reached, and 0 if ulOffset is past it).
+  Returns SUCCESS if successful.
+  Otherwise, leaves *pulRead unchanged and returns:
+  * INITIALIZATION_ERROR if the FT is not in an initialized state
+  * BAD_PATH if pcPath does not represent a well-formatted path
+  * CONFLICTING_PATH if the root's path is not a prefix of pcPath
+  * NO_SUCH_PATH if absolute path pcPath does not exist in the FT
+  * NOT_A_FILE if pcPath is in the FT as a directory not a file
+  * MEMORY_ERROR if memory could not be allocated to complete request
+*/
+int FT_readFile(const char *pcPath, size_t ulOffset, void *pvBuf,
+                size_t ulLength, size_t *pulRead);
+
+/*
+  Overwrites the ulLength bytes of the contents of the file with
+  absolute path pcPath, starting at byte ulOffset, with the bytes at
+  pvBuf. The contents are extended if the range ends past them, and
+  any gap between their old end and ulOffset is filled with zero
+  bytes. Contents that outgrow their storage are kept as chunked
+  extents, so that ranged updates cost time proportional to the bytes
+  touched.
+  Returns SUCCESS if successful. Otherwise, leaves the contents
+  unchanged and returns:
+  * INITIALIZATION_ERROR if the FT is not in an initialized state, or
+                         does not own file contents
+  * BAD_PATH if pcPath does not represent a well-formatted path
+  * CONFLICTING_PATH if the root's path is not a prefix of pcPath
+  * NO_SUCH_PATH if absolute path pcPath does not exist in the FT
+  * NOT_A_FILE if pcPath is in the FT as a directory not a file
+  * MEMORY_ERROR if memory could not be allocated to complete request
+*/
+int FT_writeFile(const char *pcPath, size_t ulOffset,
+                 const void *pvBuf, size_t ulLength);
+
+/*
+  Appends the ulLength bytes at pvBuf to the contents of the file with
+  absolute path pcPath. Returns as FT_writeFile does.
+*/
+int FT_appendFile(const char *pcPath, const void *pvBuf,
+                  size_t ulLength);
+
+/*
+  Sets the length of the contents of the file with absolute path
+  pcPath to ulLength, discarding bytes past it or extending the
+  contents with zero bytes. Returns as FT_writeFile does.
+*/
+int FT_truncateFile(const char *pcPath, size_t ulLength);
+
+/* Kinds of operation that can be applied with FT_applyBatch */
+enum FT_opKind { FT_OP_INSERT_DIR, FT_OP_INSERT_FILE, FT_OP_RM_FILE };
+
+/* An operation of a batch applied with FT_applyBatch */
+struct FT_op {
+   /* the operation to apply */
+   enum FT_opKind eKind;
+   /* the absolute path of the directory or file to operate on */
+   const char *pcPath;
+   /* the contents and their length, for FT_OP_INSERT_FILE only */
+   void *pvContents;
+   size_t ulLength;
+   /* set to the status of the operation when it is applied */
+   int iStatus;
+};
+
+/*
+  Applies the ulCount operations in psOps: FT_OP_INSERT_DIR as
+  FT_insertDir, FT_OP_INSERT_FILE as FT_insertFile and FT_OP_RM_FILE
+  as FT_rmFile, with the same arguments. Each path is validated once,
+  and the operations are applied in order of path, with operations on
+  the same path in their order in psOps. Each descent through the tree
+  continues from where the previous operation ended, and runs of
+  insertions or removals of files in the same directory update its
+  children in a single pass. Sets each operation's iStatus to the
+  status its own function would have returned if the operations were
+  called one by one in that order.
+  Returns SUCCESS if the batch was applied, even if some of its
+  operations failed. Otherwise, leaves the FT and every iStatus
+  unchanged and returns:
+  * INITIALIZATION_ERROR if the FT is not in an initialized state
+  * MEMORY_ERROR if memory could not be allocated to complete request
+*/
+int FT_applyBatch(struct FT_op *psOps, size_t ulCount);
+
+/*
+  Builds the FT from the ulCount insertions in psOps, in no particular
+  order, with ulThreads threads (one per processor if ulThreads is 0),
+  with the same result and statuses as FT_applyBatch. Paths are parsed
+  and sorted concurrently, and the subtree below each child of the 
+  root is built by one thread, its nodes appended in order, and then
+  linked into the root. Only one thread is used if the FT owns file 
+  contents or indexes names, and if the FT is not empty or psOps holds
+  FT_OP_RM_FILE operations, the operations are applied by 
+  FT_applyBatch.
+  Returns SUCCESS if the operations were applied, even if some of them
+  failed. Otherwise returns:
+  * INITIALIZATION_ERROR if the FT is not in an initialized state
+  * MEMORY_ERROR if memory could not be allocated to complete request,
+    in which case the FT is left empty
+*/
+int FT_buildFromPaths(struct FT_op *psOps, size_t ulCount,
+                      size_t ulThreads);
+
+/*
+  Pins the file with absolute path pcPath, so that its contents are
+  not evicted or moved by FT_compactBacking until the file is unpinned
+  as many times as it was pinned. Pointers returned by
+  FT_getFileContents for a pinned file stay valid until the file is
+  next changed or removed, or the FT is destroyed.
+  Returns SUCCESS if successful. Otherwise, returns:
+  * INITIALIZATION_ERROR if the FT is not in an initialized state
+  * BAD_PATH if pcPath does not represent a well-formatted path
+  * CONFLICTING_PATH if the root's path is not a prefix of pcPath
+  * NO_SUCH_PATH if absolute path pcPath does not exist in the FT
+  * NOT_A_FILE if pcPath is in the FT as a directory not a file
+  * MEMORY_ERROR if memory could not be allocated to complete request
+*/
+int FT_pinFile(const char *pcPath);
+
+/*
+  Removes one pin from the file with absolute path pcPath, if it has
+  any. Returns as FT_pinFile does.
+*/
+int FT_unpinFile(const char *pcPath);
+
 /*
   Returns SUCCESS if pcPath exists in the hierarchy,
   Otherwise, returns:
@@ -119,6 +268,252 @@ void *FT_replaceFileContents(const char *pcPath, void *pvNewContents,
 */
 int FT_stat(const char *pcPath, boolean *pbIsFile, size_t *pulSize);
 
+/* The outcome of one lookup of FT_statMany */
+struct FT_statResult {
+   /* the status FT_stat would return for the path */
+   int iStatus;
+   /* if iStatus is SUCCESS, whether the path is a file */
+   boolean bIsFile;
+   /* if iStatus is SUCCESS, the length of the file's contents, or 0
+      for a directory */
+   size_t ulSize;
+};
+
+/*
+  Looks up the ulCount paths in ppcPaths as FT_stat does, setting
+  psResults[i] to the outcome for ppcPaths[i]; the fields other than
+  iStatus are unchanged unless it is SUCCESS. The lookups advance
+  through the tree in lock-step, so that the memory accesses of
+  different lookups overlap rather than each waiting in turn; this is
+  faster than ulCount calls of FT_stat for large trees.
+  Returns INITIALIZATION_ERROR (leaving psResults unchanged) if the FT
+  is not in an initialized state, and SUCCESS otherwise.
+*/
+int FT_statMany(const char **ppcPaths, size_t ulCount,
+                struct FT_statResult *psResults);
+
+/*
+  Looks up the ulCount paths in ppcPaths as FT_statMany does, setting
+  ppvContents[i] to what FT_getFileContents would return for
+  ppcPaths[i]. If the FT has a content budget, getting the contents of
+  one file may invalidate pointers to the contents of others returned
+  by the same call unless they are pinned (see FT_getFileContents).
+  Returns INITIALIZATION_ERROR (leaving ppvContents unchanged) if the
+  FT is not in an initialized state, and SUCCESS otherwise.
+*/
+int FT_getFileContentsMany(const char **ppcPaths, size_t ulCount,
+                           void **ppvContents);
+
+/* A DirCursor_T lists the children of one directory, a page at a time */
+typedef struct dirCursor *DirCursor_T;
+
+/* One child listed by FT_readDir */
+struct FT_dirEntry {
+   /* the child's name, i.e. the last component of its path */
+   const char *pcName;
+   /* whether the child is a file */
+   boolean bIsFile;
+   /* the length of the file's contents, or 0 for a directory */
+   size_t ulSize;
+};
+
+/*
+  Opens a cursor listing the children of the directory with absolute 
+  path pcPath, setting *poCursor to it. Only the directory's path and
+  the name of the last child listed are copied, so listing allocates
+  nothing unless a child with a longer name is inserted meanwhile.
+  Returns SUCCESS if the cursor was opened, or:
+  * INITIALIZATION_ERROR if the FT is not in an initialized state
+  * BAD_PATH if pcPath does not represent a well-formatted path
+  * CONFLICTING_PATH if the root exists but is not a prefix of pcPath
+  * NO_SUCH_PATH if no directory with pcPath exists in the hierarchy
+  * NOT_A_DIRECTORY if pcPath is in the hierarchy as a file
+  * MEMORY_ERROR if memory could not be allocated to complete request
+*/
+int FT_openDir(const char *pcPath, DirCursor_T *poCursor);
+
+/*
+  Lists up to ulMax more children of oCursor's directory into 
+  psEntries, setting *pulRead to the number listed; 0 means every 
+  child has been listed. The file children are listed first and then
+  the directory children, each in order of name. Names point into the
+  FT and are valid until it next changes.
+  The FT may change between calls: the cursor then resumes after the
+  last child it listed, so children listed before are not listed 
+  again, children inserted after that place are listed, and children
+  removed before being listed are not.
+  Returns SUCCESS, or:
+  * INITIALIZATION_ERROR if the FT is not in an initialized state
+  * NO_SUCH_PATH if the directory is no longer in the hierarchy
+  * MEMORY_ERROR if memory could not be allocated to complete request
+  When returning another status than SUCCESS, *pulRead is unchanged 
+  and the cursor remains where it was.
+*/
+int FT_readDir(DirCursor_T oCursor, struct FT_dirEntry *psEntries,
+               size_t ulMax, size_t *pulRead);
+
+/* Closes oCursor, freeing all memory allocated for it. */
+void FT_closeDir(DirCursor_T oCursor);
+
+/* Orders in which FT_walk can visit a subtree */
+enum FT_walkOrder {
+   /* depth-first, each directory before its children */
+   FT_WALK_PRE,
+   /* depth-first, each directory after its children */
+   FT_WALK_POST,
+   /* breadth-first, each level before the next */
+   FT_WALK_BFS
+};
+
+/* What the visitor of FT_walk asks for after each visit */
+enum FT_walkAction {
+   /* go on with the walk */
+   FT_WALK_CONTINUE,
+   /* go on, but not below the directory just visited */
+   FT_WALK_SKIP_SUBTREE,
+   /* end the walk */
+   FT_WALK_STOP
+};
+
+/* A directory or file visited by FT_walk */
+struct FT_walkEntry {
+   /* the node's absolute path, and its last component */
+   const char *pcPath;
+   const char *pcName;
+   /* whether the node is a file */
+   boolean bIsFile;
+   /* the length of the file's contents, or 0 for a directory */
+   size_t ulSize;
+   /* the node's depth below the path the walk started from */
+   size_t ulDepth;
+};
+
+/*
+  Walks the subtree rooted at absolute path pcPath in order eOrder,
+  calling (*pfVisit)(psEntry, pvExtra) for each directory and file of
+  it. The children of a directory are visited files first, each in 
+  order of path, and pre-order visits the nodes in the same order as
+  FT_toString lists them. The entry and the strings in it are borrowed
+  from the FT for the duration of the call only, and the visitor must
+  not change the FT. FT_WALK_SKIP_SUBTREE has the same effect as 
+  FT_WALK_CONTINUE for a file and in post-order, where a directory's
+  subtree has already been visited. No memory is allocated for the 
+  walk except, breadth-first, a queue of directories still to visit.
+  Returns SUCCESS if the walk ended or was stopped, or:
+  * INITIALIZATION_ERROR if the FT is not in an initialized state
+  * BAD_PATH if pcPath does not represent a well-formatted path
+  * CONFLICTING_PATH if the root exists but is not a prefix of pcPath
+  * NO_SUCH_PATH if absolute path pcPath does not exist in the FT
+  * MEMORY_ERROR if memory could not be allocated to complete request
+*/
+int FT_walk(const char *pcPath, enum FT_walkOrder eOrder,
+            enum FT_walkAction (*pfVisit)(const struct FT_walkEntry *,
+                                          void *),
+            void *pvExtra);
+
+/*
+  Visits, as FT_walk does in pre-order, every directory and file of 
+  the FT whose absolute path matches pattern pcPattern, calling 
+  (*pfVisit)(psEntry, pvExtra) for each; psEntry->ulDepth is the 
+  number of components of the path. Each component of the pattern is
+  matched against one component of the path: '*' matches any run of
+  characters, '?' any one character, and "[...]" any one character of
+  the class ("[!...]" or "[^...]" of any other). A component "**" 
+  matches any number of components, including none, and one starting
+  with "**", as in "**.gz", means "**" followed by the rest with one
+  '*', as in "**" "*.gz". The pattern is compiled once, only 
+  directories on which a match may still be found are entered, and 
+  when a component starts with literal text only the children whose 
+  names start with it are looked at, found by binary search.
+  Returning FT_WALK_SKIP_SUBTREE for a matching directory skips its
+  descendants, and FT_WALK_STOP ends the search.
+  Returns SUCCESS, or:
+  * INITIALIZATION_ERROR if the FT is not in an initialized state
+  * BAD_PATH if pcPattern is not a well-formatted path, or has more
+             than 30 components
+  * MEMORY_ERROR if memory could not be allocated to complete request
+*/
+int FT_glob(const char *pcPattern,
+            enum FT_walkAction (*pfVisit)(const struct FT_walkEntry *,
+                                          void *),
+            void *pvExtra);
+
+/*
+  Visits, as FT_glob does, every directory and file of the FT whose
+  name (the last component of its path) is pcName, in no particular
+  order. If the FT has a name index (see FT_setNameIndex) this takes
+  time proportional to the number of matches; otherwise the whole FT
+  is walked. Returning FT_WALK_STOP ends the search.
+  Returns SUCCESS, or:
+  * INITIALIZATION_ERROR if the FT is not in an initialized state
+  * BAD_PATH if pcName is empty or contains '/'
+*/
+int FT_findByName(const char *pcName,
+                  enum FT_walkAction (*pfVisit)(
+                      const struct FT_walkEntry *, void *),
+                  void *pvExtra);
+
+/*
+  Visits, as FT_glob does, every directory and file of the FT whose
+  absolute path is not less than key pcStart (or every one, if pcStart
+  is NULL) and less than key pcEnd (or every one after pcStart, if
+  pcEnd is NULL), in increasing order of path. Paths and keys, which
+  need not be paths in the FT, are ordered character by character as
+  strcmp does, except that '/' comes before every other character, so
+  that a directory's subtree follows it without a break. The scan
+  seeks straight to pcStart by binary search at each level. 
+  FT_WALK_SKIP_SUBTREE skips a directory's descendants. If ppcResume 
+  is not NULL, *ppcResume is set to NULL if the scan reached the end 
+  of the range, or, if the visitor returned FT_WALK_STOP, to a key 
+  that can be passed as pcStart to resume right after the path it 
+  stopped at; the key is allocated for the caller, who must free it.
+  Returns SUCCESS, or:
+  * INITIALIZATION_ERROR if the FT is not in an initialized state
+  * MEMORY_ERROR if memory could not be allocated to complete request
+*/
+int FT_scanRange(const char *pcStart, const char *pcEnd,
+                 enum FT_walkAction (*pfVisit)(
+                     const struct FT_walkEntry *, void *),
+                 void *pvExtra, char **ppcResume);
+
+/*
+  Visits, as FT_scanRange does, every directory and file of the FT 
+  whose absolute path starts with pcPrefix, beginning with key 
+  pcStart if it is not NULL, and sets *ppcResume (unless ppcResume is
+  NULL) to a key to pass as pcStart to resume, or NULL.
+  Returns as FT_scanRange does.
+*/
+int FT_scanPrefix(const char *pcPrefix, const char *pcStart,
+                  enum FT_walkAction (*pfVisit)(
+                      const struct FT_walkEntry *, void *),
+                  void *pvExtra, char **ppcResume);
+
+/*
+  Walks the subtree rooted at absolute path pcPath as FT_walk does, 
+  but with ulThreads threads (one per processor if ulThreads is 0), 
+  calling (*pfVisit)(psEntry, ulWorker, pvExtra) for each directory 
+  and file of it, where ulWorker, less than the number of threads, 
+  identifies the calling thread so that the visitor can keep results
+  per thread. The threads split the subtree between them a directory
+  at a time, each stealing directories queued by the others once out
+  of work of its own, so that no order is kept except that a 
+  directory is visited before its children and its file children 
+  right after it, by the same thread. The visitor is called 
+  concurrently and must not change the FT. FT_WALK_SKIP_SUBTREE 
+  skips a directory's descendants, and FT_WALK_STOP ends the walk 
+  once the visits in progress end. The walk cannot run out of memory:
+  it uses fewer threads if it must.
+  Returns SUCCESS if the walk ended or was stopped, or:
+  * INITIALIZATION_ERROR if the FT is not in an initialized state
+  * BAD_PATH if pcPath does not represent a well-formatted path
+  * CONFLICTING_PATH if the root exists but is not a prefix of pcPath
+  * NO_SUCH_PATH if absolute path pcPath does not exist in the FT
+*/
+int FT_parallelWalk(const char *pcPath, size_t ulThreads,
+                    enum FT_walkAction (*pfVisit)(
+                        const struct FT_walkEntry *, size_t, void *),
+                    void *pvExtra);
+
 /*
   Sets the FT data structure to an initialized state.
   The data structure is initially empty.
@@ -127,9 +522,113 @@ int FT_stat(const char *pcPath, boolean *pbIsFile, size_t *pulSize);
 */
 int FT_init(void);
 
+/*
+  Selects whether the FT owns file contents (bOwned is TRUE) or borrows
+  the pointers passed to FT_insertFile and FT_replaceFileContents from
+  the client (bOwned is FALSE, the default). An owning FT copies
+  contents into its own storage: small contents are kept inline in the
+  file's node and larger ones in a size-classed content heap.
+  The setting applies to every later FT_init until changed.
+  Returns INITIALIZATION_ERROR if the FT is in an initialized state,
+  and SUCCESS otherwise.
+*/
+int FT_setOwnedContents(boolean bOwned);
+
+/*
+  Selects whether an FT that owns file contents deduplicates them
+  (bDedup is TRUE) or not (FALSE, the default). Deduplicated contents
+  passed to FT_insertFile or FT_replaceFileContents are kept in a
+  content-addressed store, so that byte-identical contents are stored
+  once and shared by every file holding them. Shared contents returned
+  by FT_getFileContents must not be modified. Contents small enough to
+  be stored inline in a file's node are never shared.
+  The setting applies to every later FT_init until changed, and has no
+  effect unless the FT owns file contents.
+  Returns INITIALIZATION_ERROR if the FT is in an initialized state,
+  and SUCCESS otherwise.
+*/
+int FT_setDedupContents(boolean bDedup);
+
+/*
+  Selects whether the FT keeps a secondary index of its directories
+  and files by name (bIndexed is TRUE) or not (FALSE, the default),
+  for FT_findByName. The index is kept up to date as directories and
+  files are inserted and removed, at the cost of one entry per node.
+  The setting applies to every later FT_init until changed.
+  Returns INITIALIZATION_ERROR if the FT is in an initialized state,
+  and SUCCESS otherwise.
+*/
+int FT_setNameIndex(boolean bIndexed);
+
+/*
+  Reports the size of the name index: sets *pulEntries to the number
+  of directories and files in it and *pulBytes to the memory it uses,
+  which is not counted anywhere else. Both are 0 if the FT has no name
+  index.
+  Returns INITIALIZATION_ERROR if the FT is not in an initialized
+  state, and SUCCESS otherwise.
+*/
+int FT_getNameIndexStats(size_t *pulEntries, size_t *pulBytes);
+
+/*
+  Reports how well file contents are deduplicated: sets
+  *pulLogicalBytes to the total length of the contents of all files
+  whose contents are in the content-addressed store, *pulStoredBytes
+  to the number of bytes actually stored for them, and *pdRatio to
+  their ratio (1.0 if nothing is stored).
+  Returns INITIALIZATION_ERROR if the FT is not in an initialized
+  state, and SUCCESS otherwise.
+*/
+int FT_getDedupStats(size_t *pulLogicalBytes, size_t *pulStoredBytes,
+                     double *pdRatio);
+
+/*
+  Makes an FT that owns file contents store the contents of any file
+  that are at least ulBytes long in a memory-mapped, unlinked backing
+  file in the temporary directory (TMPDIR, or /tmp) rather than in
+  memory, so that their pages can be written back and dropped by the
+  operating system under memory pressure. If ulBytes is 0 (the
+  default), no new contents are stored in the backing file. Contents
+  are moved when next stored, grown or rewritten in full, not at once.
+  The setting applies to all later operations. Returns SUCCESS.
+*/
+int FT_setSpillThreshold(size_t ulBytes);
+
+/*
+  Limits the memory used by the contents of an owning FT to about
+  ulBytes, or removes the limit if ulBytes is 0 (the default). Inline
+  and deduplicated contents are not counted. Whenever the limit is
+  exceeded, the contents of the least recently used unpinned files
+  are evicted to the backing file (see FT_setSpillThreshold), where
+  the operating system can write them back and drop their pages, and
+  moved back into memory when next got with FT_getFileContents.
+  Recency is tracked approximately, with a clock of reference bits.
+  The setting applies to all later operations. Returns SUCCESS.
+*/
+int FT_setContentBudget(size_t ulBytes);
+
+/*
+  Reclaims space in the backing file by moving file contents from its
+  end into free space nearer its start; space freed at the end of the
+  file is returned to the file system. Pointers previously returned by
+  FT_getFileContents may be invalidated.
+  Returns INITIALIZATION_ERROR if the FT is not in an initialized
+  state, and SUCCESS otherwise.
+*/
+int FT_compactBacking(void);
+
+/*
+  Sets *pulFileBytes to the length of the backing file and
+  *pulLiveBytes to the number of its bytes in use by file contents.
+  Returns INITIALIZATION_ERROR if the FT is not in an initialized
+  state, and SUCCESS otherwise.
+*/
+int FT_getBackingStats(size_t *pulFileBytes, size_t *pulLiveBytes);
+
 /*
   Removes all contents of the data structure and
-  returns it to an uninitialized state.
+  returns it to an uninitialized state, freeing a large tree with 
+  several threads as FT_rmDir does.
   Returns INITIALIZATION_ERROR if not already initialized,
   and SUCCESS otherwise.
 */
@@ -144,9 +643,35 @@ int FT_destroy(void);
   before directories at any given level, and nodes
   of the same type ordered lexicographically.
 
+  In an FT of several thousand directories, the text of disjoint 
+  subtrees is generated by several threads at once, each at an offset
+  measured beforehand, with the same result as generating it in 
+  order; a smaller FT's text is generated in order by the caller.
+
   Allocates memory for the returned string,
   which is then owned by client!
 */
 char *FT_toString(void);
 
+/*
+  Passes the string representation of the data structure, as 
+  FT_toString returns it but without a '\0', to 
+  (*pfWrite)(pcText, ulLength, pvExtra) in consecutive pieces, so 
+  that the whole of it is never in memory at once. Pieces are 
+  generated by ulThreads threads, or one per processor if ulThreads 
+  is 0 (by the calling thread alone if the FT has fewer than several
+  thousand directories), and each piece is borrowed for the duration
+  of its call only.
+  Stops early, without error, if pfWrite returns nonzero.
+  Returns status:
+  * INITIALIZATION_ERROR if the data structure is not in an
+    initialized state
+  * MEMORY_ERROR if memory could not be allocated to complete request
+  * SUCCESS otherwise
+*/
+int FT_streamString(size_t ulThreads,
+                    int (*pfWrite)(const char *pcText, size_t ulLength,
+                                   void *pvExtra),
+                    void *pvExtra);
+
 #endif
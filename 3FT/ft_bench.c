@@ -0,0 +1,717 @@
+/*--------------------------------------------------------------------*/
+/* ft_bench.c                                                         */
+/* Author: Will Huang and George Tziampazis                           */
+/*--------------------------------------------------------------------*/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include <sys/resource.h>
+#include <sys/types.h>
+#include <sys/wait.h>
+#include <unistd.h>
+#include "ft.h"
+
+/*
+  Benchmarks the FT with parameterized workloads, reporting for each
+  FT operation a workload uses its throughput and latency percentiles,
+  and for each workload its peak resident set size. Only the functions
+  of the reference implementation are called, so the same driver links
+  against sampleft.o (make -f Makefile.sampleft sampleft_bench) to
+  measure changes against a fixed baseline.
+
+  Usage: ft_bench [workload [scale]]
+  where workload is one of chain, wide, balanced, zipf, churn, dump or
+  all (the default), and the positive integer scale (default 1)
+  multiplies each workload's size. With all, each workload runs in its
+  own process, so that its peak resident set size is its own.
+
+  Each call is timed on its own with the monotonic clock, which adds
+  a few tens of nanoseconds to every latency reported.
+*/
+
+/* The FT operations that are timed */
+enum benchOp {
+   BENCH_INSERT_DIR, BENCH_INSERT_FILE, BENCH_CONTAINS_DIR,
+   BENCH_CONTAINS_FILE, BENCH_STAT, BENCH_GET_CONTENTS,
+   BENCH_REPLACE_CONTENTS, BENCH_RM_DIR, BENCH_RM_FILE,
+   BENCH_TO_STRING, BENCH_NUM_OPS
+};
+
+/* The names of the operations, in the order of enum benchOp */
+static const char *apcOpNames[BENCH_NUM_OPS] = {
+   "FT_insertDir", "FT_insertFile", "FT_containsDir",
+   "FT_containsFile", "FT_stat", "FT_getFileContents",
+   "FT_replaceFileContents", "FT_rmDir", "FT_rmFile", "FT_toString"
+};
+
+/* The latencies recorded for one operation */
+struct opStats {
+   /* the latencies in nanoseconds, in the order recorded */
+   unsigned long *aulNanos;
+   /* the number of latencies recorded */
+   size_t ulCount;
+   /* the number of latencies there is room for */
+   size_t ulSize;
+};
+
+/* The latencies of each operation in the current workload */
+static struct opStats asStats[BENCH_NUM_OPS];
+
+/* The contents every file is given; only their address is stored */
+static char acContents[] = "benchmark file contents";
+
+/* The state of the random number generator, fixed for repeatability */
+static unsigned long ulRandomState = 88172645463325252UL;
+
+/* Returns the next of a fixed sequence of pseudo-random numbers. */
+static unsigned long Bench_random(void) {
+   /* xorshift, so that every platform draws the same numbers */
+   ulRandomState ^= ulRandomState << 13;
+   ulRandomState ^= ulRandomState >> 7;
+   ulRandomState ^= ulRandomState << 17;
+   return ulRandomState;
+}
+
+/* Returns a pseudo-random number from 0 to ulBound - 1. */
+static size_t Bench_below(size_t ulBound) {
+   return (size_t)(Bench_random() % ulBound);
+}
+
+/* Returns the monotonic time in nanoseconds. */
+static unsigned long Bench_now(void) {
+   struct timespec sTime;
+
+   clock_gettime(CLOCK_MONOTONIC, &sTime);
+   return (unsigned long)sTime.tv_sec * 1000000000UL +
+          (unsigned long)sTime.tv_nsec;
+}
+
+/* Reports that the benchmark cannot go on because of pcWhat. */
+static void Bench_fail(const char *pcWhat, const char *pcPath) {
+   fprintf(stderr, "ft_bench: %s%s%s\n", pcWhat,
+           pcPath != NULL ? ": " : "", pcPath != NULL ? pcPath : "");
+   exit(EXIT_FAILURE);
+}
+
+/* Returns a pointer to ulSize new bytes, failing if there are none. */
+static void *Bench_malloc(size_t ulSize) {
+   void *pv = malloc(ulSize);
+
+   if(pv == NULL)
+      Bench_fail("out of memory", NULL);
+   return pv;
+}
+
+/* Records that a call of operation eOp began at time ulStart. */
+static void Bench_record(enum benchOp eOp, unsigned long ulStart) {
+   unsigned long ulNanos = Bench_now() - ulStart;
+   struct opStats *psStats = &asStats[eOp];
+   unsigned long *aulNew;
+
+   if(psStats->ulCount == psStats->ulSize) {
+      psStats->ulSize = psStats->ulSize == 0 ? 1024 : 2 * psStats->ulSize;
+      aulNew = realloc(psStats->aulNanos,
+                       psStats->ulSize * sizeof(unsigned long));
+      if(aulNew == NULL)
+         Bench_fail("out of memory", NULL);
+      psStats->aulNanos = aulNew;
+   }
+   psStats->aulNanos[psStats->ulCount++] = ulNanos;
+}
+
+/*
+  Checks that iStatus, what a call of operation eOp on pcPath
+  returned, is iExpected, since a benchmark of calls that fail
+  unexpectedly would measure the wrong thing.
+*/
+static void Bench_check(enum benchOp eOp, const char *pcPath,
+                        int iStatus, int iExpected) {
+   char acWhat[64];
+
+   if(iStatus == iExpected)
+      return;
+   sprintf(acWhat, "%s returned %d, not %d", apcOpNames[eOp], iStatus,
+           iExpected);
+   Bench_fail(acWhat, pcPath);
+}
+
+/* ------------------------------------------------------------------ */
+/*
+  The following functions call the FT operation they are named after,
+  timing it and checking that it returned what the workload expects.
+*/
+
+static void Bench_insertDir(const char *pcPath, int iExpected) {
+   unsigned long ulStart = Bench_now();
+   int iStatus = FT_insertDir(pcPath);
+
+   Bench_record(BENCH_INSERT_DIR, ulStart);
+   Bench_check(BENCH_INSERT_DIR, pcPath, iStatus, iExpected);
+}
+
+static void Bench_insertFile(const char *pcPath, int iExpected) {
+   unsigned long ulStart = Bench_now();
+   int iStatus = FT_insertFile(pcPath, acContents, sizeof(acContents));
+
+   Bench_record(BENCH_INSERT_FILE, ulStart);
+   Bench_check(BENCH_INSERT_FILE, pcPath, iStatus, iExpected);
+}
+
+static void Bench_containsDir(const char *pcPath, boolean bExpected) {
+   unsigned long ulStart = Bench_now();
+   boolean bFound = FT_containsDir(pcPath);
+
+   Bench_record(BENCH_CONTAINS_DIR, ulStart);
+   Bench_check(BENCH_CONTAINS_DIR, pcPath, bFound, bExpected);
+}
+
+static void Bench_containsFile(const char *pcPath, boolean bExpected) {
+   unsigned long ulStart = Bench_now();
+   boolean bFound = FT_containsFile(pcPath);
+
+   Bench_record(BENCH_CONTAINS_FILE, ulStart);
+   Bench_check(BENCH_CONTAINS_FILE, pcPath, bFound, bExpected);
+}
+
+static void Bench_stat(const char *pcPath, int iExpected) {
+   boolean bIsFile;
+   size_t ulSize;
+   unsigned long ulStart = Bench_now();
+   int iStatus = FT_stat(pcPath, &bIsFile, &ulSize);
+
+   Bench_record(BENCH_STAT, ulStart);
+   Bench_check(BENCH_STAT, pcPath, iStatus, iExpected);
+}
+
+static void Bench_getContents(const char *pcPath) {
+   unsigned long ulStart = Bench_now();
+   void *pvContents = FT_getFileContents(pcPath);
+
+   Bench_record(BENCH_GET_CONTENTS, ulStart);
+   if(pvContents == NULL)
+      Bench_fail("FT_getFileContents returned NULL", pcPath);
+}
+
+static void Bench_replaceContents(const char *pcPath) {
+   unsigned long ulStart = Bench_now();
+   void *pvOld = FT_replaceFileContents(pcPath, acContents,
+                                        sizeof(acContents));
+
+   Bench_record(BENCH_REPLACE_CONTENTS, ulStart);
+   if(pvOld == NULL)
+      Bench_fail("FT_replaceFileContents returned NULL", pcPath);
+}
+
+static void Bench_rmDir(const char *pcPath, int iExpected) {
+   unsigned long ulStart = Bench_now();
+   int iStatus = FT_rmDir(pcPath);
+
+   Bench_record(BENCH_RM_DIR, ulStart);
+   Bench_check(BENCH_RM_DIR, pcPath, iStatus, iExpected);
+}
+
+static void Bench_rmFile(const char *pcPath, int iExpected) {
+   unsigned long ulStart = Bench_now();
+   int iStatus = FT_rmFile(pcPath);
+
+   Bench_record(BENCH_RM_FILE, ulStart);
+   Bench_check(BENCH_RM_FILE, pcPath, iStatus, iExpected);
+}
+
+/* Returns the length of the string FT_toString returned. */
+static size_t Bench_toString(void) {
+   unsigned long ulStart = Bench_now();
+   char *pcDump = FT_toString();
+   size_t ulLength;
+
+   Bench_record(BENCH_TO_STRING, ulStart);
+   if(pcDump == NULL)
+      Bench_fail("FT_toString returned NULL", NULL);
+   ulLength = strlen(pcDump);
+   free(pcDump);
+   return ulLength;
+}
+
+/* ------------------------------------------------------------------ */
+/*
+  The following functions build and tear down the trees that the
+  workloads run on.
+*/
+
+/* Returns a new copy of the string pcString. */
+static char *Bench_strdup(const char *pcString) {
+   char *pcCopy = Bench_malloc(strlen(pcString) + 1);
+
+   strcpy(pcCopy, pcString);
+   return pcCopy;
+}
+
+/* Frees the ulCount strings in ppcStrings and the array itself. */
+static void Bench_freeStrings(char **ppcStrings, size_t ulCount) {
+   size_t i;
+
+   for(i = 0; i < ulCount; i++)
+      free(ppcStrings[i]);
+   free(ppcStrings);
+}
+
+/* Returns a new array of 0 to ulCount - 1 in random order. */
+static size_t *Bench_shuffled(size_t ulCount) {
+   size_t *aulOrder = Bench_malloc(ulCount * sizeof(size_t));
+   size_t ulSwap;
+   size_t i;
+   size_t j;
+
+   for(i = 0; i < ulCount; i++)
+      aulOrder[i] = i;
+   /* Fisher-Yates */
+   for(i = ulCount; i > 1; i--) {
+      j = Bench_below(i);
+      ulSwap = aulOrder[i - 1];
+      aulOrder[i - 1] = aulOrder[j];
+      aulOrder[j] = ulSwap;
+   }
+   return aulOrder;
+}
+
+/* The shape of a full tree of files */
+enum { BENCH_FANOUT = 8, BENCH_LEVELS = 4 };
+
+/*
+  Inserts, in random order, the files of a full tree under root "b"
+  with BENCH_LEVELS levels of BENCH_FANOUT directories each and
+  BENCH_FANOUT * ulScale files in each directory of the last level,
+  creating the directories as the files need them. Returns the paths
+  of the files, and sets *pulCount to their number.
+*/
+static char **Bench_buildBalanced(size_t ulScale, size_t *pulCount) {
+   char acPath[64];
+   char **ppcPaths;
+   size_t *aulOrder;
+   size_t ulCount = BENCH_FANOUT * ulScale;
+   size_t ulRest;
+   size_t ulLength;
+   size_t i;
+   int iLevel;
+
+   for(iLevel = 0; iLevel < BENCH_LEVELS; iLevel++)
+      ulCount *= BENCH_FANOUT;
+
+   ppcPaths = Bench_malloc(ulCount * sizeof(char *));
+   for(i = 0; i < ulCount; i++) {
+      /* the file's number picks its directory at every level */
+      ulRest = i;
+      ulLength = (size_t)sprintf(acPath, "b");
+      for(iLevel = 0; iLevel < BENCH_LEVELS; iLevel++) {
+         ulLength += (size_t)sprintf(acPath + ulLength, "/dir%lu",
+                                     (unsigned long)(ulRest %
+                                                     BENCH_FANOUT));
+         ulRest /= BENCH_FANOUT;
+      }
+      sprintf(acPath + ulLength, "/file%lu", (unsigned long)ulRest);
+      ppcPaths[i] = Bench_strdup(acPath);
+   }
+
+   aulOrder = Bench_shuffled(ulCount);
+   for(i = 0; i < ulCount; i++)
+      Bench_insertFile(ppcPaths[aulOrder[i]], SUCCESS);
+   free(aulOrder);
+
+   *pulCount = ulCount;
+   return ppcPaths;
+}
+
+/* ------------------------------------------------------------------ */
+/*
+  The following functions are the workloads. Each runs on an empty,
+  initialized FT and leaves it to be destroyed.
+*/
+
+/*
+  A chain of 200 * ulScale directories, each the only child of the
+  last: inserted one level at a time, looked up at every level, given
+  a file at the bottom, and removed from the top.
+*/
+static void Bench_chain(size_t ulScale) {
+   size_t ulDepth = 200 * ulScale;
+   char *pcPath;
+   size_t ulLength;
+   char cSaved;
+   size_t i;
+
+   /* "c" and then "/d" for each level below it, and "/f" */
+   pcPath = Bench_malloc(2 * ulDepth + 3);
+   strcpy(pcPath, "c");
+   Bench_insertDir(pcPath, SUCCESS);
+   for(i = 1, ulLength = 1; i < ulDepth; i++, ulLength += 2) {
+      strcpy(pcPath + ulLength, "/d");
+      Bench_insertDir(pcPath, SUCCESS);
+   }
+
+   /* every level, by cutting the path short */
+   for(i = 0; i < ulDepth; i++) {
+      cSaved = pcPath[1 + 2 * i];
+      pcPath[1 + 2 * i] = '\0';
+      Bench_containsDir(pcPath, TRUE);
+      Bench_stat(pcPath, SUCCESS);
+      pcPath[1 + 2 * i] = cSaved;
+   }
+
+   strcpy(pcPath + ulLength, "/f");
+   Bench_insertFile(pcPath, SUCCESS);
+   Bench_containsFile(pcPath, TRUE);
+   Bench_getContents(pcPath);
+   Bench_rmFile(pcPath, SUCCESS);
+
+   Bench_rmDir("c", SUCCESS);
+   free(pcPath);
+}
+
+/*
+  One directory with 10000 * ulScale children, half files and half
+  directories: inserted in random order, each looked up as what it is
+  and as what it is not, looked up when absent, and removed in another
+  random order.
+*/
+static void Bench_wide(size_t ulScale) {
+   size_t ulCount = 10000 * ulScale;
+   char **ppcPaths;
+   size_t *aulOrder;
+   char acPath[64];
+   size_t i;
+
+   /* names that share a long prefix, as generated names often do */
+   ppcPaths = Bench_malloc(ulCount * sizeof(char *));
+   for(i = 0; i < ulCount; i++) {
+      sprintf(acPath, "w/entry_%08lx", (unsigned long)i);
+      ppcPaths[i] = Bench_strdup(acPath);
+   }
+
+   Bench_insertDir("w", SUCCESS);
+   aulOrder = Bench_shuffled(ulCount);
+   for(i = 0; i < ulCount; i++) {
+      if(aulOrder[i] % 2 == 0)
+         Bench_insertFile(ppcPaths[aulOrder[i]], SUCCESS);
+      else
+         Bench_insertDir(ppcPaths[aulOrder[i]], SUCCESS);
+   }
+   free(aulOrder);
+
+   for(i = 0; i < ulCount; i++) {
+      Bench_containsFile(ppcPaths[i], i % 2 == 0);
+      Bench_containsDir(ppcPaths[i], i % 2 != 0);
+      Bench_stat(ppcPaths[i], SUCCESS);
+   }
+   for(i = 0; i < ulCount; i++) {
+      sprintf(acPath, "w/entry_%08lx", (unsigned long)(ulCount + i));
+      Bench_containsFile(acPath, FALSE);
+      Bench_stat(acPath, NO_SUCH_PATH);
+   }
+
+   aulOrder = Bench_shuffled(ulCount);
+   for(i = 0; i < ulCount; i++) {
+      if(aulOrder[i] % 2 == 0)
+         Bench_rmFile(ppcPaths[aulOrder[i]], SUCCESS);
+      else
+         Bench_rmDir(ppcPaths[aulOrder[i]], SUCCESS);
+   }
+   free(aulOrder);
+
+   Bench_freeStrings(ppcPaths, ulCount);
+}
+
+/*
+  A full tree of 32768 * ulScale files (see Bench_buildBalanced),
+  each then looked up in random order, and its directories looked up
+  from every file.
+*/
+static void Bench_balanced(size_t ulScale) {
+   char **ppcPaths;
+   size_t *aulOrder;
+   size_t ulCount;
+   char *pcSlash;
+   size_t i;
+
+   ppcPaths = Bench_buildBalanced(ulScale, &ulCount);
+
+   aulOrder = Bench_shuffled(ulCount);
+   for(i = 0; i < ulCount; i++) {
+      Bench_containsFile(ppcPaths[aulOrder[i]], TRUE);
+      Bench_stat(ppcPaths[aulOrder[i]], SUCCESS);
+      Bench_getContents(ppcPaths[aulOrder[i]]);
+
+      /* the file's parent directory */
+      pcSlash = strrchr(ppcPaths[aulOrder[i]], '/');
+      *pcSlash = '\0';
+      Bench_containsDir(ppcPaths[aulOrder[i]], TRUE);
+      *pcSlash = '/';
+   }
+   free(aulOrder);
+
+   Bench_freeStrings(ppcPaths, ulCount);
+}
+
+/*
+  A full tree of 32768 files (see Bench_buildBalanced), then
+  200000 * ulScale reads of files drawn from a Zipf distribution with
+  exponent 1, so that a few hot files take most of the reads, as in
+  real file systems.
+*/
+static void Bench_zipf(size_t ulScale) {
+   size_t ulReads = 200000 * ulScale;
+   char **ppcPaths;
+   size_t *aulByRank;
+   double *adCumulative;
+   double dTotal = 0.0;
+   double dDraw;
+   size_t ulCount;
+   size_t ulLow;
+   size_t ulHigh;
+   size_t ulMid;
+   size_t i;
+
+   ppcPaths = Bench_buildBalanced(1, &ulCount);
+
+   /* the probability of rank r is proportional to 1 / (r + 1) */
+   adCumulative = Bench_malloc(ulCount * sizeof(double));
+   for(i = 0; i < ulCount; i++) {
+      dTotal += 1.0 / (double)(i + 1);
+      adCumulative[i] = dTotal;
+   }
+   /* the hot files are scattered through the tree */
+   aulByRank = Bench_shuffled(ulCount);
+
+   for(i = 0; i < ulReads; i++) {
+      dDraw = (double)(Bench_random() >> 11) / 9007199254740992.0 *
+              dTotal;
+      /* the first rank whose cumulative weight exceeds the draw */
+      ulLow = 0;
+      ulHigh = ulCount - 1;
+      while(ulLow < ulHigh) {
+         ulMid = ulLow + (ulHigh - ulLow) / 2;
+         if(adCumulative[ulMid] <= dDraw)
+            ulLow = ulMid + 1;
+         else
+            ulHigh = ulMid;
+      }
+
+      /* mostly reads of the contents, then stats and checks */
+      switch(i % 10) {
+         case 0:
+            Bench_containsFile(ppcPaths[aulByRank[ulLow]], TRUE);
+            break;
+         case 1: case 2: case 3:
+            Bench_stat(ppcPaths[aulByRank[ulLow]], SUCCESS);
+            break;
+         default:
+            Bench_getContents(ppcPaths[aulByRank[ulLow]]);
+            break;
+      }
+   }
+
+   free(adCumulative);
+   free(aulByRank);
+   Bench_freeStrings(ppcPaths, ulCount);
+}
+
+/*
+  10000 * ulScale live entries spread over 256 directories, half
+  files and half directories, then 100000 * ulScale rounds of removing
+  a random entry and inserting a new one of the same kind in another
+  random directory, with a file's contents replaced every fourth round.
+*/
+static void Bench_churn(size_t ulScale) {
+   size_t ulLive = 10000 * ulScale;
+   size_t ulRounds = 100000 * ulScale;
+   unsigned long ulNextName = 0;
+   char **ppcPaths;
+   char acPath[64];
+   size_t ulSlot;
+   size_t i;
+
+   ppcPaths = Bench_malloc(ulLive * sizeof(char *));
+   for(i = 0; i < ulLive + ulRounds; i++) {
+      /* even slots hold files and odd slots directories */
+      ulSlot = i < ulLive ? i : Bench_below(ulLive);
+      if(i >= ulLive) {
+         if(ulSlot % 2 == 0)
+            Bench_rmFile(ppcPaths[ulSlot], SUCCESS);
+         else
+            Bench_rmDir(ppcPaths[ulSlot], SUCCESS);
+         free(ppcPaths[ulSlot]);
+      }
+
+      sprintf(acPath, "u/%lu/%lu/n%lu",
+              (unsigned long)Bench_below(16),
+              (unsigned long)Bench_below(16), ulNextName++);
+      ppcPaths[ulSlot] = Bench_strdup(acPath);
+      if(ulSlot % 2 == 0)
+         Bench_insertFile(ppcPaths[ulSlot], SUCCESS);
+      else
+         Bench_insertDir(ppcPaths[ulSlot], SUCCESS);
+
+      if(i >= ulLive && i % 4 == 0)
+         Bench_replaceContents(ppcPaths[2 * Bench_below(ulLive / 2)]);
+   }
+
+   Bench_freeStrings(ppcPaths, ulLive);
+}
+
+/*
+  A full tree of 32768 * ulScale files (see Bench_buildBalanced),
+  dumped whole with FT_toString 20 times.
+*/
+static void Bench_dump(size_t ulScale) {
+   char **ppcPaths;
+   size_t ulCount;
+   size_t ulBytes = 0;
+   int iDump;
+
+   ppcPaths = Bench_buildBalanced(ulScale, &ulCount);
+   for(iDump = 0; iDump < 20; iDump++)
+      ulBytes = Bench_toString();
+   printf("  dump size %lu bytes\n", (unsigned long)ulBytes);
+
+   Bench_freeStrings(ppcPaths, ulCount);
+}
+
+/* ------------------------------------------------------------------ */
+
+/* A workload and its name */
+struct workload {
+   const char *pcName;
+   void (*pfRun)(size_t ulScale);
+};
+
+/* The workloads, in the order all runs them */
+static const struct workload asWorkloads[] = {
+   {"chain", Bench_chain},
+   {"wide", Bench_wide},
+   {"balanced", Bench_balanced},
+   {"zipf", Bench_zipf},
+   {"churn", Bench_churn},
+   {"dump", Bench_dump}
+};
+
+enum { BENCH_NUM_WORKLOADS =
+          sizeof(asWorkloads) / sizeof(asWorkloads[0]) };
+
+/* Compares the latencies at pv1 and pv2 for qsort. */
+static int Bench_compareNanos(const void *pv1, const void *pv2) {
+   unsigned long ul1 = *(const unsigned long *)pv1;
+   unsigned long ul2 = *(const unsigned long *)pv2;
+
+   return (ul1 > ul2) - (ul1 < ul2);
+}
+
+/*
+  Prints, for each operation called, the number of calls, the calls
+  per second of time spent in them, and the median, 90th, 99th
+  percentile and largest latency, and then frees the latencies.
+*/
+static void Bench_report(void) {
+   struct opStats *psStats;
+   unsigned long ulTotal;
+   size_t i;
+   int iOp;
+
+   printf("  %-22s %9s %12s %9s %9s %9s %10s\n", "operation", "calls",
+          "ops/sec", "p50 ns", "p90 ns", "p99 ns", "max ns");
+   for(iOp = 0; iOp < BENCH_NUM_OPS; iOp++) {
+      psStats = &asStats[iOp];
+      if(psStats->ulCount == 0)
+         continue;
+      ulTotal = 0;
+      for(i = 0; i < psStats->ulCount; i++)
+         ulTotal += psStats->aulNanos[i];
+      qsort(psStats->aulNanos, psStats->ulCount, sizeof(unsigned long),
+            Bench_compareNanos);
+      printf("  %-22s %9lu %12.0f %9lu %9lu %9lu %10lu\n",
+             apcOpNames[iOp], (unsigned long)psStats->ulCount,
+             (double)psStats->ulCount * 1e9 /
+             (double)(ulTotal > 0 ? ulTotal : 1),
+             psStats->aulNanos[psStats->ulCount / 2],
+             psStats->aulNanos[psStats->ulCount * 9 / 10],
+             psStats->aulNanos[psStats->ulCount * 99 / 100],
+             psStats->aulNanos[psStats->ulCount - 1]);
+      free(psStats->aulNanos);
+      psStats->aulNanos = NULL;
+      psStats->ulCount = 0;
+      psStats->ulSize = 0;
+   }
+}
+
+/* Runs workload psWorkload at scale ulScale and reports on it. */
+static void Bench_run(const struct workload *psWorkload, size_t ulScale) {
+   struct rusage sUsage;
+   unsigned long ulStart;
+   unsigned long ulWall;
+
+   printf("%s (scale %lu)\n", psWorkload->pcName,
+          (unsigned long)ulScale);
+   if(FT_init() != SUCCESS)
+      Bench_fail("FT_init failed", NULL);
+   ulStart = Bench_now();
+   (*psWorkload->pfRun)(ulScale);
+   ulWall = Bench_now() - ulStart;
+   if(FT_destroy() != SUCCESS)
+      Bench_fail("FT_destroy failed", NULL);
+
+   Bench_report();
+   getrusage(RUSAGE_SELF, &sUsage);
+   printf("  wall time %.3f s, peak RSS %ld KB\n\n",
+          (double)ulWall / 1e9, sUsage.ru_maxrss);
+}
+
+/*
+  Runs the workload named by argv[1], or all of them, at the scale
+  argv[2], or 1. Returns 0, or EXIT_FAILURE if the arguments are
+  bad or a workload fails.
+*/
+int main(int argc, char *argv[]) {
+   size_t ulScale = 1;
+   const char *pcName = "all";
+   pid_t iPid;
+   int iChildStatus;
+   int iResult = 0;
+   int i;
+
+   if(argc > 3 ||
+      (argc == 3 && (ulScale = strtoul(argv[2], NULL, 10)) == 0)) {
+      fprintf(stderr, "Usage: %s [workload [scale]]\n", argv[0]);
+      return EXIT_FAILURE;
+   }
+   if(argc >= 2)
+      pcName = argv[1];
+
+   for(i = 0; i < BENCH_NUM_WORKLOADS; i++) {
+      if(strcmp(pcName, asWorkloads[i].pcName) == 0) {
+         Bench_run(&asWorkloads[i], ulScale);
+         return 0;
+      }
+   }
+   if(strcmp(pcName, "all") != 0) {
+      fprintf(stderr, "%s: no workload named %s\n", argv[0], pcName);
+      return EXIT_FAILURE;
+   }
+
+   /* a process for each, so that the peak RSS reported is its own */
+   for(i = 0; i < BENCH_NUM_WORKLOADS; i++) {
+      fflush(stdout);
+      iPid = fork();
+      if(iPid < 0)
+         Bench_fail("fork failed", NULL);
+      if(iPid == 0) {
+         Bench_run(&asWorkloads[i], ulScale);
+         exit(0);
+      }
+      if(waitpid(iPid, &iChildStatus, 0) < 0 ||
+         !WIFEXITED(iChildStatus) || WEXITSTATUS(iChildStatus) != 0)
+         iResult = EXIT_FAILURE;
+   }
+   return iResult;
+}
@@ -8,7 +8,2086 @@
 #include <stdlib.h>
 #include <stdio.h>
 #include <string.h>
+#include <unistd.h>
 #include "ft.h"
+#include "dynarray.h"
+
+/* The tests of the extensions of the FT interface below are left out
+   when testing the reference implementation, which lacks them. */
+#ifndef FT_BASELINE
+
+/* Tests that an owning FT copies file contents in, whether they are
+   kept inline or in the content heap, and keeps them across
+   replacements that move them from one to the other. */
+static void testOwnedContents(void) {
+  enum {BIGLEN = 10000};
+  char acSmall[6] = "small";
+  char acBig[BIGLEN];
+  char* pcOld;
+  char* pcContents;
+  boolean bIsFile;
+  size_t l;
+  size_t i;
+
+  memset(acBig, 'x', BIGLEN);
+  assert(FT_setOwnedContents(TRUE) == SUCCESS);
+  assert(FT_init() == SUCCESS);
+  assert(FT_setOwnedContents(FALSE) == INITIALIZATION_ERROR);
+
+  /* contents are copied, so changing the client's buffer afterwards
+     does not change them */
+  assert(FT_insertFile("1root/small", acSmall, sizeof(acSmall)) ==
+         SUCCESS);
+  acSmall[0] = 'S';
+  assert(!strcmp(FT_getFileContents("1root/small"), "small"));
+  assert(FT_insertFile("1root/big", acBig, BIGLEN) == SUCCESS);
+  pcContents = FT_getFileContents("1root/big");
+  assert(pcContents != acBig);
+  assert(!memcmp(pcContents, acBig, BIGLEN));
+
+  /* heap to inline: the old contents are returned as a copy */
+  pcOld = FT_replaceFileContents("1root/big", "tiny", 5);
+  assert(pcOld != NULL);
+  assert(!memcmp(pcOld, acBig, BIGLEN));
+  free(pcOld);
+  assert(!strcmp(FT_getFileContents("1root/big"), "tiny"));
+  assert(FT_stat("1root/big", &bIsFile, &l) == SUCCESS);
+  assert(bIsFile == TRUE);
+  assert(l == 5);
+
+  /* inline to heap, and back to a shorter prefix of the same bytes */
+  pcOld = FT_replaceFileContents("1root/small", acBig, BIGLEN);
+  assert(!strcmp(pcOld, "small"));
+  free(pcOld);
+  assert(!memcmp(FT_getFileContents("1root/small"), acBig, BIGLEN));
+  pcOld = FT_replaceFileContents("1root/small",
+                                 FT_getFileContents("1root/small"), 3);
+  assert(!memcmp(pcOld, acBig, BIGLEN));
+  free(pcOld);
+  assert(!memcmp(FT_getFileContents("1root/small"), "xxx", 3));
+  assert(FT_stat("1root/small", &bIsFile, &l) == SUCCESS);
+  assert(l == 3);
+
+  /* NULL contents are zero bytes, and empty contents are NULL */
+  assert(FT_insertFile("1root/zeros", NULL, 100) == SUCCESS);
+  pcContents = FT_getFileContents("1root/zeros");
+  for(i = 0; i < 100; i++)
+    assert(pcContents[i] == '\0');
+  pcOld = FT_replaceFileContents("1root/zeros", NULL, 0);
+  free(pcOld);
+  assert(FT_getFileContents("1root/zeros") == NULL);
+  assert(FT_replaceFileContents("1root/zeros", acBig, 1) == NULL);
+
+  assert(FT_destroy() == SUCCESS);
+  assert(FT_setOwnedContents(FALSE) == SUCCESS);
+}
+
+/* Tests that a deduplicating FT stores identical contents once, and
+   keeps count of their sharers across removals and replacements. */
+static void testDedupContents(void) {
+  enum {LEN = 1000};
+  char acSame[LEN];
+  char acOther[LEN];
+  char acPath[32];
+  char* pcOld;
+  size_t ulLogical, ulStored;
+  double dRatio;
+  int i;
+
+  memset(acSame, 'x', LEN);
+  memset(acOther, 'x', LEN);
+  acOther[LEN - 1] = 'y';
+  assert(FT_setOwnedContents(TRUE) == SUCCESS);
+  assert(FT_setDedupContents(TRUE) == SUCCESS);
+  assert(FT_init() == SUCCESS);
+  assert(FT_getDedupStats(&ulLogical, &ulStored, &dRatio) == SUCCESS);
+  assert(ulLogical == 0);
+  assert(ulStored == 0);
+  assert(dRatio == 1.0);
+
+  /* identical contents share storage */
+  for(i = 0; i < 10; i++) {
+    sprintf(acPath, "1root/f%d", i);
+    assert(FT_insertFile(acPath, acSame, LEN) == SUCCESS);
+  }
+  assert(FT_insertFile("1root/g", acOther, LEN) == SUCCESS);
+  assert(FT_getFileContents("1root/f0") ==
+         FT_getFileContents("1root/f9"));
+  assert(FT_getFileContents("1root/f0") !=
+         FT_getFileContents("1root/g"));
+  assert(FT_getDedupStats(&ulLogical, &ulStored, &dRatio) == SUCCESS);
+  assert(ulLogical == 11 * LEN);
+  assert(ulStored == 2 * LEN);
+  assert(dRatio == 5.5);
+
+  /* a replaced sharer leaves the others their contents */
+  pcOld = FT_replaceFileContents("1root/f0", acOther, LEN);
+  assert(!memcmp(pcOld, acSame, LEN));
+  free(pcOld);
+  assert(FT_getFileContents("1root/f0") ==
+         FT_getFileContents("1root/g"));
+  assert(!memcmp(FT_getFileContents("1root/f1"), acSame, LEN));
+  assert(FT_getDedupStats(&ulLogical, &ulStored, &dRatio) == SUCCESS);
+  assert(ulLogical == 11 * LEN);
+  assert(ulStored == 2 * LEN);
+
+  /* contents are kept until their last sharer is removed */
+  for(i = 1; i < 9; i++) {
+    sprintf(acPath, "1root/f%d", i);
+    assert(FT_rmFile(acPath) == SUCCESS);
+  }
+  assert(!memcmp(FT_getFileContents("1root/f9"), acSame, LEN));
+  assert(FT_getDedupStats(&ulLogical, &ulStored, &dRatio) == SUCCESS);
+  assert(ulLogical == 3 * LEN);
+  assert(ulStored == 2 * LEN);
+  assert(FT_rmFile("1root/f9") == SUCCESS);
+  assert(FT_getDedupStats(&ulLogical, &ulStored, &dRatio) == SUCCESS);
+  assert(ulLogical == 2 * LEN);
+  assert(ulStored == LEN);
+
+  /* and inserting them again stores them anew */
+  assert(FT_insertFile("1root/f9", acSame, LEN) == SUCCESS);
+  assert(!memcmp(FT_getFileContents("1root/f9"), acSame, LEN));
+  assert(FT_getDedupStats(&ulLogical, &ulStored, &dRatio) == SUCCESS);
+  assert(ulLogical == 3 * LEN);
+  assert(ulStored == 2 * LEN);
+
+  assert(FT_destroy() == SUCCESS);
+  assert(FT_setDedupContents(FALSE) == SUCCESS);
+  assert(FT_setOwnedContents(FALSE) == SUCCESS);
+}
+
+/* Asserts that the contents of the file with path pcPath are the
+   ulLength bytes at pcModel, reading them in uneven pieces. */
+static void checkRanges(const char* pcPath, const char* pcModel,
+                        size_t ulLength) {
+  enum {PIECE = 1000};
+  char acBuf[PIECE];
+  boolean bIsFile;
+  size_t ulOffset;
+  size_t l;
+
+  assert(FT_stat(pcPath, &bIsFile, &l) == SUCCESS);
+  assert(l == ulLength);
+  for(ulOffset = 0; ulOffset < ulLength; ulOffset += l) {
+    assert(FT_readFile(pcPath, ulOffset, acBuf, PIECE - 3, &l) ==
+           SUCCESS);
+    assert(l == (ulLength - ulOffset < PIECE - 3 ?
+                 ulLength - ulOffset : PIECE - 3));
+    assert(!memcmp(acBuf, pcModel + ulOffset, l));
+  }
+}
+
+/* Tests ranged reads and writes of file contents at offsets across
+   the boundaries of the 4096-byte chunks that large contents are
+   kept in, and past the end of the contents. */
+static void testRanges(void) {
+  enum {MAXLEN = 16384};
+  static char acModel[MAXLEN];
+  char acBuf[16];
+  size_t l;
+
+  assert(FT_setOwnedContents(TRUE) == SUCCESS);
+  assert(FT_init() == SUCCESS);
+  memset(acModel, 'a', 100);
+  assert(FT_insertFile("1root/f", acModel, 100) == SUCCESS);
+  assert(FT_insertDir("1root/d") == SUCCESS);
+
+  /* a write past the end fills the gap with zeros */
+  assert(FT_writeFile("1root/f", 4090, "bbbbbbbbbbbbbbbbbbbb", 20) ==
+         SUCCESS);
+  memset(acModel + 4090, 'b', 20);
+  checkRanges("1root/f", acModel, 4110);
+  assert(FT_readFile("1root/f", 4094, acBuf, 4, &l) == SUCCESS);
+  assert(l == 4);
+  assert(!memcmp(acBuf, "bbbb", 4));
+
+  /* a write spanning two boundaries, inside the contents */
+  memset(acModel + 4000, 'c', 4300);
+  assert(FT_writeFile("1root/f", 4000, acModel + 4000, 4300) ==
+         SUCCESS);
+  checkRanges("1root/f", acModel, 8300);
+
+  /* reads at and past the end */
+  assert(FT_readFile("1root/f", 8296, acBuf, 16, &l) == SUCCESS);
+  assert(l == 4);
+  assert(!memcmp(acBuf, "cccc", 4));
+  l = 99;
+  assert(FT_readFile("1root/f", 8300, acBuf, 16, &l) == SUCCESS);
+  assert(l == 0);
+  assert(FT_readFile("1root/f", 20000, acBuf, 16, &l) == SUCCESS);
+  assert(l == 0);
+
+  /* appending across a boundary */
+  memset(acModel + 8300, 'd', 100);
+  assert(FT_appendFile("1root/f", acModel + 8300, 100) == SUCCESS);
+  checkRanges("1root/f", acModel, 8400);
+
+  /* truncating across a boundary and extending again gives zeros */
+  assert(FT_truncateFile("1root/f", 4097) == SUCCESS);
+  checkRanges("1root/f", acModel, 4097);
+  assert(FT_truncateFile("1root/f", 12289) == SUCCESS);
+  memset(acModel + 4097, '\0', 12289 - 4097);
+  checkRanges("1root/f", acModel, 12289);
+  assert(FT_truncateFile("1root/f", 0) == SUCCESS);
+  checkRanges("1root/f", acModel, 0);
+  assert(FT_writeFile("1root/f", 5, "e", 1) == SUCCESS);
+  memset(acModel, '\0', 5);
+  acModel[5] = 'e';
+  checkRanges("1root/f", acModel, 6);
+
+  assert(FT_writeFile("1root/d", 0, "x", 1) == NOT_A_FILE);
+  assert(FT_writeFile("1root/g", 0, "x", 1) == NO_SUCH_PATH);
+  assert(FT_readFile("1root/d", 0, acBuf, 1, &l) == NOT_A_FILE);
+  assert(FT_truncateFile("1root/g", 0) == NO_SUCH_PATH);
+  assert(FT_destroy() == SUCCESS);
+  assert(FT_setOwnedContents(FALSE) == SUCCESS);
+
+  /* borrowed contents can be read but not written */
+  assert(FT_init() == SUCCESS);
+  assert(FT_insertFile("1root/f", "hello", 5) == SUCCESS);
+  assert(FT_writeFile("1root/f", 0, "x", 1) == INITIALIZATION_ERROR);
+  assert(FT_readFile("1root/f", 1, acBuf, 16, &l) == SUCCESS);
+  assert(l == 4);
+  assert(!memcmp(acBuf, "ello", 4));
+  assert(FT_destroy() == SUCCESS);
+}
+
+/* Tests that contents spilled to the backing file read back intact,
+   through FT_getFileContents and FT_readFile, as files are removed,
+   replaced and grown and the backing file is compacted. */
+static void testSpill(void) {
+  enum {LEN = 10000};
+  static char acA[LEN], acB[LEN], acC[LEN], acBuf[LEN];
+  size_t ulFile, ulLive, ulOldFile, ulOldLive;
+  char* pcOld;
+  size_t l;
+
+  memset(acA, 'a', LEN);
+  memset(acB, 'b', LEN);
+  memset(acC, 'c', LEN);
+  assert(FT_getBackingStats(&ulFile, &ulLive) == INITIALIZATION_ERROR);
+  assert(FT_setOwnedContents(TRUE) == SUCCESS);
+  assert(FT_setSpillThreshold(LEN - 2000) == SUCCESS);
+  assert(FT_init() == SUCCESS);
+  assert(FT_getBackingStats(&ulFile, &ulLive) == SUCCESS);
+  assert(ulFile == 0);
+  assert(ulLive == 0);
+
+  /* contents at least as long as the threshold are spilled */
+  assert(FT_insertFile("1root/a", acA, LEN) == SUCCESS);
+  assert(FT_insertFile("1root/b", acB, LEN) == SUCCESS);
+  assert(FT_insertFile("1root/c", acC, LEN) == SUCCESS);
+  assert(FT_insertFile("1root/small", acA, 100) == SUCCESS);
+  assert(FT_getBackingStats(&ulFile, &ulLive) == SUCCESS);
+  assert(ulLive >= 3 * LEN);
+  assert(ulFile >= ulLive);
+  assert(!memcmp(FT_getFileContents("1root/a"), acA, LEN));
+  assert(!memcmp(FT_getFileContents("1root/small"), acA, 100));
+  assert(FT_readFile("1root/b", 0, acBuf, LEN, &l) == SUCCESS);
+  assert(l == LEN);
+  assert(!memcmp(acBuf, acB, LEN));
+
+  /* a removal frees space that compaction returns, moving the others
+     intact */
+  assert(FT_rmFile("1root/a") == SUCCESS);
+  ulOldFile = ulFile;
+  ulOldLive = ulLive;
+  assert(FT_getBackingStats(&ulFile, &ulLive) == SUCCESS);
+  assert(ulLive <= ulOldLive - LEN);
+  assert(FT_compactBacking() == SUCCESS);
+  assert(FT_getBackingStats(&ulFile, &ulLive) == SUCCESS);
+  assert(ulFile < ulOldFile);
+  assert(ulFile >= ulLive);
+  assert(!memcmp(FT_getFileContents("1root/b"), acB, LEN));
+  assert(!memcmp(FT_getFileContents("1root/c"), acC, LEN));
+
+  /* contents rewritten in full below the threshold move back */
+  pcOld = FT_replaceFileContents("1root/b", "x", 2);
+  assert(!memcmp(pcOld, acB, LEN));
+  free(pcOld);
+  assert(!strcmp(FT_getFileContents("1root/b"), "x"));
+  ulOldLive = ulLive;
+  assert(FT_getBackingStats(&ulFile, &ulLive) == SUCCESS);
+  assert(ulLive < ulOldLive);
+
+  /* grown contents are spilled once past the threshold */
+  assert(FT_writeFile("1root/small", 100, acC, LEN - 100) == SUCCESS);
+  ulOldLive = ulLive;
+  assert(FT_getBackingStats(&ulFile, &ulLive) == SUCCESS);
+  assert(ulLive >= ulOldLive + LEN);
+  assert(FT_readFile("1root/small", 0, acBuf, LEN, &l) == SUCCESS);
+  assert(l == LEN);
+  assert(!memcmp(acBuf, acA, 100));
+  assert(!memcmp(acBuf + 100, acC, LEN - 100));
+
+  /* without a threshold nothing new is spilled */
+  assert(FT_setSpillThreshold(0) == SUCCESS);
+  pcOld = FT_replaceFileContents("1root/c", acA, LEN);
+  assert(!memcmp(pcOld, acC, LEN));
+  free(pcOld);
+  assert(!memcmp(FT_getFileContents("1root/c"), acA, LEN));
+  assert(FT_compactBacking() == SUCCESS);
+  assert(!memcmp(FT_getFileContents("1root/small"), acA, 100));
+  assert(!memcmp((char*)FT_getFileContents("1root/small") + 100, acC,
+                 LEN - 100));
+
+  assert(FT_destroy() == SUCCESS);
+  assert(FT_compactBacking() == INITIALIZATION_ERROR);
+  assert(FT_setOwnedContents(FALSE) == SUCCESS);
+}
+
+/* Tests that an FT with a content budget evicts contents to keep
+   within it, except those of pinned files, and that evicted contents
+   read back intact. */
+static void testContentBudget(void) {
+  enum {LEN = 5000, FILES = 10, BUDGET = 4 * LEN};
+  static char acModel[FILES][LEN];
+  char acPath[32];
+  char acBuf[LEN];
+  char* pcPinned;
+  char* pcOld;
+  size_t ulFile, ulLive;
+  size_t l;
+  int i, iRound;
+
+  assert(FT_setOwnedContents(TRUE) == SUCCESS);
+  assert(FT_setContentBudget(BUDGET) == SUCCESS);
+  assert(FT_init() == SUCCESS);
+  assert(FT_insertDir("1root/d") == SUCCESS);
+
+  /* nothing is evicted until the budget is exceeded */
+  for(i = 0; i < FILES; i++) {
+    memset(acModel[i], 'a' + i, LEN);
+    sprintf(acPath, "1root/f%d", i);
+    assert(FT_insertFile(acPath, acModel[i], LEN) == SUCCESS);
+    assert(FT_getBackingStats(&ulFile, &ulLive) == SUCCESS);
+    if(i < BUDGET / LEN)
+      assert(ulLive == 0);
+  }
+  assert(ulLive >= FILES * LEN - BUDGET);
+
+  /* evicted contents are moved back intact, others evicted instead */
+  for(iRound = 0; iRound < 2; iRound++) {
+    for(i = 0; i < FILES; i++) {
+      sprintf(acPath, "1root/f%d", i);
+      assert(!memcmp(FT_getFileContents(acPath), acModel[i], LEN));
+      assert(FT_readFile(acPath, 0, acBuf, LEN, &l) == SUCCESS);
+      assert(l == LEN);
+      assert(!memcmp(acBuf, acModel[i], LEN));
+      assert(FT_getBackingStats(&ulFile, &ulLive) == SUCCESS);
+      assert(ulLive >= FILES * LEN - BUDGET);
+    }
+  }
+
+  /* a pinned file's contents stay where they are */
+  assert(FT_pinFile("1root/f0") == SUCCESS);
+  assert(FT_pinFile("1root/f0") == SUCCESS);
+  assert(FT_pinFile("1root/d") == NOT_A_FILE);
+  assert(FT_pinFile("1root/g") == NO_SUCH_PATH);
+  pcPinned = FT_getFileContents("1root/f0");
+  for(i = 1; i < FILES; i++) {
+    sprintf(acPath, "1root/f%d", i);
+    assert(!memcmp(FT_getFileContents(acPath), acModel[i], LEN));
+    assert(!memcmp(pcPinned, acModel[0], LEN));
+  }
+  assert(FT_unpinFile("1root/f0") == SUCCESS);
+  assert(FT_getFileContents("1root/f0") == pcPinned);
+  assert(FT_unpinFile("1root/f0") == SUCCESS);
+  assert(FT_unpinFile("1root/f0") == SUCCESS);
+
+  /* replacing evicted contents */
+  memset(acModel[1], 'z', LEN);
+  pcOld = FT_replaceFileContents("1root/f1", acModel[1], LEN);
+  assert(pcOld != NULL);
+  free(pcOld);
+  for(i = 0; i < FILES; i++) {
+    sprintf(acPath, "1root/f%d", i);
+    assert(!memcmp(FT_getFileContents(acPath), acModel[i], LEN));
+  }
+
+  /* without a budget, contents moved back are not evicted again */
+  assert(FT_setContentBudget(0) == SUCCESS);
+  for(i = 0; i < FILES; i++) {
+    sprintf(acPath, "1root/f%d", i);
+    assert(!memcmp(FT_getFileContents(acPath), acModel[i], LEN));
+  }
+  assert(FT_getBackingStats(&ulFile, &ulLive) == SUCCESS);
+  assert(ulLive == 0);
+
+  assert(FT_destroy() == SUCCESS);
+  assert(FT_setOwnedContents(FALSE) == SUCCESS);
+}
+
+/* Applies operation *psOp as FT_applyBatch would, by calling its own
+   function. Returns the function's status. */
+static int applyOne(const struct FT_op* psOp) {
+  if(psOp->eKind == FT_OP_INSERT_DIR)
+    return FT_insertDir(psOp->pcPath);
+  if(psOp->eKind == FT_OP_INSERT_FILE)
+    return FT_insertFile(psOp->pcPath, psOp->pvContents,
+                         psOp->ulLength);
+  return FT_rmFile(psOp->pcPath);
+}
+
+/* Tests that FT_applyBatch applies operations in component-wise
+   order of path, with '/' below every other character, keeps their
+   order in the batch for equal paths, and sets each status as the
+   operations applied one by one would. */
+static void testApplyBatch(void) {
+  enum {OPS = 14};
+  static struct FT_op asOps[OPS] = {
+    {FT_OP_INSERT_FILE, "1root/a/b", "ab", 3, -1},
+    {FT_OP_RM_FILE, "1root/f", NULL, 0, -1},
+    {FT_OP_INSERT_DIR, "1root-x", NULL, 0, -1},
+    {FT_OP_INSERT_FILE, "1root/f", "1", 2, -1},
+    {FT_OP_INSERT_FILE, "1root/a", "a", 2, -1},
+    {FT_OP_INSERT_FILE, "1root/f", "2", 2, -1},
+    {FT_OP_INSERT_DIR, "1root//x", NULL, 0, -1},
+    {FT_OP_RM_FILE, "1root/f", NULL, 0, -1},
+    {FT_OP_INSERT_DIR, "1root/d", NULL, 0, -1},
+    {FT_OP_INSERT_FILE, "1root/f", "3", 2, -1},
+    {FT_OP_RM_FILE, "1root/d", NULL, 0, -1},
+    {FT_OP_INSERT_FILE, "1root/d", "d", 2, -1},
+    {FT_OP_INSERT_DIR, "1root/a-b/c", NULL, 0, -1},
+    {FT_OP_INSERT_DIR, "1root/x", NULL, 0, -1}
+  };
+  /* the statuses, and the order in which applying the operations one
+     by one gives them: "1root" sorts before "1root-x", which is left
+     out, and "1root/a/b" before "1root/a-b/c" */
+  static const int aiStatuses[OPS] = {
+    NOT_A_DIRECTORY, NO_SUCH_PATH, CONFLICTING_PATH, SUCCESS,
+    SUCCESS, ALREADY_IN_TREE, BAD_PATH, SUCCESS, SUCCESS, SUCCESS,
+    NOT_A_FILE, ALREADY_IN_TREE, SUCCESS, SUCCESS
+  };
+  static const size_t aulOrder[OPS - 2] = {
+    4, 0, 12, 8, 10, 11, 1, 3, 5, 7, 9, 13
+  };
+  struct FT_op sOp;
+  char* pcBatch;
+  char* pcOneByOne;
+  size_t i;
+
+  assert(FT_applyBatch(asOps, OPS) == INITIALIZATION_ERROR);
+  assert(asOps[0].iStatus == -1);
+  assert(FT_init() == SUCCESS);
+  assert(FT_applyBatch(asOps, OPS) == SUCCESS);
+  for(i = 0; i < OPS; i++)
+    assert(asOps[i].iStatus == aiStatuses[i]);
+  assert(!strcmp(FT_getFileContents("1root/f"), "3"));
+  assert(!strcmp(FT_getFileContents("1root/a"), "a"));
+  assert((pcBatch = FT_toString()) != NULL);
+
+  /* a batch of failing operations leaves the FT unchanged */
+  sOp.eKind = FT_OP_INSERT_FILE;
+  sOp.pcPath = "1root/a/c";
+  sOp.pvContents = NULL;
+  sOp.ulLength = 0;
+  assert(FT_applyBatch(&sOp, 1) == SUCCESS);
+  assert(sOp.iStatus == NOT_A_DIRECTORY);
+  sOp.pcPath = "2root/a";
+  assert(FT_applyBatch(&sOp, 1) == SUCCESS);
+  assert(sOp.iStatus == CONFLICTING_PATH);
+  sOp.eKind = FT_OP_RM_FILE;
+  sOp.pcPath = "1root/x";
+  assert(FT_applyBatch(&sOp, 1) == SUCCESS);
+  assert(sOp.iStatus == NOT_A_FILE);
+  assert(FT_applyBatch(&sOp, 0) == SUCCESS);
+  assert((pcOneByOne = FT_toString()) != NULL);
+  assert(!strcmp(pcBatch, pcOneByOne));
+  free(pcOneByOne);
+  assert(FT_destroy() == SUCCESS);
+
+  /* applying the operations one by one in that order gives the same
+     statuses and FT */
+  assert(FT_init() == SUCCESS);
+  for(i = 0; i < OPS - 2; i++)
+    assert(applyOne(&asOps[aulOrder[i]]) == aiStatuses[aulOrder[i]]);
+  assert(applyOne(&asOps[2]) == CONFLICTING_PATH);
+  assert(applyOne(&asOps[6]) == BAD_PATH);
+  assert((pcOneByOne = FT_toString()) != NULL);
+  assert(!strcmp(pcBatch, pcOneByOne));
+  free(pcOneByOne);
+  free(pcBatch);
+  assert(FT_destroy() == SUCCESS);
+}
+
+/* Tests that FT_statMany and FT_getFileContentsMany give each path of
+   one call the outcome of its own lookup, mixing files, directories,
+   missing, conflicting and ill-formatted paths. */
+static void testLookupMany(void) {
+  enum {PATHS = 12};
+  static const char* apcPaths[PATHS] = {
+    "1root/a/f", "1root", "1root/a", "1root/a/g", "1root//a",
+    "2root/a", "1root/b/c/d/e", "1root/a/f/x", "1root/b/c/d",
+    "/1root", "1root/b/empty", "1root/a/f"
+  };
+  static const int aiStatuses[PATHS] = {
+    SUCCESS, SUCCESS, SUCCESS, NO_SUCH_PATH, BAD_PATH,
+    CONFLICTING_PATH, SUCCESS, NO_SUCH_PATH, SUCCESS,
+    BAD_PATH, SUCCESS, SUCCESS
+  };
+  struct FT_statResult asResults[PATHS];
+  void* apvContents[PATHS];
+  boolean bIsFile;
+  size_t l;
+  size_t i;
+
+  assert(FT_statMany(apcPaths, PATHS, asResults) ==
+         INITIALIZATION_ERROR);
+  assert(FT_getFileContentsMany(apcPaths, PATHS, apvContents) ==
+         INITIALIZATION_ERROR);
+  assert(FT_init() == SUCCESS);
+  assert(FT_insertFile("1root/a/f", "contents", 9) == SUCCESS);
+  assert(FT_insertFile("1root/b/c/d/e", "e", 2) == SUCCESS);
+  assert(FT_insertFile("1root/b/empty", NULL, 0) == SUCCESS);
+
+  for(i = 0; i < PATHS; i++) {
+    asResults[i].bIsFile = (boolean)2;
+    asResults[i].ulSize = 99;
+  }
+  assert(FT_statMany(apcPaths, PATHS, asResults) == SUCCESS);
+  for(i = 0; i < PATHS; i++) {
+    assert(asResults[i].iStatus == aiStatuses[i]);
+    bIsFile = (boolean)2;
+    l = 99;
+    assert(FT_stat(apcPaths[i], &bIsFile, &l) == aiStatuses[i]);
+    assert(asResults[i].bIsFile == bIsFile);
+    if(aiStatuses[i] != SUCCESS || bIsFile)
+      assert(asResults[i].ulSize == l);
+    else
+      assert(asResults[i].ulSize == 0);
+  }
+
+  for(i = 0; i < PATHS; i++)
+    apvContents[i] = &apvContents[i];
+  assert(FT_getFileContentsMany(apcPaths, PATHS, apvContents) ==
+         SUCCESS);
+  for(i = 0; i < PATHS; i++)
+    assert(apvContents[i] == FT_getFileContents(apcPaths[i]));
+  assert(!strcmp(apvContents[0], "contents"));
+  assert(apvContents[0] == apvContents[PATHS - 1]);
+  assert(!strcmp(apvContents[6], "e"));
+
+  assert(FT_statMany(apcPaths, 0, NULL) == SUCCESS);
+  assert(FT_destroy() == SUCCESS);
+}
+
+/* Lists the rest of oCursor's directory, ulPage children at a time,
+   into pcOut as "f" or "d", the name, ':' and the size of each
+   child, followed by a space. */
+static void listDir(DirCursor_T oCursor, size_t ulPage, char* pcOut) {
+  enum {MAXPAGE = 8};
+  struct FT_dirEntry asEntries[MAXPAGE];
+  size_t ulRead;
+  size_t i;
+
+  assert(ulPage <= MAXPAGE);
+  pcOut[0] = '\0';
+  do {
+    assert(FT_readDir(oCursor, asEntries, ulPage, &ulRead) == SUCCESS);
+    for(i = 0; i < ulRead; i++)
+      sprintf(pcOut + strlen(pcOut), "%s%s:%lu ",
+              asEntries[i].bIsFile ? "f" : "d", asEntries[i].pcName,
+              (unsigned long)asEntries[i].ulSize);
+  } while(ulRead > 0);
+}
+
+/* Tests that a cursor lists a directory's files and then its
+   directories, each in order of name, whatever the page size, and
+   resumes after the last child it listed when the FT changes between
+   pages. */
+static void testDirCursor(void) {
+  enum {OUTLEN = 256};
+  struct FT_dirEntry asEntries[2];
+  DirCursor_T oCursor;
+  char acOut[OUTLEN];
+  size_t ulRead;
+  size_t ulPage;
+
+  assert(FT_openDir("1root", &oCursor) == INITIALIZATION_ERROR);
+  assert(FT_init() == SUCCESS);
+  assert(FT_openDir("1root", &oCursor) == NO_SUCH_PATH);
+  assert(FT_insertFile("1root/b/x", "hello", 5) == SUCCESS);
+  assert(FT_insertFile("1root/y", "hi", 2) == SUCCESS);
+  assert(FT_insertDir("1root/c") == SUCCESS);
+  assert(FT_insertFile("1root/B", NULL, 0) == SUCCESS);
+  assert(FT_openDir("1root/y", &oCursor) == NOT_A_DIRECTORY);
+  assert(FT_openDir("2root", &oCursor) == CONFLICTING_PATH);
+  assert(FT_openDir("1root//b", &oCursor) == BAD_PATH);
+
+  for(ulPage = 1; ulPage <= 5; ulPage++) {
+    assert(FT_openDir("1root", &oCursor) == SUCCESS);
+    listDir(oCursor, ulPage, acOut);
+    assert(!strcmp(acOut, "fB:0 fy:2 db:0 dc:0 "));
+    FT_closeDir(oCursor);
+  }
+  assert(FT_openDir("1root/c", &oCursor) == SUCCESS);
+  listDir(oCursor, 3, acOut);
+  assert(!strcmp(acOut, ""));
+  FT_closeDir(oCursor);
+
+  /* children inserted before the last one listed are not listed,
+     those after it are, even if it has been removed meanwhile */
+  assert(FT_insertFile("1root/m", NULL, 0) == SUCCESS);
+  assert(FT_openDir("1root", &oCursor) == SUCCESS);
+  assert(FT_readDir(oCursor, asEntries, 2, &ulRead) == SUCCESS);
+  assert(ulRead == 2);
+  assert(!strcmp(asEntries[1].pcName, "m"));
+  assert(FT_insertFile("1root/a", NULL, 0) == SUCCESS);
+  assert(FT_insertFile("1root/zzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzz", "q",
+                       1) == SUCCESS);
+  assert(FT_rmFile("1root/m") == SUCCESS);
+  assert(FT_rmFile("1root/y") == SUCCESS);
+  assert(FT_readDir(oCursor, asEntries, 1, &ulRead) == SUCCESS);
+  assert(ulRead == 1);
+  assert(!strcmp(asEntries[0].pcName,
+                 "zzzzzzzzzzzzzzzzzzzzzzzzzzzzzzzz"));
+  assert(FT_insertDir("1root/0") == SUCCESS);
+  assert(FT_rmDir("1root/b") == SUCCESS);
+  assert(FT_insertDir("1root/bb") == SUCCESS);
+  listDir(oCursor, 2, acOut);
+  assert(!strcmp(acOut, "d0:0 dbb:0 dc:0 "));
+  assert(FT_readDir(oCursor, asEntries, 2, &ulRead) == SUCCESS);
+  assert(ulRead == 0);
+  FT_closeDir(oCursor);
+
+  /* a removed directory cannot be listed further, and one removed and
+     inserted again is resumed by name */
+  assert(FT_openDir("1root/c", &oCursor) == SUCCESS);
+  assert(FT_rmDir("1root/c") == SUCCESS);
+  ulRead = 99;
+  assert(FT_readDir(oCursor, asEntries, 2, &ulRead) == NO_SUCH_PATH);
+  assert(ulRead == 99);
+  FT_closeDir(oCursor);
+  assert(FT_insertFile("1root/bb/1", NULL, 0) == SUCCESS);
+  assert(FT_insertFile("1root/bb/2", NULL, 0) == SUCCESS);
+  assert(FT_openDir("1root/bb", &oCursor) == SUCCESS);
+  assert(FT_readDir(oCursor, asEntries, 1, &ulRead) == SUCCESS);
+  assert(ulRead == 1);
+  assert(!strcmp(asEntries[0].pcName, "1"));
+  assert(FT_rmDir("1root/bb") == SUCCESS);
+  assert(FT_insertFile("1root/bb/0", NULL, 0) == SUCCESS);
+  assert(FT_insertFile("1root/bb/3", "333", 3) == SUCCESS);
+  listDir(oCursor, 4, acOut);
+  assert(!strcmp(acOut, "f3:3 "));
+  FT_closeDir(oCursor);
+
+  assert(FT_destroy() == SUCCESS);
+}
+
+/* The paths visited by a walk, each followed by a space, and the path
+   at which the walk is to skip the subtree or stop, or NULL */
+static char acWalked[512];
+static const char* pcWalkSkip;
+static const char* pcWalkStop;
+
+/* Appends the path of psEntry to acWalked, checking its name, size,
+   and depth below path pvBase, for FT_walk. Returns
+   FT_WALK_SKIP_SUBTREE or FT_WALK_STOP if the path is pcWalkSkip or
+   pcWalkStop, and FT_WALK_CONTINUE otherwise. */
+static enum FT_walkAction recordWalk(const struct FT_walkEntry* psEntry,
+                                     void* pvBase) {
+  const char* pcBase = pvBase;
+  const char* pc;
+  size_t ulDepth = 0;
+
+  assert(strlen(acWalked) + strlen(psEntry->pcPath) + 2 <
+         sizeof(acWalked));
+  strcat(acWalked, psEntry->pcPath);
+  strcat(acWalked, " ");
+  pc = strrchr(psEntry->pcPath, '/');
+  assert(!strcmp(psEntry->pcName, pc != NULL ? pc + 1 : psEntry->pcPath));
+  for(pc = psEntry->pcPath + strlen(pcBase); *pc != '\0'; pc++)
+    if(*pc == '/')
+      ulDepth++;
+  assert(psEntry->ulDepth == ulDepth);
+  if(!strcmp(psEntry->pcName, "x"))
+    assert(psEntry->bIsFile && psEntry->ulSize == 3);
+  else if(!psEntry->bIsFile)
+    assert(psEntry->ulSize == 0);
+  if(pcWalkStop != NULL && !strcmp(psEntry->pcPath, pcWalkStop))
+    return FT_WALK_STOP;
+  if(pcWalkSkip != NULL && !strcmp(psEntry->pcPath, pcWalkSkip))
+    return FT_WALK_SKIP_SUBTREE;
+  return FT_WALK_CONTINUE;
+}
+
+/* Walks the subtree at "1root" in order eOrder, skipping the subtree
+   at pcSkip and stopping at pcStop unless NULL, and asserts that the
+   paths visited are pcExpected. */
+static void checkWalk(enum FT_walkOrder eOrder, const char* pcSkip,
+                      const char* pcStop, const char* pcExpected) {
+  acWalked[0] = '\0';
+  pcWalkSkip = pcSkip;
+  pcWalkStop = pcStop;
+  assert(FT_walk("1root", eOrder, recordWalk, "1root") == SUCCESS);
+  assert(!strcmp(acWalked, pcExpected));
+}
+
+/* The number of threads of the parallel walks, the number of visits
+   by each, and the last directory each visited */
+enum {WALKERS = 4};
+static size_t aulParVisits[WALKERS];
+static char aacParLastDir[WALKERS][64];
+
+/* Counts the visit of psEntry by worker ulWorker, checking that a file
+   is visited right after its parent directory by the same worker, for
+   FT_parallelWalk. Returns FT_WALK_CONTINUE. */
+static enum FT_walkAction recordParWalk(
+    const struct FT_walkEntry* psEntry, size_t ulWorker, void* pvExtra) {
+  size_t ulParentLength;
+
+  assert(ulWorker < WALKERS);
+  (void)pvExtra;
+  aulParVisits[ulWorker]++;
+  if(psEntry->bIsFile) {
+    ulParentLength = strlen(psEntry->pcPath) -
+      strlen(psEntry->pcName) - 1;
+    assert(strlen(aacParLastDir[ulWorker]) == ulParentLength);
+    assert(!strncmp(aacParLastDir[ulWorker], psEntry->pcPath,
+                    ulParentLength));
+  }
+  else {
+    assert(strlen(psEntry->pcPath) < sizeof(aacParLastDir[ulWorker]));
+    strcpy(aacParLastDir[ulWorker], psEntry->pcPath);
+  }
+  return FT_WALK_CONTINUE;
+}
+
+/* Walks the FT from "1root" with WALKERS threads and asserts that
+   ulExpected nodes were visited. */
+static void checkParWalk(size_t ulExpected) {
+  size_t ulVisits = 0;
+  size_t i;
+
+  for(i = 0; i < WALKERS; i++) {
+    aulParVisits[i] = 0;
+    aacParLastDir[i][0] = '\0';
+  }
+  assert(FT_parallelWalk("1root", WALKERS, recordParWalk, NULL) ==
+         SUCCESS);
+  for(i = 0; i < WALKERS; i++)
+    ulVisits += aulParVisits[i];
+  assert(ulVisits == ulExpected);
+}
+
+/* Tests the order of the visits of FT_walk, pre-order, post-order and
+   breadth-first, with subtrees skipped and walks stopped, and the
+   visits of FT_parallelWalk in a small and a large tree. */
+static void testWalk(void) {
+  char acPath[32];
+  int i;
+
+  assert(FT_walk("1root", FT_WALK_PRE, recordWalk, "1root") ==
+         INITIALIZATION_ERROR);
+  assert(FT_parallelWalk("1root", 0, recordParWalk, NULL) ==
+         INITIALIZATION_ERROR);
+  assert(FT_init() == SUCCESS);
+  assert(FT_walk("1root", FT_WALK_PRE, recordWalk, "1root") ==
+         NO_SUCH_PATH);
+  assert(FT_insertFile("1root/b/x", "abc", 3) == SUCCESS);
+  assert(FT_insertFile("1root/b/c/y", NULL, 0) == SUCCESS);
+  assert(FT_insertFile("1root/z", NULL, 0) == SUCCESS);
+  assert(FT_insertDir("1root/d/e") == SUCCESS);
+  assert(FT_insertFile("1root/b/c/d/w", NULL, 0) == SUCCESS);
+  assert(FT_walk("1root/q", FT_WALK_PRE, recordWalk, "1root") ==
+         NO_SUCH_PATH);
+  assert(FT_walk("2root", FT_WALK_PRE, recordWalk, "1root") ==
+         CONFLICTING_PATH);
+  assert(FT_walk("/1root", FT_WALK_PRE, recordWalk, "1root") ==
+         BAD_PATH);
+
+  checkWalk(FT_WALK_PRE, NULL, NULL,
+            "1root 1root/z 1root/b 1root/b/x 1root/b/c 1root/b/c/y "
+            "1root/b/c/d 1root/b/c/d/w 1root/d 1root/d/e ");
+  checkWalk(FT_WALK_POST, NULL, NULL,
+            "1root/z 1root/b/x 1root/b/c/y 1root/b/c/d/w 1root/b/c/d "
+            "1root/b/c 1root/b 1root/d/e 1root/d 1root ");
+  checkWalk(FT_WALK_BFS, NULL, NULL,
+            "1root 1root/z 1root/b 1root/d 1root/b/x 1root/b/c "
+            "1root/d/e 1root/b/c/y 1root/b/c/d 1root/b/c/d/w ");
+  checkWalk(FT_WALK_PRE, "1root/b", NULL,
+            "1root 1root/z 1root/b 1root/d 1root/d/e ");
+  checkWalk(FT_WALK_BFS, "1root/b", NULL,
+            "1root 1root/z 1root/b 1root/d 1root/d/e ");
+  checkWalk(FT_WALK_POST, "1root/b", NULL,
+            "1root/z 1root/b/x 1root/b/c/y 1root/b/c/d/w 1root/b/c/d "
+            "1root/b/c 1root/b 1root/d/e 1root/d 1root ");
+  checkWalk(FT_WALK_PRE, NULL, "1root/b/c",
+            "1root 1root/z 1root/b 1root/b/x 1root/b/c ");
+  checkWalk(FT_WALK_POST, NULL, "1root/b/c/y",
+            "1root/z 1root/b/x 1root/b/c/y ");
+  checkWalk(FT_WALK_BFS, NULL, "1root/b/c/y",
+            "1root 1root/z 1root/b 1root/d 1root/b/x 1root/b/c "
+            "1root/d/e 1root/b/c/y ");
+
+  /* the depth is counted from the path the walk starts from */
+  acWalked[0] = '\0';
+  pcWalkSkip = pcWalkStop = NULL;
+  assert(FT_walk("1root/b/c", FT_WALK_PRE, recordWalk, "1root/b/c") ==
+         SUCCESS);
+  assert(!strcmp(acWalked,
+                 "1root/b/c 1root/b/c/y 1root/b/c/d 1root/b/c/d/w "));
+  acWalked[0] = '\0';
+  assert(FT_walk("1root/b/x", FT_WALK_POST, recordWalk, "1root/b/x") ==
+         SUCCESS);
+  assert(!strcmp(acWalked, "1root/b/x "));
+
+  /* a small tree, and one large enough to be split between threads */
+  checkParWalk(10);
+  for(i = 0; i < 1000; i++) {
+    sprintf(acPath, "1root/p%d/q%d/f", i % 10, i);
+    assert(FT_insertFile(acPath, NULL, 0) == SUCCESS);
+  }
+  checkParWalk(10 + 10 + 2000);
+  assert(FT_destroy() == SUCCESS);
+}
+
+/* Appends the path of psEntry to acWalked, checking that its depth is
+   its number of components, for FT_glob. Returns FT_WALK_CONTINUE. */
+static enum FT_walkAction recordGlob(const struct FT_walkEntry* psEntry,
+                                     void* pvExtra) {
+  const char* pc;
+  size_t ulDepth = 1;
+
+  (void)pvExtra;
+  assert(strlen(acWalked) + strlen(psEntry->pcPath) + 2 <
+         sizeof(acWalked));
+  strcat(acWalked, psEntry->pcPath);
+  strcat(acWalked, " ");
+  for(pc = psEntry->pcPath; *pc != '\0'; pc++)
+    if(*pc == '/')
+      ulDepth++;
+  assert(psEntry->ulDepth == ulDepth);
+  return FT_WALK_CONTINUE;
+}
+
+/* Asserts that FT_glob returns iStatus for pattern pcPattern, and that
+   the paths it visits are pcExpected. */
+static void checkGlob(const char* pcPattern, int iStatus,
+                      const char* pcExpected) {
+  acWalked[0] = '\0';
+  assert(FT_glob(pcPattern, recordGlob, NULL) == iStatus);
+  assert(!strcmp(acWalked, pcExpected));
+}
+
+/* Tests FT_glob's wildcards, bracket expressions and "**", that no
+   wildcard matches a '/', and that ill-formatted patterns and ones of
+   too many components are rejected. */
+static void testGlob(void) {
+  char acPattern[128];
+  int i;
+
+  assert(FT_glob("1root", recordGlob, NULL) == INITIALIZATION_ERROR);
+  assert(FT_init() == SUCCESS);
+  checkGlob("1root/**", SUCCESS, "");
+  assert(FT_insertFile("1root/a", NULL, 0) == SUCCESS);
+  assert(FT_insertFile("1root/ab/x.gz", NULL, 0) == SUCCESS);
+  assert(FT_insertFile("1root/abc", NULL, 0) == SUCCESS);
+  assert(FT_insertFile("1root/b/y.gz", NULL, 0) == SUCCESS);
+  assert(FT_insertFile("1root/b/c/z.gz", NULL, 0) == SUCCESS);
+  assert(FT_insertFile("1root/l[1]", NULL, 0) == SUCCESS);
+  assert(FT_insertDir("1root/2024-01") == SUCCESS);
+  assert(FT_insertFile("1root/2024-02/log.gz", NULL, 0) == SUCCESS);
+
+  checkGlob("1root", SUCCESS, "1root ");
+  checkGlob("1root*", SUCCESS, "1root ");
+  checkGlob("2root/*", SUCCESS, "");
+  checkGlob("1root/*", SUCCESS,
+            "1root/a 1root/abc 1root/l[1] 1root/2024-01 1root/2024-02 "
+            "1root/ab 1root/b ");
+  checkGlob("1root/a?", SUCCESS, "1root/ab ");
+  checkGlob("1root/a*", SUCCESS, "1root/a 1root/abc 1root/ab ");
+  checkGlob("1root/a?c", SUCCESS, "1root/abc ");
+
+  /* bracket expressions */
+  checkGlob("1root/[ab]", SUCCESS, "1root/a 1root/b ");
+  checkGlob("1root/[!a]*", SUCCESS,
+            "1root/l[1] 1root/2024-01 1root/2024-02 1root/b ");
+  checkGlob("1root/[^a]*", SUCCESS,
+            "1root/l[1] 1root/2024-01 1root/2024-02 1root/b ");
+  checkGlob("1root/a[a-c]*", SUCCESS, "1root/abc 1root/ab ");
+  checkGlob("1root/l[[]1]", SUCCESS, "1root/l[1] ");
+  checkGlob("1root/2024-0[2-9]/*", SUCCESS, "1root/2024-02/log.gz ");
+
+  /* no wildcard but "**" matches across a '/' */
+  checkGlob("1root/*/*.gz", SUCCESS,
+            "1root/2024-02/log.gz 1root/ab/x.gz 1root/b/y.gz ");
+  checkGlob("*/b", SUCCESS, "1root/b ");
+  checkGlob("1root/b*z.gz", SUCCESS, "");
+  checkGlob("1root/**", SUCCESS,
+            "1root 1root/a 1root/abc 1root/l[1] 1root/2024-01 "
+            "1root/2024-02 1root/2024-02/log.gz 1root/ab 1root/ab/x.gz "
+            "1root/b 1root/b/y.gz 1root/b/c 1root/b/c/z.gz ");
+  checkGlob("1root/**/*.gz", SUCCESS,
+            "1root/2024-02/log.gz 1root/ab/x.gz 1root/b/y.gz "
+            "1root/b/c/z.gz ");
+  checkGlob("1root/**.gz", SUCCESS,
+            "1root/2024-02/log.gz 1root/ab/x.gz 1root/b/y.gz "
+            "1root/b/c/z.gz ");
+  checkGlob("1root/b/**/z.gz", SUCCESS, "1root/b/c/z.gz ");
+  checkGlob("1root/**/c", SUCCESS, "1root/b/c ");
+
+  /* ill-formatted patterns */
+  checkGlob("/1root", BAD_PATH, "");
+  checkGlob("1root/", BAD_PATH, "");
+  checkGlob("1root//a", BAD_PATH, "");
+  checkGlob("", BAD_PATH, "");
+
+  /* 30 components at most */
+  strcpy(acPattern, "1root");
+  for(i = 1; i < 30; i++)
+    strcat(acPattern, "/*");
+  checkGlob(acPattern, SUCCESS, "");
+  strcat(acPattern, "/*");
+  checkGlob(acPattern, BAD_PATH, "");
+  strcpy(acPattern, "**");
+  for(i = 1; i < 30; i++)
+    strcat(acPattern, "/**");
+  checkGlob(acPattern, SUCCESS,
+            "1root 1root/a 1root/abc 1root/l[1] 1root/2024-01 "
+            "1root/2024-02 1root/2024-02/log.gz 1root/ab 1root/ab/x.gz "
+            "1root/b 1root/b/y.gz 1root/b/c 1root/b/c/z.gz ");
+  strcat(acPattern, "/**");
+  checkGlob(acPattern, BAD_PATH, "");
+
+  assert(FT_destroy() == SUCCESS);
+}
+
+/* The paths found by FT_findByName, in the order found */
+enum {MAXFOUND = 16};
+static char aacFound[MAXFOUND][32];
+static size_t ulFound;
+
+/* Records the path of psEntry in aacFound, for FT_findByName. Returns
+   FT_WALK_STOP once *(size_t*)pvLimit paths are recorded, if pvLimit
+   is not NULL, and FT_WALK_CONTINUE otherwise. */
+static enum FT_walkAction recordFound(const struct FT_walkEntry* psEntry,
+                                      void* pvLimit) {
+  assert(ulFound < MAXFOUND);
+  assert(strlen(psEntry->pcPath) < sizeof(aacFound[ulFound]));
+  strcpy(aacFound[ulFound++], psEntry->pcPath);
+  if(pvLimit != NULL && ulFound == *(size_t*)pvLimit)
+    return FT_WALK_STOP;
+  return FT_WALK_CONTINUE;
+}
+
+/* Compares the paths at pv1 and pv2 for qsort. */
+static int comparePaths(const void* pv1, const void* pv2) {
+  return strcmp(pv1, pv2);
+}
+
+/* Asserts that the paths FT_findByName finds for pcName, in order of
+   path and each followed by a space, are pcExpected. */
+static void checkFound(const char* pcName, const char* pcExpected) {
+  char acFound[MAXFOUND * 32];
+  size_t i;
+
+  ulFound = 0;
+  assert(FT_findByName(pcName, recordFound, NULL) == SUCCESS);
+  qsort(aacFound, ulFound, sizeof(aacFound[0]), comparePaths);
+  acFound[0] = '\0';
+  for(i = 0; i < ulFound; i++) {
+    strcat(acFound, aacFound[i]);
+    strcat(acFound, " ");
+  }
+  assert(!strcmp(acFound, pcExpected));
+}
+
+/* Tests that FT_findByName finds every directory and file of a name,
+   and only those, as they are inserted and removed, with and without
+   the name index. */
+static void testFindByName(void) {
+  size_t ulEntries, ulBytes;
+  size_t ulLimit;
+  int iIndexed;
+
+  assert(FT_findByName("c", recordFound, NULL) == INITIALIZATION_ERROR);
+  for(iIndexed = 0; iIndexed < 2; iIndexed++) {
+    assert(FT_setNameIndex((boolean)iIndexed) == SUCCESS);
+    assert(FT_init() == SUCCESS);
+    assert(FT_setNameIndex(FALSE) == INITIALIZATION_ERROR);
+    checkFound("c", "");
+    assert(FT_insertFile("1root/a/c", NULL, 0) == SUCCESS);
+    assert(FT_insertDir("1root/c/b/c") == SUCCESS);
+    assert(FT_insertFile("1root/c/c", NULL, 0) == SUCCESS);
+    assert(FT_insertFile("1root/b/cc", NULL, 0) == SUCCESS);
+    assert(FT_insertFile("1root/b/C", NULL, 0) == SUCCESS);
+    assert(FT_findByName("a/c", recordFound, NULL) == BAD_PATH);
+    assert(FT_findByName("", recordFound, NULL) == BAD_PATH);
+
+    checkFound("c", "1root/a/c 1root/c 1root/c/b/c 1root/c/c ");
+    checkFound("1root", "1root ");
+    checkFound("b", "1root/b 1root/c/b ");
+    checkFound("cc", "1root/b/cc ");
+    checkFound("d", "");
+    assert(FT_getNameIndexStats(&ulEntries, &ulBytes) == SUCCESS);
+    assert(ulEntries == (iIndexed ? 10 : 0));
+    assert((ulBytes > 0) == (iIndexed != 0));
+
+    /* stopping after the first match */
+    ulFound = 0;
+    ulLimit = 1;
+    assert(FT_findByName("c", recordFound, &ulLimit) == SUCCESS);
+    assert(ulFound == 1);
+
+    /* removed nodes are not found, nor are their descendants */
+    assert(FT_rmFile("1root/a/c") == SUCCESS);
+    checkFound("c", "1root/c 1root/c/b/c 1root/c/c ");
+    assert(FT_rmDir("1root/c/b") == SUCCESS);
+    checkFound("c", "1root/c 1root/c/c ");
+    checkFound("b", "1root/b ");
+    assert(FT_rmDir("1root/c") == SUCCESS);
+    checkFound("c", "");
+    assert(FT_insertDir("1root/a/c") == SUCCESS);
+    checkFound("c", "1root/a/c ");
+    assert(FT_getNameIndexStats(&ulEntries, &ulBytes) == SUCCESS);
+    assert(ulEntries == (iIndexed ? 6 : 0));
+    assert(FT_rmDir("1root") == SUCCESS);
+    checkFound("c", "");
+    assert(FT_getNameIndexStats(&ulEntries, &ulBytes) == SUCCESS);
+    assert(ulEntries == 0);
+    assert(FT_destroy() == SUCCESS);
+  }
+  assert(FT_setNameIndex(FALSE) == SUCCESS);
+}
+
+/* Appends the path of psEntry to acWalked, for FT_scanRange and
+   FT_scanPrefix. Returns FT_WALK_STOP once *(size_t*)pvLimit paths
+   have been visited, if pvLimit is not NULL, FT_WALK_SKIP_SUBTREE
+   for pcWalkSkip, and FT_WALK_CONTINUE otherwise. */
+static enum FT_walkAction recordScan(const struct FT_walkEntry* psEntry,
+                                     void* pvLimit) {
+  assert(strlen(acWalked) + strlen(psEntry->pcPath) + 2 <
+         sizeof(acWalked));
+  strcat(acWalked, psEntry->pcPath);
+  strcat(acWalked, " ");
+  if(pvLimit != NULL && --*(size_t*)pvLimit == 0)
+    return FT_WALK_STOP;
+  if(pcWalkSkip != NULL && !strcmp(psEntry->pcPath, pcWalkSkip))
+    return FT_WALK_SKIP_SUBTREE;
+  return FT_WALK_CONTINUE;
+}
+
+/* Asserts that FT_scanRange from pcStart to pcEnd visits the paths
+   pcExpected, and again when resumed after every ulPage visits. */
+static void checkScan(const char* pcStart, const char* pcEnd,
+                      const char* pcExpected) {
+  char* pcResume = NULL;
+  char* pcNext;
+  size_t ulPage, ulLimit;
+
+  acWalked[0] = '\0';
+  pcWalkSkip = NULL;
+  pcNext = &acWalked[0];
+  assert(FT_scanRange(pcStart, pcEnd, recordScan, NULL, &pcNext) ==
+         SUCCESS);
+  assert(pcNext == NULL);
+  assert(!strcmp(acWalked, pcExpected));
+
+  for(ulPage = 1; ulPage <= 3; ulPage++) {
+    acWalked[0] = '\0';
+    do {
+      ulLimit = ulPage;
+      assert(FT_scanRange(pcResume != NULL ? pcResume : pcStart, pcEnd,
+                          recordScan, &ulLimit, &pcNext) == SUCCESS);
+      free(pcResume);
+      pcResume = pcNext;
+    } while(pcResume != NULL);
+    assert(!strcmp(acWalked, pcExpected));
+  }
+}
+
+/* Tests FT_scanRange and FT_scanPrefix at the edges of ranges, with
+   keys in and out of the FT, empty ranges, and resuming from the key
+   returned when stopped. */
+static void testScan(void) {
+  char* pcResume;
+  size_t ulLimit;
+
+  assert(FT_scanRange(NULL, NULL, recordScan, NULL, NULL) ==
+         INITIALIZATION_ERROR);
+  assert(FT_scanPrefix("1root", NULL, recordScan, NULL, NULL) ==
+         INITIALIZATION_ERROR);
+  assert(FT_init() == SUCCESS);
+  checkScan(NULL, NULL, "");
+  assert(FT_insertFile("1root/a/b/c", NULL, 0) == SUCCESS);
+  assert(FT_insertDir("1root/a-") == SUCCESS);
+  assert(FT_insertFile("1root/a.b", NULL, 0) == SUCCESS);
+  assert(FT_insertFile("1root/b", NULL, 0) == SUCCESS);
+
+  /* '/' comes first, so each subtree follows its directory */
+  checkScan(NULL, NULL,
+            "1root 1root/a 1root/a/b 1root/a/b/c 1root/a- 1root/a.b "
+            "1root/b ");
+  checkScan("1root/a", "1root/a-", "1root/a 1root/a/b 1root/a/b/c ");
+  checkScan("1root/a/", NULL,
+            "1root/a/b 1root/a/b/c 1root/a- 1root/a.b 1root/b ");
+  checkScan(NULL, "1root/", "1root ");
+  checkScan("1root/a0", NULL, "1root/b ");
+  checkScan("1root/a-", "1root/a.c", "1root/a- 1root/a.b ");
+
+  /* empty ranges */
+  checkScan(NULL, "1root", "");
+  checkScan("1root/a/b/c", "1root/a/b/c", "");
+  checkScan("1root/b", "1root/a", "");
+  checkScan("1root/c", NULL, "");
+  checkScan("2root", NULL, "");
+
+  /* the key to resume from is just past the path stopped at, before
+     its descendants */
+  acWalked[0] = '\0';
+  ulLimit = 2;
+  assert(FT_scanRange("1root", NULL, recordScan, &ulLimit, &pcResume) ==
+         SUCCESS);
+  assert(!strcmp(acWalked, "1root 1root/a "));
+  assert(!strcmp(pcResume, "1root/a/"));
+  acWalked[0] = '\0';
+  pcWalkSkip = "1root/a";
+  assert(FT_scanRange(pcResume, NULL, recordScan, NULL, NULL) ==
+         SUCCESS);
+  free(pcResume);
+  assert(!strcmp(acWalked,
+                 "1root/a/b 1root/a/b/c 1root/a- 1root/a.b 1root/b "));
+
+  /* skipping a directory's descendants */
+  acWalked[0] = '\0';
+  assert(FT_scanRange(NULL, NULL, recordScan, NULL, NULL) == SUCCESS);
+  assert(!strcmp(acWalked, "1root 1root/a 1root/a- 1root/a.b 1root/b "));
+  pcWalkSkip = NULL;
+
+  /* prefixes are of characters, not components */
+  acWalked[0] = '\0';
+  assert(FT_scanPrefix("1root/a", NULL, recordScan, NULL, NULL) ==
+         SUCCESS);
+  assert(!strcmp(acWalked,
+                 "1root/a 1root/a/b 1root/a/b/c 1root/a- 1root/a.b "));
+  acWalked[0] = '\0';
+  assert(FT_scanPrefix("1root/a/", NULL, recordScan, NULL, NULL) ==
+         SUCCESS);
+  assert(!strcmp(acWalked, "1root/a/b 1root/a/b/c "));
+  acWalked[0] = '\0';
+  ulLimit = 1;
+  assert(FT_scanPrefix("1root/a", NULL, recordScan, &ulLimit,
+                       &pcResume) == SUCCESS);
+  assert(!strcmp(pcResume, "1root/a/"));
+  assert(FT_scanPrefix("1root/a", pcResume, recordScan, NULL, NULL) ==
+         SUCCESS);
+  free(pcResume);
+  assert(!strcmp(acWalked,
+                 "1root/a 1root/a/b 1root/a/b/c 1root/a- 1root/a.b "));
+  acWalked[0] = '\0';
+  assert(FT_scanPrefix("1root/a", "1root/a-", recordScan, NULL,
+                       &pcResume) == SUCCESS);
+  assert(pcResume == NULL);
+  assert(!strcmp(acWalked, "1root/a- 1root/a.b "));
+  acWalked[0] = '\0';
+  assert(FT_scanPrefix("1root/c", NULL, recordScan, NULL, NULL) ==
+         SUCCESS);
+  assert(!strcmp(acWalked, ""));
+
+  assert(FT_destroy() == SUCCESS);
+}
+
+/* Inserts ulCount files with contents "x" below pcBase, each at the
+   bottom of two directories of its own. */
+static void insertWide(const char* pcBase, size_t ulCount) {
+  char acPath[64];
+  size_t i;
+
+  for(i = 0; i < ulCount; i++) {
+    sprintf(acPath, "%s/d%lu/e/f", pcBase, (unsigned long)i);
+    assert(FT_insertFile(acPath, "x", 2) == SUCCESS);
+  }
+}
+
+/* Tests removing and destroying subtrees of more directories than
+   are freed by one thread. */
+static void testParallelFree(void) {
+  enum {FILES = 5000};
+  boolean bIsFile;
+  size_t l;
+  char* pcText;
+
+  assert(FT_init() == SUCCESS);
+  insertWide("1root/big", FILES);
+  insertWide("1root/small", 10);
+  assert(FT_containsFile("1root/big/d4999/e/f"));
+  assert(FT_rmDir("1root/big") == SUCCESS);
+  assert(!FT_containsDir("1root/big"));
+  assert(!FT_containsFile("1root/big/d0/e/f"));
+  assert(FT_stat("1root/small/d9/e/f", &bIsFile, &l) == SUCCESS);
+  assert(bIsFile == TRUE);
+  assert(l == 2);
+
+  /* the FT remains usable, and can be built up and freed again */
+  insertWide("1root/big", FILES);
+  assert(FT_rmDir("1root/small") == SUCCESS);
+  assert((pcText = FT_toString()) != NULL);
+  assert(!strncmp(pcText, "1root\n1root/big\n1root/big/d0\n",
+                  strlen("1root\n1root/big\n1root/big/d0\n")));
+  free(pcText);
+  assert(FT_destroy() == SUCCESS);
+
+  /* a whole large FT, from the root */
+  assert(FT_init() == SUCCESS);
+  insertWide("1root", FILES);
+  assert(FT_rmDir("1root") == SUCCESS);
+  assert((pcText = FT_toString()) != NULL);
+  assert(!strcmp(pcText, ""));
+  free(pcText);
+  insertWide("1root", FILES);
+  assert(FT_destroy() == SUCCESS);
+}
+
+/*
+  The following functions make an allocation fail on request, count
+  reallocations, and tell the FT that as many processors are online
+  as a test asks for, so that its threads are used on any host. The
+  linker sends the calls of malloc, calloc, realloc and sysconf here,
+  and the __real_ functions are the C library's.
+*/
+
+/* The number of allocations to let succeed before one fails, or a
+   negative number if none is to fail */
+static long lAllocsLeft = -1;
+
+/* Returns TRUE if the allocation being made is to fail, and FALSE
+   otherwise. May be called by several threads at once. */
+static boolean failAlloc(void) {
+  return (boolean)(__sync_add_and_fetch(&lAllocsLeft, 0) >= 0 &&
+                   __sync_sub_and_fetch(&lAllocsLeft, 1) == -1);
+}
+
+void *__real_malloc(size_t ulSize);
+void *__real_calloc(size_t ulCount, size_t ulSize);
+void *__real_realloc(void *pv, size_t ulSize);
+
+void *__wrap_malloc(size_t ulSize) {
+  return failAlloc() ? NULL : __real_malloc(ulSize);
+}
+
+void *__wrap_calloc(size_t ulCount, size_t ulSize) {
+  return failAlloc() ? NULL : __real_calloc(ulCount, ulSize);
+}
+
+/* The number of reallocations asked for, and the size of the last */
+static unsigned long ulReallocs = 0;
+static size_t ulLastRealloc = 0;
+
+void *__wrap_realloc(void *pv, size_t ulSize) {
+  (void)__sync_add_and_fetch(&ulReallocs, 1);
+  (void)__sync_lock_test_and_set(&ulLastRealloc, ulSize);
+  return failAlloc() ? NULL : __real_realloc(pv, ulSize);
+}
+
+/* The number of processors the FT is told are online, or 0 to tell it
+   the true number */
+static long lProcessorsShown = 0;
+
+long __real_sysconf(int iName);
+
+long __wrap_sysconf(int iName) {
+  if(iName == _SC_NPROCESSORS_ONLN && lProcessorsShown > 0)
+    return lProcessorsShown;
+  return __real_sysconf(iName);
+}
+
+/* Asserts that FT_buildFromPaths with ulThreads threads gives the ulCount
+   operations of psOps the statuses FT_applyBatch does, and the same FT
+   as its string pcExpected. */
+static void checkBuild(struct FT_op* psOps, size_t ulCount,
+                       size_t ulThreads, const int* aiStatuses,
+                       const char* pcExpected) {
+  char* pcText;
+  size_t i;
+
+  for(i = 0; i < ulCount; i++)
+    psOps[i].iStatus = -1;
+  assert(FT_init() == SUCCESS);
+  assert(FT_buildFromPaths(psOps, ulCount, ulThreads) == SUCCESS);
+  for(i = 0; i < ulCount; i++)
+    assert(psOps[i].iStatus == aiStatuses[i]);
+  assert((pcText = FT_toString()) != NULL);
+  assert(!strcmp(pcText, pcExpected));
+  free(pcText);
+  assert(FT_destroy() == SUCCESS);
+}
+
+/* Applies the ulCount operations of psOps to an empty FT with
+   FT_applyBatch, setting aiStatuses to their statuses, and returns the
+   string of the FT, which the caller must free. */
+static char* applyToEmpty(struct FT_op* psOps, size_t ulCount,
+                          int* aiStatuses) {
+  char* pcText;
+  size_t i;
+
+  assert(FT_init() == SUCCESS);
+  assert(FT_applyBatch(psOps, ulCount) == SUCCESS);
+  for(i = 0; i < ulCount; i++)
+    aiStatuses[i] = psOps[i].iStatus;
+  assert((pcText = FT_toString()) != NULL);
+  assert(FT_destroy() == SUCCESS);
+  return pcText;
+}
+
+/* Tests that FT_buildFromPaths gives the statuses and FT FT_applyBatch
+   does, with duplicate, invalid and conflicting paths, files used as
+   directories, any number of threads and enough operations to be
+   sorted by several, and that it leaves the FT empty if it runs out
+   of memory at any allocation. */
+static void testBuildFromPaths(void) {
+  enum {OPS = 16, TOPS = 20, BIGOPS = 6000};
+  static struct FT_op asOps[OPS] = {
+    {FT_OP_INSERT_DIR, "1root/a/b", NULL, 0, -1},
+    {FT_OP_INSERT_FILE, "1root/f", "f", 2, -1},
+    {FT_OP_INSERT_DIR, "1root/a/b", NULL, 0, -1},
+    {FT_OP_INSERT_FILE, "1root/f/g", "g", 2, -1},
+    {FT_OP_INSERT_DIR, "1root//x", NULL, 0, -1},
+    {FT_OP_INSERT_FILE, "1root", "r", 2, -1},
+    {FT_OP_INSERT_DIR, "2root/a", NULL, 0, -1},
+    {FT_OP_INSERT_FILE, "1root/a/b/h", "h", 2, -1},
+    {FT_OP_INSERT_FILE, "1root/a/b/h", "H", 2, -1},
+    {FT_OP_INSERT_DIR, "1root/a/b/h/i", NULL, 0, -1},
+    {FT_OP_INSERT_DIR, "1root", NULL, 0, -1},
+    {FT_OP_INSERT_DIR, "/1root/c", NULL, 0, -1},
+    {FT_OP_INSERT_DIR, "1root/a", NULL, 0, -1},
+    {FT_OP_INSERT_DIR, "1root/f", NULL, 0, -1},
+    {FT_OP_INSERT_FILE, "1root/a/c/d/e", "e", 2, -1},
+    {FT_OP_INSERT_DIR, "1root", NULL, 0, -1}
+  };
+  static const int aiStatuses[OPS] = {
+    SUCCESS, SUCCESS, ALREADY_IN_TREE, NOT_A_DIRECTORY, BAD_PATH,
+    CONFLICTING_PATH, CONFLICTING_PATH, SUCCESS, ALREADY_IN_TREE,
+    NOT_A_DIRECTORY, SUCCESS, BAD_PATH, SUCCESS,
+    NOT_A_DIRECTORY, SUCCESS, ALREADY_IN_TREE
+  };
+  static struct FT_op asTops[TOPS];
+  static char aacTops[TOPS][32];
+  static struct FT_op asBig[BIGOPS];
+  static char aacBig[BIGOPS][32];
+  static int aiBig[BIGOPS];
+  int aiTops[TOPS];
+  char* pcExpected;
+  char* pcText;
+  long lAllocs, lLeft;
+  size_t ulThreads;
+  size_t i;
+  int iStatus;
+
+  assert(FT_buildFromPaths(asOps, OPS, 0) == INITIALIZATION_ERROR);
+  pcExpected = applyToEmpty(asOps, OPS, aiTops);
+  for(i = 0; i < OPS; i++)
+    assert(aiTops[i] == aiStatuses[i]);
+  for(ulThreads = 0; ulThreads <= 4; ulThreads++)
+    checkBuild(asOps, OPS, ulThreads, aiStatuses, pcExpected);
+  free(pcExpected);
+
+  /* with no operations, or on a non-empty FT, as FT_applyBatch */
+  assert(FT_init() == SUCCESS);
+  assert(FT_buildFromPaths(asOps, 0, 2) == SUCCESS);
+  assert(FT_buildFromPaths(asOps, 1, 2) == SUCCESS);
+  assert(FT_buildFromPaths(asOps, OPS, 2) == SUCCESS);
+  assert(asOps[0].iStatus == ALREADY_IN_TREE);
+  assert(asOps[14].iStatus == SUCCESS);
+  assert(asOps[3].iStatus == NOT_A_DIRECTORY);
+  assert(FT_destroy() == SUCCESS);
+
+  /* enough operations to be sorted in runs and merged */
+  for(i = 0; i < BIGOPS; i++) {
+    sprintf(aacBig[i], "1root/d%lu/%c%lu%s", (unsigned long)(i % 97),
+            "aba"[i % 3], (unsigned long)(i * 7 % (BIGOPS / 2)),
+            i % 3 == 2 ? "/x" : "");
+    asBig[i].eKind = i % 5 == 0 ? FT_OP_INSERT_DIR : FT_OP_INSERT_FILE;
+    asBig[i].pcPath = aacBig[i];
+    asBig[i].pvContents = aacBig[i];
+    asBig[i].ulLength = strlen(aacBig[i]) + 1;
+  }
+  pcExpected = applyToEmpty(asBig, BIGOPS, aiBig);
+  checkBuild(asBig, BIGOPS, 1, aiBig, pcExpected);
+  checkBuild(asBig, BIGOPS, 4, aiBig, pcExpected);
+  checkBuild(asBig, BIGOPS, 0, aiBig, pcExpected);
+  free(pcExpected);
+
+  /* running out of memory at each allocation in turn, below more
+     children of the root than are kept inline */
+  for(i = 0; i < TOPS; i++) {
+    sprintf(aacTops[i], "1root/t%02lu/u/v", (unsigned long)i);
+    asTops[i].eKind = i % 2 == 0 ? FT_OP_INSERT_DIR : FT_OP_INSERT_FILE;
+    asTops[i].pcPath = aacTops[i];
+    asTops[i].pvContents = NULL;
+    asTops[i].ulLength = 0;
+  }
+  pcExpected = applyToEmpty(asTops, TOPS, aiTops);
+  for(lAllocs = 0; ; lAllocs++) {
+    assert(FT_init() == SUCCESS);
+    lAllocsLeft = lAllocs;
+    iStatus = FT_buildFromPaths(asTops, TOPS, 2);
+    lLeft = lAllocsLeft;
+    lAllocsLeft = -1;
+    assert((pcText = FT_toString()) != NULL);
+    if(iStatus == MEMORY_ERROR)
+      assert(!strcmp(pcText, ""));
+    else {
+      /* a failure may only have failed the operation it was for */
+      assert(iStatus == SUCCESS);
+      for(i = 0; i < TOPS; i++) {
+        assert(asTops[i].iStatus == aiTops[i] ||
+               asTops[i].iStatus == MEMORY_ERROR);
+        if(asTops[i].iStatus == SUCCESS)
+          assert(asTops[i].eKind == FT_OP_INSERT_DIR ?
+                 FT_containsDir(asTops[i].pcPath) :
+                 FT_containsFile(asTops[i].pcPath));
+      }
+    }
+    assert(FT_destroy() == SUCCESS);
+    /* the first allocation, at least, is made */
+    assert(lAllocs > 0 || lLeft < 0);
+    if(lLeft >= 0) {
+      /* no allocation failed, so all is built */
+      assert(!strcmp(pcText, pcExpected));
+      free(pcText);
+      break;
+    }
+    free(pcText);
+  }
+  free(pcExpected);
+}
+
+/* Asserts that 1root/p holds the names among the ulNames sorted ones
+   in aacNames whose entry in abLive is TRUE, those at even indices as
+   files with contents "x" and the others as directories, and lists
+   them in order. */
+static void checkShared(char aacNames[][16], const boolean* abLive,
+                        size_t ulNames) {
+  enum {OUTLEN = 1024};
+  DirCursor_T oCursor;
+  char acExpected[OUTLEN];
+  char acOut[OUTLEN];
+  char acPath[32];
+  boolean bIsFile;
+  size_t ulSize;
+  size_t i;
+
+  acExpected[0] = '\0';
+  for(i = 0; i < ulNames; i += 2)
+    if(abLive[i])
+      sprintf(acExpected + strlen(acExpected), "f%s:1 ", aacNames[i]);
+  for(i = 1; i < ulNames; i += 2)
+    if(abLive[i])
+      sprintf(acExpected + strlen(acExpected), "d%s:0 ", aacNames[i]);
+
+  for(i = 0; i < ulNames; i++) {
+    sprintf(acPath, "1root/p/%s", aacNames[i]);
+    assert(FT_containsFile(acPath) == (abLive[i] && i % 2 == 0));
+    assert(FT_containsDir(acPath) == (abLive[i] && i % 2 == 1));
+    if(abLive[i]) {
+      assert(FT_stat(acPath, &bIsFile, &ulSize) == SUCCESS);
+      assert(bIsFile == (i % 2 == 0));
+    }
+    else
+      assert(FT_stat(acPath, &bIsFile, &ulSize) == NO_SUCH_PATH);
+  }
+
+  assert(FT_openDir("1root/p", &oCursor) == SUCCESS);
+  listDir(oCursor, 8, acOut);
+  FT_closeDir(oCursor);
+  assert(!strcmp(acOut, acExpected));
+}
+
+/* Tests inserting, finding, listing and removing children whose names
+   tie on their first eight bytes, all that a packed search key of a
+   directory's children holds, or stop just short of or just past
+   them, including names whose first eight bytes pack to the greatest
+   key. */
+static void testSharedPrefixes(void) {
+  enum {FIXED = 11, NAMES = 50, ABSENT = 7};
+  static const char* apcFixed[FIXED] = {
+    "samepre", "samepref", "samepref0", "sameprefA", "sameprefa",
+    "sameprefi", "sameprefiw", "sameprefiz", "sameprefix",
+    "\377\377\377\377\377\377\377\377",
+    "\377\377\377\377\377\377\377\377\377"
+  };
+  static const char* apcAbsent[ABSENT] = {
+    "same", "sameprefB", "samepref00", "sameprefiy", "sameprefix4",
+    "sameprefix39", "sameprefix0a"
+  };
+  char aacNames[NAMES][16];
+  boolean abLive[NAMES];
+  char acPath[32];
+  boolean bIsFile;
+  size_t ulSize;
+  size_t i;
+  size_t j;
+
+  for(i = 0; i < FIXED; i++)
+    strcpy(aacNames[i], apcFixed[i]);
+  for(; i < NAMES; i++)
+    sprintf(aacNames[i], "sameprefix%02lu", (unsigned long)(i - FIXED));
+  qsort(aacNames, NAMES, sizeof(aacNames[0]), comparePaths);
+  for(i = 0; i < NAMES; i++)
+    abLive[i] = FALSE;
+
+  assert(FT_init() == SUCCESS);
+  assert(FT_insertDir("1root/p") == SUCCESS);
+
+  /* out of order, so that names are inserted between ones they tie
+     with */
+  for(i = 0; i < NAMES; i++) {
+    j = i * 7 % NAMES;
+    sprintf(acPath, "1root/p/%s", aacNames[j]);
+    assert((j % 2 == 0 ? FT_insertFile(acPath, "x", 1) :
+            FT_insertDir(acPath)) == SUCCESS);
+    abLive[j] = TRUE;
+    if(i % 8 == 7)
+      checkShared(aacNames, abLive, NAMES);
+  }
+  for(i = 0; i < ABSENT; i++) {
+    sprintf(acPath, "1root/p/%s", apcAbsent[i]);
+    assert(FT_stat(acPath, &bIsFile, &ulSize) == NO_SUCH_PATH);
+  }
+
+  for(i = 0; i < NAMES; i++) {
+    j = i * 11 % NAMES;
+    sprintf(acPath, "1root/p/%s", aacNames[j]);
+    assert((j % 2 == 0 ? FT_rmFile(acPath) : FT_rmDir(acPath)) ==
+           SUCCESS);
+    abLive[j] = FALSE;
+    if(i % 8 == 7)
+      checkShared(aacNames, abLive, NAMES);
+  }
+
+  assert(FT_destroy() == SUCCESS);
+}
+
+/* Asserts that 1root/w holds, of the ulNames names "n<i>", those for
+   which abLive[i] is TRUE, as files at even i and as directories at
+   odd i, and no others. */
+static void checkIndexed(const boolean* abLive, size_t ulNames) {
+  char acPath[32];
+  boolean bIsFile;
+  size_t ulSize;
+  size_t i;
+
+  for(i = 0; i < ulNames; i++) {
+    sprintf(acPath, "1root/w/n%02lu", (unsigned long)i);
+    assert(FT_containsFile(acPath) == (abLive[i] && i % 2 == 0));
+    assert(FT_containsDir(acPath) == (abLive[i] && i % 2 == 1));
+    if(abLive[i]) {
+      assert(FT_stat(acPath, &bIsFile, &ulSize) == SUCCESS);
+      assert(bIsFile == (i % 2 == 0));
+    }
+    else
+      assert(FT_stat(acPath, &bIsFile, &ulSize) == NO_SUCH_PATH);
+  }
+  assert(!FT_containsFile("1root/w/n"));
+  assert(!FT_containsDir("1root/w/n0"));
+}
+
+/* Inserts 1root/w/swap as a file, replaces it with a directory and
+   removes that, asserting that each lookup of the name finds it as
+   what it is at the time. */
+static void swapIndexed(void) {
+  assert(FT_insertFile("1root/w/swap", "s", 1) == SUCCESS);
+  assert(FT_containsFile("1root/w/swap"));
+  assert(!FT_containsDir("1root/w/swap"));
+  assert(FT_insertDir("1root/w/swap") == NOT_A_DIRECTORY);
+  assert(FT_insertFile("1root/w/swap/x", "x", 1) == NOT_A_DIRECTORY);
+  assert(FT_rmDir("1root/w/swap") == NOT_A_DIRECTORY);
+  assert(FT_rmFile("1root/w/swap") == SUCCESS);
+  assert(!FT_containsFile("1root/w/swap"));
+  assert(!FT_containsDir("1root/w/swap"));
+
+  assert(FT_insertDir("1root/w/swap/y") == SUCCESS);
+  assert(FT_containsDir("1root/w/swap"));
+  assert(!FT_containsFile("1root/w/swap"));
+  assert(FT_containsDir("1root/w/swap/y"));
+  assert(FT_insertFile("1root/w/swap", "s", 1) == ALREADY_IN_TREE);
+  assert(FT_rmFile("1root/w/swap") == NOT_A_FILE);
+  assert(FT_rmDir("1root/w/swap") == SUCCESS);
+  assert(!FT_containsDir("1root/w/swap"));
+  assert(!FT_containsDir("1root/w/swap/y"));
+}
+
+/* Tests finding children of both kinds as a directory gains enough of
+   them to index them, past the points at which its index is rehashed,
+   and then loses them again, enough of them that removals move
+   children back along their runs of the index. */
+static void testChildIndex(void) {
+  enum {NAMES = 100};
+  boolean abLive[NAMES];
+  char acPath[32];
+  size_t i;
+  size_t j;
+
+  for(i = 0; i < NAMES; i++)
+    abLive[i] = FALSE;
+  assert(FT_init() == SUCCESS);
+  assert(FT_insertDir("1root/w") == SUCCESS);
+
+  /* the swapped name is the child that takes the directory to each
+     count in turn */
+  for(i = 0; i < NAMES; i++) {
+    swapIndexed();
+    sprintf(acPath, "1root/w/n%02lu", (unsigned long)i);
+    assert((i % 2 == 0 ? FT_insertFile(acPath, "x", 1) :
+            FT_insertDir(acPath)) == SUCCESS);
+    abLive[i] = TRUE;
+    checkIndexed(abLive, NAMES);
+  }
+  swapIndexed();
+
+  for(i = 0; i < NAMES; i++) {
+    j = i * 7 % NAMES;
+    sprintf(acPath, "1root/w/n%02lu", (unsigned long)j);
+    assert((j % 2 == 0 ? FT_rmFile(acPath) : FT_rmDir(acPath)) ==
+           SUCCESS);
+    abLive[j] = FALSE;
+    checkIndexed(abLive, NAMES);
+    swapIndexed();
+  }
+
+  assert(FT_destroy() == SUCCESS);
+}
+
+/* Counts the visit of psEntry by worker ulWorker, for FT_parallelWalk,
+   asserting that it is not below a directory named pcWalkSkip, and
+   appends its path to acWalked if pvExtra is not NULL, in which case
+   only worker 0 may visit. Returns FT_WALK_SKIP_SUBTREE for a
+   directory named pcWalkSkip, FT_WALK_STOP for a node named
+   pcWalkStop, and FT_WALK_CONTINUE otherwise. */
+static enum FT_walkAction recordParRules(
+    const struct FT_walkEntry* psEntry, size_t ulWorker, void* pvExtra) {
+  char acBelowSkip[32];
+
+  assert(ulWorker < WALKERS);
+  aulParVisits[ulWorker]++;
+  if(pcWalkSkip != NULL) {
+    sprintf(acBelowSkip, "/%s/", pcWalkSkip);
+    assert(strstr(psEntry->pcPath, acBelowSkip) == NULL);
+  }
+  if(pvExtra != NULL) {
+    assert(ulWorker == 0);
+    assert(strlen(acWalked) + strlen(psEntry->pcPath) + 2 <
+           sizeof(acWalked));
+    strcat(acWalked, psEntry->pcPath);
+    strcat(acWalked, " ");
+  }
+  if(pcWalkStop != NULL && !strcmp(psEntry->pcName, pcWalkStop))
+    return FT_WALK_STOP;
+  if(pcWalkSkip != NULL && !psEntry->bIsFile &&
+     !strcmp(psEntry->pcName, pcWalkSkip))
+    return FT_WALK_SKIP_SUBTREE;
+  return FT_WALK_CONTINUE;
+}
+
+/* Walks the FT from "1root" with ulThreads threads, skipping below
+   directories named pcSkip and stopping at a node named pcStop unless
+   NULL, recording the paths visited in acWalked if bRecord, and
+   returns the number of visits. */
+static size_t countParWalk(size_t ulThreads, const char* pcSkip,
+                           const char* pcStop, boolean bRecord) {
+  size_t ulVisits = 0;
+  size_t i;
+
+  for(i = 0; i < WALKERS; i++)
+    aulParVisits[i] = 0;
+  acWalked[0] = '\0';
+  pcWalkSkip = pcSkip;
+  pcWalkStop = pcStop;
+  assert(FT_parallelWalk("1root", ulThreads, recordParRules,
+                         bRecord ? acWalked : NULL) == SUCCESS);
+  for(i = 0; i < WALKERS; i++)
+    ulVisits += aulParVisits[i];
+  pcWalkSkip = pcWalkStop = NULL;
+  return ulVisits;
+}
+
+/* Tests that parallel walks with several threads never visit below a
+   skipped directory and end early when stopped, that a tree too small
+   to share is walked by the calling thread alone in FT_walk's
+   pre-order, and that a subtree freed by several threads, each
+   directory once its children are queued, leaves the rest of the FT
+   intact. */
+static void testParallelRules(void) {
+  enum {ALL = 3031, BELOW_SKIPS = 1000, BELOW_STOP = 200};
+  char acPath[32];
+  char* pcBefore;
+  char* pcAfter;
+  size_t ulThreads;
+  size_t ulVisits;
+  int i;
+
+  assert(FT_init() == SUCCESS);
+  assert(FT_insertFile("1root/b/x", "abc", 3) == SUCCESS);
+  assert(FT_insertFile("1root/b/c/y", NULL, 0) == SUCCESS);
+  assert(FT_insertFile("1root/z", NULL, 0) == SUCCESS);
+  assert(FT_insertDir("1root/d/e") == SUCCESS);
+  assert(FT_insertFile("1root/b/c/d/w", NULL, 0) == SUCCESS);
+
+  /* too few directories for a second thread, however many are asked
+     for */
+  lProcessorsShown = WALKERS;
+  for(ulThreads = 0; ulThreads <= WALKERS; ulThreads += 2) {
+    assert(countParWalk(ulThreads, NULL, NULL, TRUE) == 10);
+    assert(!strcmp(acWalked,
+                   "1root 1root/z 1root/b 1root/b/x 1root/b/c "
+                   "1root/b/c/y 1root/b/c/d 1root/b/c/d/w 1root/d "
+                   "1root/d/e "));
+    assert(countParWalk(ulThreads, "c", NULL, TRUE) == 7);
+    assert(!strcmp(acWalked,
+                   "1root 1root/z 1root/b 1root/b/x 1root/b/c 1root/d "
+                   "1root/d/e "));
+    assert(countParWalk(ulThreads, NULL, "y", TRUE) == 6);
+    assert(!strcmp(acWalked,
+                   "1root 1root/z 1root/b 1root/b/x 1root/b/c "
+                   "1root/b/c/y "));
+  }
+  assert(FT_destroy() == SUCCESS);
+
+  /* ten directories, each with a file "stop", a hundred directories
+     with a file each, and a directory "skip" with fifty more */
+  assert(FT_init() == SUCCESS);
+  for(i = 0; i < 1000; i++) {
+    sprintf(acPath, "1root/p%d/q%d/f", i % 10, i);
+    assert(FT_insertFile(acPath, NULL, 0) == SUCCESS);
+  }
+  for(i = 0; i < 500; i++) {
+    sprintf(acPath, "1root/p%d/skip/s%d/f", i % 10, i);
+    assert(FT_insertFile(acPath, NULL, 0) == SUCCESS);
+  }
+  for(i = 0; i < 10; i++) {
+    sprintf(acPath, "1root/p%d/stop", i);
+    assert(FT_insertFile(acPath, NULL, 0) == SUCCESS);
+  }
+
+  for(ulThreads = 0; ulThreads <= WALKERS; ulThreads += 2) {
+    assert(countParWalk(ulThreads, NULL, NULL, FALSE) == ALL);
+    assert(countParWalk(ulThreads, "skip", NULL, FALSE) ==
+           ALL - BELOW_SKIPS);
+    assert(countParWalk(ulThreads, NULL, "1root", FALSE) == 1);
+    /* the first "stop" keeps its directory's children from being
+       queued at all */
+    ulVisits = countParWalk(ulThreads, NULL, "stop", FALSE);
+    assert(ulVisits >= 3);
+    assert(ulVisits <= ALL - BELOW_STOP);
+    ulVisits = countParWalk(ulThreads, "skip", "stop", FALSE);
+    assert(ulVisits >= 3);
+    assert(ulVisits <= ALL - BELOW_SKIPS - BELOW_STOP);
+  }
+
+  /* a subtree freed by several threads */
+  assert((pcBefore = FT_toString()) != NULL);
+  insertWide("1root/big", 5000);
+  assert(FT_rmDir("1root/big") == SUCCESS);
+  assert(!FT_containsDir("1root/big"));
+  assert(countParWalk(WALKERS, NULL, NULL, FALSE) == ALL);
+  assert((pcAfter = FT_toString()) != NULL);
+  assert(!strcmp(pcBefore, pcAfter));
+  free(pcBefore);
+  free(pcAfter);
+  insertWide("1root/big", 5000);
+  assert(FT_destroy() == SUCCESS);
+  lProcessorsShown = 0;
+}
+
+/* Text collected from FT_walk or FT_streamString */
+struct collected {
+  /* the text, not '\0'-terminated, and the room for it */
+  char* pcText;
+  size_t ulLength;
+  size_t ulRoom;
+  /* the number of pieces written, and the number after which to ask
+     for no more, or 0 to take all */
+  size_t ulPieces;
+  size_t ulMaxPieces;
+};
+
+/* Appends the ulLength characters at pcText to *psText. */
+static void appendText(struct collected* psText, const char* pcText,
+                       size_t ulLength) {
+  while(psText->ulLength + ulLength > psText->ulRoom) {
+    psText->ulRoom = psText->ulRoom == 0 ? 4096 : 2 * psText->ulRoom;
+    psText->pcText = realloc(psText->pcText, psText->ulRoom);
+    assert(psText->pcText != NULL);
+  }
+  memcpy(psText->pcText + psText->ulLength, pcText, ulLength);
+  psText->ulLength += ulLength;
+}
+
+/* Appends the path of psEntry and a newline to the text collected in
+   *pvExtra, as FT_toString lists it, for FT_walk. Returns
+   FT_WALK_CONTINUE. */
+static enum FT_walkAction collectWalk(const struct FT_walkEntry* psEntry,
+                                      void* pvExtra) {
+  appendText(pvExtra, psEntry->pcPath, strlen(psEntry->pcPath));
+  appendText(pvExtra, "\n", 1);
+  return FT_WALK_CONTINUE;
+}
+
+/* Appends the ulLength characters at pcText to the text collected in
+   *pvExtra, for FT_streamString. Returns nonzero once the most pieces
+   asked for have been taken. */
+static int collectStream(const char* pcText, size_t ulLength,
+                         void* pvExtra) {
+  struct collected* psText = pvExtra;
+
+  assert(ulLength > 0);
+  appendText(psText, pcText, ulLength);
+  psText->ulPieces++;
+  return psText->ulMaxPieces != 0 &&
+         psText->ulPieces == psText->ulMaxPieces;
+}
+
+/* Asserts that FT_streamString with ulThreads threads writes the
+   ulLength characters at pcExpected, in at least ulMinPieces
+   pieces. */
+static void checkStream(size_t ulThreads, const char* pcExpected,
+                        size_t ulLength, size_t ulMinPieces) {
+  struct collected sText = {NULL, 0, 0, 0, 0};
+
+  assert(FT_streamString(ulThreads, collectStream, &sText) == SUCCESS);
+  assert(sText.ulLength == ulLength);
+  assert(ulLength == 0 || !memcmp(sText.pcText, pcExpected, ulLength));
+  assert(sText.ulPieces >= ulMinPieces);
+  free(sText.pcText);
+}
+
+/* Asserts that FT_toString, with the FT told there are lProcessors
+   processors, returns the ulLength characters at pcExpected. */
+static void checkText(long lProcessors, const char* pcExpected,
+                      size_t ulLength) {
+  char* pcText;
+
+  lProcessorsShown = lProcessors;
+  assert((pcText = FT_toString()) != NULL);
+  lProcessorsShown = 0;
+  assert(strlen(pcText) == ulLength);
+  assert(!memcmp(pcText, pcExpected, ulLength));
+  free(pcText);
+}
+
+/* Tests that FT_toString and FT_streamString give the same text as a
+   pre-order walk, whether rendered by one thread or several, in an FT
+   with too few directories to be rendered in parallel and in one
+   with enough and over a megabyte of text, and that a stream stops
+   when asked to. */
+static void testStreamString(void) {
+  enum {GROUPS = 60, DIRS = 6000};
+  struct collected sWalk = {NULL, 0, 0, 0, 0};
+  struct collected sText = {NULL, 0, 0, 0, 1};
+  char acLong[128];
+  char acPath[192];
+  size_t ulThreads;
+  size_t ulGroup;
+  size_t i;
+
+  assert(FT_streamString(1, collectStream, &sText) ==
+         INITIALIZATION_ERROR);
+  assert(FT_init() == SUCCESS);
+  checkStream(2, NULL, 0, 0);
+  checkText(4, "", 0);
+
+  /* files at every level, below directories of names up to a
+     hundred characters long, in groups one of which holds half of
+     them, and a directory of files alone too large to share but not
+     to be split */
+  memset(acLong, 'l', 96);
+  for(i = 0; i < DIRS; i++) {
+    sprintf(acLong + 96, "%04lu", (unsigned long)i);
+    ulGroup = i % 2 == 0 ? 0 : i % GROUPS;
+    sprintf(acPath, "1root/g%02lu/d%04lu/%s/f", (unsigned long)ulGroup,
+            (unsigned long)i, acLong);
+    assert(FT_insertFile(acPath, acPath, strlen(acPath)) == SUCCESS);
+    if(i % 2 == 0) {
+      sprintf(acPath, "1root/flat/%s", acLong);
+      assert(FT_insertFile(acPath, NULL, 0) == SUCCESS);
+    }
+    if(i % 3 == 0) {
+      sprintf(acPath, "1root/g%02lu/d%04lu/e", (unsigned long)ulGroup,
+              (unsigned long)i);
+      assert(FT_insertFile(acPath, NULL, 0) == SUCCESS);
+    }
+    if(i < GROUPS) {
+      sprintf(acPath, "1root/g%02lu/h", (unsigned long)i);
+      assert(FT_insertFile(acPath, NULL, 0) == SUCCESS);
+      sprintf(acPath, "1root/r%02lu", (unsigned long)i);
+      assert(FT_insertFile(acPath, NULL, 0) == SUCCESS);
+    }
+
+    /* the text of a small FT, rendered in one pass */
+    if(i == 100) {
+      assert(FT_walk("1root", FT_WALK_PRE, collectWalk, &sWalk) ==
+             SUCCESS);
+      checkText(4, sWalk.pcText, sWalk.ulLength);
+      for(ulThreads = 0; ulThreads <= 8; ulThreads++)
+        checkStream(ulThreads, sWalk.pcText, sWalk.ulLength, 1);
+      sWalk.ulLength = 0;
+    }
+  }
+
+  /* the text of a large FT, measured and rendered in segments */
+  assert(FT_walk("1root", FT_WALK_PRE, collectWalk, &sWalk) == SUCCESS);
+  assert(sWalk.ulLength > 1 << 20);
+  checkText(1, sWalk.pcText, sWalk.ulLength);
+  checkText(8, sWalk.pcText, sWalk.ulLength);
+  checkStream(1, sWalk.pcText, sWalk.ulLength, 2);
+  checkStream(2, sWalk.pcText, sWalk.ulLength, 1);
+  checkStream(4, sWalk.pcText, sWalk.ulLength, 1);
+  checkStream(8, sWalk.pcText, sWalk.ulLength, 1);
+  lProcessorsShown = 8;
+  checkStream(0, sWalk.pcText, sWalk.ulLength, 1);
+  lProcessorsShown = 0;
+
+  /* stopped after the first piece, without error */
+  assert(FT_streamString(1, collectStream, &sText) == SUCCESS);
+  assert(sText.ulPieces == 1);
+  assert(sText.ulLength < sWalk.ulLength);
+  assert(!memcmp(sText.pcText, sWalk.pcText, sText.ulLength));
+  free(sText.pcText);
+  free(sWalk.pcText);
+  assert(FT_destroy() == SUCCESS);
+}
+
+/* The characters whose addresses are the elements of the DynArrays
+   tested */
+static const char acLetters[] =
+  "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmnopqrstuvwxyz";
+
+/* Asserts that the elements of oDArray are the addresses of the
+   characters of pcExpected, in order. */
+static void checkArray(DynArray_T oDArray, const char* pcExpected) {
+  size_t i;
+
+  assert(DynArray_getLength(oDArray) == strlen(pcExpected));
+  for(i = 0; i < strlen(pcExpected); i++)
+    assert(*(const char*)DynArray_get(oDArray, i) == pcExpected[i]);
+}
+
+/* Tests adding and removing ranges of a DynArray at its front, in its
+   middle and at its end, reserving room, and giving memory back when
+   asked to or, with DYNARRAY_SHRINK_QUARTER, once it drops below a
+   quarter full, all without changing its elements. */
+static void testDynArrayRanges(void) {
+  enum {LETTERS = 52};
+  const void* apvLetters[LETTERS];
+  DynArray_T oDArray;
+  unsigned long ulBefore;
+  size_t i;
+
+  for(i = 0; i < LETTERS; i++)
+    apvLetters[i] = &acLetters[i];
+  assert((oDArray = DynArray_new(0)) != NULL);
+
+  assert(DynArray_addRange(oDArray, 0, apvLetters, 0));
+  checkArray(oDArray, "");
+  assert(DynArray_addRange(oDArray, 0, apvLetters + 3, 3));
+  checkArray(oDArray, "DEF");
+  assert(DynArray_addRange(oDArray, 0, apvLetters, 3));
+  checkArray(oDArray, "ABCDEF");
+  assert(DynArray_addRange(oDArray, 6, apvLetters + 6, 3));
+  checkArray(oDArray, "ABCDEFGHI");
+  assert(DynArray_addRange(oDArray, 3, apvLetters + 26, 2));
+  checkArray(oDArray, "ABCabDEFGHI");
+  assert(DynArray_addRange(oDArray, 11, apvLetters, 0));
+  assert(DynArray_addRange(oDArray, 5, apvLetters, 0));
+  DynArray_removeRange(oDArray, 0, 0);
+  DynArray_removeRange(oDArray, 4, 0);
+  DynArray_removeRange(oDArray, 11, 0);
+  checkArray(oDArray, "ABCabDEFGHI");
+  DynArray_removeRange(oDArray, 3, 2);
+  checkArray(oDArray, "ABCDEFGHI");
+  DynArray_removeRange(oDArray, 0, 2);
+  checkArray(oDArray, "CDEFGHI");
+  DynArray_removeRange(oDArray, 5, 2);
+  checkArray(oDArray, "CDEFG");
+  DynArray_removeRange(oDArray, 0, 5);
+  checkArray(oDArray, "");
+
+  /* a failed addition leaves the elements as they were */
+  assert(DynArray_addRange(oDArray, 0, apvLetters, 2));
+  lAllocsLeft = 0;
+  assert(!DynArray_addRange(oDArray, 1, apvLetters + 2, 20));
+  lAllocsLeft = -1;
+  checkArray(oDArray, "AB");
+
+  /* exactly the room asked for, filled without reallocating */
+  assert(DynArray_reserve(oDArray, 40));
+  assert(ulLastRealloc == 40 * sizeof(void*));
+  checkArray(oDArray, "AB");
+  ulBefore = ulReallocs;
+  assert(DynArray_reserve(oDArray, 10));
+  assert(DynArray_addRange(oDArray, 2, apvLetters + 2, 30));
+  for(i = 32; i < 40; i++)
+    assert(DynArray_add(oDArray, apvLetters[i]));
+  assert(ulReallocs == ulBefore);
+  checkArray(oDArray, "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmn");
+  lAllocsLeft = 0;
+  assert(!DynArray_reserve(oDArray, 80));
+  lAllocsLeft = -1;
+  checkArray(oDArray, "ABCDEFGHIJKLMNOPQRSTUVWXYZabcdefghijklmn");
+  ulBefore = ulReallocs;
+
+  /* shrunk only below a quarter of the 40 slots, to twice the
+     length */
+  DynArray_setShrinkPolicy(oDArray, DYNARRAY_SHRINK_QUARTER);
+  DynArray_removeRange(oDArray, 5, 30);
+  assert(ulReallocs == ulBefore);
+  checkArray(oDArray, "ABCDEjklmn");
+  (void)DynArray_removeAt(oDArray, 9);
+  assert(ulReallocs == ulBefore + 1);
+  assert(ulLastRealloc == 18 * sizeof(void*));
+  checkArray(oDArray, "ABCDEjklm");
+  DynArray_removeRange(oDArray, 0, 6);
+  assert(ulLastRealloc == 6 * sizeof(void*));
+  checkArray(oDArray, "klm");
+  ulBefore = ulReallocs;
+  DynArray_removeRange(oDArray, 1, 1);
+  assert(ulReallocs == ulBefore);
+  checkArray(oDArray, "km");
+  DynArray_removeRange(oDArray, 0, 2);
+  assert(ulLastRealloc == 2 * sizeof(void*));
+  checkArray(oDArray, "");
+  assert(DynArray_addRange(oDArray, 0, apvLetters, 8));
+  checkArray(oDArray, "ABCDEFGH");
+  DynArray_free(oDArray);
+
+  /* the policy applies at once */
+  assert((oDArray = DynArray_new(0)) != NULL);
+  assert(DynArray_reserve(oDArray, 64));
+  assert(DynArray_addRange(oDArray, 0, apvLetters, 4));
+  DynArray_setShrinkPolicy(oDArray, DYNARRAY_SHRINK_QUARTER);
+  assert(ulLastRealloc == 8 * sizeof(void*));
+  checkArray(oDArray, "ABCD");
+  DynArray_free(oDArray);
+
+  /* without it, memory is given back only when asked for */
+  assert((oDArray = DynArray_new(0)) != NULL);
+  assert(DynArray_addRange(oDArray, 0, apvLetters, 20));
+  ulBefore = ulReallocs;
+  DynArray_removeRange(oDArray, 2, 15);
+  assert(ulReallocs == ulBefore);
+  lAllocsLeft = 0;
+  DynArray_shrinkToFit(oDArray);
+  lAllocsLeft = -1;
+  checkArray(oDArray, "ABRST");
+  DynArray_shrinkToFit(oDArray);
+  assert(ulReallocs == ulBefore + 2);
+  assert(ulLastRealloc == 5 * sizeof(void*));
+  checkArray(oDArray, "ABRST");
+  DynArray_shrinkToFit(oDArray);
+  assert(ulReallocs == ulBefore + 2);
+  assert(DynArray_add(oDArray, apvLetters[51]));
+  checkArray(oDArray, "ABRSTz");
+  DynArray_removeRange(oDArray, 0, 6);
+  DynArray_shrinkToFit(oDArray);
+  assert(ulLastRealloc == 2 * sizeof(void*));
+  checkArray(oDArray, "");
+  DynArray_free(oDArray);
+}
+
+#endif
 
 /* Tests the FT implementation with an assortment of checks.
    Prints the status of the data structure along the way to stderr.
@@ -241,5 +2320,27 @@ int main(void) {
   assert(FT_containsFile("1root") == FALSE);
   assert((temp = FT_toString()) == NULL);
 
+#ifndef FT_BASELINE
+  testOwnedContents();
+  testDedupContents();
+  testRanges();
+  testSpill();
+  testContentBudget();
+  testApplyBatch();
+  testLookupMany();
+  testDirCursor();
+  testWalk();
+  testGlob();
+  testFindByName();
+  testScan();
+  testParallelFree();
+  testBuildFromPaths();
+  testSharedPrefixes();
+  testChildIndex();
+  testParallelRules();
+  testStreamString();
+  testDynArrayRanges();
+#endif
+
   return 0;
 }
@@ -0,0 +1,518 @@
+/*--------------------------------------------------------------------*/
+/* micro_bench.c                                                      */
+/* Author: Will Huang and George Tziampazis                           */
+/*--------------------------------------------------------------------*/
+
+#define _GNU_SOURCE
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <time.h>
+#include "a4def.h"
+#include "dynarray.h"
+#include "path.h"
+
+/*
+  Measures the Path and DynArray primitives that dominate FT profiles
+  in isolation, across path depths, component lengths and array sizes,
+  reporting nanoseconds and allocations per operation.
+
+  Usage: micro_bench [filter]
+  runs only the primitives whose names contain filter, if given.
+
+  Allocations are counted by wrapping malloc, calloc and realloc at
+  link time (see the micro_bench rule of the Makefile); built without
+  the wrapping, every count is 0. Each measurement repeats rounds of
+  operations until they have taken MICRO_MIN_NANOS, and only the
+  operations themselves are timed: building their inputs and freeing
+  their results happens between rounds.
+*/
+
+/* The least time, in nanoseconds, that each measurement runs for */
+#define MICRO_MIN_NANOS 50000000UL
+
+/* The most operations timed at once */
+enum { MICRO_BATCH = 64 };
+
+/* ------------------------------------------------------------------ */
+/*
+  The following functions count every allocation the primitives make.
+  The linker sends their calls of malloc, calloc and realloc here, and
+  the __real_ functions are the C library's.
+*/
+
+/* The number of allocations made so far */
+static unsigned long ulAllocations = 0;
+
+void *__real_malloc(size_t ulSize);
+void *__real_calloc(size_t ulCount, size_t ulSize);
+void *__real_realloc(void *pv, size_t ulSize);
+
+void *__wrap_malloc(size_t ulSize) {
+   ulAllocations++;
+   return __real_malloc(ulSize);
+}
+
+void *__wrap_calloc(size_t ulCount, size_t ulSize) {
+   ulAllocations++;
+   return __real_calloc(ulCount, ulSize);
+}
+
+void *__wrap_realloc(void *pv, size_t ulSize) {
+   ulAllocations++;
+   return __real_realloc(pv, ulSize);
+}
+
+/* ------------------------------------------------------------------ */
+
+/* The totals of one measurement */
+struct measure {
+   /* the time taken by the operations, in nanoseconds */
+   unsigned long ulNanos;
+   /* the allocations the operations made */
+   unsigned long ulAllocs;
+   /* the number of operations */
+   unsigned long ulOps;
+};
+
+/* The time and allocation count when timing last began */
+static unsigned long ulBeginNanos;
+static unsigned long ulBeginAllocs;
+
+/* The time taken to read the clock, taken off every timing */
+static unsigned long ulOverhead = 0;
+
+/* Where results are stored so the compiler cannot skip computing them */
+static volatile size_t ulSink;
+
+/* Returns the monotonic time in nanoseconds. */
+static unsigned long Micro_now(void) {
+   struct timespec sTime;
+
+   clock_gettime(CLOCK_MONOTONIC, &sTime);
+   return (unsigned long)sTime.tv_sec * 1000000000UL +
+          (unsigned long)sTime.tv_nsec;
+}
+
+/* Reports that the benchmark cannot go on because of pcWhat. */
+static void Micro_fail(const char *pcWhat) {
+   fprintf(stderr, "micro_bench: %s\n", pcWhat);
+   exit(EXIT_FAILURE);
+}
+
+/* Returns a pointer to ulSize new bytes, failing if there are none. */
+static void *Micro_malloc(size_t ulSize) {
+   void *pv = malloc(ulSize);
+
+   if(pv == NULL)
+      Micro_fail("out of memory");
+   return pv;
+}
+
+/* Starts timing operations. */
+static void Micro_begin(void) {
+   ulBeginAllocs = ulAllocations;
+   ulBeginNanos = Micro_now();
+}
+
+/* Stops timing, adding the ulOps operations since to *psMeasure. */
+static void Micro_end(struct measure *psMeasure, unsigned long ulOps) {
+   unsigned long ulNanos = Micro_now() - ulBeginNanos;
+
+   psMeasure->ulNanos += ulNanos > ulOverhead ? ulNanos - ulOverhead : 0;
+   psMeasure->ulAllocs += ulAllocations - ulBeginAllocs;
+   psMeasure->ulOps += ulOps;
+}
+
+/* Sets ulOverhead to the least time a timing of nothing takes. */
+static void Micro_calibrate(void) {
+   unsigned long ulNanos;
+   int i;
+
+   ulOverhead = (unsigned long)-1;
+   for(i = 0; i < 10000; i++) {
+      ulNanos = Micro_now();
+      ulNanos = Micro_now() - ulNanos;
+      if(ulNanos < ulOverhead)
+         ulOverhead = ulNanos;
+   }
+}
+
+/*
+  Measures primitive pcName with parameters pcParams by calling
+  (*pfRound)(pvState, &sMeasure) until its operations have taken
+  MICRO_MIN_NANOS, after one round to warm up, and prints the result.
+*/
+static void Micro_run(const char *pcName, const char *pcParams,
+                      void (*pfRound)(void *pvState,
+                                      struct measure *psMeasure),
+                      void *pvState) {
+   struct measure sMeasure = {0, 0, 0};
+
+   (*pfRound)(pvState, &sMeasure);
+   sMeasure.ulNanos = sMeasure.ulAllocs = sMeasure.ulOps = 0;
+   while(sMeasure.ulNanos < MICRO_MIN_NANOS)
+      (*pfRound)(pvState, &sMeasure);
+
+   printf("%-26s %-22s %11.1f %10.2f\n", pcName, pcParams,
+          (double)sMeasure.ulNanos / (double)sMeasure.ulOps,
+          (double)sMeasure.ulAllocs / (double)sMeasure.ulOps);
+   fflush(stdout);
+}
+
+/* ------------------------------------------------------------------ */
+/*
+  The following functions measure the Path primitives, on paths of
+  some depth whose components all have the same length.
+*/
+
+/* The paths that the Path primitives are measured on */
+struct pathState {
+   /* the pathname */
+   char *pcPath;
+   /* the path, and an equal path, so comparing them reads all of it */
+   Path_T oPPath;
+   Path_T oPEqual;
+   /* a path that differs from oPPath only in its last component */
+   Path_T oPSibling;
+   /* the depth of the prefixes taken */
+   size_t ulPrefixDepth;
+   /* the paths made by the last round */
+   Path_T aoPMade[MICRO_BATCH];
+};
+
+/* Fails unless iStatus is SUCCESS. */
+static void Micro_checkPath(int iStatus) {
+   if(iStatus != SUCCESS)
+      Micro_fail("a Path function failed");
+}
+
+/* Frees the paths the last round of psState made. */
+static void Micro_freeMade(struct pathState *psState) {
+   int i;
+
+   for(i = 0; i < MICRO_BATCH; i++)
+      Path_free(psState->aoPMade[i]);
+}
+
+static void Micro_pathNew(void *pvState, struct measure *psMeasure) {
+   struct pathState *psState = pvState;
+   int aiStatus[MICRO_BATCH];
+   int i;
+
+   Micro_begin();
+   for(i = 0; i < MICRO_BATCH; i++)
+      aiStatus[i] = Path_new(psState->pcPath, &psState->aoPMade[i]);
+   Micro_end(psMeasure, MICRO_BATCH);
+   for(i = 0; i < MICRO_BATCH; i++)
+      Micro_checkPath(aiStatus[i]);
+   Micro_freeMade(psState);
+}
+
+static void Micro_pathPrefix(void *pvState, struct measure *psMeasure) {
+   struct pathState *psState = pvState;
+   int aiStatus[MICRO_BATCH];
+   int i;
+
+   Micro_begin();
+   for(i = 0; i < MICRO_BATCH; i++)
+      aiStatus[i] = Path_prefix(psState->oPPath, psState->ulPrefixDepth,
+                                &psState->aoPMade[i]);
+   Micro_end(psMeasure, MICRO_BATCH);
+   for(i = 0; i < MICRO_BATCH; i++)
+      Micro_checkPath(aiStatus[i]);
+   Micro_freeMade(psState);
+}
+
+static void Micro_pathDup(void *pvState, struct measure *psMeasure) {
+   struct pathState *psState = pvState;
+   int aiStatus[MICRO_BATCH];
+   int i;
+
+   Micro_begin();
+   for(i = 0; i < MICRO_BATCH; i++)
+      aiStatus[i] = Path_dup(psState->oPPath, &psState->aoPMade[i]);
+   Micro_end(psMeasure, MICRO_BATCH);
+   for(i = 0; i < MICRO_BATCH; i++)
+      Micro_checkPath(aiStatus[i]);
+   Micro_freeMade(psState);
+}
+
+static void Micro_pathCompare(void *pvState, struct measure *psMeasure) {
+   struct pathState *psState = pvState;
+   int iSum = 0;
+   int i;
+
+   Micro_begin();
+   for(i = 0; i < MICRO_BATCH; i++)
+      iSum += Path_comparePath(psState->oPPath, psState->oPEqual);
+   Micro_end(psMeasure, MICRO_BATCH);
+   ulSink = (size_t)iSum;
+}
+
+static void Micro_pathShared(void *pvState, struct measure *psMeasure) {
+   struct pathState *psState = pvState;
+   size_t ulSum = 0;
+   int i;
+
+   Micro_begin();
+   for(i = 0; i < MICRO_BATCH; i++)
+      ulSum += Path_getSharedPrefixDepth(psState->oPPath,
+                                         psState->oPSibling);
+   Micro_end(psMeasure, MICRO_BATCH);
+   ulSink = ulSum;
+}
+
+/*
+  Measures each Path primitive whose name contains pcFilter on paths
+  of every depth and component length.
+*/
+static void Micro_paths(const char *pcFilter) {
+   static const size_t aulDepths[] = {1, 4, 16, 64};
+   static const size_t aulLengths[] = {1, 8, 32};
+   static const struct {
+      const char *pcName;
+      void (*pfRound)(void *pvState, struct measure *psMeasure);
+   } asPrimitives[] = {
+      {"Path_new", Micro_pathNew},
+      {"Path_prefix", Micro_pathPrefix},
+      {"Path_dup", Micro_pathDup},
+      {"Path_comparePath", Micro_pathCompare},
+      {"Path_getSharedPrefixDepth", Micro_pathShared}
+   };
+   struct pathState sState;
+   char acParams[64];
+   size_t ulDepth;
+   size_t ulLength;
+   size_t d;
+   size_t l;
+   size_t p;
+   size_t i;
+
+   for(p = 0; p < sizeof(asPrimitives) / sizeof(asPrimitives[0]); p++) {
+      if(strstr(asPrimitives[p].pcName, pcFilter) == NULL)
+         continue;
+      for(d = 0; d < sizeof(aulDepths) / sizeof(aulDepths[0]); d++)
+         for(l = 0; l < sizeof(aulLengths) / sizeof(aulLengths[0]);
+             l++) {
+            ulDepth = aulDepths[d];
+            ulLength = aulLengths[l];
+
+            /* components of letters that change with the level */
+            sState.pcPath = Micro_malloc(ulDepth * (ulLength + 1));
+            for(i = 0; i < ulDepth * (ulLength + 1); i++)
+               sState.pcPath[i] = (char)('a' + i / (ulLength + 1) % 26);
+            for(i = 1; i < ulDepth; i++)
+               sState.pcPath[i * (ulLength + 1) - 1] = '/';
+            sState.pcPath[ulDepth * (ulLength + 1) - 1] = '\0';
+
+            Micro_checkPath(Path_new(sState.pcPath, &sState.oPPath));
+            Micro_checkPath(Path_new(sState.pcPath, &sState.oPEqual));
+            sState.pcPath[ulDepth * (ulLength + 1) - 2] = 'z';
+            Micro_checkPath(Path_new(sState.pcPath, &sState.oPSibling));
+            sState.pcPath[ulDepth * (ulLength + 1) - 2] =
+               (char)('a' + (ulDepth - 1) % 26);
+            sState.ulPrefixDepth = (ulDepth + 1) / 2;
+
+            sprintf(acParams, "depth %lu, length %lu",
+                    (unsigned long)ulDepth, (unsigned long)ulLength);
+            Micro_run(asPrimitives[p].pcName, acParams,
+                      asPrimitives[p].pfRound, &sState);
+
+            Path_free(sState.oPPath);
+            Path_free(sState.oPEqual);
+            Path_free(sState.oPSibling);
+            free(sState.pcPath);
+         }
+   }
+}
+
+/* ------------------------------------------------------------------ */
+/*
+  The following functions measure the DynArray primitives, on arrays
+  of pointers to distinct numbers, sorted by number.
+*/
+
+/* The array that the DynArray primitives are measured on */
+struct arrayState {
+   /* the array */
+   DynArray_T oDArray;
+   /* its length between operations */
+   size_t ulLength;
+   /* the numbers, each twice its index */
+   size_t *aulValues;
+   /* pointers to the numbers, in random order */
+   const void **ppvShuffled;
+   /* the number of operations timed at once */
+   size_t ulBatch;
+   /* the index of the next number to search for */
+   size_t ulProbe;
+};
+
+/*
+  Compares the numbers at pv1 and pv2. Returns <0, 0 or >0 if the
+  first is less than, equal to or greater than the second.
+*/
+static int Micro_compareValues(const void *pv1, const void *pv2) {
+   size_t ul1 = *(const size_t *)pv1;
+   size_t ul2 = *(const size_t *)pv2;
+
+   return (ul1 > ul2) - (ul1 < ul2);
+}
+
+static void Micro_arrayAddAt(void *pvState, struct measure *psMeasure) {
+   struct arrayState *psState = pvState;
+   size_t ulMiddle = psState->ulLength / 2;
+   const void *pvElement = &psState->aulValues[ulMiddle];
+   size_t i;
+
+   Micro_begin();
+   for(i = 0; i < psState->ulBatch; i++)
+      if(!DynArray_addAt(psState->oDArray, ulMiddle, pvElement))
+         Micro_fail("DynArray_addAt failed");
+   Micro_end(psMeasure, psState->ulBatch);
+   for(i = 0; i < psState->ulBatch; i++)
+      (void)DynArray_removeAt(psState->oDArray, ulMiddle);
+}
+
+static void Micro_arrayRemoveAt(void *pvState,
+                                struct measure *psMeasure) {
+   struct arrayState *psState = pvState;
+   size_t ulMiddle = psState->ulLength / 2;
+   const void *pvElement = &psState->aulValues[ulMiddle];
+   size_t ulSum = 0;
+   size_t i;
+
+   for(i = 0; i < psState->ulBatch; i++)
+      if(!DynArray_addAt(psState->oDArray, ulMiddle, pvElement))
+         Micro_fail("DynArray_addAt failed");
+   Micro_begin();
+   for(i = 0; i < psState->ulBatch; i++)
+      ulSum += (size_t)DynArray_removeAt(psState->oDArray, ulMiddle);
+   Micro_end(psMeasure, psState->ulBatch);
+   ulSink = ulSum;
+}
+
+static void Micro_arrayBsearch(void *pvState,
+                               struct measure *psMeasure) {
+   struct arrayState *psState = pvState;
+   const void *apvSought[MICRO_BATCH];
+   size_t ulIndex;
+   size_t ulSum = 0;
+   int i;
+
+   /* the shuffled order spreads the searches over the array */
+   for(i = 0; i < MICRO_BATCH; i++) {
+      apvSought[i] = psState->ppvShuffled[psState->ulProbe];
+      psState->ulProbe = (psState->ulProbe + 1) % psState->ulLength;
+   }
+   Micro_begin();
+   for(i = 0; i < MICRO_BATCH; i++) {
+      (void)DynArray_bsearch(psState->oDArray, (void *)apvSought[i],
+                             &ulIndex, Micro_compareValues);
+      ulSum += ulIndex;
+   }
+   Micro_end(psMeasure, MICRO_BATCH);
+   ulSink = ulSum;
+}
+
+static void Micro_arraySort(void *pvState, struct measure *psMeasure) {
+   struct arrayState *psState = pvState;
+   size_t i;
+
+   for(i = 0; i < psState->ulLength; i++)
+      (void)DynArray_set(psState->oDArray, i, psState->ppvShuffled[i]);
+   Micro_begin();
+   DynArray_sort(psState->oDArray, Micro_compareValues);
+   Micro_end(psMeasure, 1);
+}
+
+/*
+  Measures each DynArray primitive whose name contains pcFilter on
+  arrays of every size.
+*/
+static void Micro_arrays(const char *pcFilter) {
+   static const size_t aulLengths[] = {16, 256, 4096, 65536};
+   static const struct {
+      const char *pcName;
+      void (*pfRound)(void *pvState, struct measure *psMeasure);
+   } asPrimitives[] = {
+      {"DynArray_addAt", Micro_arrayAddAt},
+      {"DynArray_removeAt", Micro_arrayRemoveAt},
+      {"DynArray_bsearch", Micro_arrayBsearch},
+      {"DynArray_sort", Micro_arraySort}
+   };
+   struct arrayState sState;
+   char acParams[64];
+   const void *pvSwap;
+   size_t ulLength;
+   size_t a;
+   size_t p;
+   size_t i;
+   size_t j;
+
+   /* a fixed seed, so that every run sorts the same orders */
+   srand(1);
+   for(p = 0; p < sizeof(asPrimitives) / sizeof(asPrimitives[0]); p++) {
+      if(strstr(asPrimitives[p].pcName, pcFilter) == NULL)
+         continue;
+      for(a = 0; a < sizeof(aulLengths) / sizeof(aulLengths[0]); a++) {
+         ulLength = aulLengths[a];
+         sState.ulLength = ulLength;
+         sState.ulProbe = 0;
+         /* few enough that the length hardly changes in a batch */
+         sState.ulBatch = ulLength / 4 < MICRO_BATCH ? ulLength / 4
+                                                     : MICRO_BATCH;
+
+         sState.aulValues = Micro_malloc(ulLength * sizeof(size_t));
+         sState.ppvShuffled = Micro_malloc(ulLength * sizeof(void *));
+         sState.oDArray = DynArray_new(ulLength);
+         if(sState.oDArray == NULL)
+            Micro_fail("out of memory");
+         for(i = 0; i < ulLength; i++) {
+            sState.aulValues[i] = 2 * i;
+            sState.ppvShuffled[i] = &sState.aulValues[i];
+            (void)DynArray_set(sState.oDArray, i, &sState.aulValues[i]);
+         }
+         for(i = ulLength; i > 1; i--) {
+            j = (size_t)rand() % i;
+            pvSwap = sState.ppvShuffled[i - 1];
+            sState.ppvShuffled[i - 1] = sState.ppvShuffled[j];
+            sState.ppvShuffled[j] = pvSwap;
+         }
+
+         sprintf(acParams, "length %lu", (unsigned long)ulLength);
+         Micro_run(asPrimitives[p].pcName, acParams,
+                   asPrimitives[p].pfRound, &sState);
+
+         DynArray_free(sState.oDArray);
+         free(sState.ppvShuffled);
+         free(sState.aulValues);
+      }
+   }
+}
+
+/* ------------------------------------------------------------------ */
+
+/*
+  Measures the primitives whose names contain argv[1], or all of them.
+  Returns 0, or EXIT_FAILURE if the arguments are bad.
+*/
+int main(int argc, char *argv[]) {
+   const char *pcFilter = "";
+
+   if(argc > 2) {
+      fprintf(stderr, "Usage: %s [filter]\n", argv[0]);
+      return EXIT_FAILURE;
+   }
+   if(argc == 2)
+      pcFilter = argv[1];
+
+   Micro_calibrate();
+   printf("%-26s %-22s %11s %10s\n", "primitive", "parameters",
+          "ns/op", "allocs/op");
+   Micro_paths(pcFilter);
+   Micro_arrays(pcFilter);
+   return 0;
+}
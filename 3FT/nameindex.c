@@ -0,0 +1,252 @@
+/*--------------------------------------------------------------------*/
+/* nameindex.c                                                        */
+/* Author: Will Huang and George Tziampazis                           */
+/*--------------------------------------------------------------------*/
+
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include "nameindex.h"
+
+/* Number of buckets in a new table (must be a power of two) */
+#define MIN_BUCKETS 64
+
+/* The nodes carrying one name */
+struct nameGroup {
+   /* hash of the name */
+   size_t ulHash;
+
+   /* first of the entries with the name, which are doubly linked */
+   struct nameEntry *psFirst;
+
+   /* next group in the same bucket of the table */
+   struct nameGroup *psNext;
+};
+
+/* The entry of one node */
+struct nameEntry {
+   /* the node's name, borrowed from its path */
+   const char *pcName;
+
+   /* the node, and whether it is a file */
+   void *pvNode;
+   boolean bIsFile;
+
+   /* the group of the name, and the neighbouring entries in it */
+   struct nameGroup *psGroup;
+   struct nameEntry *psPrev;
+   struct nameEntry *psNext;
+};
+
+/* Whether nodes created now are indexed */
+static boolean bIsEnabled;
+/* Buckets of the table, chained through psNext */
+static struct nameGroup **ppsBuckets;
+/* Number of buckets in ppsBuckets (a power of two, or 0) */
+static size_t ulNumBuckets;
+/* Number of groups in the table */
+static size_t ulNumGroups;
+/* Number of entries in the table */
+static size_t ulNumEntries;
+
+/* Returns the FNV-1a hash of string pcName. */
+static size_t NameIndex_hash(const char *pcName) {
+   size_t ulHash = (size_t)2166136261UL;
+
+   assert(pcName != NULL);
+
+   while(*pcName != '\0') {
+      ulHash ^= (unsigned char)*pcName++;
+      ulHash *= (size_t)16777619UL;
+   }
+   return ulHash;
+}
+
+/*
+  Returns the group of name pcName, whose hash is ulHash, or NULL if
+  no node carries that name.
+*/
+static struct nameGroup *NameIndex_findGroup(const char *pcName,
+                                             size_t ulHash) {
+   struct nameGroup *psGroup;
+
+   assert(pcName != NULL);
+
+   if(ulNumBuckets == 0)
+      return NULL;
+   for(psGroup = ppsBuckets[ulHash & (ulNumBuckets - 1)];
+       psGroup != NULL; psGroup = psGroup->psNext)
+      if(psGroup->ulHash == ulHash &&
+         strcmp(psGroup->psFirst->pcName, pcName) == 0)
+         return psGroup;
+   return NULL;
+}
+
+/*
+  Doubles the number of buckets (or creates the table) and rehashes
+  the groups. Returns SUCCESS or MEMORY_ERROR, in which case the table
+  is unchanged.
+*/
+static int NameIndex_grow(void) {
+   struct nameGroup **ppsNew;
+   struct nameGroup *psGroup;
+   struct nameGroup *psNext;
+   size_t ulNewNum;
+   size_t i;
+
+   ulNewNum = ulNumBuckets == 0 ? MIN_BUCKETS : ulNumBuckets * 2;
+   ppsNew = calloc(ulNewNum, sizeof(struct nameGroup *));
+   if(ppsNew == NULL)
+      return MEMORY_ERROR;
+
+   for(i = 0; i < ulNumBuckets; i++) {
+      for(psGroup = ppsBuckets[i]; psGroup != NULL; psGroup = psNext) {
+         psNext = psGroup->psNext;
+         psGroup->psNext = ppsNew[psGroup->ulHash & (ulNewNum - 1)];
+         ppsNew[psGroup->ulHash & (ulNewNum - 1)] = psGroup;
+      }
+   }
+
+   free(ppsBuckets);
+   ppsBuckets = ppsNew;
+   ulNumBuckets = ulNewNum;
+   return SUCCESS;
+}
+
+/* ================================================================== */
+void NameIndex_setEnabled(boolean bEnabled) {
+   bIsEnabled = bEnabled;
+}
+
+/* ================================================================== */
+boolean NameIndex_isEnabled(void) {
+   return bIsEnabled;
+}
+
+/* ================================================================== */
+int NameIndex_add(Path_T oPPath, boolean bIsFile, void *pvNode,
+                  NameEntry_T *poEntry) {
+   struct nameEntry *psEntry;
+   struct nameGroup *psGroup;
+   const char *pcName;
+   size_t ulHash;
+
+   assert(oPPath != NULL);
+   assert(pvNode != NULL);
+   assert(poEntry != NULL);
+
+   pcName = strrchr(Path_getPathname(oPPath), '/');
+   pcName = pcName != NULL ? pcName + 1 : Path_getPathname(oPPath);
+   ulHash = NameIndex_hash(pcName);
+
+   psEntry = malloc(sizeof(struct nameEntry));
+   if(psEntry == NULL) {
+      *poEntry = NULL;
+      return MEMORY_ERROR;
+   }
+
+   psGroup = NameIndex_findGroup(pcName, ulHash);
+   if(psGroup == NULL) {
+      /* keep at most one group per bucket on average */
+      if(ulNumGroups >= ulNumBuckets && NameIndex_grow() != SUCCESS) {
+         free(psEntry);
+         *poEntry = NULL;
+         return MEMORY_ERROR;
+      }
+      psGroup = malloc(sizeof(struct nameGroup));
+      if(psGroup == NULL) {
+         free(psEntry);
+         *poEntry = NULL;
+         return MEMORY_ERROR;
+      }
+      psGroup->ulHash = ulHash;
+      psGroup->psFirst = NULL;
+      psGroup->psNext = ppsBuckets[ulHash & (ulNumBuckets - 1)];
+      ppsBuckets[ulHash & (ulNumBuckets - 1)] = psGroup;
+      ulNumGroups++;
+   }
+
+   psEntry->pcName = pcName;
+   psEntry->pvNode = pvNode;
+   psEntry->bIsFile = bIsFile;
+   psEntry->psGroup = psGroup;
+   psEntry->psPrev = NULL;
+   psEntry->psNext = psGroup->psFirst;
+   if(psGroup->psFirst != NULL)
+      psGroup->psFirst->psPrev = psEntry;
+   psGroup->psFirst = psEntry;
+   ulNumEntries++;
+
+   *poEntry = psEntry;
+   return SUCCESS;
+}
+
+/* ================================================================== */
+void NameIndex_remove(NameEntry_T oEntry) {
+   struct nameGroup *psGroup;
+   struct nameGroup **ppsLink;
+
+   assert(oEntry != NULL);
+   assert(ulNumEntries > 0);
+
+   psGroup = oEntry->psGroup;
+   if(oEntry->psPrev != NULL)
+      oEntry->psPrev->psNext = oEntry->psNext;
+   else
+      psGroup->psFirst = oEntry->psNext;
+   if(oEntry->psNext != NULL)
+      oEntry->psNext->psPrev = oEntry->psPrev;
+   free(oEntry);
+   ulNumEntries--;
+
+   /* the name is gone once its last node is */
+   if(psGroup->psFirst == NULL) {
+      ppsLink = &ppsBuckets[psGroup->ulHash & (ulNumBuckets - 1)];
+      while(*ppsLink != psGroup)
+         ppsLink = &(*ppsLink)->psNext;
+      *ppsLink = psGroup->psNext;
+      free(psGroup);
+      ulNumGroups--;
+   }
+}
+
+/* ================================================================== */
+void NameIndex_find(const char *pcName,
+                    boolean (*pfVisit)(boolean bIsFile, void *pvNode,
+                                       void *pvExtra),
+                    void *pvExtra) {
+   struct nameGroup *psGroup;
+   struct nameEntry *psEntry;
+
+   assert(pcName != NULL);
+   assert(pfVisit != NULL);
+
+   psGroup = NameIndex_findGroup(pcName, NameIndex_hash(pcName));
+   if(psGroup == NULL)
+      return;
+   for(psEntry = psGroup->psFirst; psEntry != NULL;
+       psEntry = psEntry->psNext)
+      if(!(*pfVisit)(psEntry->bIsFile, psEntry->pvNode, pvExtra))
+         return;
+}
+
+/* ================================================================== */
+void NameIndex_getStats(size_t *pulEntries, size_t *pulBytes) {
+   assert(pulEntries != NULL);
+   assert(pulBytes != NULL);
+
+   *pulEntries = ulNumEntries;
+   *pulBytes = ulNumEntries * sizeof(struct nameEntry) +
+               ulNumGroups * sizeof(struct nameGroup) +
+               ulNumBuckets * sizeof(struct nameGroup *);
+}
+
+/* ================================================================== */
+void NameIndex_reset(void) {
+   assert(ulNumEntries == 0);
+
+   free(ppsBuckets);
+   ppsBuckets = NULL;
+   ulNumBuckets = 0;
+   ulNumGroups = 0;
+}
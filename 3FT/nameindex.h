@@ -0,0 +1,68 @@
+/*--------------------------------------------------------------------*/
+/* nameindex.h                                                        */
+/* Author: Will Huang and George Tziampazis                           */
+/*--------------------------------------------------------------------*/
+
+#ifndef NAMEINDEX_INCLUDED
+#define NAMEINDEX_INCLUDED
+
+#include <stddef.h>
+#include "a4def.h"
+#include "path.h"
+
+/*
+  The name index is an optional secondary index of the directory and
+  file nodes of a tree by name, the last component of their path. It
+  is a hash table from each name to the list of nodes carrying it, so
+  that all nodes with a name are found in time proportional to their
+  number. Nodes add and remove themselves while it is enabled.
+*/
+
+/* A NameEntry_T is the entry of one node in the name index */
+typedef struct nameEntry *NameEntry_T;
+
+/*
+  Selects whether nodes created from now on are indexed (bEnabled is
+  TRUE) or not (FALSE, the default).
+*/
+void NameIndex_setEnabled(boolean bEnabled);
+
+/* Returns TRUE if nodes created now are to be indexed. */
+boolean NameIndex_isEnabled(void);
+
+/*
+  Indexes node pvNode, a file if bIsFile and a directory otherwise, 
+  under the last component of oPPath, which must remain unchanged 
+  while it is indexed. Returns an int SUCCESS status and sets 
+  *poEntry to the node's entry if successful. Otherwise, sets *poEntry
+  to NULL and returns status:
+  * MEMORY_ERROR if memory could not be allocated to complete request
+*/
+int NameIndex_add(Path_T oPPath, boolean bIsFile, void *pvNode,
+                  NameEntry_T *poEntry);
+
+/* Removes oEntry from the name index and frees it. */
+void NameIndex_remove(NameEntry_T oEntry);
+
+/*
+  Calls (*pfVisit)(bIsFile, pvNode, pvExtra) for each node indexed 
+  under name pcName, in no particular order, until it returns FALSE.
+  The visitor must not add or remove entries.
+*/
+void NameIndex_find(const char *pcName,
+                    boolean (*pfVisit)(boolean bIsFile, void *pvNode,
+                                       void *pvExtra),
+                    void *pvExtra);
+
+/*
+  Sets *pulEntries to the number of nodes indexed and *pulBytes to 
+  the memory used by the index.
+*/
+void NameIndex_getStats(size_t *pulEntries, size_t *pulBytes);
+
+/*
+  Frees the index's hash table. Every entry must have been removed.
+*/
+void NameIndex_reset(void);
+
+#endif
@@ -7,8 +7,65 @@
 #include <assert.h>
 #include <string.h>
 #include "dynarray.h"
+#if defined(NODED_ART)
+#include "art.h"
+#elif defined(NODED_BTREE)
+#include "btree.h"
+#else
+#include "prefixkeys.h"
+#endif
 #include "noded.h"
 #include "nodef.h"
+#include "nameindex.h"
+#include "childindex.h"
+#include "sortedarray.h"
+
+/* Hints the processor to start loading the memory at pv into cache */
+#if defined(__GNUC__)
+#define NODED_PREFETCH(pv) __builtin_prefetch(pv)
+#else
+#define NODED_PREFETCH(pv) ((void)(pv))
+#endif
+
+/*
+  A node's children of each kind, in order of path. They are kept in a
+  sorted array by default, in an adaptive radix tree keyed by name if 
+  built with NODED_ART defined, e.g. with make CHILDREN=-DNODED_ART, or
+  in a B+tree if built with NODED_BTREE defined. NODED_TREE is defined
+  for both trees, which add children one at a time instead of merging.
+*/
+#if defined(NODED_ART)
+typedef Art_T Children_T;
+#define NODED_TREE
+#elif defined(NODED_BTREE)
+typedef BTree_T Children_T;
+#define NODED_TREE
+#else
+/* The most children kept in the node itself; most directories are
+   leaves or have only a few children */
+enum { NODED_INLINE_CHILDREN = 4 };
+
+/*
+  A sorted array of children, held inline until it outgrows the
+  inline slots and in a DynArray_T allocated then from that point on,
+  with the packed keys of their names alongside to search
+*/
+struct children {
+   /* the number of children, while they are inline */
+   size_t ulInline;
+   /* the array of the children once spilled, or NULL while inline */
+   DynArray_T oDSpill;
+   /* the keys of the spilled children, or NULL while inline */
+   PrefixKeys_T oKeys;
+   /* the children, while they are inline */
+   void *apvInline[NODED_INLINE_CHILDREN];
+};
+typedef struct children Children_T;
+#endif
+
+/* The fewest children for which a directory keeps a child index;
+   below that, searching each kind's children costs no more */
+enum { NODED_INDEXED_CHILDREN = 16 };
 
 /* A directory node in a DT */
 struct nodeD {
@@ -20,13 +77,775 @@ struct nodeD {
 
     /* the object containing links to this node's children that are 
     files */
-    DynArray_T oDFileChildren;
+    Children_T oCFileChildren;
 
     /* the object containg links to this node's children that are 
     directories */
-    DynArray_T oDDirChildren;
+    Children_T oCDirChildren;
+
+    /* this node's entry in the name index, or NULL if not indexed */
+    NameEntry_T oNameEntry;
+
+    /* the index of the children of both kinds by name, or NULL if 
+    there are too few children or it could not be allocated */
+    ChildIndex_T oIndex;
+};
+
+#if !defined(NODED_ART)
+/* A key for searching children by a prefix of a pathname */
+struct childKey {
+   /* the pathname */
+   const char *pcPath;
+   /* the length of the prefix that a child's path must equal */
+   size_t ulLength;
+};
+
+/*
+  Compares the pathname pcChildPath with the prefix described by
+  psKey. Returns <0, 0, or >0 if pcChildPath is "less than", "equal
+  to", or "greater than" the prefix, respectively.
+*/
+static int NodeD_comparePrefix(const char *pcChildPath,
+                               const struct childKey *psKey) {
+   int iCmp;
+
+   assert(pcChildPath != NULL);
+   assert(psKey != NULL);
+
+   iCmp = strncmp(pcChildPath, psKey->pcPath, psKey->ulLength);
+   if(iCmp != 0)
+      return iCmp;
+   /* a longer path is greater than its own prefix */
+   return pcChildPath[psKey->ulLength] != '\0';
+}
+
+/*
+  Compares the path of directory node oNdNode with the prefix
+  described by psKey, as NodeD_comparePrefix does.
+*/
+static int NodeD_compareDirPrefix(const NodeD_T oNdNode,
+                                  const struct childKey *psKey) {
+   assert(oNdNode != NULL);
+
+   return NodeD_comparePrefix(Path_getPathname(oNdNode->oPPath), psKey);
+}
+
+/*
+  Compares the path of file node oNfNode with the prefix described by
+  psKey, as NodeD_comparePrefix does.
+*/
+static int NodeD_compareFilePrefix(const NodeF_T oNfNode,
+                                   const struct childKey *psKey) {
+   assert(oNfNode != NULL);
+
+   return NodeD_comparePrefix(Path_getPathname(NodeF_getPath(oNfNode)),
+                              psKey);
+}
+
+/* A key for seeking children by a prefix of their names */
+struct nameKey {
+   /* the name prefix */
+   const char *pcName;
+   /* the length of the name prefix */
+   size_t ulLength;
+   /* the length of the parent's path and the '/' after it */
+   size_t ulSkip;
+};
+
+/*
+  Compares the name in pathname pcChildPath with the name prefix 
+  described by psKey. Returns <0 if the name is "less than" the prefix
+  and >0 otherwise, so that a search never stops at a name starting 
+  with the prefix but finds where the first such name is.
+*/
+static int NodeD_compareName(const char *pcChildPath,
+                             const struct nameKey *psKey) {
+   assert(pcChildPath != NULL);
+   assert(psKey != NULL);
+
+   if(strncmp(pcChildPath + psKey->ulSkip, psKey->pcName,
+              psKey->ulLength) < 0)
+      return -1;
+   return 1;
+}
+
+/*
+  Compares the name of directory node oNdNode with the name prefix
+  described by psKey, as NodeD_compareName does.
+*/
+static int NodeD_compareDirName(const NodeD_T oNdNode,
+                                const struct nameKey *psKey) {
+   assert(oNdNode != NULL);
+
+   return NodeD_compareName(Path_getPathname(oNdNode->oPPath), psKey);
+}
+
+/*
+  Compares the name of file node oNfNode with the name prefix 
+  described by psKey, as NodeD_compareName does.
+*/
+static int NodeD_compareFileName(const NodeF_T oNfNode,
+                                 const struct nameKey *psKey) {
+   assert(oNfNode != NULL);
+
+   return NodeD_compareName(Path_getPathname(NodeF_getPath(oNfNode)),
+                            psKey);
+}
+
+#if defined(NODED_BTREE)
+/*
+  Binary searches *poCChildren for *pvKey using *pfCompare, as 
+  DynArray_bsearch does.
+*/
+static boolean NodeD_bsearchChildren(Children_T *poCChildren,
+                                     void *pvKey, size_t *pulChildID,
+                                     int (*pfCompare)(const void *pv1,
+                                                      const void *pv2)) {
+   assert(poCChildren != NULL);
+
+   return (boolean)BTree_bsearch(*poCChildren, pvKey, pulChildID,
+                                 pfCompare);
+}
+#else
+/*
+  Binary searches of the ulCount children at apvChildren, with the
+  comparisons above compiled into the loops instead of called through
+  a pointer on every probe
+*/
+SORTEDARRAY_BSEARCH(NodeD_searchFilePrefix, void *,
+                    const struct childKey *, NodeD_compareFilePrefix)
+SORTEDARRAY_BSEARCH(NodeD_searchDirPrefix, void *,
+                    const struct childKey *, NodeD_compareDirPrefix)
+SORTEDARRAY_BSEARCH(NodeD_searchFileName, void *,
+                    const struct nameKey *, NodeD_compareFileName)
+SORTEDARRAY_BSEARCH(NodeD_searchDirName, void *,
+                    const struct nameKey *, NodeD_compareDirName)
+
+/*
+  Returns the array of the children in *poCChildren, in order, and
+  stores their number in *pulCount. The array is valid until children
+  are next added or removed.
+*/
+static void **NodeD_getChildArray(Children_T *poCChildren,
+                                  size_t *pulCount) {
+   assert(poCChildren != NULL);
+   assert(pulCount != NULL);
+
+   if(poCChildren->oDSpill == NULL) {
+      *pulCount = poCChildren->ulInline;
+      return poCChildren->apvInline;
+   }
+   *pulCount = DynArray_getLength(poCChildren->oDSpill);
+   return DynArray_getArray(poCChildren->oDSpill);
+}
+#endif
+#endif
+
+/* Returns the path of directory node pvNode, which keys it. */
+static const char *NodeD_getDirKey(const void *pvNode) {
+   assert(pvNode != NULL);
+
+   return Path_getPathname(((const struct nodeD *)pvNode)->oPPath);
+}
+
+/* Returns the path of file node pvNode, which keys it. */
+static const char *NodeD_getFileKey(const void *pvNode) {
+   assert(pvNode != NULL);
+
+   return Path_getPathname(NodeF_getPath((NodeF_T)pvNode));
+}
+
+/* Returns the path of child pvChild, a file if bIsFile. */
+static const char *NodeD_getChildKey(const void *pvChild,
+                                     boolean bIsFile) {
+   assert(pvChild != NULL);
+
+   if(bIsFile)
+      return NodeD_getFileKey(pvChild);
+   return NodeD_getDirKey(pvChild);
+}
+
+/*
+  Makes *poCChildren new, empty children of oNdNode, which are files if
+  bFiles and directories if not. Returns SUCCESS, or MEMORY_ERROR if
+  memory could not be allocated.
+*/
+static int NodeD_initChildren(NodeD_T oNdNode, Children_T *poCChildren,
+                              boolean bFiles) {
+   assert(oNdNode != NULL);
+   assert(poCChildren != NULL);
+
+#if defined(NODED_ART)
+   /* children are keyed by name, after their parent's path and '/' */
+   *poCChildren = Art_new(bFiles ? NodeD_getFileKey : NodeD_getDirKey,
+                          Path_getStrLength(oNdNode->oPPath) + 1);
+   return *poCChildren == NULL ? MEMORY_ERROR : SUCCESS;
+#elif defined(NODED_BTREE)
+   (void)bFiles;
+   *poCChildren = BTree_new();
+   return *poCChildren == NULL ? MEMORY_ERROR : SUCCESS;
+#else
+   /* nothing is allocated until the inline slots run out */
+   (void)bFiles;
+   poCChildren->ulInline = 0;
+   poCChildren->oDSpill = NULL;
+   poCChildren->oKeys = NULL;
+   return SUCCESS;
+#endif
+}
+
+/* Frees *poCChildren, but not the children themselves. */
+static void NodeD_freeChildren(Children_T *poCChildren) {
+   assert(poCChildren != NULL);
+
+#if defined(NODED_ART)
+   Art_free(*poCChildren);
+#elif defined(NODED_BTREE)
+   BTree_free(*poCChildren);
+#else
+   if(poCChildren->oDSpill != NULL) {
+      DynArray_free(poCChildren->oDSpill);
+      PrefixKeys_free(poCChildren->oKeys);
+   }
+#endif
+}
+
+/* Returns the number of children in *poCChildren. */
+static size_t NodeD_countChildren(Children_T *poCChildren) {
+   assert(poCChildren != NULL);
+
+#if defined(NODED_ART)
+   return Art_getLength(*poCChildren);
+#elif defined(NODED_BTREE)
+   return BTree_getLength(*poCChildren);
+#else
+   if(poCChildren->oDSpill == NULL)
+      return poCChildren->ulInline;
+   return DynArray_getLength(poCChildren->oDSpill);
+#endif
+}
+
+/* Returns the child of *poCChildren with identifier ulChildID. */
+static void *NodeD_getChild(Children_T *poCChildren, size_t ulChildID) {
+   assert(poCChildren != NULL);
+
+#if defined(NODED_ART)
+   return Art_get(*poCChildren, ulChildID);
+#elif defined(NODED_BTREE)
+   return BTree_get(*poCChildren, ulChildID);
+#else
+   if(poCChildren->oDSpill == NULL) {
+      assert(ulChildID < poCChildren->ulInline);
+      return poCChildren->apvInline[ulChildID];
+   }
+   return DynArray_get(poCChildren->oDSpill, ulChildID);
+#endif
+}
+
+#if !defined(NODED_TREE)
+/*
+  Moves the inline children of *poCChildren, children of oNdParent,
+  to a new array, which gives memory back as a directory empties out,
+  and keys them by name. Returns SUCCESS, or MEMORY_ERROR (leaving
+  them inline) if allocation fails.
+*/
+static int NodeD_spillChildren(NodeD_T oNdParent,
+                               Children_T *poCChildren) {
+   DynArray_T oDSpill;
+   PrefixKeys_T oKeys;
+   size_t i;
+
+   assert(oNdParent != NULL);
+   assert(poCChildren != NULL);
+   assert(poCChildren->oDSpill == NULL);
+
+   oDSpill = DynArray_new(0);
+   if(oDSpill == NULL)
+      return MEMORY_ERROR;
+   oKeys = PrefixKeys_new(poCChildren == &oNdParent->oCFileChildren ?
+                          NodeD_getFileKey : NodeD_getDirKey,
+                          Path_getStrLength(oNdParent->oPPath) + 1);
+   if(oKeys == NULL ||
+      !DynArray_addRange(oDSpill, 0,
+                         (const void **)poCChildren->apvInline,
+                         poCChildren->ulInline) ||
+      PrefixKeys_grow(oKeys, poCChildren->ulInline) != SUCCESS) {
+      PrefixKeys_free(oKeys);
+      DynArray_free(oDSpill);
+      return MEMORY_ERROR;
+   }
+   for(i = 0; i < poCChildren->ulInline; i++)
+      PrefixKeys_set(oKeys, i, poCChildren->apvInline[i]);
+   PrefixKeys_layOut(oKeys);
+   DynArray_setShrinkPolicy(oDSpill, DYNARRAY_SHRINK_QUARTER);
+   poCChildren->oDSpill = oDSpill;
+   poCChildren->oKeys = oKeys;
+   return SUCCESS;
+}
+
+/* Replaces the child of *poCChildren with identifier ulChildID. */
+static void NodeD_setChild(Children_T *poCChildren, size_t ulChildID,
+                           void *pvChild) {
+   assert(poCChildren != NULL);
+
+   if(poCChildren->oDSpill == NULL) {
+      assert(ulChildID < poCChildren->ulInline);
+      poCChildren->apvInline[ulChildID] = pvChild;
+   }
+   else {
+      (void)DynArray_set(poCChildren->oDSpill, ulChildID, pvChild);
+      PrefixKeys_set(poCChildren->oKeys, ulChildID, pvChild);
+   }
+}
+
+/*
+  Removes the last ulCount children of *poCChildren, without freeing
+  them. Removing from the end shifts nothing.
+*/
+static void NodeD_shrinkChildren(Children_T *poCChildren,
+                                 size_t ulCount) {
+   size_t ulLength;
+
+   assert(poCChildren != NULL);
+   assert(ulCount <= NodeD_countChildren(poCChildren));
+
+   if(poCChildren->oDSpill == NULL) {
+      poCChildren->ulInline -= ulCount;
+      return;
+   }
+   ulLength = DynArray_getLength(poCChildren->oDSpill);
+   DynArray_removeRange(poCChildren->oDSpill, ulLength - ulCount,
+                        ulCount);
+   PrefixKeys_removeRange(poCChildren->oKeys, ulLength - ulCount,
+                          ulCount);
+}
+
+/*
+  Adds ulCount empty slots to the end of *poCChildren, children of
+  oNdParent, to be filled with NodeD_setChild. Returns SUCCESS, or
+  MEMORY_ERROR (leaving the children unchanged) if allocation fails.
+*/
+static int NodeD_growChildren(NodeD_T oNdParent, Children_T *poCChildren,
+                              size_t ulCount) {
+   size_t i;
+
+   assert(oNdParent != NULL);
+   assert(poCChildren != NULL);
+
+   if(poCChildren->oDSpill == NULL &&
+      poCChildren->ulInline + ulCount <= NODED_INLINE_CHILDREN) {
+      for(i = 0; i < ulCount; i++)
+         poCChildren->apvInline[poCChildren->ulInline++] = NULL;
+      return SUCCESS;
+   }
+   if(poCChildren->oDSpill == NULL &&
+      NodeD_spillChildren(oNdParent, poCChildren) != SUCCESS)
+      return MEMORY_ERROR;
+   /* One reallocation for the lot; the adds below then cannot fail. */
+   if(!DynArray_reserve(poCChildren->oDSpill,
+                        DynArray_getLength(poCChildren->oDSpill) +
+                        ulCount) ||
+      PrefixKeys_grow(poCChildren->oKeys, ulCount) != SUCCESS)
+      return MEMORY_ERROR;
+   for(i = 0; i < ulCount; i++)
+      (void)DynArray_add(poCChildren->oDSpill, NULL);
+   return SUCCESS;
+}
+
+/* Makes *poCChildren ready to be searched after changes to it. */
+static void NodeD_layOutChildren(Children_T *poCChildren) {
+   assert(poCChildren != NULL);
+
+   if(poCChildren->oKeys != NULL)
+      PrefixKeys_layOut(poCChildren->oKeys);
+}
+#endif
+
+/*
+  Applies function *pfApply to each child in *poCChildren in order,
+  passing pvExtra as an extra argument.
+*/
+static void NodeD_mapChildren(Children_T *poCChildren,
+                              void (*pfApply)(void *pvChild,
+                                              void *pvExtra),
+                              void *pvExtra) {
+#if !defined(NODED_TREE)
+   size_t i;
+#endif
+
+   assert(poCChildren != NULL);
+   assert(pfApply != NULL);
+
+#if defined(NODED_ART)
+   Art_map(*poCChildren, pfApply, pvExtra);
+#elif defined(NODED_BTREE)
+   BTree_map(*poCChildren, pfApply, pvExtra);
+#else
+   if(poCChildren->oDSpill != NULL)
+      DynArray_map(poCChildren->oDSpill, pfApply, pvExtra);
+   else
+      for(i = 0; i < poCChildren->ulInline; i++)
+         (*pfApply)(poCChildren->apvInline[i], pvExtra);
+#endif
+}
+
+/* The state of building a child index with NodeD_mapChildren */
+struct indexBuild {
+   /* the index being built */
+   ChildIndex_T oIndex;
+   /* whether the children being added are files */
+   boolean bFiles;
+   /* SUCCESS, or MEMORY_ERROR once an addition has failed */
+   int iStatus;
 };
 
+/*
+  Adds child pvChild to the index that pvExtra, a struct indexBuild,
+  is building, unless an earlier addition has failed.
+*/
+static void NodeD_addToIndex(void *pvChild, void *pvExtra) {
+   struct indexBuild *psBuild = pvExtra;
+
+   assert(pvChild != NULL);
+   assert(psBuild != NULL);
+
+   if(psBuild->iStatus == SUCCESS)
+      psBuild->iStatus = ChildIndex_add(psBuild->oIndex, pvChild,
+                                        psBuild->bFiles);
+}
+
+/*
+  Indexes the ulCount children in apvChildren, just linked into
+  oNdParent's children that are files if bFiles and directories if
+  not. The index is built from all of the children once there are
+  enough of them, and dropped if memory for it cannot be allocated;
+  searches then go to each kind's children instead, so that changes
+  never fail because of it.
+*/
+static void NodeD_indexChildren(NodeD_T oNdParent, void **apvChildren,
+                                size_t ulCount, boolean bFiles) {
+   struct indexBuild sBuild;
+   size_t i;
+
+   assert(oNdParent != NULL);
+   assert(apvChildren != NULL || ulCount == 0);
+
+   if(oNdParent->oIndex != NULL) {
+      for(i = 0; i < ulCount; i++)
+         if(ChildIndex_add(oNdParent->oIndex, apvChildren[i], bFiles)
+            != SUCCESS) {
+            ChildIndex_free(oNdParent->oIndex);
+            oNdParent->oIndex = NULL;
+            return;
+         }
+      return;
+   }
+
+   if(NodeD_countChildren(&oNdParent->oCFileChildren) +
+      NodeD_countChildren(&oNdParent->oCDirChildren)
+      < NODED_INDEXED_CHILDREN)
+      return;
+   sBuild.oIndex = ChildIndex_new(NodeD_getChildKey,
+                                  Path_getStrLength(oNdParent->oPPath)
+                                  + 1);
+   if(sBuild.oIndex == NULL)
+      return;
+   sBuild.iStatus = SUCCESS;
+   sBuild.bFiles = TRUE;
+   NodeD_mapChildren(&oNdParent->oCFileChildren, NodeD_addToIndex,
+                     &sBuild);
+   sBuild.bFiles = FALSE;
+   NodeD_mapChildren(&oNdParent->oCDirChildren, NodeD_addToIndex,
+                     &sBuild);
+   if(sBuild.iStatus != SUCCESS) {
+      ChildIndex_free(sBuild.oIndex);
+      return;
+   }
+   oNdParent->oIndex = sBuild.oIndex;
+}
+
+/*
+  Removes child pvChild of oNdParent, a file if bFiles, from its child
+  index, if it has one.
+*/
+static void NodeD_unindexChild(NodeD_T oNdParent, const void *pvChild,
+                               boolean bFiles) {
+   assert(oNdParent != NULL);
+   assert(pvChild != NULL);
+
+   if(oNdParent->oIndex != NULL)
+      ChildIndex_remove(oNdParent->oIndex, pvChild, bFiles);
+}
+
+/*
+  Links pvChild into *poCChildren, children of oNdParent, at 
+  identifier ulChildID, which is where a search for its path found
+  that it belongs. Returns SUCCESS, or MEMORY_ERROR (leaving the 
+  children unchanged) if allocation fails.
+*/
+static int NodeD_insertChild(NodeD_T oNdParent, Children_T *poCChildren,
+                             size_t ulChildID, void *pvChild) {
+   int iStatus;
+
+   assert(oNdParent != NULL);
+   assert(poCChildren != NULL);
+
+#if defined(NODED_ART)
+   /* the tree finds the place from the child's key */
+   (void)ulChildID;
+   iStatus = Art_insert(*poCChildren, pvChild);
+#elif defined(NODED_BTREE)
+   iStatus = BTree_addAt(*poCChildren, ulChildID, pvChild) ?
+             SUCCESS : MEMORY_ERROR;
+#else
+   if(poCChildren->oDSpill == NULL &&
+      poCChildren->ulInline < NODED_INLINE_CHILDREN) {
+      memmove(poCChildren->apvInline + ulChildID + 1,
+              poCChildren->apvInline + ulChildID,
+              (poCChildren->ulInline - ulChildID) * sizeof(void *));
+      poCChildren->apvInline[ulChildID] = pvChild;
+      poCChildren->ulInline++;
+      iStatus = SUCCESS;
+   }
+   else if(poCChildren->oDSpill == NULL &&
+           NodeD_spillChildren(oNdParent, poCChildren) != SUCCESS)
+      iStatus = MEMORY_ERROR;
+   else if(!DynArray_addAt(poCChildren->oDSpill, ulChildID, pvChild))
+      iStatus = MEMORY_ERROR;
+   else if(PrefixKeys_addAt(poCChildren->oKeys, ulChildID, pvChild)
+           != SUCCESS) {
+      (void)DynArray_removeAt(poCChildren->oDSpill, ulChildID);
+      iStatus = MEMORY_ERROR;
+   }
+   else {
+      PrefixKeys_layOut(poCChildren->oKeys);
+      iStatus = SUCCESS;
+   }
+#endif
+   if(iStatus == SUCCESS)
+      NodeD_indexChildren(oNdParent, &pvChild, 1,
+                          poCChildren == &oNdParent->oCFileChildren);
+   return iStatus;
+}
+
+/*
+  Unlinks the child of *poCChildren, children of oNdParent, with
+  identifier ulChildID and returns it.
+*/
+static void *NodeD_removeChild(NodeD_T oNdParent, Children_T *poCChildren,
+                               size_t ulChildID) {
+   void *pvChild;
+
+   assert(oNdParent != NULL);
+   assert(poCChildren != NULL);
+
+#if defined(NODED_ART)
+   pvChild = Art_removeAt(*poCChildren, ulChildID);
+#elif defined(NODED_BTREE)
+   pvChild = BTree_removeAt(*poCChildren, ulChildID);
+#else
+   if(poCChildren->oDSpill != NULL) {
+      PrefixKeys_removeRange(poCChildren->oKeys, ulChildID, 1);
+      PrefixKeys_layOut(poCChildren->oKeys);
+      pvChild = DynArray_removeAt(poCChildren->oDSpill, ulChildID);
+   }
+   else {
+      assert(ulChildID < poCChildren->ulInline);
+      pvChild = poCChildren->apvInline[ulChildID];
+      poCChildren->ulInline--;
+      memmove(poCChildren->apvInline + ulChildID,
+              poCChildren->apvInline + ulChildID + 1,
+              (poCChildren->ulInline - ulChildID) * sizeof(void *));
+   }
+#endif
+   NodeD_unindexChild(oNdParent, pvChild,
+                      poCChildren == &oNdParent->oCFileChildren);
+   return pvChild;
+}
+
+/*
+  Returns TRUE if *poCChildren, the children of oNdParent that are files
+  if bFiles and directories if not, has one whose path is the first
+  ulLength characters of pathname pcPath, and FALSE if not. Sets
+  *pulChildID to its identifier, or that it would have if inserted.
+*/
+static boolean NodeD_findChild(NodeD_T oNdParent, Children_T *poCChildren,
+                               const char *pcPath, size_t ulLength,
+                               boolean bFiles, size_t *pulChildID) {
+#if defined(NODED_ART)
+   size_t ulSkip;
+
+   assert(oNdParent != NULL);
+   assert(pcPath != NULL);
+   assert(pulChildID != NULL);
+
+   (void)bFiles;
+   ulSkip = Path_getStrLength(oNdParent->oPPath) + 1;
+   /* the parent's own path sorts before all of its children */
+   if(ulLength < ulSkip) {
+      *pulChildID = 0;
+      return FALSE;
+   }
+   return Art_search(*poCChildren, pcPath + ulSkip, ulLength - ulSkip,
+                     pulChildID);
+#else
+   struct childKey sKey;
+#if !defined(NODED_BTREE)
+   void **apvChildren;
+   size_t ulCount;
+   size_t ulSkip;
+#endif
+
+   assert(oNdParent != NULL);
+   assert(pcPath != NULL);
+   assert(pulChildID != NULL);
+
+   sKey.pcPath = pcPath;
+   sKey.ulLength = ulLength;
+#if defined(NODED_BTREE)
+   if(bFiles)
+      return NodeD_bsearchChildren(poCChildren, &sKey, pulChildID,
+            (int (*)(const void*,const void*)) NodeD_compareFilePrefix);
+   return NodeD_bsearchChildren(poCChildren, &sKey, pulChildID,
+            (int (*)(const void*,const void*)) NodeD_compareDirPrefix);
+#else
+   apvChildren = NodeD_getChildArray(poCChildren, &ulCount);
+   if(poCChildren->oKeys != NULL) {
+      /* the parent's own path sorts before all of its children */
+      ulSkip = Path_getStrLength(oNdParent->oPPath) + 1;
+      if(ulLength < ulSkip) {
+         *pulChildID = 0;
+         return FALSE;
+      }
+      return PrefixKeys_search(poCChildren->oKeys, apvChildren,
+                               pcPath + ulSkip, ulLength - ulSkip,
+                               pulChildID);
+   }
+   if(bFiles)
+      return (boolean)NodeD_searchFilePrefix(apvChildren, ulCount,
+                                             &sKey, pulChildID);
+   return (boolean)NodeD_searchDirPrefix(apvChildren, ulCount, &sKey,
+                                         pulChildID);
+#endif
+#endif
+}
+
+/*
+  Returns the identifier of the first child in *poCChildren, the 
+  children of oNdParent that are files if bFiles and directories if 
+  not, whose name is not less than the first ulLength characters of 
+  pcName, or the number of children if there is none.
+*/
+static size_t NodeD_seekChildren(NodeD_T oNdParent, Children_T *poCChildren,
+                                 const char *pcName, size_t ulLength,
+                                 boolean bFiles) {
+#if defined(NODED_ART)
+   assert(oNdParent != NULL);
+   assert(pcName != NULL);
+
+   (void)bFiles;
+   return Art_seek(*poCChildren, pcName, ulLength);
+#else
+   struct nameKey sKey;
+   size_t ulChildID = 0;
+#if !defined(NODED_BTREE)
+   void **apvChildren;
+   size_t ulCount;
+#endif
+
+   assert(oNdParent != NULL);
+   assert(pcName != NULL);
+
+   sKey.pcName = pcName;
+   sKey.ulLength = ulLength;
+   sKey.ulSkip = Path_getStrLength(oNdParent->oPPath) + 1;
+#if defined(NODED_BTREE)
+   if(bFiles)
+      (void)NodeD_bsearchChildren(poCChildren, &sKey, &ulChildID,
+            (int (*)(const void*,const void*)) NodeD_compareFileName);
+   else
+      (void)NodeD_bsearchChildren(poCChildren, &sKey, &ulChildID,
+            (int (*)(const void*,const void*)) NodeD_compareDirName);
+#else
+   apvChildren = NodeD_getChildArray(poCChildren, &ulCount);
+   if(bFiles)
+      (void)NodeD_searchFileName(apvChildren, ulCount, &sKey,
+                                 &ulChildID);
+   else
+      (void)NodeD_searchDirName(apvChildren, ulCount, &sKey,
+                                &ulChildID);
+#endif
+   return ulChildID;
+#endif
+}
+
+/*
+  Unlinks the child of oNdParent with path oPPath, which must be in
+  *poCChildren, its children that are files if bFiles and directories
+  if not.
+*/
+static void NodeD_unlinkChild(NodeD_T oNdParent, Children_T *poCChildren,
+                              Path_T oPPath, boolean bFiles) {
+   size_t ulChildID;
+   boolean bFound;
+
+   assert(oNdParent != NULL);
+   assert(oPPath != NULL);
+
+   bFound = NodeD_findChild(oNdParent, poCChildren,
+                            Path_getPathname(oPPath),
+                            Path_getStrLength(oPPath), bFiles,
+                            &ulChildID);
+   assert(bFound);
+   (void)bFound;
+   (void)NodeD_removeChild(oNdParent, poCChildren, ulChildID);
+}
+
+#if defined(NODED_TREE)
+/* Returns the path of child pvChild, a file if bFiles. */
+static Path_T NodeD_getChildPath(void *pvChild, boolean bFiles) {
+   assert(pvChild != NULL);
+
+   if(bFiles)
+      return NodeF_getPath(pvChild);
+   return ((NodeD_T)pvChild)->oPPath;
+}
+
+/*
+  Links the ulCount new children in apvChildren into *poCChildren, 
+  the children of oNdParent that are files if bFiles and directories 
+  if not, one at a time. Returns SUCCESS, or MEMORY_ERROR (leaving 
+  them unchanged) if allocation fails.
+*/
+static int NodeD_insertChildren(NodeD_T oNdParent, Children_T *poCChildren,
+                                void **apvChildren, size_t ulCount,
+                                boolean bFiles) {
+   Path_T oPPath;
+   size_t ulChildID;
+   size_t i;
+
+   assert(oNdParent != NULL);
+   assert(apvChildren != NULL || ulCount == 0);
+
+   /* each insertion is logarithmic, so no merge is needed */
+   for(i = 0; i < ulCount; i++) {
+      oPPath = NodeD_getChildPath(apvChildren[i], bFiles);
+      (void)NodeD_findChild(oNdParent, poCChildren,
+                            Path_getPathname(oPPath),
+                            Path_getStrLength(oPPath), bFiles,
+                            &ulChildID);
+      if(NodeD_insertChild(oNdParent, poCChildren, ulChildID,
+                           apvChildren[i]) != SUCCESS) {
+         while(i-- > 0)
+            NodeD_unlinkChild(oNdParent, poCChildren,
+                  NodeD_getChildPath(apvChildren[i], bFiles), bFiles);
+         return MEMORY_ERROR;
+      }
+   }
+   return SUCCESS;
+}
+#endif
+
 /* ================================================================== */
 /*
   Links new directory child oNdChild into oNdParent's directory 
@@ -40,55 +859,87 @@ static int NodeD_addDirChild(NodeD_T oNdParent, NodeD_T oNdChild,
     assert(oNdChild != NULL);
 
    /* insert into directory children array at user-given index */
-    if(DynArray_addAt(oNdParent->oDDirChildren, ulIndex, oNdChild))
-        return SUCCESS;
-    else
-        return MEMORY_ERROR;
+    return NodeD_insertChild(oNdParent, &oNdParent->oCDirChildren,
+                             ulIndex, oNdChild);
 }
 
-/* Removes and frees all file children from oNdNode. */
-static void NodeD_removeFileChildren(NodeD_T oNdNode){
-   size_t numFileChildren;
-   size_t numFileChildren2;
+/* Frees file node pvChild; pvExtra is unused. */
+static void NodeD_freeFileChild(void *pvChild, void *pvExtra) {
+   assert(pvChild != NULL);
 
+   (void)pvExtra;
+   NodeF_free(pvChild);
+}
+
+/* Frees all file children of oNdNode and its file children array. */
+static void NodeD_removeFileChildren(NodeD_T oNdNode){
    assert(oNdNode != NULL);
 
-   /* Get number of file children initially, copy used for safety 
-   checks */
-   numFileChildren = NodeD_getNumFileChildren(oNdNode);
-   numFileChildren2 = NodeD_getNumFileChildren(oNdNode);
-   /* Loop thru array of file children and remove/free them */
-   while(numFileChildren != 0) {
-      /* free memory and remove from dynarray */
-      NodeF_free(DynArray_get(oNdNode->oDFileChildren,0));
-      (void)DynArray_removeAt(oNdNode->oDFileChildren,0);
-
-      /* check that a file child was actually removed*/
-      numFileChildren2 -= 1;
-      numFileChildren = NodeD_getNumFileChildren(oNdNode);
-      assert(numFileChildren == numFileChildren2);
-   }
+   /* the array goes too, so there is no need to close the gaps */
+   NodeD_mapChildren(&oNdNode->oCFileChildren, NodeD_freeFileChild,
+                     NULL);
    /* Free array of file children */
-   DynArray_free(oNdNode->oDFileChildren);  
+   NodeD_freeChildren(&oNdNode->oCFileChildren);
 }
 
+/*
+  Frees oNdNode alone: its file children, its children arrays and
+  index, its path and itself, removing them from the name index.
+*/
+static void NodeD_freeNode(NodeD_T oNdNode) {
+   assert(oNdNode != NULL);
+
+   NodeD_freeChildren(&oNdNode->oCDirChildren);
+   NodeD_removeFileChildren(oNdNode);
+   ChildIndex_free(oNdNode->oIndex);
+
+   /* remove from the name index and remove path */
+   if(oNdNode->oNameEntry != NULL)
+      NameIndex_remove(oNdNode->oNameEntry);
+   Path_free(oNdNode->oPPath);
+
+   /* finally, free the struct node */
+   free(oNdNode);
+}
 
 /*
-  Compares the string representation of a directory node oNdNode1 with 
-  a string pcSecond representing a directory node's path.
-  Returns <0, 0, or >0 if oNdNode1 is "less than", "equal to", or
-  "greater than" pcSecond, respectively.
+  Frees the subtree rooted at oNdNode, which need not be unlinked 
+  from its parent. Returns the number of directories freed.
 */
-static int NodeD_compareString(const NodeD_T oNdNode1,
-                                 const char *pcSecond) {
-   assert(oNdNode1 != NULL);
-   assert(pcSecond != NULL);
+static size_t NodeD_freeSubtree(NodeD_T oNdNode);
 
-   return Path_compareString(oNdNode1->oPPath, pcSecond);
+/*
+  Frees the subtree rooted at directory node pvChild, adding the number
+  of directories freed to *(size_t *)pvExtra.
+*/
+static void NodeD_freeDirChild(void *pvChild, void *pvExtra) {
+   assert(pvChild != NULL);
+   assert(pvExtra != NULL);
+
+   *(size_t *)pvExtra += NodeD_freeSubtree(pvChild);
 }
 
+static size_t NodeD_freeSubtree(NodeD_T oNdNode) {
+   size_t ulCount = 1;
+
+   assert(oNdNode != NULL);
+
+   /* the children are freed before the array listing them */
+   NodeD_mapChildren(&oNdNode->oCDirChildren, NodeD_freeDirChild,
+                     &ulCount);
+   NodeD_freeNode(oNdNode);
+   return ulCount;
+}
+
+
 /* ================================================================== */
-int NodeD_new(Path_T oPPath, NodeD_T oNdParent, NodeD_T *poNdResult) {
+/*
+  Creates a new directory node as NodeD_new does, linking it into 
+  oNdParent's directory children array only if bLink, in which case 
+  the array is also checked for a child with the same path.
+*/
+static int NodeD_create(Path_T oPPath, NodeD_T oNdParent, boolean bLink,
+                        NodeD_T *poNdResult) {
    struct nodeD *psdNew;
    Path_T oPParentPath = NULL;
    Path_T oPNewPath = NULL;
@@ -142,7 +993,7 @@ int NodeD_new(Path_T oPPath, NodeD_T oNdParent, NodeD_T *poNdResult) {
       }
 
       /* parent must not already have child with this path */
-      if(NodeD_hasDirChild(oNdParent, oPPath, &ulIndex)) {
+      if(bLink && NodeD_hasDirChild(oNdParent, oPPath, &ulIndex)) {
          Path_free(psdNew->oPPath);
          free(psdNew);
          *poNdResult = NULL;
@@ -161,21 +1012,45 @@ int NodeD_new(Path_T oPPath, NodeD_T oNdParent, NodeD_T *poNdResult) {
    }
    /* parent of root is NULL */
    psdNew->oNdParent = oNdParent;
+   psdNew->oIndex = NULL;
 
    /* initialize the new node */
-   psdNew->oDFileChildren = DynArray_new(0);
-   psdNew->oDDirChildren = DynArray_new(0);
-   if(psdNew->oDFileChildren == NULL || psdNew->oDDirChildren == NULL) {
+   iStatus = NodeD_initChildren(psdNew, &psdNew->oCFileChildren, TRUE);
+   if(iStatus == SUCCESS) {
+      iStatus = NodeD_initChildren(psdNew, &psdNew->oCDirChildren, FALSE);
+      if(iStatus != SUCCESS)
+         NodeD_freeChildren(&psdNew->oCFileChildren);
+   }
+   if(iStatus != SUCCESS) {
       Path_free(psdNew->oPPath);
       free(psdNew);
       *poNdResult = NULL;
       return MEMORY_ERROR;
    }
 
+   /* index the new node by name if the tree is indexed */
+   psdNew->oNameEntry = NULL;
+   if(NameIndex_isEnabled()) {
+      iStatus = NameIndex_add(psdNew->oPPath, FALSE, psdNew,
+                              &psdNew->oNameEntry);
+      if(iStatus != SUCCESS) {
+         NodeD_freeChildren(&psdNew->oCFileChildren);
+         NodeD_freeChildren(&psdNew->oCDirChildren);
+         Path_free(psdNew->oPPath);
+         free(psdNew);
+         *poNdResult = NULL;
+         return iStatus;
+      }
+   }
+
    /* Link into parent's children list */
-   if(oNdParent != NULL) {
+   if(oNdParent != NULL && bLink) {
       iStatus = NodeD_addDirChild(oNdParent, psdNew, ulIndex);
       if(iStatus != SUCCESS) {
+         if(psdNew->oNameEntry != NULL)
+            NameIndex_remove(psdNew->oNameEntry);
+         NodeD_freeChildren(&psdNew->oCFileChildren);
+         NodeD_freeChildren(&psdNew->oCDirChildren);
          Path_free(psdNew->oPPath);
          free(psdNew);
          *poNdResult = NULL;
@@ -188,59 +1063,219 @@ int NodeD_new(Path_T oPPath, NodeD_T oNdParent, NodeD_T *poNdResult) {
    return SUCCESS;
 }
 
+/* ================================================================== */
+int NodeD_new(Path_T oPPath, NodeD_T oNdParent, NodeD_T *poNdResult) {
+   assert(oPPath != NULL);
+   assert(poNdResult != NULL);
+
+   return NodeD_create(oPPath, oNdParent, TRUE, poNdResult);
+}
+
+/* ================================================================== */
+int NodeD_newUnlinked(Path_T oPPath, NodeD_T oNdParent,
+                      NodeD_T *poNdResult) {
+   assert(oPPath != NULL);
+   assert(oNdParent != NULL);
+   assert(poNdResult != NULL);
+
+   return NodeD_create(oPPath, oNdParent, FALSE, poNdResult);
+}
+
+/* ================================================================== */
+int NodeD_appendDirChildren(NodeD_T oNdParent, NodeD_T *aoNdChildren,
+                            size_t ulCount) {
+#if defined(NODED_TREE)
+   assert(oNdParent != NULL);
+   assert(aoNdChildren != NULL || ulCount == 0);
+
+   return NodeD_insertChildren(oNdParent, &oNdParent->oCDirChildren,
+                               (void **)aoNdChildren, ulCount, FALSE);
+#else
+   size_t ulOld;
+   size_t i;
+
+   assert(oNdParent != NULL);
+   assert(aoNdChildren != NULL || ulCount == 0);
+
+   ulOld = NodeD_countChildren(&oNdParent->oCDirChildren);
+   if(NodeD_growChildren(oNdParent, &oNdParent->oCDirChildren, ulCount)
+      != SUCCESS)
+      return MEMORY_ERROR;
+   for(i = 0; i < ulCount; i++) {
+      assert(aoNdChildren[i]->oNdParent == oNdParent);
+      assert(ulOld + i == 0 ||
+             NodeD_compare(NodeD_getChild(&oNdParent->oCDirChildren,
+                                          ulOld + i - 1),
+                           aoNdChildren[i]) < 0);
+      NodeD_setChild(&oNdParent->oCDirChildren, ulOld + i,
+                     aoNdChildren[i]);
+   }
+   NodeD_layOutChildren(&oNdParent->oCDirChildren);
+   NodeD_indexChildren(oNdParent, (void **)aoNdChildren, ulCount,
+                       FALSE);
+   return SUCCESS;
+#endif
+}
+
 /* ================================================================== */
 int NodeD_addFileChild(NodeD_T oNdParent, NodeF_T oNfChild, size_t 
 ulIndex) {
    assert(oNdParent != NULL);
    assert(oNfChild != NULL);
 
-   if (DynArray_addAt(oNdParent->oDFileChildren, ulIndex, oNfChild))
-      return SUCCESS;
-   else
+   return NodeD_insertChild(oNdParent, &oNdParent->oCFileChildren,
+                            ulIndex, oNfChild);
+}
+
+/* ================================================================== */
+int NodeD_addFileChildren(NodeD_T oNdParent, NodeF_T *aoNfChildren,
+                          size_t ulCount) {
+#if defined(NODED_TREE)
+   assert(oNdParent != NULL);
+   assert(aoNfChildren != NULL || ulCount == 0);
+
+   return NodeD_insertChildren(oNdParent, &oNdParent->oCFileChildren,
+                               (void **)aoNfChildren, ulCount, TRUE);
+#else
+   size_t ulOld;  /* Number of file children before the merge */
+   size_t ulRead; /* Number of old children not yet placed */
+   size_t ulNext; /* Number of new children not yet placed */
+   size_t ulWrite; /* Slot to place the next child in */
+   NodeF_T oNfOld;
+
+   assert(oNdParent != NULL);
+   assert(aoNfChildren != NULL || ulCount == 0);
+
+   /* make room at the end for all of the new children at once */
+   ulOld = NodeD_countChildren(&oNdParent->oCFileChildren);
+   if(NodeD_growChildren(oNdParent, &oNdParent->oCFileChildren, ulCount)
+      != SUCCESS)
       return MEMORY_ERROR;
+
+   /* merge from the back, so that each old child moves only once */
+   ulRead = ulOld;
+   ulNext = ulCount;
+   ulWrite = ulOld + ulCount;
+   while(ulNext > 0) {
+      ulWrite--;
+      oNfOld = (ulRead > 0) ? NodeD_getChild(&oNdParent->oCFileChildren,
+                                             ulRead - 1)
+                            : NULL;
+      if(oNfOld != NULL &&
+         NodeF_compare(oNfOld, aoNfChildren[ulNext - 1]) > 0) {
+         NodeD_setChild(&oNdParent->oCFileChildren, ulWrite, oNfOld);
+         ulRead--;
+      }
+      else {
+         NodeD_setChild(&oNdParent->oCFileChildren, ulWrite,
+                        aoNfChildren[ulNext - 1]);
+         ulNext--;
+      }
+   }
+   NodeD_layOutChildren(&oNdParent->oCFileChildren);
+   NodeD_indexChildren(oNdParent, (void **)aoNfChildren, ulCount, TRUE);
+
+   return SUCCESS;
+#endif
+}
+
+/* ================================================================== */
+void NodeD_removeFileChild(NodeD_T oNdParent, size_t ulIndex) {
+   assert(oNdParent != NULL);
+   assert(ulIndex < NodeD_getNumFileChildren(oNdParent));
+
+   NodeF_free(NodeD_removeChild(oNdParent, &oNdParent->oCFileChildren,
+                                ulIndex));
+}
+
+/* ================================================================== */
+void NodeD_removeFileChildrenAt(NodeD_T oNdParent,
+                                const size_t *aulIndices,
+                                size_t ulCount) {
+#if defined(NODED_TREE)
+   assert(oNdParent != NULL);
+   assert(aulIndices != NULL || ulCount == 0);
+
+   /* removing from the last keeps the other identifiers valid */
+   while(ulCount > 0) {
+      ulCount--;
+      assert(ulCount == 0 || aulIndices[ulCount - 1] < aulIndices[ulCount]);
+      NodeF_free(NodeD_removeChild(oNdParent,
+                                   &oNdParent->oCFileChildren,
+                                   aulIndices[ulCount]));
+   }
+#else
+   size_t ulLength; /* Number of file children before removal */
+   size_t ulWrite;  /* Slot to move the next kept child to */
+   size_t ulNext = 0; /* Number of removed children passed */
+   NodeF_T oNfChild;
+   size_t i;
+
+   assert(oNdParent != NULL);
+   assert(aulIndices != NULL || ulCount == 0);
+
+   if(ulCount == 0)
+      return;
+
+   /* free the removed children and close the gaps in one pass */
+   ulLength = NodeD_countChildren(&oNdParent->oCFileChildren);
+   ulWrite = aulIndices[0];
+   for(i = aulIndices[0]; i < ulLength; i++) {
+      if(ulNext < ulCount && aulIndices[ulNext] == i) {
+         assert(ulNext == 0 || aulIndices[ulNext - 1] < i);
+         oNfChild = NodeD_getChild(&oNdParent->oCFileChildren, i);
+         NodeD_unindexChild(oNdParent, oNfChild, TRUE);
+         NodeF_free(oNfChild);
+         ulNext++;
+      }
+      else {
+         NodeD_setChild(&oNdParent->oCFileChildren, ulWrite,
+                        NodeD_getChild(&oNdParent->oCFileChildren, i));
+         ulWrite++;
+      }
+   }
+   assert(ulNext == ulCount);
+
+   NodeD_shrinkChildren(&oNdParent->oCFileChildren, ulLength - ulWrite);
+   NodeD_layOutChildren(&oNdParent->oCFileChildren);
+#endif
 }
 
 /* ================================================================== */
 size_t NodeD_free(NodeD_T oNdNode) {
-   size_t ulIndex;
-   size_t ulCount = 0;
+   assert(oNdNode != NULL);
+
+   NodeD_detach(oNdNode);
+   return NodeD_freeSubtree(oNdNode);
+}
 
+/* ================================================================== */
+size_t NodeD_freeUnlinked(NodeD_T oNdNode) {
+   assert(oNdNode != NULL);
+
+   /* the parent never held it, so there is nothing to unlink */
+   oNdNode->oNdParent = NULL;
+   return NodeD_freeSubtree(oNdNode);
+}
+
+/* ================================================================== */
+void NodeD_detach(NodeD_T oNdNode) {
    assert(oNdNode != NULL);
 
    /* remove from parent's list */
    if(oNdNode->oNdParent != NULL) {
-      /* Search for directory in parent's directory children array and 
-      sets index in the array */
-      if(DynArray_bsearch(
-            oNdNode->oNdParent->oDDirChildren,
-            oNdNode, &ulIndex,
-            (int (*)(const void *, const void *)) NodeD_compare)) {
-               /* Remove in the parent's directory children array at 
-               the index found */
-               (void) DynArray_removeAt
-               (oNdNode->oNdParent->oDDirChildren,
-                                  ulIndex);
-            }
-   }
-
-   /* Recursively remove directory children */
-   while(DynArray_getLength(oNdNode->oDDirChildren) != 0) {
-      /* Increment counter of directories removed */
-      ulCount += NodeD_free(DynArray_get(oNdNode->oDDirChildren, 0));
-   }
-   /* free the node's children */
-   DynArray_free(oNdNode->oDDirChildren);
-
-   /* Removes and frees file children (hence no free after) */
-   NodeD_removeFileChildren(oNdNode);
+      NodeD_unlinkChild(oNdNode->oNdParent,
+                        &oNdNode->oNdParent->oCDirChildren,
+                        oNdNode->oPPath, FALSE);
+      oNdNode->oNdParent = NULL;
+   }
+}
 
-   /* remove path */
-   Path_free(oNdNode->oPPath);
+/* ================================================================== */
+void NodeD_freeShallow(NodeD_T oNdNode) {
+   assert(oNdNode != NULL);
 
-   /* finally, free the struct node */
-   free(oNdNode);
-   ulCount++;
-   return ulCount;
+   NodeD_freeNode(oNdNode);
 }
 
 /* ================================================================== */
@@ -257,12 +1292,10 @@ boolean NodeD_hasDirChild(NodeD_T oNdParent, Path_T oPPath,
    assert(oPPath != NULL);
    assert(pulChildID != NULL);
 
-   /* returns results of binary search of directory child array, 
-   *pulChildID is the index into oNdParent->oDDirChildren, gets set by 
-   DynArray_bsearch */
-   return (DynArray_bsearch(oNdParent->oDDirChildren,
-            (char*) Path_getPathname(oPPath), pulChildID,
-            (int (*)(const void*,const void*)) NodeD_compareString));
+   /* *pulChildID is the index into oNdParent->oCDirChildren */
+   return NodeD_findChild(oNdParent, &oNdParent->oCDirChildren,
+                          Path_getPathname(oPPath),
+                          Path_getStrLength(oPPath), FALSE, pulChildID);
 }
 
 /* ================================================================== */
@@ -272,12 +1305,122 @@ boolean NodeD_hasFileChild(NodeD_T oNdParent, Path_T oPPath,
    assert(oPPath != NULL);
    assert(pulChildID != NULL);
 
-   /* returns results of binary search of file child array, *pulChildID 
-   is the index into oNdParent->oDFileChildren, gets set by 
-   DynArray_bsearch */
-   return (DynArray_bsearch(oNdParent->oDFileChildren,
-            (char*) Path_getPathname(oPPath), pulChildID,
-            (int (*)(const void*,const void*)) NodeF_compareString));
+   /* *pulChildID is the index into oNdParent->oCFileChildren */
+   return NodeD_findChild(oNdParent, &oNdParent->oCFileChildren,
+                          Path_getPathname(oPPath),
+                          Path_getStrLength(oPPath), TRUE, pulChildID);
+}
+
+/* ================================================================== */
+boolean NodeD_findDirChild(NodeD_T oNdParent, const char *pcPath,
+                           size_t ulLength, size_t *pulChildID) {
+   assert(oNdParent != NULL);
+   assert(pcPath != NULL);
+   assert(pulChildID != NULL);
+
+   return NodeD_findChild(oNdParent, &oNdParent->oCDirChildren, pcPath,
+                          ulLength, FALSE, pulChildID);
+}
+
+/* ================================================================== */
+boolean NodeD_findFileChild(NodeD_T oNdParent, const char *pcPath,
+                            size_t ulLength, size_t *pulChildID) {
+   assert(oNdParent != NULL);
+   assert(pcPath != NULL);
+   assert(pulChildID != NULL);
+
+   return NodeD_findChild(oNdParent, &oNdParent->oCFileChildren, pcPath,
+                          ulLength, TRUE, pulChildID);
+}
+
+/* ================================================================== */
+boolean NodeD_lookupChild(NodeD_T oNdParent, const char *pcPath,
+                          size_t ulLength, NodeD_T *poNdChild,
+                          NodeF_T *poNfChild) {
+   size_t ulSkip;
+   size_t ulChildID;
+   boolean bIsFile;
+   void *pvChild;
+
+   assert(oNdParent != NULL);
+   assert(pcPath != NULL);
+   assert(poNdChild != NULL);
+   assert(poNfChild != NULL);
+
+   *poNdChild = NULL;
+   *poNfChild = NULL;
+
+   /* one probe finds a child of either kind */
+   if(oNdParent->oIndex != NULL) {
+      ulSkip = Path_getStrLength(oNdParent->oPPath) + 1;
+      if(ulLength < ulSkip)
+         return FALSE;
+      pvChild = ChildIndex_find(oNdParent->oIndex, pcPath + ulSkip,
+                                ulLength - ulSkip, &bIsFile);
+      if(pvChild == NULL)
+         return FALSE;
+      if(bIsFile)
+         *poNfChild = pvChild;
+      else
+         *poNdChild = pvChild;
+      return TRUE;
+   }
+
+   /* otherwise the directories are searched first, as paths name
+      them more often */
+   if(NodeD_findChild(oNdParent, &oNdParent->oCDirChildren, pcPath,
+                      ulLength, FALSE, &ulChildID)) {
+      *poNdChild = NodeD_getChild(&oNdParent->oCDirChildren, ulChildID);
+      return TRUE;
+   }
+   if(NodeD_findChild(oNdParent, &oNdParent->oCFileChildren, pcPath,
+                      ulLength, TRUE, &ulChildID)) {
+      *poNfChild = NodeD_getChild(&oNdParent->oCFileChildren, ulChildID);
+      return TRUE;
+   }
+   return FALSE;
+}
+
+/* ================================================================== */
+size_t NodeD_seekDirChildren(NodeD_T oNdParent, const char *pcName,
+                             size_t ulLength) {
+   assert(oNdParent != NULL);
+   assert(pcName != NULL);
+
+   return NodeD_seekChildren(oNdParent, &oNdParent->oCDirChildren,
+                             pcName, ulLength, FALSE);
+}
+
+/* ================================================================== */
+size_t NodeD_seekFileChildren(NodeD_T oNdParent, const char *pcName,
+                              size_t ulLength) {
+   assert(oNdParent != NULL);
+   assert(pcName != NULL);
+
+   return NodeD_seekChildren(oNdParent, &oNdParent->oCFileChildren,
+                             pcName, ulLength, TRUE);
+}
+
+/* ================================================================== */
+void NodeD_prefetch(NodeD_T oNdNode) {
+   assert(oNdNode != NULL);
+
+   NODED_PREFETCH(oNdNode);
+}
+
+/* ================================================================== */
+void NodeD_prefetchChildren(NodeD_T oNdNode) {
+   assert(oNdNode != NULL);
+
+#if defined(NODED_TREE)
+   NODED_PREFETCH(oNdNode->oCDirChildren);
+   NODED_PREFETCH(oNdNode->oCFileChildren);
+#else
+   /* inline children are already cached with the node */
+   NODED_PREFETCH(oNdNode->oCDirChildren.oDSpill);
+   NODED_PREFETCH(oNdNode->oCFileChildren.oDSpill);
+#endif
+   NODED_PREFETCH(oNdNode->oPPath);
 }
 
 /* ================================================================== */
@@ -285,7 +1428,7 @@ size_t NodeD_getNumDirChildren(NodeD_T oNdParent) {
    assert(oNdParent != NULL);
 
    /* length of file child array */
-   return DynArray_getLength(oNdParent->oDDirChildren);
+   return NodeD_countChildren(&oNdParent->oCDirChildren);
 }
 
 /* ================================================================== */
@@ -293,7 +1436,7 @@ size_t NodeD_getNumFileChildren(NodeD_T oNdParent) {
    assert(oNdParent != NULL);
 
    /* length of file child array */
-   return DynArray_getLength(oNdParent->oDFileChildren);
+   return NodeD_countChildren(&oNdParent->oCFileChildren);
 }
 
 /* ================================================================== */
@@ -303,14 +1446,15 @@ int  NodeD_getDirChild(NodeD_T oNdParent, size_t ulChildID,
    assert(oNdParent != NULL);
    assert(poNdResult != NULL);
 
-   /* ulChildID is the index into oNdParent->oDDirChildren */
+   /* ulChildID is the index into oNdParent->oCDirChildren */
    if(ulChildID >= NodeD_getNumDirChildren(oNdParent)) {
       *poNdResult = NULL;
       return NO_SUCH_PATH;
    }
    else {
     /* Check where it exists (which array) then store in poNdResult */
-      *poNdResult = DynArray_get(oNdParent->oDDirChildren, ulChildID);
+      *poNdResult = NodeD_getChild(&oNdParent->oCDirChildren,
+                                   ulChildID);
       return SUCCESS;
    }
 }
@@ -322,14 +1466,15 @@ int  NodeD_getFileChild(NodeD_T oNdParent, size_t ulChildID,
    assert(oNdParent != NULL);
    assert(poNfResult != NULL);
 
-   /* ulChildID is the index into oNdParent->oDFileChildren */
+   /* ulChildID is the index into oNdParent->oCFileChildren */
    if(ulChildID >= NodeD_getNumFileChildren(oNdParent)) {
       *poNfResult = NULL;
       return NO_SUCH_PATH;
    }
    else {
     /* Check where it exists (which array) then store in poNfResult */
-      *poNfResult = DynArray_get(oNdParent->oDFileChildren, ulChildID);
+      *poNfResult = NodeD_getChild(&oNdParent->oCFileChildren,
+                                   ulChildID);
       return SUCCESS;
    }
 }
@@ -349,59 +1494,79 @@ int NodeD_compare(NodeD_T oNdNode1, NodeD_T oNdNode2) {
    return Path_comparePath(oNdNode1->oPPath, oNdNode2->oPPath);
 }
 
+/*
+  Adds the length of the line for file node pvChild in a string
+  representation to *(size_t *)pvExtra.
+*/
+static void NodeD_measureFileChild(void *pvChild, void *pvExtra) {
+   assert(pvChild != NULL);
+   assert(pvExtra != NULL);
+
+   *(size_t *)pvExtra += Path_getStrLength(NodeF_getPath(pvChild)) + 1;
+}
+
+/*
+  Writes the line for file node pvChild in a string representation to
+  *(char **)pvExtra and advances it past the line.
+*/
+static void NodeD_writeFileChild(void *pvChild, void *pvExtra) {
+   Path_T oPPath; /* Path of the file child */
+   size_t ulLength; /* Length of the path being copied */
+   char **ppcDest = pvExtra;
+
+   assert(pvChild != NULL);
+   assert(ppcDest != NULL);
+
+   oPPath = NodeF_getPath(pvChild);
+   ulLength = Path_getStrLength(oPPath);
+   memcpy(*ppcDest, Path_getPathname(oPPath), ulLength);
+   *ppcDest += ulLength;
+   *(*ppcDest)++ = '\n';
+}
+
 /* ================================================================== */
-char *NodeD_toString(NodeD_T oNdNode) {
-   char *pcResult;  /* Resulting string representation to be returned */
-   size_t totalStrlen; /* Total string length of pcResult */
-   size_t i;   /* Index to iterate thru file children */
-   size_t numFileChildren; /* Number of file children of directory */
-   NodeF_T oNfChild; /* File child of oNdNode*/
+size_t NodeD_getStringLength(NodeD_T oNdNode) {
+   size_t ulLength; /* Total string length of the representation */
 
    assert(oNdNode != NULL);
 
-   totalStrlen = Path_getStrLength(NodeD_getPath(oNdNode)) + 1;
+   ulLength = Path_getStrLength(oNdNode->oPPath) + 1;
+   NodeD_mapChildren(&oNdNode->oCFileChildren, NodeD_measureFileChild,
+                     &ulLength);
+   return ulLength;
+}
 
-   /* Find out how many characters will be in pcResult */
-   numFileChildren = NodeD_getNumFileChildren(oNdNode);
-   for (i = 0; i < numFileChildren; i++) {
-      oNfChild = DynArray_get(oNdNode->oDFileChildren,i);
-      totalStrlen += Path_getStrLength(NodeF_getPath(oNfChild)) + 1;
-   }
+/* ================================================================== */
+char *NodeD_writeString(NodeD_T oNdNode, char *pcDest) {
+   size_t ulLength; /* Length of the path being copied */
+
+   assert(oNdNode != NULL);
+   assert(pcDest != NULL);
+
+   /* Copy oNdNode directory path name to pcDest */
+   ulLength = Path_getStrLength(oNdNode->oPPath);
+   memcpy(pcDest, Path_getPathname(oNdNode->oPPath), ulLength);
+   pcDest += ulLength;
+   *pcDest++ = '\n';
+
+   /* Copy child file path names after it */
+   NodeD_mapChildren(&oNdNode->oCFileChildren, NodeD_writeFileChild,
+                     &pcDest);
+   return pcDest;
+}
+
+/* ================================================================== */
+char *NodeD_toString(NodeD_T oNdNode) {
+   char *pcResult;  /* Resulting string representation to be returned */
+
+   assert(oNdNode != NULL);
 
    /* Allocate mem and check if enough mem */
-   pcResult = malloc(totalStrlen + 1);
+   pcResult = malloc(NodeD_getStringLength(oNdNode) + 1);
    if (pcResult == NULL) {
       return NULL;
    }
-   
-   *pcResult = '\0';
-
-   /* Concatenate oNdNode directory path name onto pcResult */
-   strcat(pcResult, Path_getPathname(NodeD_getPath(oNdNode)));
-   strcat(pcResult,"\n");
-
-   /* Concatenate child file path names onto pcResult */
-   for (i = 0; i < numFileChildren; i++) {
-      oNfChild = DynArray_get(oNdNode->oDFileChildren,i);
-      strcat(pcResult, Path_getPathname(NodeF_getPath(oNfChild)));
-      strcat(pcResult,"\n");
-   }
 
+   *NodeD_writeString(oNdNode, pcResult) = '\0';
    return pcResult;
 }
-
-/* Returns the dynarray object representing the children of oNdNode 
-that are files */
-DynArray_T NodeD_getFileChildren(NodeD_T oNdNode) {
-   assert(oNdNode != NULL);
-
-   return oNdNode->oDFileChildren;
-}
-
-/* Returns the dynarray object representing the children of oNdNode 
-that are directories */
-DynArray_T NodeD_getDirChildren(NodeD_T oNdNode) {
-   assert(oNdNode != NULL);
-
-   return oNdNode->oDDirChildren;
-}
\ No newline at end of file
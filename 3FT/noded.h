@@ -17,7 +17,8 @@ typedef struct nodeD *NodeD_T;
 
 /*
   Creates a new directory node in Directory Tree, with path oPPath and
-  parent oNdParent. Returns an int SUCCESS status and sets *poNdResult
+  parent oNdParent, indexing it by name if the name index is enabled.
+  Returns an int SUCCESS status and sets *poNdResult
   to be the new node if successful. Otherwise, sets *poNdResult to NULL
   and returns status:
   * MEMORY_ERROR if memory could not be allocated to complete request
@@ -29,18 +30,90 @@ typedef struct nodeD *NodeD_T;
 */
 int NodeD_new(Path_T oPPath, NodeD_T oNdParent, NodeD_T *poNdResult);
 
+/*
+  Creates a new directory node with path oPPath and parent oNdParent 
+  as NodeD_new does, but without linking it into oNdParent's 
+  directory children array, which is not read either, so that 
+  subtrees can be built under the same parent concurrently and linked
+  later with NodeD_appendDirChildren. Returns as NodeD_new does, 
+  except for ALREADY_IN_TREE, which is not checked.
+*/
+int NodeD_newUnlinked(Path_T oPPath, NodeD_T oNdParent,
+                      NodeD_T *poNdResult);
+
+/*
+  Links the ulCount unlinked directory children of oNdParent in 
+  aoNdChildren, which must be sorted by path and sort after its 
+  current directory children, at the end of oNdParent's directory 
+  children array. Returns SUCCESS, or MEMORY_ERROR (leaving the array
+  unchanged) if allocation fails.
+*/
+int NodeD_appendDirChildren(NodeD_T oNdParent, NodeD_T *aoNdChildren,
+                            size_t ulCount);
+
 /*
   Destroys and frees all memory allocated for the subtree rooted at
-  oNdNode, i.e., deletes this directory and all its descendents. 
+  oNdNode, i.e., deletes this directory and all its descendents, and
+  removes them from the name index.
   Returns the number of directories (exluding files) deleted.
 */
 size_t NodeD_free(NodeD_T oNdNode);
 
+/*
+  Frees the subtree rooted at oNdNode as NodeD_free does, for a
+  directory created with NodeD_newUnlinked and never linked into its
+  parent's directory children array, which is left unchanged.
+  Returns the number of directories (excluding files) deleted.
+*/
+size_t NodeD_freeUnlinked(NodeD_T oNdNode);
+
+/*
+  Unlinks oNdNode from its parent's directory children array, if it 
+  has a parent, so that its subtree can be freed on its own, e.g. one
+  directory at a time with NodeD_freeShallow.
+*/
+void NodeD_detach(NodeD_T oNdNode);
+
+/*
+  Destroys and frees all memory allocated for oNdNode and its file
+  children, removing them from the name index, but not its directory
+  children, which must be freed separately. oNdNode must be detached
+  from its parent, or its parent freed along with it. Different nodes
+  may be freed concurrently if they own no contents and are not in 
+  the name index.
+*/
+void NodeD_freeShallow(NodeD_T oNdNode);
+
 /*
   Links new file child oNfChild into oNdParent's file children array at index ulIndex. Returns SUCCESS if the new directory child was added successfully, or  MEMORY_ERROR if allocation fails adding oNdChild to the directory children array.
 */
 int NodeD_addFileChild(NodeD_T oNdParent, NodeF_T oNfChild, size_t ulIndex);
 
+/*
+  Links the ulCount new file children in aoNfChildren, which must be
+  sorted by path and must not already be children of oNdParent, into
+  oNdParent's file children array in a single merge pass. Returns
+  SUCCESS if the new children were added successfully, or MEMORY_ERROR
+  (leaving the array unchanged) if allocation fails.
+*/
+int NodeD_addFileChildren(NodeD_T oNdParent, NodeF_T *aoNfChildren,
+                          size_t ulCount);
+
+/*
+  Unlinks and frees the file child of oNdParent with identifier
+  ulIndex (as used in NodeD_getFileChild).
+*/
+void NodeD_removeFileChild(NodeD_T oNdParent, size_t ulIndex);
+
+/*
+  Unlinks and frees the ulCount file children of oNdParent whose
+  identifiers are in aulIndices, which must be in increasing order,
+  closing the gaps in the file children array in a single pass.
+*/
+void NodeD_removeFileChildrenAt(NodeD_T oNdParent,
+                                const size_t *aulIndices,
+                                size_t ulCount);
+
 
 /* Returns the path object representing oNdNode's absolute path. */
 Path_T NodeD_getPath(NodeD_T oNdNode);
@@ -68,6 +141,67 @@ boolean NodeD_hasDirChild(NodeD_T oNdParent, Path_T oPPath,
 boolean NodeD_hasFileChild(NodeD_T oNdParent, Path_T oPPath,
                          size_t *pulChildID);
 
+/*
+  Returns TRUE if oNdParent has a child directory whose path is the
+  first ulLength characters of pathname pcPath, and FALSE if it does
+  not, setting *pulChildID as NodeD_hasDirChild does. Unlike
+  NodeD_hasDirChild, no Path_T needs to be made for the prefix.
+*/
+boolean NodeD_findDirChild(NodeD_T oNdParent, const char *pcPath,
+                           size_t ulLength, size_t *pulChildID);
+
+/*
+  Returns TRUE if oNdParent has a child file whose path is the first
+  ulLength characters of pathname pcPath, and FALSE if it does not,
+  setting *pulChildID as NodeD_hasFileChild does.
+*/
+boolean NodeD_findFileChild(NodeD_T oNdParent, const char *pcPath,
+                            size_t ulLength, size_t *pulChildID);
+
+/*
+  Returns TRUE if oNdParent has a child of either kind whose path is
+  the first ulLength characters of pathname pcPath, storing it in
+  *poNdChild if it is a directory and in *poNfChild if it is a file
+  and setting the other to NULL, and FALSE (setting both to NULL) if
+  it does not. Once a directory has enough children, they are indexed
+  by name together, and this takes one search instead of one for each
+  kind.
+*/
+boolean NodeD_lookupChild(NodeD_T oNdParent, const char *pcPath,
+                          size_t ulLength, NodeD_T *poNdChild,
+                          NodeF_T *poNfChild);
+
+/*
+  Returns the identifier of the first directory child of oNdParent
+  whose name (the last component of its path) is not less than the
+  first ulLength characters of pcName, or the number of directory
+  children if there is none. The children whose names start with
+  those characters follow it, one after another.
+*/
+size_t NodeD_seekDirChildren(NodeD_T oNdParent, const char *pcName,
+                             size_t ulLength);
+
+/*
+  Returns the identifier of the first file child of oNdParent whose 
+  name is not less than the first ulLength characters of pcName, as 
+  NodeD_seekDirChildren does for directory children.
+*/
+size_t NodeD_seekFileChildren(NodeD_T oNdParent, const char *pcName,
+                              size_t ulLength);
+
+/*
+  Starts loading oNdNode into the processor's cache without waiting,
+  so that a later use of it does not stall.
+*/
+void NodeD_prefetch(NodeD_T oNdNode);
+
+/*
+  Starts loading what searching oNdNode's children first touches into
+  the processor's cache without waiting. oNdNode itself should already
+  be cached, e.g. by an earlier NodeD_prefetch.
+*/
+void NodeD_prefetchChildren(NodeD_T oNdNode);
+
 /* Returns the number of directory children that oNdParent has. */
 size_t NodeD_getNumDirChildren(NodeD_T oNdParent);
 
@@ -103,6 +237,19 @@ NodeD_T NodeD_getParent(NodeD_T oNdNode);
 */
 int NodeD_compare(NodeD_T oNdNode1, NodeD_T oNdNode2);
 
+/*
+  Returns the length of the string representation of oNdNode, as 
+  NodeD_toString would return it, not counting its '\0'.
+*/
+size_t NodeD_getStringLength(NodeD_T oNdNode);
+
+/*
+  Writes the string representation of oNdNode, without a '\0', to 
+  pcDest, which must have room for NodeD_getStringLength(oNdNode)
+  characters. Returns the address just past the characters written.
+*/
+char *NodeD_writeString(NodeD_T oNdNode, char *pcDest);
+
 /*
   Returns a string representation for oNdNode, or NULL if
   there is an allocation error. String representation includes the file children.
@@ -112,10 +259,4 @@ int NodeD_compare(NodeD_T oNdNode1, NodeD_T oNdNode2);
 */
 char *NodeD_toString(NodeD_T oNdNode);
 
-/* Returns the dynarray object representing the children of oNdNode that are files */
-DynArray_T NodeD_getFileChildren(NodeD_T oNdNode);
-
-/* Returns the dynarray object representing the children of oNdNode that are directories */
-DynArray_T NodeD_getDirChildren(NodeD_T oNdNode);
-
 #endif
@@ -6,7 +6,13 @@
 #include <stdlib.h>
 #include <assert.h>
 #include <string.h>
+#include "dynarray.h"
 #include "nodef.h"
+#include "contentheap.h"
+#include "blobstore.h"
+#include "extents.h"
+#include "backing.h"
+#include "nameindex.h"
 
 /* A file node in a FT */
 struct nodeF {
@@ -18,12 +24,501 @@ struct nodeF {
 
    /* Contents of the file */
    void *pvContents;
+
+   /* TRUE if pvContents is storage owned by the node, FALSE if it is
+      a pointer borrowed from the client */
+   boolean bOwnsContents;
+
+   /* Usable size of the content heap block or backing file extent
+      pvContents points to, or 0 if the owned contents are inline,
+      shared or empty */
+   size_t ulCapacity;
+
+   /* TRUE if pvContents points to an extent of the backing file,
+      FALSE if it points to a content heap block */
+   boolean bMapped;
+
+   /* Offset in the backing file of the extent if bMapped is TRUE */
+   size_t ulOffset;
+
+   /* Blob whose bytes pvContents points to if the owned contents are
+      shared through the blob store, otherwise NULL */
+   Blob_T oBShared;
+
+   /* Chunked storage holding the owned contents if they are stored as
+      extents (in which case pvContents is NULL), otherwise NULL */
+   Extents_T oEChunks;
+
+   /* TRUE if the contents were moved to the backing file to keep
+      within the content budget, and are to be moved back when used */
+   boolean bEvicted;
+
+   /* Reference bit for the clock: TRUE if the contents were used
+      since the clock hand last passed the node */
+   boolean bReferenced;
+
+   /* Number of pins on the node; pinned contents are never moved */
+   size_t ulPins;
+
+   /* Bytes of memory charged to the content budget for the contents;
+      the node is in the clock at slot ulClockSlot iff this is > 0 */
+   size_t ulCharged;
+   size_t ulClockSlot;
+
+   /* The node's entry in the name index, or NULL if not indexed */
+   NameEntry_T oNameEntry;
+
+   /* An owning node is allocated with NODEF_INLINE_MAX extra bytes
+      directly after this struct for inline contents */
 };
 
-/* ================================================================== */
-int NodeF_new(Path_T oPPath, NodeF_T *poNfResult) {
+/* Owned contents of at least this many bytes are stored in the backing
+   file, or 0 if contents are never stored there */
+static size_t ulSpillThreshold;
+
+/* Most bytes of evictable contents to keep in memory, or 0 for no
+   limit */
+static size_t ulContentBudget;
+
+/* Bytes of evictable contents in memory: the sum of ulCharged */
+static size_t ulResidentBytes;
+
+/* Clock of the nodes with evictable contents in memory, or NULL if
+   there are none */
+static DynArray_T oDClock;
+
+/* Slot of oDClock the clock hand is at */
+static size_t ulClockHand;
+
+/*
+  Returns the inline contents area of owning file node oNfNode.
+*/
+static void *NodeF_getInline(NodeF_T oNfNode) {
+   assert(oNfNode != NULL);
+   assert(oNfNode->bOwnsContents);
+
+   return (void *)(oNfNode + 1);
+}
+
+/*
+  Returns the number of bytes of memory that oNfNode's contents take
+  up and that could be freed by moving them to the backing file.
+  Inline, shared and mapped contents take up none.
+*/
+static size_t NodeF_getEvictable(NodeF_T oNfNode) {
+   assert(oNfNode != NULL);
+
+   if(oNfNode->oEChunks != NULL)
+      return (oNfNode->ulLength + EXTENTS_CHUNK_SIZE - 1) /
+             EXTENTS_CHUNK_SIZE * EXTENTS_CHUNK_SIZE;
+   if(oNfNode->ulCapacity != 0 && !oNfNode->bMapped)
+      return oNfNode->ulCapacity;
+   return 0;
+}
+
+/*
+  Removes oNfNode from the clock, if it is there, and stops charging
+  its contents to the content budget.
+*/
+static void NodeF_unclock(NodeF_T oNfNode) {
+   NodeF_T oNfLast;
+   size_t ulLast;
+
+   assert(oNfNode != NULL);
+
+   if(oNfNode->ulCharged == 0)
+      return;
+
+   assert(oDClock != NULL);
+   assert(ulResidentBytes >= oNfNode->ulCharged);
+   ulResidentBytes -= oNfNode->ulCharged;
+   oNfNode->ulCharged = 0;
+
+   /* move the last node of the clock into the vacated slot */
+   ulLast = DynArray_getLength(oDClock) - 1;
+   oNfLast = DynArray_removeAt(oDClock, ulLast);
+   if(oNfLast != oNfNode) {
+      (void)DynArray_set(oDClock, oNfNode->ulClockSlot, oNfLast);
+      oNfLast->ulClockSlot = oNfNode->ulClockSlot;
+   }
+
+   if(ulLast == 0) {
+      DynArray_free(oDClock);
+      oDClock = NULL;
+      ulClockHand = 0;
+   }
+   else if(ulClockHand >= ulLast)
+      ulClockHand = 0;
+}
+
+/*
+  Brings the charge of oNfNode's contents to the content budget up to
+  date, adding oNfNode to the clock if its contents have become
+  evictable and removing it if they no longer are. If there is not
+  enough memory to add oNfNode, its contents are simply not charged
+  and never evicted.
+*/
+static void NodeF_recharge(NodeF_T oNfNode) {
+   size_t ulNew;
+
+   assert(oNfNode != NULL);
+
+   ulNew = NodeF_getEvictable(oNfNode);
+   if(ulNew == 0) {
+      NodeF_unclock(oNfNode);
+      return;
+   }
+
+   if(oNfNode->ulCharged == 0) {
+      if(oDClock == NULL) {
+         oDClock = DynArray_new(0);
+         if(oDClock == NULL)
+            return;
+      }
+      if(!DynArray_add(oDClock, oNfNode)) {
+         if(DynArray_getLength(oDClock) == 0) {
+            DynArray_free(oDClock);
+            oDClock = NULL;
+         }
+         return;
+      }
+      oNfNode->ulClockSlot = DynArray_getLength(oDClock) - 1;
+   }
+
+   ulResidentBytes = ulResidentBytes - oNfNode->ulCharged + ulNew;
+   oNfNode->ulCharged = ulNew;
+}
+
+/*
+  Frees the content heap block owned by oNfNode, if any, and leaves it
+  with empty contents.
+*/
+static void NodeF_releaseContents(NodeF_T oNfNode) {
+   assert(oNfNode != NULL);
+
+   NodeF_unclock(oNfNode);
+   if(oNfNode->ulCapacity != 0) {
+      if(oNfNode->bMapped)
+         Backing_free(oNfNode->ulOffset, oNfNode->ulCapacity);
+      else
+         ContentHeap_free(oNfNode->pvContents, oNfNode->ulCapacity);
+   }
+   if(oNfNode->oBShared != NULL)
+      BlobStore_release(oNfNode->oBShared);
+   if(oNfNode->oEChunks != NULL)
+      Extents_free(oNfNode->oEChunks);
+   oNfNode->pvContents = NULL;
+   oNfNode->ulLength = 0;
+   oNfNode->ulCapacity = 0;
+   oNfNode->bMapped = FALSE;
+   oNfNode->oBShared = NULL;
+   oNfNode->oEChunks = NULL;
+   oNfNode->bEvicted = FALSE;
+}
+
+/*
+  Allocates contiguous storage for at least ulLength bytes of owned
+  contents (ulLength must be > 0): an extent of the backing file if
+  ulLength reaches the spill threshold, otherwise (or if the backing
+  file cannot be extended) a content heap block. Returns SUCCESS and
+  sets *ppvBlock, *pulCapacity, *pbMapped and *pulOffset to describe
+  the storage, or returns MEMORY_ERROR.
+*/
+static int NodeF_allocBlock(size_t ulLength, void **ppvBlock,
+                            size_t *pulCapacity, boolean *pbMapped,
+                            size_t *pulOffset) {
+   assert(ulLength > 0);
+   assert(ppvBlock != NULL);
+   assert(pulCapacity != NULL);
+   assert(pbMapped != NULL);
+   assert(pulOffset != NULL);
+
+   if(ulSpillThreshold != 0 && ulLength >= ulSpillThreshold &&
+      Backing_alloc(ulLength, pulOffset, pulCapacity) == SUCCESS) {
+      *ppvBlock = Backing_getAddress(*pulOffset);
+      *pbMapped = TRUE;
+      return SUCCESS;
+   }
+
+   *ppvBlock = ContentHeap_alloc(ulLength, pulCapacity);
+   if(*ppvBlock == NULL)
+      return MEMORY_ERROR;
+   *pbMapped = FALSE;
+   *pulOffset = 0;
+   return SUCCESS;
+}
+
+/*
+  Returns TRUE if owned contents of ulLength bytes should be kept in
+  the backing file rather than in memory.
+*/
+static boolean NodeF_shouldSpill(size_t ulLength) {
+   return (boolean)(ulSpillThreshold != 0 &&
+                    ulLength >= ulSpillThreshold);
+}
+
+/*
+  Returns the number of bytes that owning file node oNfNode can hold in
+  its current contiguous storage without reallocating, or 0 if that
+  storage is shared and thus must not be written.
+*/
+static size_t NodeF_getRoom(NodeF_T oNfNode) {
+   assert(oNfNode != NULL);
+   assert(oNfNode->oEChunks == NULL);
+
+   if(oNfNode->oBShared != NULL)
+      return 0;
+   if(oNfNode->ulCapacity != 0)
+      return oNfNode->ulCapacity;
+   return NODEF_INLINE_MAX;
+}
+
+/*
+  Returns the writable contiguous storage of owning file node oNfNode:
+  its content heap block if it has one, or else its inline area.
+*/
+static unsigned char *NodeF_getWritable(NodeF_T oNfNode) {
+   assert(oNfNode != NULL);
+   assert(oNfNode->oEChunks == NULL);
+   assert(oNfNode->oBShared == NULL);
+
+   if(oNfNode->ulCapacity != 0)
+      return oNfNode->pvContents;
+   return NodeF_getInline(oNfNode);
+}
+
+/*
+  Moves the chunked contents of oNfNode into contiguous storage.
+  Returns SUCCESS, or MEMORY_ERROR (leaving the contents chunked) if
+  memory could not be allocated to complete request.
+*/
+static int NodeF_flatten(NodeF_T oNfNode) {
+   Extents_T oEChunks;
+   void *pvNew;
+   size_t ulCapacity = 0;
+   boolean bMapped = FALSE;
+   size_t ulOffset = 0;
+   int iStatus;
+
+   assert(oNfNode != NULL);
+   assert(oNfNode->oEChunks != NULL);
+
+   oEChunks = oNfNode->oEChunks;
+   if(oNfNode->ulLength == 0)
+      pvNew = NULL;
+   else if(oNfNode->ulLength <= NODEF_INLINE_MAX)
+      pvNew = NodeF_getInline(oNfNode);
+   else {
+      iStatus = NodeF_allocBlock(oNfNode->ulLength, &pvNew,
+                                 &ulCapacity, &bMapped, &ulOffset);
+      if(iStatus != SUCCESS)
+         return iStatus;
+   }
+
+   (void)Extents_read(oEChunks, 0, pvNew, oNfNode->ulLength);
+   Extents_free(oEChunks);
+
+   oNfNode->oEChunks = NULL;
+   oNfNode->pvContents = pvNew;
+   oNfNode->ulCapacity = ulCapacity;
+   oNfNode->bMapped = bMapped;
+   oNfNode->ulOffset = ulOffset;
+   return SUCCESS;
+}
+
+/*
+  Creates in *poEResult a chunked copy of the contiguous contents of
+  oNfNode. Returns SUCCESS, or MEMORY_ERROR (setting *poEResult to
+  NULL) if memory could not be allocated to complete request.
+*/
+static int NodeF_chunkCopy(NodeF_T oNfNode, Extents_T *poEResult) {
+   assert(oNfNode != NULL);
+   assert(oNfNode->oEChunks == NULL);
+   assert(poEResult != NULL);
+
+   /* a NULL pointer is only ever paired with a zero length */
+   return Extents_new(oNfNode->pvContents, oNfNode->ulLength,
+                      poEResult);
+}
+
+/*
+  Makes the contents of owning file node oNfNode the chunked contents
+  oEChunks, freeing its old contents.
+*/
+static void NodeF_adoptChunks(NodeF_T oNfNode, Extents_T oEChunks) {
+   assert(oNfNode != NULL);
+   assert(oEChunks != NULL);
+
+   NodeF_releaseContents(oNfNode);
+   oNfNode->oEChunks = oEChunks;
+   oNfNode->ulLength = Extents_getLength(oEChunks);
+}
+
+/*
+  Moves the contents of owning file node oNfNode into new contiguous
+  storage for ulNewLength bytes, with room to double, and then writes
+  the ulLength bytes at pvBuf (which may point into the old contents)
+  at byte ulOffset. Bytes between the old end of the contents and
+  ulNewLength that are not written read as zero. ulNewLength must be
+  at least the old length and ulOffset + ulLength.
+  Returns SUCCESS, or MEMORY_ERROR (leaving the contents unchanged) if
+  memory could not be allocated to complete request.
+*/
+static int NodeF_regrow(NodeF_T oNfNode, size_t ulOffset,
+                        const void *pvBuf, size_t ulLength,
+                        size_t ulNewLength) {
+   unsigned char *pucNew;
+   void *pvNew;
+   size_t ulWant, ulCapacity, ulOffsetInFile;
+   boolean bMapped;
+   int iStatus;
+
+   assert(oNfNode != NULL);
+   assert(ulNewLength >= oNfNode->ulLength);
+   assert(ulNewLength >= ulOffset + ulLength);
+   assert(ulNewLength > 0);
+
+   /* leave room for appends to double the contents in place */
+   ulWant = ulNewLength;
+   if(oNfNode->ulLength <= ((size_t)-1) / 2 &&
+      2 * oNfNode->ulLength > ulWant)
+      ulWant = 2 * oNfNode->ulLength;
+
+   iStatus = NodeF_allocBlock(ulWant, &pvNew, &ulCapacity, &bMapped,
+                              &ulOffsetInFile);
+   if(iStatus != SUCCESS)
+      return iStatus;
+   pucNew = pvNew;
+
+   (void)NodeF_read(oNfNode, 0, pucNew, oNfNode->ulLength);
+   memset(pucNew + oNfNode->ulLength, 0,
+          ulNewLength - oNfNode->ulLength);
+   if(ulLength != 0)
+      memmove(pucNew + ulOffset, pvBuf, ulLength);
+
+   NodeF_releaseContents(oNfNode);
+   oNfNode->pvContents = pucNew;
+   oNfNode->ulLength = ulNewLength;
+   oNfNode->ulCapacity = ulCapacity;
+   oNfNode->bMapped = bMapped;
+   oNfNode->ulOffset = ulOffsetInFile;
+   return SUCCESS;
+}
+
+/*
+  Moves the evictable contents of oNfNode to the backing file, where
+  the operating system can write them back and drop their pages.
+  Returns SUCCESS, or MEMORY_ERROR if the backing file could not be
+  extended.
+*/
+static int NodeF_evict(NodeF_T oNfNode) {
+   void *pvMapped;
+   size_t ulOffset, ulCapacity, ulLength;
+   int iStatus;
+
+   assert(oNfNode != NULL);
+   assert(oNfNode->ulCharged != 0);
+   assert(oNfNode->ulPins == 0);
+
+   ulLength = oNfNode->ulLength;
+   iStatus = Backing_alloc(ulLength, &ulOffset, &ulCapacity);
+   if(iStatus != SUCCESS)
+      return iStatus;
+   pvMapped = Backing_getAddress(ulOffset);
+   (void)NodeF_read(oNfNode, 0, pvMapped, ulLength);
+
+   NodeF_releaseContents(oNfNode);
+   oNfNode->pvContents = pvMapped;
+   oNfNode->ulLength = ulLength;
+   oNfNode->ulCapacity = ulCapacity;
+   oNfNode->bMapped = TRUE;
+   oNfNode->ulOffset = ulOffset;
+   oNfNode->bEvicted = TRUE;
+   return SUCCESS;
+}
+
+/*
+  Evicts the contents of unpinned nodes in clock order until the
+  evictable contents in memory fit the content budget, giving nodes
+  that were used since the hand last passed them a second chance.
+  Stops early if every node left is pinned or cannot be evicted.
+*/
+static void NodeF_enforceBudget(void) {
+   NodeF_T oNfNode;
+   size_t ulScanned = 0;
+
+   if(ulContentBudget == 0)
+      return;
+
+   while(ulResidentBytes > ulContentBudget && oDClock != NULL &&
+         ulScanned <= 2 * DynArray_getLength(oDClock)) {
+      oNfNode = DynArray_get(oDClock, ulClockHand);
+      if(oNfNode->ulPins == 0 && !oNfNode->bReferenced &&
+         NodeF_evict(oNfNode) == SUCCESS) {
+         /* another node has moved into the hand's slot */
+         ulScanned = 0;
+         continue;
+      }
+      oNfNode->bReferenced = FALSE;
+      ulClockHand = (ulClockHand + 1) % DynArray_getLength(oDClock);
+      ulScanned++;
+   }
+}
+
+/*
+  Records a use of owning node oNfNode's contents after they may have
+  changed: sets its reference bit, recharges it, and evicts other
+  contents if the content budget is exceeded.
+*/
+static void NodeF_touch(NodeF_T oNfNode) {
+   assert(oNfNode != NULL);
+   assert(oNfNode->bOwnsContents);
+
+   oNfNode->bReferenced = TRUE;
+   NodeF_recharge(oNfNode);
+
+   /* the node just used is not a candidate */
+   oNfNode->ulPins++;
+   NodeF_enforceBudget();
+   oNfNode->ulPins--;
+}
+
+/*
+  Moves oNfNode's contents back into memory if they were evicted.
+  If there is not enough memory they are left in the backing file,
+  where they can still be used.
+*/
+static void NodeF_faultIn(NodeF_T oNfNode) {
+   void *pvNew;
+   size_t ulCapacity, ulLength;
+
+   assert(oNfNode != NULL);
+
+   if(!oNfNode->bEvicted)
+      return;
+
+   ulLength = oNfNode->ulLength;
+   pvNew = ContentHeap_alloc(ulLength, &ulCapacity);
+   if(pvNew == NULL)
+      return;
+   memcpy(pvNew, oNfNode->pvContents, ulLength);
+
+   NodeF_releaseContents(oNfNode);
+   oNfNode->pvContents = pvNew;
+   oNfNode->ulLength = ulLength;
+   oNfNode->ulCapacity = ulCapacity;
+}
+
+/*
+  Creates a new file node with path oPPath, setting *poNfResult as
+  NodeF_new does. If bOwned is TRUE, the node owns its contents and is
+  allocated with room for inline contents.
+*/
+static int NodeF_create(Path_T oPPath, boolean bOwned,
+                        NodeF_T *poNfResult) {
    NodeF_T oNfNew;   /* New file node to be created */
    Path_T oPNewPath; /* New path of new file node */
+   size_t ulSize;    /* Bytes to allocate for the new node */
    int iStatus;
 
    assert(oPPath != NULL);
@@ -36,7 +531,10 @@ int NodeF_new(Path_T oPPath, NodeF_T *poNfResult) {
    }
 
    /* Allocate mem for new node and check for enough mem */
-   oNfNew = (NodeF_T)malloc(sizeof(struct nodeF));
+   ulSize = sizeof(struct nodeF);
+   if(bOwned)
+      ulSize += NODEF_INLINE_MAX;
+   oNfNew = (NodeF_T)malloc(ulSize);
    if(oNfNew == NULL) {
       *poNfResult = NULL;
       return MEMORY_ERROR;
@@ -54,17 +552,56 @@ int NodeF_new(Path_T oPPath, NodeF_T *poNfResult) {
    /* Set initial values of file contents and size*/
    oNfNew->ulLength = 0;
    oNfNew->pvContents = NULL;
+   oNfNew->bOwnsContents = bOwned;
+   oNfNew->ulCapacity = 0;
+   oNfNew->bMapped = FALSE;
+   oNfNew->ulOffset = 0;
+   oNfNew->oBShared = NULL;
+   oNfNew->oEChunks = NULL;
+   oNfNew->bEvicted = FALSE;
+   oNfNew->bReferenced = FALSE;
+   oNfNew->ulPins = 0;
+   oNfNew->ulCharged = 0;
+   oNfNew->ulClockSlot = 0;
+
+   /* Index the new node by name if the tree is indexed */
+   oNfNew->oNameEntry = NULL;
+   if(NameIndex_isEnabled()) {
+      iStatus = NameIndex_add(oPNewPath, TRUE, oNfNew,
+                              &oNfNew->oNameEntry);
+      if(iStatus != SUCCESS) {
+         Path_free(oPNewPath);
+         free(oNfNew);
+         *poNfResult = NULL;
+         return iStatus;
+      }
+   }
 
    *poNfResult = oNfNew;
 
    return SUCCESS;
 }
 
+/* ================================================================== */
+int NodeF_new(Path_T oPPath, NodeF_T *poNfResult) {
+   return NodeF_create(oPPath, FALSE, poNfResult);
+}
+
+/* ================================================================== */
+int NodeF_newOwned(Path_T oPPath, NodeF_T *poNfResult) {
+   return NodeF_create(oPPath, TRUE, poNfResult);
+}
+
 /* ================================================================== */
 void NodeF_free(NodeF_T oNfNode) {
    assert(oNfNode != NULL);
 
-   /* Remove path */
+   /* Free owned contents; borrowed contents belong to the client */
+   if(oNfNode->bOwnsContents)
+      NodeF_releaseContents(oNfNode);
+   /* Remove from the name index and remove path */
+   if(oNfNode->oNameEntry != NULL)
+      NameIndex_remove(oNfNode->oNameEntry);
    Path_free(oNfNode->oPPath);
    /* Free the actual file node */
    free(oNfNode);
@@ -95,6 +632,16 @@ int NodeF_compareString(const NodeF_T oNfNode1, const char *pcSecond) {
 void *NodeF_getContents(NodeF_T oNfNode) {
    assert(oNfNode != NULL);
 
+   if(!oNfNode->bOwnsContents)
+      return oNfNode->pvContents;
+
+   /* Chunked contents must be made contiguous to be returned */
+   if(oNfNode->oEChunks != NULL)
+      if(NodeF_flatten(oNfNode) != SUCCESS)
+         return NULL;
+
+   NodeF_faultIn(oNfNode);
+   NodeF_touch(oNfNode);
    return oNfNode->pvContents;
 }
 
@@ -109,6 +656,7 @@ size_t NodeF_getLength(NodeF_T oNfNode) {
 void *NodeF_replaceContents(NodeF_T oNfNode, void* pvNewContents) {
    void *pvOldContents;
    assert(oNfNode != NULL);
+   assert(!oNfNode->bOwnsContents);
    /* Record the old contents */
    pvOldContents = oNfNode->pvContents;
    /* Set the new contents */
@@ -120,6 +668,7 @@ void *NodeF_replaceContents(NodeF_T oNfNode, void* pvNewContents) {
 size_t NodeF_replaceLength(NodeF_T oNfNode, size_t ulNewLength) {
    size_t ulOldLength;
    assert(oNfNode != NULL);
+   assert(!oNfNode->bOwnsContents);
 
    /* Record the old length */
    ulOldLength = oNfNode->ulLength;
@@ -128,6 +677,326 @@ size_t NodeF_replaceLength(NodeF_T oNfNode, size_t ulNewLength) {
    return ulOldLength;
 }
 
+/* ================================================================== */
+boolean NodeF_ownsContents(NodeF_T oNfNode) {
+   assert(oNfNode != NULL);
+
+   return oNfNode->bOwnsContents;
+}
+
+/*
+  Does the work of NodeF_setContents, without updating the clock.
+*/
+static int NodeF_storeBytes(NodeF_T oNfNode, const void *pvContents,
+                            size_t ulLength) {
+   void *pvNew;          /* Storage for the new contents */
+   size_t ulCapacity = 0; /* Capacity of pvNew if not inline */
+   boolean bMapped = FALSE; /* Whether pvNew is in the backing file */
+   size_t ulOffset = 0;  /* Offset of pvNew in the backing file */
+   int iStatus;
+
+   assert(oNfNode != NULL);
+   assert(oNfNode->bOwnsContents);
+
+   if(ulLength == 0) {
+      NodeF_releaseContents(oNfNode);
+      return SUCCESS;
+   }
+
+   /* Pick the new storage before releasing the old, since pvContents
+      may point into the old contents */
+   if(ulLength <= NODEF_INLINE_MAX)
+      pvNew = NodeF_getInline(oNfNode);
+   else {
+      iStatus = NodeF_allocBlock(ulLength, &pvNew, &ulCapacity,
+                                 &bMapped, &ulOffset);
+      if(iStatus != SUCCESS)
+         return iStatus;
+   }
+
+   if(pvContents == NULL)
+      memset(pvNew, 0, ulLength);
+   else
+      memmove(pvNew, pvContents, ulLength);
+
+   /* Inline storage is never released, so only a heap block or blob
+      is freed here */
+   NodeF_releaseContents(oNfNode);
+
+   oNfNode->pvContents = pvNew;
+   oNfNode->ulLength = ulLength;
+   oNfNode->ulCapacity = ulCapacity;
+   oNfNode->bMapped = bMapped;
+   oNfNode->ulOffset = ulOffset;
+   return SUCCESS;
+}
+
+/* ================================================================== */
+int NodeF_setContents(NodeF_T oNfNode, const void *pvContents,
+                      size_t ulLength) {
+   int iStatus;
+
+   iStatus = NodeF_storeBytes(oNfNode, pvContents, ulLength);
+   NodeF_touch(oNfNode);
+   return iStatus;
+}
+
+/* ================================================================== */
+int NodeF_setSharedContents(NodeF_T oNfNode, const void *pvContents,
+                            size_t ulLength) {
+   Blob_T oBNew;
+   int iStatus;
+
+   assert(oNfNode != NULL);
+   assert(oNfNode->bOwnsContents);
+
+   /* Empty, zero-filled and inline contents are not worth sharing,
+      and contents big enough for the backing file are not kept in
+      memory at all */
+   if(ulLength <= NODEF_INLINE_MAX || pvContents == NULL ||
+      NodeF_shouldSpill(ulLength))
+      return NodeF_setContents(oNfNode, pvContents, ulLength);
+
+   /* Intern before releasing the old contents, since pvContents may
+      point into them */
+   iStatus = BlobStore_intern(pvContents, ulLength, &oBNew);
+   if(iStatus != SUCCESS)
+      return iStatus;
+
+   NodeF_releaseContents(oNfNode);
+
+   oNfNode->oBShared = oBNew;
+   oNfNode->pvContents = (void *)BlobStore_getBytes(oBNew);
+   oNfNode->ulLength = ulLength;
+   return SUCCESS;
+}
+
+/* ================================================================== */
+int NodeF_copyContents(NodeF_T oNfNode, void **ppvCopy) {
+   size_t ulRead;
+
+   assert(oNfNode != NULL);
+   assert(ppvCopy != NULL);
+
+   if(oNfNode->ulLength == 0 ||
+      (oNfNode->pvContents == NULL && oNfNode->oEChunks == NULL)) {
+      *ppvCopy = NULL;
+      return SUCCESS;
+   }
+
+   *ppvCopy = malloc(oNfNode->ulLength);
+   if(*ppvCopy == NULL)
+      return MEMORY_ERROR;
+   ulRead = NodeF_read(oNfNode, 0, *ppvCopy, oNfNode->ulLength);
+   assert(ulRead == oNfNode->ulLength);
+   return SUCCESS;
+}
+
+/* ================================================================== */
+size_t NodeF_read(NodeF_T oNfNode, size_t ulOffset, void *pvBuf,
+                  size_t ulLength) {
+   assert(oNfNode != NULL);
+   assert(pvBuf != NULL || ulLength == 0);
+
+   oNfNode->bReferenced = TRUE;
+   if(oNfNode->oEChunks != NULL)
+      return Extents_read(oNfNode->oEChunks, ulOffset, pvBuf,
+                          ulLength);
+
+   if(ulOffset >= oNfNode->ulLength)
+      return 0;
+   if(ulLength > oNfNode->ulLength - ulOffset)
+      ulLength = oNfNode->ulLength - ulOffset;
+
+   /* borrowed NULL contents with a nonzero length read as zeros */
+   if(oNfNode->pvContents == NULL)
+      memset(pvBuf, 0, ulLength);
+   else
+      memcpy(pvBuf, (char *)oNfNode->pvContents + ulOffset, ulLength);
+   return ulLength;
+}
+
+/*
+  Does the work of NodeF_write, without updating the clock.
+*/
+static int NodeF_writeBytes(NodeF_T oNfNode, size_t ulOffset,
+                            const void *pvBuf, size_t ulLength) {
+   unsigned char *pucBase;
+   Extents_T oEChunks;
+   size_t ulNewLength;
+   int iStatus;
+
+   assert(oNfNode != NULL);
+   assert(oNfNode->bOwnsContents);
+   assert(pvBuf != NULL || ulLength == 0);
+
+   if(ulLength == 0)
+      return SUCCESS;
+   if(ulOffset + ulLength < ulOffset)
+      return MEMORY_ERROR;
+
+   ulNewLength = ulOffset + ulLength;
+   if(ulNewLength < oNfNode->ulLength)
+      ulNewLength = oNfNode->ulLength;
+
+   if(oNfNode->oEChunks != NULL) {
+      /* Chunks that grow past the spill threshold move to the backing
+         file */
+      if(NodeF_shouldSpill(ulNewLength))
+         return NodeF_regrow(oNfNode, ulOffset, pvBuf, ulLength,
+                             ulNewLength);
+      iStatus = Extents_write(oNfNode->oEChunks, ulOffset, pvBuf,
+                              ulLength);
+      oNfNode->ulLength = Extents_getLength(oNfNode->oEChunks);
+      return iStatus;
+   }
+
+   /* Overwrite in place if the contiguous storage is big enough */
+   if(ulNewLength <= NodeF_getRoom(oNfNode)) {
+      pucBase = NodeF_getWritable(oNfNode);
+      if(ulOffset > oNfNode->ulLength)
+         memset(pucBase + oNfNode->ulLength, 0,
+                ulOffset - oNfNode->ulLength);
+      memmove(pucBase + ulOffset, pvBuf, ulLength);
+      oNfNode->pvContents = pucBase;
+      oNfNode->ulLength = ulNewLength;
+      return SUCCESS;
+   }
+
+   /* Otherwise move to the backing file if big enough */
+   if(NodeF_shouldSpill(ulNewLength))
+      return NodeF_regrow(oNfNode, ulOffset, pvBuf, ulLength,
+                          ulNewLength);
+
+   /* or else switch to chunks, writing before the old contents are
+      freed since pvBuf may point into them */
+   iStatus = NodeF_chunkCopy(oNfNode, &oEChunks);
+   if(iStatus != SUCCESS)
+      return iStatus;
+   iStatus = Extents_write(oEChunks, ulOffset, pvBuf, ulLength);
+   if(iStatus != SUCCESS) {
+      Extents_free(oEChunks);
+      return iStatus;
+   }
+   NodeF_adoptChunks(oNfNode, oEChunks);
+   return SUCCESS;
+}
+
+/* ================================================================== */
+int NodeF_write(NodeF_T oNfNode, size_t ulOffset, const void *pvBuf,
+                size_t ulLength) {
+   int iStatus;
+
+   iStatus = NodeF_writeBytes(oNfNode, ulOffset, pvBuf, ulLength);
+   NodeF_touch(oNfNode);
+   return iStatus;
+}
+
+/*
+  Does the work of NodeF_truncate, without updating the clock.
+*/
+static int NodeF_setLength(NodeF_T oNfNode, size_t ulLength) {
+   unsigned char *pucBase;
+   Extents_T oEChunks;
+   int iStatus;
+
+   assert(oNfNode != NULL);
+   assert(oNfNode->bOwnsContents);
+
+   if(oNfNode->oEChunks != NULL) {
+      if(ulLength > oNfNode->ulLength && NodeF_shouldSpill(ulLength))
+         return NodeF_regrow(oNfNode, 0, NULL, 0, ulLength);
+      iStatus = Extents_truncate(oNfNode->oEChunks, ulLength);
+      oNfNode->ulLength = Extents_getLength(oNfNode->oEChunks);
+      return iStatus;
+   }
+
+   if(ulLength == 0) {
+      NodeF_releaseContents(oNfNode);
+      return SUCCESS;
+   }
+
+   /* Shrinking shared contents copies the kept prefix */
+   if(oNfNode->oBShared != NULL && ulLength <= oNfNode->ulLength)
+      return NodeF_storeBytes(oNfNode, oNfNode->pvContents, ulLength);
+
+   /* Shrink, or grow with zeros, in place if there is room */
+   if(ulLength <= NodeF_getRoom(oNfNode)) {
+      pucBase = NodeF_getWritable(oNfNode);
+      if(ulLength > oNfNode->ulLength)
+         memset(pucBase + oNfNode->ulLength, 0,
+                ulLength - oNfNode->ulLength);
+      oNfNode->pvContents = pucBase;
+      oNfNode->ulLength = ulLength;
+      return SUCCESS;
+   }
+
+   /* Otherwise grow in the backing file or as chunks */
+   if(NodeF_shouldSpill(ulLength))
+      return NodeF_regrow(oNfNode, 0, NULL, 0, ulLength);
+   iStatus = NodeF_chunkCopy(oNfNode, &oEChunks);
+   if(iStatus != SUCCESS)
+      return iStatus;
+   iStatus = Extents_truncate(oEChunks, ulLength);
+   if(iStatus != SUCCESS) {
+      Extents_free(oEChunks);
+      return iStatus;
+   }
+   NodeF_adoptChunks(oNfNode, oEChunks);
+   return SUCCESS;
+}
+
+/* ================================================================== */
+int NodeF_truncate(NodeF_T oNfNode, size_t ulLength) {
+   int iStatus;
+
+   iStatus = NodeF_setLength(oNfNode, ulLength);
+   NodeF_touch(oNfNode);
+   return iStatus;
+}
+
+/* ================================================================== */
+void NodeF_setSpillThreshold(size_t ulThreshold) {
+   ulSpillThreshold = ulThreshold;
+}
+
+/* ================================================================== */
+void NodeF_compactBacking(NodeF_T oNfNode) {
+   size_t ulNewOffset;
+
+   assert(oNfNode != NULL);
+
+   if(oNfNode->ulCapacity == 0 || !oNfNode->bMapped ||
+      oNfNode->ulPins != 0)
+      return;
+
+   ulNewOffset = Backing_relocate(oNfNode->ulOffset,
+                                  oNfNode->ulCapacity);
+   oNfNode->ulOffset = ulNewOffset;
+   oNfNode->pvContents = Backing_getAddress(ulNewOffset);
+}
+
+/* ================================================================== */
+void NodeF_setContentBudget(size_t ulBudget) {
+   ulContentBudget = ulBudget;
+   NodeF_enforceBudget();
+}
+
+/* ================================================================== */
+void NodeF_pin(NodeF_T oNfNode) {
+   assert(oNfNode != NULL);
+
+   oNfNode->ulPins++;
+}
+
+/* ================================================================== */
+void NodeF_unpin(NodeF_T oNfNode) {
+   assert(oNfNode != NULL);
+
+   if(oNfNode->ulPins != 0)
+      oNfNode->ulPins--;
+}
+
 /* ================================================================== */
 char *NodeF_toString(NodeF_T oNfNode) {
    char *copyPath;   /* String representation of oNFNode */
@@ -10,12 +10,15 @@
 #include "a4def.h"
 #include "path.h"
 
+/* Largest contents, in bytes, stored inline in an owning file node */
+enum { NODEF_INLINE_MAX = 48 };
 
 /* A NodeF_T is a node in a Directory Tree */
 typedef struct nodeF *NodeF_T;
 
 /*
-  Creates a new file node in File Tree, with path oPPath. Returns an 
+  Creates a new file node in File Tree, with path oPPath, indexing it
+  by name if the name index is enabled. Returns an 
   int SUCCESS status and sets *poNfResult to be the new node
   if successful. Otherwise, sets *poNfResult to NULL and returns status:
   * MEMORY_ERROR if memory could not be allocated to complete request
@@ -24,8 +27,18 @@ typedef struct nodeF *NodeF_T;
 int NodeF_new(Path_T oPPath, NodeF_T *poNfResult);
 
 /*
-  Destroys and frees memory allocated to file node oNfNode except for
-  its contents because contents are owned by client.
+  Creates a new file node in File Tree, with path oPPath, that owns a
+  copy of its contents rather than borrowing the client's pointer.
+  Contents of up to NODEF_INLINE_MAX bytes are stored inline in the
+  node itself; larger contents are stored in the content heap.
+  Returns and sets *poNfResult as NodeF_new does.
+*/
+int NodeF_newOwned(Path_T oPPath, NodeF_T *poNfResult);
+
+/*
+  Destroys and frees memory allocated to file node oNfNode, removing
+  it from the name index. Contents are freed only if oNfNode owns 
+  them; borrowed contents are owned by the client.
 */
 void NodeF_free(NodeF_T oNfNode);
 
@@ -46,20 +59,129 @@ int NodeF_compare(NodeF_T oNfNode1, NodeF_T oNfNode2);
 */
 int NodeF_compareString(const NodeF_T oNfNode1, const char *pcSecond);
 
-/* Gets and returns the contents of file node oNfNode. */
+/*
+  Gets and returns the contents of file node oNfNode. Owned contents
+  stored as chunks are first moved into contiguous storage; if memory
+  could not be allocated to do so, returns NULL. Owned contents that
+  were evicted to keep within the content budget are moved back into
+  memory if possible, which may evict the contents of other nodes.
+*/
 void *NodeF_getContents(NodeF_T oNfNode);
 
 /* Gets and returns the length of the contents of oNfNode */
 size_t NodeF_getLength(NodeF_T oNfNode);
 
 /* Replaces the current contents of oNfNode with new contents
-  pvNewContents. Returns the old contents. */
+  pvNewContents. Returns the old contents. oNfNode must not own its
+  contents. */
 void *NodeF_replaceContents(NodeF_T oNfNode, void* pvNewContents);
 
 /* Replaces the current length of oNfNode with new length ulNewLength.
-  Returns the old length. */
+  Returns the old length. oNfNode must not own its contents. */
 size_t NodeF_replaceLength(NodeF_T oNfNode, size_t ulNewLength);
 
+/* Returns TRUE if oNfNode owns its contents and FALSE if they are
+  borrowed from the client. */
+boolean NodeF_ownsContents(NodeF_T oNfNode);
+
+/*
+  Copies ulLength bytes from pvContents into the storage owned by
+  oNfNode, replacing (and freeing) its old contents. If pvContents is
+  NULL, the new contents are ulLength zero bytes. pvContents may point
+  into oNfNode's current contents. oNfNode must own its contents.
+  Returns SUCCESS, or MEMORY_ERROR (leaving the old contents in place)
+  if memory could not be allocated to complete request.
+*/
+int NodeF_setContents(NodeF_T oNfNode, const void *pvContents,
+                      size_t ulLength);
+
+/*
+  Sets the contents of oNfNode as NodeF_setContents does, except that
+  contents too big to be stored inline are shared through the blob
+  store with any other files holding the same bytes. Such contents
+  must not be modified through NodeF_getContents.
+  Returns SUCCESS, or MEMORY_ERROR (leaving the old contents in place)
+  if memory could not be allocated to complete request.
+*/
+int NodeF_setSharedContents(NodeF_T oNfNode, const void *pvContents,
+                            size_t ulLength);
+
+/*
+  Returns a copy of oNfNode's contents in *ppvCopy, allocated with
+  malloc and owned by the caller, or NULL if the contents are empty.
+  Returns SUCCESS, or MEMORY_ERROR (setting *ppvCopy to NULL) if
+  memory could not be allocated to complete request.
+*/
+int NodeF_copyContents(NodeF_T oNfNode, void **ppvCopy);
+
+/*
+  Copies up to ulLength bytes of oNfNode's contents, starting at byte
+  ulOffset, into pvBuf. Returns the number of bytes copied, which is
+  less than ulLength only if the end of the contents is reached.
+*/
+size_t NodeF_read(NodeF_T oNfNode, size_t ulOffset, void *pvBuf,
+                  size_t ulLength);
+
+/*
+  Overwrites the ulLength bytes of oNfNode's contents starting at byte
+  ulOffset with the bytes at pvBuf, extending the contents if needed;
+  any gap between the old end and ulOffset is filled with zero bytes.
+  Contents that outgrow their contiguous storage are moved to chunked
+  extents, after which updates cost time proportional to the bytes
+  touched. oNfNode must own its contents.
+  Returns SUCCESS, or MEMORY_ERROR (leaving the contents unchanged) if
+  memory could not be allocated to complete request.
+*/
+int NodeF_write(NodeF_T oNfNode, size_t ulOffset, const void *pvBuf,
+                size_t ulLength);
+
+/*
+  Sets the length of oNfNode's contents to ulLength, discarding bytes
+  past it or extending with zero bytes. oNfNode must own its contents.
+  Returns SUCCESS, or MEMORY_ERROR (leaving the contents unchanged) if
+  memory could not be allocated to complete request.
+*/
+int NodeF_truncate(NodeF_T oNfNode, size_t ulLength);
+
+/*
+  Sets the length, in bytes, from which owned contents are stored in
+  the memory-mapped backing file rather than in memory, or disables
+  the backing file for new contents if ulThreshold is 0. The setting
+  applies to all file nodes.
+*/
+void NodeF_setSpillThreshold(size_t ulThreshold);
+
+/*
+  Moves oNfNode's contents, if they are in the backing file, to the
+  lowest free extent of the file before them that is big enough.
+  This invalidates pointers previously returned by NodeF_getContents.
+  Pinned contents are not moved.
+*/
+void NodeF_compactBacking(NodeF_T oNfNode);
+
+/*
+  Limits the owned contents kept in memory, other than inline and
+  shared contents, to about ulBudget bytes, or removes the limit if
+  ulBudget is 0. Whenever the limit is exceeded, the contents of the
+  least recently used unpinned nodes (as approximated by a clock) are
+  evicted to the backing file, to be moved back into memory when next
+  got with NodeF_getContents. The setting applies to all file nodes.
+*/
+void NodeF_setContentBudget(size_t ulBudget);
+
+/*
+  Pins oNfNode, so that its contents are not evicted or otherwise
+  moved (and a pointer returned by NodeF_getContents stays valid)
+  until the contents are changed or oNfNode is unpinned as many times
+  as it was pinned.
+*/
+void NodeF_pin(NodeF_T oNfNode);
+
+/*
+  Removes one pin from oNfNode, if it has any.
+*/
+void NodeF_unpin(NodeF_T oNfNode);
+
 /*
   Returns a string representation for oNfNode, or NULL if
   there is an allocation error.
@@ -0,0 +1,474 @@
+/*--------------------------------------------------------------------*/
+/* partrav.c                                                          */
+/* Author: Will Huang and George Tziampazis                           */
+/*--------------------------------------------------------------------*/
+
+#define _GNU_SOURCE
+
+#include <stdlib.h>
+#include <assert.h>
+#include <string.h>
+#include <pthread.h>
+#include <sched.h>
+#include <unistd.h>
+#include "dynarray.h"
+#include "partrav.h"
+
+/* Initial capacity of a deque */
+#define MIN_TASKS 64
+
+/* Number of directories each worker of a traversal should have */
+#define DIRS_PER_WORKER 64
+
+/* A directory still to visit */
+struct task {
+   /* the directory */
+   NodeD_T oNdDir;
+   /* the index of the subtree it is in */
+   size_t ulRoot;
+};
+
+/* A worker's deque of tasks */
+struct deque {
+   /* lock taken by the owner and by thieves */
+   pthread_mutex_t sLock;
+   /* tasks ulHead to ulTail - 1 of the ulCapacity in asTasks are 
+      queued; the owner works at the tail and thieves at the head */
+   struct task *asTasks;
+   size_t ulHead;
+   size_t ulTail;
+   size_t ulCapacity;
+};
+
+/* A traversal shared by its workers */
+struct traversal {
+   /* the callbacks */
+   const struct ParTrav_visitor *psVisitor;
+   /* one deque per worker */
+   struct deque *asDeques;
+   size_t ulWorkers;
+   /* number of tasks queued or being done, across all deques */
+   size_t ulPending;
+   /* set once a visitor has asked to stop */
+   int iStopped;
+};
+
+/* The argument of a worker thread */
+struct worker {
+   struct traversal *psTraversal;
+   size_t ulWorker;
+};
+
+/* A set of independent tasks shared by its workers */
+struct taskSet {
+   /* the task and its argument */
+   void (*pfTask)(size_t ulTask, size_t ulWorker, void *pvExtra);
+   void *pvExtra;
+   /* the number of tasks, and that of the next one to claim */
+   size_t ulCount;
+   size_t ulNext;
+};
+
+/* The argument of a worker thread running a set of tasks */
+struct taskWorker {
+   struct taskSet *psSet;
+   size_t ulWorker;
+};
+
+/* Marks *psTraversal as stopped, for every worker to see. */
+static void ParTrav_stop(struct traversal *psTraversal) {
+   assert(psTraversal != NULL);
+
+   (void)__sync_lock_test_and_set(&psTraversal->iStopped, 1);
+}
+
+/* Returns TRUE if *psTraversal has been stopped, and FALSE if not. */
+static boolean ParTrav_isStopped(struct traversal *psTraversal) {
+   assert(psTraversal != NULL);
+
+   return (boolean)(__sync_add_and_fetch(&psTraversal->iStopped, 0) 
+                    != 0);
+}
+
+/*
+  Appends a task for oNdDir in subtree ulRoot to the tail of 
+  *psDeque, growing it if full. Returns SUCCESS, or MEMORY_ERROR if it
+  could not be grown. The caller must hold the deque's lock.
+*/
+static int ParTrav_push(struct deque *psDeque, NodeD_T oNdDir,
+                        size_t ulRoot) {
+   struct task *asNew;
+   size_t ulNewCapacity;
+
+   assert(psDeque != NULL);
+
+   if(psDeque->ulTail == psDeque->ulCapacity) {
+      if(psDeque->ulHead > psDeque->ulCapacity / 2) {
+         /* reuse the room freed at the head by thieves */
+         memmove(psDeque->asTasks, psDeque->asTasks + psDeque->ulHead,
+                 (psDeque->ulTail - psDeque->ulHead) *
+                 sizeof(struct task));
+         psDeque->ulTail -= psDeque->ulHead;
+         psDeque->ulHead = 0;
+      }
+      else {
+         ulNewCapacity = psDeque->ulCapacity == 0 ?
+            MIN_TASKS : psDeque->ulCapacity * 2;
+         asNew = realloc(psDeque->asTasks,
+                         ulNewCapacity * sizeof(struct task));
+         if(asNew == NULL)
+            return MEMORY_ERROR;
+         psDeque->asTasks = asNew;
+         psDeque->ulCapacity = ulNewCapacity;
+      }
+   }
+
+   psDeque->asTasks[psDeque->ulTail].oNdDir = oNdDir;
+   psDeque->asTasks[psDeque->ulTail].ulRoot = ulRoot;
+   psDeque->ulTail++;
+   return SUCCESS;
+}
+
+/*
+  Takes a task from the tail of *psDeque if bOwner, or from its head
+  otherwise, into *psTask. Returns TRUE if there was one, and FALSE
+  if the deque is empty.
+*/
+static boolean ParTrav_take(struct deque *psDeque, boolean bOwner,
+                            struct task *psTask) {
+   boolean bTaken = FALSE;
+
+   assert(psDeque != NULL);
+   assert(psTask != NULL);
+
+   pthread_mutex_lock(&psDeque->sLock);
+   if(psDeque->ulHead < psDeque->ulTail) {
+      if(bOwner)
+         *psTask = psDeque->asTasks[--psDeque->ulTail];
+      else
+         *psTask = psDeque->asTasks[psDeque->ulHead++];
+      if(psDeque->ulHead == psDeque->ulTail)
+         psDeque->ulHead = psDeque->ulTail = 0;
+      bTaken = TRUE;
+   }
+   pthread_mutex_unlock(&psDeque->sLock);
+   return bTaken;
+}
+
+/*
+  Visits oNdDir, in subtree ulRoot, as worker ulWorker of 
+  *psTraversal, and queues its children on the worker's deque. 
+  Children that cannot be queued are visited right away, depth-first.
+*/
+static void ParTrav_visit(struct traversal *psTraversal, 
+                          NodeD_T oNdDir, size_t ulRoot,
+                          size_t ulWorker) {
+   const struct ParTrav_visitor *psVisitor;
+   struct deque *psDeque;
+   enum ParTrav_action eAction;
+   NodeD_T oNdChild = NULL;
+   size_t ulNumChildren;
+   size_t ulQueued;
+   size_t i;
+
+   assert(psTraversal != NULL);
+   assert(oNdDir != NULL);
+
+   psVisitor = psTraversal->psVisitor;
+   eAction = (*psVisitor->pfVisit)(oNdDir, ulRoot, ulWorker,
+                                   psVisitor->pvExtra);
+   if(eAction == PARTRAV_STOP)
+      ParTrav_stop(psTraversal);
+
+   ulNumChildren = eAction == PARTRAV_CONTINUE ?
+      NodeD_getNumDirChildren(oNdDir) : 0;
+   ulQueued = ulNumChildren;
+   if(ulNumChildren > 0) {
+      /* count the children before anyone can take them, so that the
+         traversal never looks finished while they are pending */
+      (void)__sync_add_and_fetch(&psTraversal->ulPending, ulNumChildren);
+
+      /* in reverse, so that the owner takes the first child first */
+      psDeque = &psTraversal->asDeques[ulWorker];
+      pthread_mutex_lock(&psDeque->sLock);
+      for(i = ulNumChildren; i > 0; i--) {
+         (void)NodeD_getDirChild(oNdDir, i - 1, &oNdChild);
+         if(ParTrav_push(psDeque, oNdChild, ulRoot) != SUCCESS)
+            break;
+      }
+      pthread_mutex_unlock(&psDeque->sLock);
+      ulQueued = ulNumChildren - i;
+   }
+
+   /* the children not queued come first in order, so visit them in
+      order before the directory is released */
+   for(i = 0; i < ulNumChildren - ulQueued; i++) {
+      (void)NodeD_getDirChild(oNdDir, i, &oNdChild);
+      ParTrav_visit(psTraversal, oNdChild, ulRoot, ulWorker);
+      (void)__sync_sub_and_fetch(&psTraversal->ulPending, 1);
+   }
+
+   if(psVisitor->pfRelease != NULL)
+      (*psVisitor->pfRelease)(oNdDir, ulRoot, ulWorker,
+                              psVisitor->pvExtra);
+}
+
+/*
+  Traverses the subtree rooted at oNdDir, in subtree ulRoot, 
+  depth-first in the calling thread, as worker 0 of *psTraversal.
+*/
+static void ParTrav_serial(struct traversal *psTraversal, 
+                           NodeD_T oNdDir, size_t ulRoot) {
+   const struct ParTrav_visitor *psVisitor;
+   enum ParTrav_action eAction;
+   NodeD_T oNdChild = NULL;
+   size_t i;
+
+   assert(psTraversal != NULL);
+   assert(oNdDir != NULL);
+
+   psVisitor = psTraversal->psVisitor;
+   eAction = (*psVisitor->pfVisit)(oNdDir, ulRoot, 0,
+                                   psVisitor->pvExtra);
+   if(eAction == PARTRAV_STOP)
+      ParTrav_stop(psTraversal);
+
+   if(eAction == PARTRAV_CONTINUE) {
+      for(i = 0; i < NodeD_getNumDirChildren(oNdDir) &&
+                 !ParTrav_isStopped(psTraversal); i++) {
+         (void)NodeD_getDirChild(oNdDir, i, &oNdChild);
+         ParTrav_serial(psTraversal, oNdChild, ulRoot);
+      }
+   }
+
+   if(psVisitor->pfRelease != NULL)
+      (*psVisitor->pfRelease)(oNdDir, ulRoot, 0, psVisitor->pvExtra);
+}
+
+/*
+  Returns the number of directories in the subtree rooted at oNdDir,
+  counting no more than ulLimit of them.
+*/
+static size_t ParTrav_countDirs(NodeD_T oNdDir, size_t ulLimit) {
+   NodeD_T oNdChild = NULL;
+   size_t ulDirs = 1;
+   size_t i;
+
+   assert(oNdDir != NULL);
+
+   for(i = 0; i < NodeD_getNumDirChildren(oNdDir) && ulDirs < ulLimit;
+       i++) {
+      (void)NodeD_getDirChild(oNdDir, i, &oNdChild);
+      ulDirs += ParTrav_countDirs(oNdChild, ulLimit - ulDirs);
+   }
+   return ulDirs;
+}
+
+/*
+  Runs worker psWorker->ulWorker until no task is pending anywhere or
+  the traversal is stopped. Returns NULL.
+*/
+static void *ParTrav_work(void *pvWorker) {
+   struct worker *psWorker = pvWorker;
+   struct traversal *psTraversal;
+   struct task sTask;
+   size_t ulWorker, ulVictim;
+   size_t i;
+   boolean bFound;
+
+   assert(psWorker != NULL);
+
+   psTraversal = psWorker->psTraversal;
+   ulWorker = psWorker->ulWorker;
+
+   while(!ParTrav_isStopped(psTraversal) &&
+         __sync_add_and_fetch(&psTraversal->ulPending, 0) > 0) {
+      bFound = ParTrav_take(&psTraversal->asDeques[ulWorker], TRUE,
+                            &sTask);
+      /* steal from the others in turn, starting with the next */
+      for(i = 1; !bFound && i < psTraversal->ulWorkers; i++) {
+         ulVictim = (ulWorker + i) % psTraversal->ulWorkers;
+         bFound = ParTrav_take(&psTraversal->asDeques[ulVictim], FALSE,
+                               &sTask);
+      }
+      if(!bFound) {
+         /* the pending tasks are being done; some may add more */
+         sched_yield();
+         continue;
+      }
+
+      ParTrav_visit(psTraversal, sTask.oNdDir, sTask.ulRoot, ulWorker);
+      (void)__sync_sub_and_fetch(&psTraversal->ulPending, 1);
+   }
+   return NULL;
+}
+
+/* ================================================================== */
+size_t ParTrav_getDefaultWorkers(void) {
+   long lProcessors = sysconf(_SC_NPROCESSORS_ONLN);
+
+   return lProcessors > 0 ? (size_t)lProcessors : 1;
+}
+
+/* ================================================================== */
+void ParTrav_run(NodeD_T *aoNdRoots, size_t ulCount, size_t ulWorkers,
+                 const struct ParTrav_visitor *psVisitor) {
+   struct traversal sTraversal;
+   struct worker *asWorkers;
+   pthread_t *aThreads;
+   size_t ulStarted;
+   size_t ulDirs;
+   size_t i;
+
+   assert(aoNdRoots != NULL || ulCount == 0);
+   assert(psVisitor != NULL);
+   assert(psVisitor->pfVisit != NULL);
+
+   if(ulWorkers == 0)
+      ulWorkers = ParTrav_getDefaultWorkers();
+
+   /* a worker with too few directories to visit would only cost a
+      thread, so count up to as many as would keep them all busy */
+   ulDirs = 0;
+   for(i = 0; i < ulCount && ulDirs < ulWorkers * DIRS_PER_WORKER; i++)
+      ulDirs += ParTrav_countDirs(aoNdRoots[i],
+                                  ulWorkers * DIRS_PER_WORKER - ulDirs);
+   if(ulWorkers > ulDirs / DIRS_PER_WORKER)
+      ulWorkers = ulDirs / DIRS_PER_WORKER;
+
+   sTraversal.psVisitor = psVisitor;
+   sTraversal.ulPending = 0;
+   sTraversal.iStopped = 0;
+   sTraversal.ulWorkers = ulWorkers;
+
+   asWorkers = NULL;
+   aThreads = NULL;
+   sTraversal.asDeques = NULL;
+   if(ulWorkers > 1) {
+      asWorkers = malloc(ulWorkers * sizeof(struct worker));
+      aThreads = malloc(ulWorkers * sizeof(pthread_t));
+      sTraversal.asDeques = calloc(ulWorkers, sizeof(struct deque));
+   }
+   if(asWorkers == NULL || aThreads == NULL ||
+      sTraversal.asDeques == NULL) {
+      free(asWorkers);
+      free(aThreads);
+      free(sTraversal.asDeques);
+      /* without a pool, the caller does all the work */
+      for(i = 0; i < ulCount && !ParTrav_isStopped(&sTraversal); i++)
+         ParTrav_serial(&sTraversal, aoNdRoots[i], i);
+      return;
+   }
+
+   for(i = 0; i < ulWorkers; i++) {
+      pthread_mutex_init(&sTraversal.asDeques[i].sLock, NULL);
+      asWorkers[i].psTraversal = &sTraversal;
+      asWorkers[i].ulWorker = i;
+   }
+
+   /* deal the roots out to the workers' deques, as if stolen */
+   for(i = 0; i < ulCount; i++) {
+      sTraversal.ulPending++;
+      if(ParTrav_push(&sTraversal.asDeques[i % ulWorkers],
+                      aoNdRoots[ulCount - 1 - i], ulCount - 1 - i)
+         != SUCCESS) {
+         sTraversal.ulPending--;
+         ParTrav_visit(&sTraversal, aoNdRoots[ulCount - 1 - i],
+                       ulCount - 1 - i, 0);
+      }
+   }
+
+   ulStarted = 1;
+   while(ulStarted < ulWorkers &&
+         pthread_create(&aThreads[ulStarted], NULL, ParTrav_work,
+                        &asWorkers[ulStarted]) == 0)
+      ulStarted++;
+   /* the workers that could not be started are robbed by the others */
+   (void)ParTrav_work(&asWorkers[0]);
+   for(i = 1; i < ulStarted; i++)
+      (void)pthread_join(aThreads[i], NULL);
+
+   for(i = 0; i < ulWorkers; i++) {
+      free(sTraversal.asDeques[i].asTasks);
+      pthread_mutex_destroy(&sTraversal.asDeques[i].sLock);
+   }
+   free(sTraversal.asDeques);
+   free(aThreads);
+   free(asWorkers);
+}
+
+/*
+  Runs the tasks of psWorker->psSet as worker psWorker->ulWorker until
+  all have been claimed. Returns NULL.
+*/
+static void *ParTrav_workTasks(void *pvWorker) {
+   struct taskWorker *psWorker = pvWorker;
+   struct taskSet *psSet;
+   size_t ulTask;
+
+   assert(psWorker != NULL);
+
+   psSet = psWorker->psSet;
+   for(;;) {
+      ulTask = __sync_fetch_and_add(&psSet->ulNext, 1);
+      if(ulTask >= psSet->ulCount)
+         break;
+      (*psSet->pfTask)(ulTask, psWorker->ulWorker, psSet->pvExtra);
+   }
+   return NULL;
+}
+
+/* ================================================================== */
+void ParTrav_runTasks(size_t ulCount, size_t ulWorkers,
+                      void (*pfTask)(size_t ulTask, size_t ulWorker,
+                                     void *pvExtra),
+                      void *pvExtra) {
+   struct taskSet sSet;
+   struct taskWorker *asWorkers;
+   pthread_t *aThreads;
+   size_t ulStarted;
+   size_t i;
+
+   assert(pfTask != NULL);
+
+   if(ulCount == 0)
+      return;
+   if(ulWorkers == 0)
+      ulWorkers = ParTrav_getDefaultWorkers();
+   /* a worker with no task to claim would only cost a thread */
+   if(ulWorkers > ulCount)
+      ulWorkers = ulCount;
+
+   sSet.pfTask = pfTask;
+   sSet.pvExtra = pvExtra;
+   sSet.ulCount = ulCount;
+   sSet.ulNext = 0;
+
+   asWorkers = malloc(ulWorkers * sizeof(struct taskWorker));
+   aThreads = malloc(ulWorkers * sizeof(pthread_t));
+   if(asWorkers == NULL || aThreads == NULL) {
+      free(asWorkers);
+      free(aThreads);
+      /* without a pool, the caller does all the work */
+      for(i = 0; i < ulCount; i++)
+         (*pfTask)(i, 0, pvExtra);
+      return;
+   }
+
+   for(i = 0; i < ulWorkers; i++) {
+      asWorkers[i].psSet = &sSet;
+      asWorkers[i].ulWorker = i;
+   }
+
+   ulStarted = 1;
+   while(ulStarted < ulWorkers &&
+         pthread_create(&aThreads[ulStarted], NULL, ParTrav_workTasks,
+                        &asWorkers[ulStarted]) == 0)
+      ulStarted++;
+   (void)ParTrav_workTasks(&asWorkers[0]);
+   for(i = 1; i < ulStarted; i++)
+      (void)pthread_join(aThreads[i], NULL);
+
+   free(aThreads);
+   free(asWorkers);
+}
@@ -0,0 +1,88 @@
+/*--------------------------------------------------------------------*/
+/* partrav.h                                                          */
+/* Author: Will Huang and George Tziampazis                           */
+/*--------------------------------------------------------------------*/
+
+#ifndef PARTRAV_INCLUDED
+#define PARTRAV_INCLUDED
+
+#include <stddef.h>
+#include "a4def.h"
+#include "noded.h"
+
+/*
+  A parallel traversal visits every directory of one or more subtrees
+  with a pool of worker threads. Each worker keeps a deque of 
+  directories still to visit: it takes the most recently queued one 
+  from its own deque, so that it works depth-first, and when that is
+  empty steals the oldest one, the root of the largest pending 
+  subtree, from another worker's deque.
+*/
+
+/* What a visitor asks for after visiting a directory */
+enum ParTrav_action {
+   /* go on, visiting the directory's children */
+   PARTRAV_CONTINUE,
+   /* go on, but not below the directory */
+   PARTRAV_SKIP,
+   /* end the traversal as soon as possible */
+   PARTRAV_STOP
+};
+
+/* The callbacks of a parallel traversal */
+struct ParTrav_visitor {
+   /*
+     Called once for each directory oNdDir visited, by worker 
+     ulWorker, where ulRoot is the index of the subtree the directory
+     is in. Called concurrently for different directories.
+   */
+   enum ParTrav_action (*pfVisit)(NodeD_T oNdDir, size_t ulRoot,
+                                  size_t ulWorker, void *pvExtra);
+   /*
+     If not NULL, called for each visited directory right after its 
+     children have been queued, after which the traversal does not 
+     use the directory again (so that it may be freed).
+   */
+   void (*pfRelease)(NodeD_T oNdDir, size_t ulRoot, size_t ulWorker,
+                     void *pvExtra);
+   /* passed to both callbacks */
+   void *pvExtra;
+};
+
+/*
+  Returns the number of workers to use when the client asks for 0:
+  the number of processors online.
+*/
+size_t ParTrav_getDefaultWorkers(void);
+
+/*
+  Traverses the ulCount subtrees rooted at the directories in 
+  aoNdRoots with ulWorkers workers (ParTrav_getDefaultWorkers() if 
+  ulWorkers is 0), the calling thread being worker 0, and returns 
+  when every directory has been visited or the traversal was stopped
+  and every worker has finished. Directories are visited in no 
+  particular order, except that a directory is visited before its 
+  children. Once the traversal is stopped, the directories still 
+  queued are neither visited nor released. Fewer workers are used if
+  the subtrees hold too few directories to keep them all busy, all the
+  work being done by the calling thread for small subtrees, or if 
+  threads cannot be created, and a directory that cannot be queued is
+  traversed at once by the worker that visited its parent, so that 
+  the traversal cannot fail.
+*/
+void ParTrav_run(NodeD_T *aoNdRoots, size_t ulCount, size_t ulWorkers,
+                 const struct ParTrav_visitor *psVisitor);
+
+/*
+  Calls (*pfTask)(ulTask, ulWorker, pvExtra) once for each ulTask from
+  0 to ulCount - 1, with up to ulWorkers workers as ParTrav_run does,
+  and returns when every call has returned. Each worker claims the 
+  next task not yet claimed whenever it is done with one, so tasks 
+  are started in order but run concurrently.
+*/
+void ParTrav_runTasks(size_t ulCount, size_t ulWorkers,
+                      void (*pfTask)(size_t ulTask, size_t ulWorker,
+                                     void *pvExtra),
+                      void *pvExtra);
+
+#endif
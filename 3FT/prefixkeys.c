@@ -0,0 +1,438 @@
+/*--------------------------------------------------------------------*/
+/* prefixkeys.c                                                       */
+/* Author: Will Huang and George Tziampazis                           */
+/*--------------------------------------------------------------------*/
+
+#include <stdlib.h>
+#include <string.h>
+#include <limits.h>
+#include <assert.h>
+#include "prefixkeys.h"
+
+/* Hints the processor to start loading the memory at pv into cache */
+#if defined(__GNUC__)
+#define PREFIXKEYS_PREFETCH(pv) __builtin_prefetch(pv)
+#else
+#define PREFIXKEYS_PREFETCH(pv) ((void)(pv))
+#endif
+
+/* The number of key bytes packed into each key */
+enum { PREFIXKEYS_BYTES = sizeof(unsigned long) };
+
+/* The fewest keys that room is kept for */
+enum { PREFIXKEYS_MIN_PHYS = 8 };
+
+/* The keys of a sorted array of elements */
+struct prefixKeys {
+   /* the packed keys, in the order of the elements */
+   unsigned long *aulKeys;
+   /* the number of keys */
+   size_t ulLength;
+   /* the number of keys there is room for in aulKeys */
+   size_t ulPhysLength;
+   /* the function that returns an element's key */
+   const char *(*pfGetKey)(const void *pvElement);
+   /* the number of characters of each key to skip */
+   size_t ulSkip;
+#if defined(PREFIXKEYS_EYTZINGER)
+   /* the packed keys in Eytzinger order, from index 1, or NULL if the
+      layout could not be allocated */
+   unsigned long *aulEytzinger;
+   /* the index in aulKeys of each key in aulEytzinger */
+   size_t *aulRanks;
+   /* the number of keys there is room for in the layout */
+   size_t ulEytzingerPhys;
+   /* TRUE if the keys changed since the layout was built */
+   boolean bStale;
+#endif
+};
+
+/*
+  Returns the first PREFIXKEYS_BYTES characters of the key at pcKey,
+  which ends at its first '\0' or after ulLength characters, packed
+  into an unsigned long with the first character most significant and
+  '\0's after the end.
+*/
+static unsigned long PrefixKeys_pack(const char *pcKey, size_t ulLength) {
+   unsigned long ulPacked = 0;
+   size_t i;
+
+   assert(pcKey != NULL);
+
+   if(ulLength > PREFIXKEYS_BYTES)
+      ulLength = PREFIXKEYS_BYTES;
+   for(i = 0; i < ulLength && pcKey[i] != '\0'; i++)
+      ulPacked = (ulPacked << CHAR_BIT) | (unsigned char)pcKey[i];
+   /* shifting by the whole width at once would be undefined */
+   for(; i < PREFIXKEYS_BYTES; i++)
+      ulPacked <<= CHAR_BIT;
+   return ulPacked;
+}
+
+/* Returns the packed key of pvElement in oKeys. */
+static unsigned long PrefixKeys_packElement(PrefixKeys_T oKeys,
+                                            const void *pvElement) {
+   assert(oKeys != NULL);
+   assert(pvElement != NULL);
+
+   return PrefixKeys_pack((*oKeys->pfGetKey)(pvElement) + oKeys->ulSkip,
+                          PREFIXKEYS_BYTES);
+}
+
+/*
+  Returns the index of the first of the ulCount sorted keys at aulKeys
+  that is not less than ulSought, or ulCount if there is none. The
+  loop runs the same number of times whatever the keys, and picks
+  each half with a conditional move rather than a branch.
+*/
+static size_t PrefixKeys_lowerBound(const unsigned long *aulKeys,
+                                    size_t ulCount,
+                                    unsigned long ulSought) {
+   const unsigned long *pulBase = aulKeys;
+   size_t ulHalf;
+
+   if(ulCount == 0)
+      return 0;
+   while(ulCount > 1) {
+      ulHalf = ulCount / 2;
+      pulBase = (pulBase[ulHalf] < ulSought) ? pulBase + ulHalf : pulBase;
+      ulCount -= ulHalf;
+   }
+   return (size_t)(pulBase - aulKeys) + (*pulBase < ulSought);
+}
+
+#if defined(PREFIXKEYS_EYTZINGER)
+/*
+  Copies oKeys' sorted keys from index ulNext onwards into the subtree
+  of the Eytzinger layout rooted at ulNode, in order. Returns the
+  index of the first sorted key not copied.
+*/
+static size_t PrefixKeys_fillEytzinger(PrefixKeys_T oKeys, size_t ulNext,
+                                       size_t ulNode) {
+   assert(oKeys != NULL);
+
+   if(ulNode > oKeys->ulLength)
+      return ulNext;
+   ulNext = PrefixKeys_fillEytzinger(oKeys, ulNext, 2 * ulNode);
+   oKeys->aulEytzinger[ulNode] = oKeys->aulKeys[ulNext];
+   oKeys->aulRanks[ulNode] = ulNext;
+   ulNext++;
+   return PrefixKeys_fillEytzinger(oKeys, ulNext, 2 * ulNode + 1);
+}
+
+/*
+  Returns the index in the sorted keys of the first key of oKeys that
+  is not less than ulSought, or the number of keys if there is none,
+  searching the Eytzinger layout. Each step goes to a child of the
+  node compared, without branching on which; the descendants four
+  levels down share a couple of cache lines, prefetched in advance.
+*/
+static size_t PrefixKeys_lowerBoundEytzinger(PrefixKeys_T oKeys,
+                                             unsigned long ulSought) {
+   const unsigned long *aulEytzinger;
+   size_t ulNode = 1;
+
+   assert(oKeys != NULL);
+
+   aulEytzinger = oKeys->aulEytzinger;
+   while(ulNode <= oKeys->ulLength) {
+      if(16 * ulNode <= oKeys->ulLength)
+         PREFIXKEYS_PREFETCH(aulEytzinger + 16 * ulNode);
+      ulNode = 2 * ulNode + (aulEytzinger[ulNode] < ulSought);
+   }
+   /* the last node at which the search went left is the answer: undo
+      the right turns after it, and that left turn */
+   while((ulNode & 1) != 0)
+      ulNode >>= 1;
+   ulNode >>= 1;
+   if(ulNode == 0)
+      return oKeys->ulLength;
+   return oKeys->aulRanks[ulNode];
+}
+#endif
+
+/*
+  Returns the index of the first key of oKeys that is not less than
+  ulSought, or the number of keys if there is none.
+*/
+static size_t PrefixKeys_find(PrefixKeys_T oKeys, unsigned long ulSought) {
+   assert(oKeys != NULL);
+
+#if defined(PREFIXKEYS_EYTZINGER)
+   assert(!oKeys->bStale);
+   if(oKeys->aulEytzinger != NULL)
+      return PrefixKeys_lowerBoundEytzinger(oKeys, ulSought);
+#endif
+   return PrefixKeys_lowerBound(oKeys->aulKeys, oKeys->ulLength,
+                                ulSought);
+}
+
+/*
+  Compares the key of pvElement in oKeys with the ulLength characters
+  at pcKey. Returns <0, 0, or >0 as with strcmp.
+*/
+static int PrefixKeys_compareElement(PrefixKeys_T oKeys,
+                                     const void *pvElement,
+                                     const char *pcKey, size_t ulLength) {
+   const char *pcElementKey;
+   int iCmp;
+
+   assert(oKeys != NULL);
+   assert(pvElement != NULL);
+   assert(pcKey != NULL);
+
+   pcElementKey = (*oKeys->pfGetKey)(pvElement) + oKeys->ulSkip;
+   iCmp = strncmp(pcElementKey, pcKey, ulLength);
+   if(iCmp != 0)
+      return iCmp;
+   /* a longer key is greater than its own prefix */
+   return pcElementKey[ulLength] != '\0';
+}
+
+/*
+  Makes room in oKeys for at least ulPhysLength keys. Returns SUCCESS,
+  or MEMORY_ERROR (leaving oKeys unchanged) if memory could not be
+  allocated.
+*/
+static int PrefixKeys_reserve(PrefixKeys_T oKeys, size_t ulPhysLength) {
+   unsigned long *aulKeys;
+   size_t ulNewPhys;
+
+   assert(oKeys != NULL);
+
+   if(ulPhysLength <= oKeys->ulPhysLength)
+      return SUCCESS;
+   ulNewPhys = 2 * oKeys->ulPhysLength;
+   if(ulNewPhys < ulPhysLength)
+      ulNewPhys = ulPhysLength;
+   aulKeys = realloc(oKeys->aulKeys, ulNewPhys * sizeof(unsigned long));
+   if(aulKeys == NULL)
+      return MEMORY_ERROR;
+   oKeys->aulKeys = aulKeys;
+   oKeys->ulPhysLength = ulNewPhys;
+   return SUCCESS;
+}
+
+/* Marks oKeys as changed since it was last laid out. */
+static void PrefixKeys_touch(PrefixKeys_T oKeys) {
+   assert(oKeys != NULL);
+
+#if defined(PREFIXKEYS_EYTZINGER)
+   oKeys->bStale = TRUE;
+#else
+   (void)oKeys;
+#endif
+}
+
+/* ================================================================== */
+PrefixKeys_T PrefixKeys_new(const char *(*pfGetKey)(const void *pvElement),
+                            size_t ulSkip) {
+   PrefixKeys_T oKeys;
+
+   assert(pfGetKey != NULL);
+
+   oKeys = malloc(sizeof(struct prefixKeys));
+   if(oKeys == NULL)
+      return NULL;
+   oKeys->aulKeys = malloc(PREFIXKEYS_MIN_PHYS * sizeof(unsigned long));
+   if(oKeys->aulKeys == NULL) {
+      free(oKeys);
+      return NULL;
+   }
+   oKeys->ulLength = 0;
+   oKeys->ulPhysLength = PREFIXKEYS_MIN_PHYS;
+   oKeys->pfGetKey = pfGetKey;
+   oKeys->ulSkip = ulSkip;
+#if defined(PREFIXKEYS_EYTZINGER)
+   oKeys->aulEytzinger = NULL;
+   oKeys->aulRanks = NULL;
+   oKeys->ulEytzingerPhys = 0;
+   /* with no layout, searches use the sorted keys, all none of them */
+   oKeys->bStale = FALSE;
+#endif
+   return oKeys;
+}
+
+/* ================================================================== */
+void PrefixKeys_free(PrefixKeys_T oKeys) {
+   if(oKeys == NULL)
+      return;
+#if defined(PREFIXKEYS_EYTZINGER)
+   free(oKeys->aulEytzinger);
+   free(oKeys->aulRanks);
+#endif
+   free(oKeys->aulKeys);
+   free(oKeys);
+}
+
+/* ================================================================== */
+size_t PrefixKeys_getLength(PrefixKeys_T oKeys) {
+   assert(oKeys != NULL);
+
+   return oKeys->ulLength;
+}
+
+/* ================================================================== */
+int PrefixKeys_addAt(PrefixKeys_T oKeys, size_t ulIndex,
+                     const void *pvElement) {
+   assert(oKeys != NULL);
+   assert(ulIndex <= oKeys->ulLength);
+   assert(pvElement != NULL);
+
+   if(PrefixKeys_reserve(oKeys, oKeys->ulLength + 1) != SUCCESS)
+      return MEMORY_ERROR;
+   memmove(oKeys->aulKeys + ulIndex + 1, oKeys->aulKeys + ulIndex,
+           (oKeys->ulLength - ulIndex) * sizeof(unsigned long));
+   oKeys->aulKeys[ulIndex] = PrefixKeys_packElement(oKeys, pvElement);
+   oKeys->ulLength++;
+   PrefixKeys_touch(oKeys);
+   return SUCCESS;
+}
+
+/* ================================================================== */
+int PrefixKeys_grow(PrefixKeys_T oKeys, size_t ulCount) {
+   assert(oKeys != NULL);
+
+   if(PrefixKeys_reserve(oKeys, oKeys->ulLength + ulCount) != SUCCESS)
+      return MEMORY_ERROR;
+   /* zero keys keep the array sorted until they are set */
+   memset(oKeys->aulKeys + oKeys->ulLength, 0,
+          ulCount * sizeof(unsigned long));
+   oKeys->ulLength += ulCount;
+   PrefixKeys_touch(oKeys);
+   return SUCCESS;
+}
+
+/* ================================================================== */
+void PrefixKeys_set(PrefixKeys_T oKeys, size_t ulIndex,
+                    const void *pvElement) {
+   assert(oKeys != NULL);
+   assert(ulIndex < oKeys->ulLength);
+   assert(pvElement != NULL);
+
+   oKeys->aulKeys[ulIndex] = PrefixKeys_packElement(oKeys, pvElement);
+   PrefixKeys_touch(oKeys);
+}
+
+/* ================================================================== */
+void PrefixKeys_removeRange(PrefixKeys_T oKeys, size_t ulIndex,
+                            size_t ulCount) {
+   unsigned long *aulKeys;
+   size_t ulNewPhys;
+
+   assert(oKeys != NULL);
+   assert(ulIndex <= oKeys->ulLength);
+   assert(ulCount <= oKeys->ulLength - ulIndex);
+
+   memmove(oKeys->aulKeys + ulIndex, oKeys->aulKeys + ulIndex + ulCount,
+           (oKeys->ulLength - ulIndex - ulCount) * sizeof(unsigned long));
+   oKeys->ulLength -= ulCount;
+   PrefixKeys_touch(oKeys);
+
+   /* give memory back below a quarter full, as the children do */
+   if(oKeys->ulLength >= oKeys->ulPhysLength / 4)
+      return;
+   ulNewPhys = 2 * oKeys->ulLength;
+   if(ulNewPhys < PREFIXKEYS_MIN_PHYS)
+      ulNewPhys = PREFIXKEYS_MIN_PHYS;
+   if(ulNewPhys >= oKeys->ulPhysLength)
+      return;
+   aulKeys = realloc(oKeys->aulKeys, ulNewPhys * sizeof(unsigned long));
+   if(aulKeys == NULL)
+      return;
+   oKeys->aulKeys = aulKeys;
+   oKeys->ulPhysLength = ulNewPhys;
+}
+
+/* ================================================================== */
+void PrefixKeys_layOut(PrefixKeys_T oKeys) {
+#if defined(PREFIXKEYS_EYTZINGER)
+   unsigned long *aulEytzinger;
+   size_t *aulRanks;
+   size_t ulNewPhys;
+
+   assert(oKeys != NULL);
+
+   if(!oKeys->bStale)
+      return;
+   oKeys->bStale = FALSE;
+
+   /* index 0 is unused, so that a node's children are at 2i, 2i + 1 */
+   if(oKeys->ulLength + 1 > oKeys->ulEytzingerPhys) {
+      ulNewPhys = oKeys->ulLength + 1;
+      if(ulNewPhys < 2 * oKeys->ulEytzingerPhys)
+         ulNewPhys = 2 * oKeys->ulEytzingerPhys;
+      aulEytzinger = malloc(ulNewPhys * sizeof(unsigned long));
+      aulRanks = malloc(ulNewPhys * sizeof(size_t));
+      free(oKeys->aulEytzinger);
+      free(oKeys->aulRanks);
+      oKeys->aulEytzinger = aulEytzinger;
+      oKeys->aulRanks = aulRanks;
+      oKeys->ulEytzingerPhys = ulNewPhys;
+      if(aulEytzinger == NULL || aulRanks == NULL) {
+         /* search the sorted keys until a layout can be allocated */
+         free(aulEytzinger);
+         free(aulRanks);
+         oKeys->aulEytzinger = NULL;
+         oKeys->aulRanks = NULL;
+         oKeys->ulEytzingerPhys = 0;
+         return;
+      }
+   }
+   (void)PrefixKeys_fillEytzinger(oKeys, 0, 1);
+#else
+   assert(oKeys != NULL);
+
+   (void)oKeys;
+#endif
+}
+
+/* ================================================================== */
+boolean PrefixKeys_search(PrefixKeys_T oKeys, void **apvElements,
+                          const char *pcKey, size_t ulLength,
+                          size_t *pulIndex) {
+   unsigned long ulSought;
+   size_t ulLo;
+   size_t ulHi;
+   size_t ulMid;
+   int iCmp;
+
+   assert(oKeys != NULL);
+   assert(apvElements != NULL || oKeys->ulLength == 0);
+   assert(pcKey != NULL);
+   assert(pulIndex != NULL);
+
+   ulSought = PrefixKeys_pack(pcKey, ulLength);
+   ulLo = PrefixKeys_find(oKeys, ulSought);
+
+   /* a key shorter than the packed bytes is all there, so equal
+      packed keys are equal keys */
+   if(ulLength < PREFIXKEYS_BYTES) {
+      *pulIndex = ulLo;
+      return (boolean)(ulLo < oKeys->ulLength &&
+                       oKeys->aulKeys[ulLo] == ulSought);
+   }
+
+   /* otherwise, binary search the elements whose packed keys tie */
+   if(ulSought == ULONG_MAX)
+      ulHi = oKeys->ulLength;
+   else
+      ulHi = ulLo + PrefixKeys_lowerBound(oKeys->aulKeys + ulLo,
+                                          oKeys->ulLength - ulLo,
+                                          ulSought + 1);
+   while(ulLo < ulHi) {
+      ulMid = ulLo + (ulHi - ulLo) / 2;
+      iCmp = PrefixKeys_compareElement(oKeys, apvElements[ulMid], pcKey,
+                                       ulLength);
+      if(iCmp == 0) {
+         *pulIndex = ulMid;
+         return TRUE;
+      }
+      if(iCmp < 0)
+         ulLo = ulMid + 1;
+      else
+         ulHi = ulMid;
+   }
+   *pulIndex = ulLo;
+   return FALSE;
+}
@@ -0,0 +1,88 @@
+/*--------------------------------------------------------------------*/
+/* prefixkeys.h                                                       */
+/* Author: Will Huang and George Tziampazis                           */
+/*--------------------------------------------------------------------*/
+
+#ifndef PREFIXKEYS_INCLUDED
+#define PREFIXKEYS_INCLUDED
+
+#include <stddef.h>
+#include "a4def.h"
+
+/*
+  A PrefixKeys_T keeps, next to a sorted array of elements keyed by
+  strings, a contiguous array of fixed-size keys: the first bytes of
+  each element's key, packed into an unsigned long so that they
+  compare as integers in the order strcmp gives. A search compares
+  against these without branching on the outcome, and dereferences
+  elements only among those whose packed bytes tie with the sought
+  key's, which for most keys is none or one. Short keys fit whole and
+  never need an element.
+
+  If built with PREFIXKEYS_EYTZINGER defined, the keys are also laid
+  out in Eytzinger (breadth-first) order, so that the first probes of
+  every search share cache lines and the next ones can be prefetched.
+  That costs rebuilding the layout whenever the keys change, so it
+  suits trees that are built once and searched many times.
+
+  The keys mirror the elements index for index; the client updates
+  them whenever it changes the array, and calls PrefixKeys_layOut
+  after the changes and before the next search.
+*/
+typedef struct prefixKeys *PrefixKeys_T;
+
+/*
+  Returns a new, empty PrefixKeys_T for elements keyed by the strings
+  (*pfGetKey)(pvElement) returns, less their first ulSkip characters,
+  or NULL if memory could not be allocated.
+*/
+PrefixKeys_T PrefixKeys_new(const char *(*pfGetKey)(const void *pvElement),
+                            size_t ulSkip);
+
+/* Frees oKeys. */
+void PrefixKeys_free(PrefixKeys_T oKeys);
+
+/* Returns the number of keys in oKeys. */
+size_t PrefixKeys_getLength(PrefixKeys_T oKeys);
+
+/*
+  Inserts the key of pvElement at index ulIndex, which must not be
+  more than the number of keys. Returns SUCCESS, or MEMORY_ERROR
+  (leaving oKeys unchanged) if memory could not be allocated.
+*/
+int PrefixKeys_addAt(PrefixKeys_T oKeys, size_t ulIndex,
+                     const void *pvElement);
+
+/*
+  Adds ulCount keys to the end of oKeys, to be set with PrefixKeys_set
+  before the next search. Returns SUCCESS, or MEMORY_ERROR (leaving
+  oKeys unchanged) if memory could not be allocated.
+*/
+int PrefixKeys_grow(PrefixKeys_T oKeys, size_t ulCount);
+
+/* Sets the key at index ulIndex to that of pvElement. */
+void PrefixKeys_set(PrefixKeys_T oKeys, size_t ulIndex,
+                    const void *pvElement);
+
+/* Removes the ulCount keys from index ulIndex onwards. */
+void PrefixKeys_removeRange(PrefixKeys_T oKeys, size_t ulIndex,
+                            size_t ulCount);
+
+/*
+  Makes oKeys ready to be searched after changes. Only the Eytzinger
+  layout has any work to do; if memory for it cannot be allocated,
+  searches fall back to the sorted keys.
+*/
+void PrefixKeys_layOut(PrefixKeys_T oKeys);
+
+/*
+  Returns TRUE if the sorted array apvElements, which oKeys mirrors,
+  has an element whose key is the ulLength characters at pcKey, and
+  FALSE if not. Sets *pulIndex to the index of that element, or the
+  index that such an element would have if inserted.
+*/
+boolean PrefixKeys_search(PrefixKeys_T oKeys, void **apvElements,
+                          const char *pcKey, size_t ulLength,
+                          size_t *pulIndex);
+
+#endif
@@ -0,0 +1,162 @@
+/*--------------------------------------------------------------------*/
+/* sortedarray.h                                                      */
+/* Author: Will Huang and George Tziampazis                           */
+/*--------------------------------------------------------------------*/
+
+#ifndef SORTEDARRAY_INCLUDED
+#define SORTEDARRAY_INCLUDED
+
+#include <stddef.h>
+
+/*
+  Generators of search and sort functions specialized for one element
+  type and comparison. DynArray_bsearch and qsort call their
+  comparison through a function pointer on every probe, which the
+  compiler cannot inline; the functions generated here call COMPARE
+  directly, so that a comparison that is a macro or a static function
+  in the same file is compiled into the loop. DynArray_T stays the
+  container for generic use; these work on the arrays of elements
+  themselves, such as a DynArray_T's from DynArray_getArray.
+
+  Each macro expands to a static function definition, so it is used
+  at file scope, once per name, in the file that uses the function.
+*/
+
+/*
+  Defines
+
+     static int NAME(ELEM *aElems, size_t ulCount, KEY key,
+                     size_t *pulIndex)
+
+  which binary searches the ulCount elements at aElems, sorted as
+  determined by COMPARE, for key, as DynArray_bsearch does: if it is
+  found, assigns the index of the element to *pulIndex and returns 1
+  (TRUE), and otherwise assigns the index where it would belong to
+  *pulIndex and returns 0 (FALSE). COMPARE(element, key) returns <0,
+  0, or >0 as the element is "less than", "equal to", or "greater
+  than" key.
+*/
+#define SORTEDARRAY_BSEARCH(NAME, ELEM, KEY, COMPARE)                  \
+static int NAME(ELEM *aElems, size_t ulCount, KEY key,                 \
+                size_t *pulIndex)                                      \
+{                                                                      \
+   size_t ulLo = 0;                                                    \
+   size_t ulHi = ulCount;                                              \
+   size_t ulMid;                                                       \
+   int iCompare;                                                       \
+                                                                       \
+   assert(aElems != NULL || ulCount == 0);                             \
+   assert(pulIndex != NULL);                                           \
+                                                                       \
+   while (ulLo < ulHi)                                                 \
+   {                                                                   \
+      ulMid = ulLo + (ulHi - ulLo) / 2;                                \
+      iCompare = COMPARE(aElems[ulMid], key);                          \
+      if (iCompare == 0)                                               \
+      {                                                                \
+         *pulIndex = ulMid;                                            \
+         return 1;                                                     \
+      }                                                                \
+      if (iCompare < 0)                                                \
+         ulLo = ulMid + 1;                                             \
+      else                                                             \
+         ulHi = ulMid;                                                 \
+   }                                                                   \
+   *pulIndex = ulLo;                                                   \
+   return 0;                                                           \
+}
+
+/* Runs shorter than this are finished by insertion sort. */
+enum { SORTEDARRAY_INSERTION_MAX = 16 };
+
+/*
+  Defines
+
+     static void NAME(ELEM *aElems, size_t ulCount)
+
+  which sorts the ulCount elements at aElems as determined by
+  COMPARE, as qsort does: COMPARE(pElem1, pElem2) is given pointers to
+  two elements and returns <0, 0, or >0 as the first is "less than",
+  "equal to", or "greater than" the second. The sort is a quicksort
+  with median-of-three pivots, finished by insertion sort. It is not
+  stable, and uses stack space logarithmic in ulCount.
+*/
+#define SORTEDARRAY_SORT(NAME, ELEM, COMPARE)                          \
+static void NAME(ELEM *aElems, size_t ulCount)                         \
+{                                                                      \
+   ELEM tTemp;                                                         \
+   size_t ulLo;                                                        \
+   size_t ulHi;                                                        \
+   size_t ulMid;                                                       \
+   size_t i;                                                           \
+   size_t j;                                                           \
+                                                                       \
+   assert(aElems != NULL || ulCount == 0);                             \
+                                                                       \
+   while (ulCount > SORTEDARRAY_INSERTION_MAX)                         \
+   {                                                                   \
+      /* Order the first, middle and last elements, and use the        \
+         middle one as the pivot, parked just before the last. */      \
+      ulLo = 0;                                                        \
+      ulHi = ulCount - 1;                                              \
+      ulMid = ulCount / 2;                                             \
+      if (COMPARE(&aElems[ulMid], &aElems[ulLo]) < 0)                  \
+      {                                                                \
+         tTemp = aElems[ulMid]; aElems[ulMid] = aElems[ulLo];          \
+         aElems[ulLo] = tTemp;                                         \
+      }                                                                \
+      if (COMPARE(&aElems[ulHi], &aElems[ulMid]) < 0)                  \
+      {                                                                \
+         tTemp = aElems[ulHi]; aElems[ulHi] = aElems[ulMid];           \
+         aElems[ulMid] = tTemp;                                        \
+         if (COMPARE(&aElems[ulMid], &aElems[ulLo]) < 0)               \
+         {                                                             \
+            tTemp = aElems[ulMid]; aElems[ulMid] = aElems[ulLo];       \
+            aElems[ulLo] = tTemp;                                      \
+         }                                                             \
+      }                                                                \
+      ulHi--;                                                          \
+      tTemp = aElems[ulMid]; aElems[ulMid] = aElems[ulHi];             \
+      aElems[ulHi] = tTemp;                                            \
+                                                                       \
+      /* Partition the elements between the first and the pivot; the   \
+         first and last are sentinels for the scans. */                \
+      i = ulLo;                                                        \
+      j = ulHi;                                                        \
+      for (;;)                                                         \
+      {                                                                \
+         while (COMPARE(&aElems[++i], &aElems[ulHi]) < 0)              \
+            ;                                                          \
+         while (COMPARE(&aElems[ulHi], &aElems[--j]) < 0)              \
+            ;                                                          \
+         if (i >= j)                                                   \
+            break;                                                     \
+         tTemp = aElems[i]; aElems[i] = aElems[j]; aElems[j] = tTemp;  \
+      }                                                                \
+      tTemp = aElems[i]; aElems[i] = aElems[ulHi];                     \
+      aElems[ulHi] = tTemp;                                            \
+                                                                       \
+      /* Recur into the smaller side and loop on the larger. */        \
+      if (i < ulCount - i - 1)                                         \
+      {                                                                \
+         NAME(aElems, i);                                              \
+         aElems += i + 1;                                              \
+         ulCount -= i + 1;                                             \
+      }                                                                \
+      else                                                             \
+      {                                                                \
+         NAME(aElems + i + 1, ulCount - i - 1);                        \
+         ulCount = i;                                                  \
+      }                                                                \
+   }                                                                   \
+                                                                       \
+   for (i = 1; i < ulCount; i++)                                       \
+   {                                                                   \
+      tTemp = aElems[i];                                               \
+      for (j = i; j > 0 && COMPARE(&tTemp, &aElems[j - 1]) < 0; j--)   \
+         aElems[j] = aElems[j - 1];                                    \
+      aElems[j] = tTemp;                                               \
+   }                                                                   \
+}
+
+#endif